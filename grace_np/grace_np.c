@@ -52,6 +52,7 @@
 /* static global variables */
 static char* buf = NULL;               /* global write buffer */
 static int bufsize;                    /* size of the global write buffer */
+static int buflen = 0;                 /* number of bytes waiting in it */
 static int bufsizeforce;               /* threshold for forcing a flush */
 static int fd_pipe = -1;               /* file descriptor of the pipe */
 static pid_t pid = (pid_t) -1;         /* pid of grace */
@@ -124,6 +125,7 @@ GraceCleanup(void)
     
     free(buf);
     buf = NULL;
+    buflen = 0;
 }
 
 /*
@@ -141,16 +143,14 @@ GraceOneWrite(int left)
         left -= written;
 
         if (left > 0) {
-            /* move the remaining characters (and the final '\0') */
+            /* move the remaining bytes */
 #ifdef HAVE_MEMMOVE
-            memmove(buf, buf + written, left + 1);
+            memmove(buf, buf + written, left);
 #else
-            bcopy(buf + written, buf, left + 1);
+            bcopy(buf + written, buf, left);
 #endif
-        } else {
-            /* clear the buffer */
-            *buf = '\0';
         }
+        buflen = left;
 
     } else if (written < 0) {
         if (errno == EPIPE) {
@@ -291,7 +291,7 @@ GraceOpenVA(char* exe, int bs, ...)
         close(fd[1]);
         return (-1);
     }
-    *buf = '\0';
+    buflen = 0;
 
     close(fd[0]);
     fd_pipe = fd[1];
@@ -358,7 +358,7 @@ GraceFlush(void)
         return (-1);
     }
 
-    left = strlen(buf);
+    left = buflen;
 
     for (loop = 0; loop < 30; loop++) {
         left = GraceOneWrite(left);
@@ -411,7 +411,7 @@ GracePrintf(const char* fmt, ...)
 int
 GraceCommand(const char* cmd)
 {
-    int left;
+    int left, len;
     
     if (fd_pipe == -1) {
         error_function("No grace subprocess");
@@ -419,16 +419,17 @@ GraceCommand(const char* cmd)
     }
 
     /* Append the new string to the global write buffer */
-    if (strlen(buf) + strlen(cmd) + 2 > bufsize) {
+    len = strlen(cmd);
+    if (buflen + len + 1 > bufsize) {
         error_function("GraceCommand: Buffer full");
         return (-1);
     }
-    strcat(buf, cmd);
-    strcat(buf, "\n");
-    left = strlen(buf);
+    memcpy(buf + buflen, cmd, len);
+    buflen += len;
+    buf[buflen++] = '\n';
     
     /* Try to send the global write buffer to grace */
-    left = GraceOneWrite(left);
+    left = GraceOneWrite(buflen);
     if (left >= bufsizeforce) {
         if (GraceFlush() != 0) {
             return (-1);
@@ -439,3 +440,121 @@ GraceCommand(const char* cmd)
 
     return (0);
 }
+
+/*
+ * send data to grace bypassing the buffer (which must be empty)
+ */
+static int
+GraceWriteAll(const void *data, int len)
+{
+    const char *p = data;
+    int written;
+
+    while (len > 0) {
+        written = write(fd_pipe, p, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EPIPE) {
+                /* Grace has closed the pipe : we cannot write anymore */
+                GraceCleanup();
+            } else {
+                GracePerror("GraceWriteAll");
+            }
+            return (-1);
+        }
+        p   += written;
+        len -= written;
+    }
+
+    return (0);
+}
+
+/* send a single binary frame, see the description in grace's src/files.c */
+static int
+GraceAppendFrame(const char* set, int idlen, int ncols, int nrows,
+                 const double* data)
+{
+    unsigned char header[8];
+    int datalen, framelen, left;
+
+    datalen  = ncols*nrows*sizeof(double);
+    framelen = sizeof(header) + idlen + datalen;
+
+    header[0] = 1;
+    header[1] = idlen;
+    header[2] = ncols & 0xff;
+    header[3] = (ncols >> 8) & 0xff;
+    header[4] = nrows & 0xff;
+    header[5] = (nrows >> 8) & 0xff;
+    header[6] = (nrows >> 16) & 0xff;
+    header[7] = (nrows >> 24) & 0xff;
+
+    if (buflen + framelen > bufsize) {
+        /* make room, or keep the order before bypassing the buffer */
+        if (GraceFlush() != 0) {
+            return (-1);
+        }
+    }
+    
+    if (framelen > bufsize) {
+        /* too large to be buffered */
+        if (GraceWriteAll(header, sizeof(header)) != 0 ||
+            GraceWriteAll(set, idlen) != 0 ||
+            GraceWriteAll(data, datalen) != 0) {
+            return (-1);
+        }
+        return (0);
+    }
+    
+    memcpy(buf + buflen, header, sizeof(header));
+    buflen += sizeof(header);
+    memcpy(buf + buflen, set, idlen);
+    buflen += idlen;
+    memcpy(buf + buflen, data, datalen);
+    buflen += datalen;
+    
+    /* Try to send the global write buffer to grace */
+    left = GraceOneWrite(buflen);
+    if (left >= bufsizeforce) {
+        if (GraceFlush() != 0) {
+            return (-1);
+        }
+    } else if (left < 0) {
+        return (-1);
+    }
+
+    return (0);
+}
+
+int
+GraceAppendData(const char* set, int ncols, int nrows, const double* data)
+{
+    int idlen, maxrows, n;
+
+    if (fd_pipe == -1) {
+        error_function("No grace subprocess");
+        return (-1);
+    }
+
+    idlen = strlen(set);
+    if (idlen < 1 || idlen > 255 ||
+        ncols < 1 || ncols > GRACE_APPEND_MAX_COLS || nrows < 0) {
+        error_function("GraceAppendData: Wrong arguments");
+        return (-1);
+    }
+
+    /* grace rejects larger frames, so big blocks go in several of them */
+    maxrows = GRACE_APPEND_MAX_FRAME/(ncols*(int) sizeof(double));
+    while (nrows > 0) {
+        n = (nrows > maxrows) ? maxrows : nrows;
+        if (GraceAppendFrame(set, idlen, ncols, n, data) != 0) {
+            return (-1);
+        }
+        data  += n*ncols;
+        nrows -= n;
+    }
+
+    return (0);
+}
@@ -58,6 +58,17 @@ int GracePrintf(const char*, ...);
 /* send an already formated command to the grace subprocess */
 int GraceCommand(const char*);
 
+/* limits of the binary frames read by grace (see its src/files.c):
+   the number of values per row and the size of the data in one frame */
+#define GRACE_APPEND_MAX_COLS   6
+#define GRACE_APPEND_MAX_FRAME  (16*1024*1024)
+
+/* append nrows rows of ncols values (stored row after row) to a set
+   of the grace subprocess, given by its idstr path (e.g. "G0.S1"),
+   without formatting them as text; ncols may not exceed
+   GRACE_APPEND_MAX_COLS, larger blocks are sent in several frames */
+int GraceAppendData(const char* set, int ncols, int nrows, const double* data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -85,6 +85,7 @@ char *concat_strings(char *dest, const char *src);
 
 #define AMEM_MODEL_SIMPLE   0
 #define AMEM_MODEL_LIBUNDO  1
+#define AMEM_MODEL_COW      2
 
 /* advanced memory allocation & friends */
 typedef struct _AMem AMem;
@@ -97,6 +98,8 @@ void amem_free(AMem *amem, void *ptr);
 # define AMEM_CFREE(amem, ptr) amem_free(amem, ptr); ptr = NULL
 
 int amem_set_undo_limit(AMem *amem, size_t max_memory);
+size_t amem_get_history_size(AMem *amem);
+void amem_touch(AMem *amem, const void *ptr);
 
 int amem_snapshot(AMem *amem);
 int amem_undo(AMem *amem);
@@ -135,6 +138,8 @@ void grfile_free(GrFILE *grf);
 GrFILE *grfile_openr(const char *fname);
 GrFILE *grfile_openw(const char *fname);
 int grfile_close(GrFILE *grf);
+void *grfile_map(GrFILE *grf, size_t *len);
+void grfile_unmap(void *addr, size_t len);
 time_t grfile_get_mtime(const GrFILE *grf);
 
 /* dates */
@@ -169,10 +174,22 @@ int isoneof(int c, char *s);
 /* locale */
 int init_locale(void);
 void set_locale_num(int flag);
+char *localize_decimal_point(char *s, size_t size);
 int is_locale_utf8(void);
 
 int get_hostname(char *name, size_t len);
 
+/* parallel execution */
+typedef void (*ParallelProc)(unsigned int job, unsigned int njobs, void *udata);
+
+unsigned int parallel_get_nthreads(void);
+void parallel_set_nthreads(unsigned int nthreads);
+int parallel_run(unsigned int njobs, ParallelProc proc, void *udata);
+
+/* sorting */
+int dsort_index(const double *keys, unsigned int n, int descending,
+    unsigned int *ind);
+
 /* dict3 stuff */
 typedef struct {
     int key;     /* key */
@@ -265,6 +282,8 @@ typedef struct _LLNode {
     struct _LLNode *next;
     struct _LLNode *prev;
     void *data;
+    int id;                     /* position in the list */
+    struct _LLNode *hnext;      /* next node in the same hash bucket */
 } LLNode;
 
 typedef struct _Storage {
@@ -276,6 +295,11 @@ typedef struct _Storage {
     Storage_data_free data_free;
     Storage_data_copy data_copy;
     Storage_exception_handler exception_handler;
+    
+    LLNode **index;             /* the nodes in list order */
+    int nalloc;
+    LLNode **buckets;           /* data pointer -> node hash */
+    unsigned int nbuckets;
 } Storage;
 
 typedef int (*Storage_traverse_hook)(unsigned int step, void *data, void *udata); 
@@ -279,6 +279,15 @@ typedef void (*DevPutTextProc)(const Canvas *canvas, void *data,
     const VPoint *vp, const char *s, int len, int font, const TextMatrix *tm,
     int underline, int overline, int kerning);
 
+/* start defining symbol id; bbox is its extent around the origin */
+typedef void (*DevBeginSymbolProc)(const Canvas *canvas, void *data,
+    int id, const view *bbox);
+/* finish the symbol definition */
+typedef void (*DevEndSymbolProc)(const Canvas *canvas, void *data);
+/* stamp a defined symbol with its origin at vp */
+typedef void (*DevPutSymbolProc)(const Canvas *canvas, void *data,
+    int id, const VPoint *vp);
+
 /* drawing procedure */
 typedef void (*CanvasDrawProc)(Canvas *canvas, void *data);
 
@@ -364,6 +373,11 @@ typedef struct {
     DevPutPixmapProc     putpixmap;
     DevPutTextProc       puttext;
     
+    /* optional symbol instancing */
+    DevBeginSymbolProc   beginsymbol;
+    DevEndSymbolProc     endsymbol;
+    DevPutSymbolProc     putsymbol;
+    
     void                 *devdata;         /* device private data */
     DevFreeDataProc      freedata;         /* freeing private data */
     
@@ -442,6 +456,8 @@ void canvas_set_linewidth_scale(Canvas *canvas, double lscale);
 
 void canvas_set_pagefill(Canvas *canvas, int flag);
 
+void canvas_set_update_region(Canvas *canvas, const view *v);
+
 void setclipping(Canvas *canvas, int flag);
 int canvas_set_clipview(Canvas *canvas, const view *v);
 
@@ -495,8 +511,11 @@ void update_bbox(Canvas *canvas, int type, const VPoint *vp);
 int melt_bbox(Canvas *canvas, int type);
 void activate_bbox(Canvas *canvas, int type, int status);
 
+void view_invalidate(view *v);
+int is_valid_bbox(const view *v);
 int view_extend(view *v, double w);
 int merge_bboxes(const view *v1, const view *v2, view *v);
+int views_overlap(const view *v1, const view *v2);
 void vpswap(VPoint *vp1, VPoint *vp2);
 int VPoints2bbox(const VPoint *vp1, const VPoint *vp2, view *bb);
 
@@ -521,6 +540,7 @@ int set_page_geometry(Canvas *canvas, const Page_geometry *pg);
 
 int get_device_page_dimensions(const Canvas *canvas,
     unsigned int dindex, int *wpp, int *hpp);
+double get_page_scale(const Canvas *canvas);
 
 int get_device_by_name(const Canvas *canvas, const char *dname);
 
@@ -529,16 +549,27 @@ int parse_device_options(Canvas *canvas, unsigned int dindex, char *options);
 int number_of_devices(const Canvas *canvas);
 
 int terminal_device(const Canvas *canvas);
+int raster_device(const Canvas *canvas);
 int device_is_aux(const Canvas *canvas, unsigned int dindex);
 int device_set_aux(const Canvas *canvas, unsigned int dindex);
 
 PageFormat get_page_format(const Canvas *canvas, int device);
 
 int canvas_draw(Canvas *canvas, CanvasDrawProc dproc, void *data);
+int canvas_measure(Canvas *canvas,
+    CanvasDrawProc dproc, void *data, view *bbox);
+
+int canvas_symbol_define(Canvas *canvas, CanvasDrawProc dproc, void *data);
+void canvas_symbol_put(Canvas *canvas, int id, const VPoint *vp);
 
 int get_string_bbox(Canvas *canvas,
     const VPoint *vp, double angle, int just, const char *s, view *bbox);
 
+int canvas_set_glyph_cache_size(Canvas *canvas, unsigned long maxsize);
+void canvas_flush_glyph_cache(Canvas *canvas);
+void canvas_get_glyph_cache_stats(const Canvas *canvas,
+    unsigned long *hits, unsigned long *misses, unsigned long *size);
+
 CPixmap *canvas_raster_char(Canvas *canvas,
     int font, char c, float size, int *vshift, int *hshift);
 void canvas_cpixmap_free(CPixmap *pm);
@@ -605,12 +636,17 @@ int device_set_procs(Device_entry *d,
     DevFillArcProc       fillarc,
     DevPutPixmapProc     putpixmap,
     DevPutTextProc       puttext);
+int device_set_symbol_procs(Device_entry *d,
+    DevBeginSymbolProc   beginsymbol,
+    DevEndSymbolProc     endsymbol,
+    DevPutSymbolProc     putsymbol);
 int device_set_fext(Device_entry *d, const char *fext);
 int device_set_autocrop(Device_entry *d, int autocrop);
 int device_set_fontrast(Device_entry *d, FontRaster fontrast);
 int device_set_dpi(Device_entry *d, float dpi);
 
 Page_geometry *get_page_geometry(const Canvas *canvas);
+int canvas_get_update_region(const Canvas *canvas, view *v);
 
 int register_device(Canvas *canvas, Device_entry *d);
 
@@ -635,6 +671,23 @@ double *get_kerning_vector(const Canvas *canvas,
 
 void *device_get_devdata(const Canvas *canvas, unsigned int dindex);
 
+/* buffered output for the vector drivers */
+#define OUTBUF_SIZE 8192
+
+typedef struct {
+    FILE *fp;
+    unsigned int len;
+    char buf[OUTBUF_SIZE];
+} OutBuf;
+
+void outbuf_init(OutBuf *ob, FILE *fp);
+void outbuf_flush(OutBuf *ob);
+void outbuf_puts(OutBuf *ob, const char *s);
+void outbuf_putc(OutBuf *ob, char c);
+int outbuf_round(double v, int prec, long *n);
+void outbuf_putf(OutBuf *ob, double v, int width, int prec);
+void outbuf_putfixed(OutBuf *ob, long n, int prec, int compact);
+
 
 /* PostScript/EPS driver */
 #define PS_FORMAT   0
@@ -711,6 +764,9 @@ typedef struct {
 
     int             *font_ids;
     int             *pattern_ids;
+    int             *symbol_ids;
+    view            *symbol_bboxes;
+    unsigned int     nsymbols;
 
     int              color;
     int              pattern;
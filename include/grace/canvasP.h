@@ -52,6 +52,12 @@
 #define T1_AALEVELS_LOW   5
 #define T1_AALEVELS_HIGH 17
 
+/* default memory limit of the rasterized glyph cache */
+#define GLYPH_CACHE_DEFAULT_SIZE    (8*1024*1024)
+
+/* memory limit of the display list of two-pass devices */
+#define DISPLAY_LIST_MAX_SIZE       (256*1024*1024)
+
 #define fRGB2fSRGB(c) (c <= 0.0031308 ? 12.92*c:1.055*pow(c, 1.0/2.4) - 0.055)
 
 /* Drawing properties */
@@ -67,10 +73,26 @@ typedef struct {
     int fillrule;
 } DrawProps;
 
+/* font info strings, copied from T1lib on demand */
+typedef enum {
+    FONT_INFO_NAME,
+    FONT_INFO_FULLNAME,
+    FONT_INFO_FAMILYNAME,
+    FONT_INFO_WEIGHT,
+    FONT_INFO_ENCSCHEME,
+    FONT_INFO_FILENAME,
+    FONT_INFO_FILEPATH,
+    FONT_INFO_AFMNAME,
+    FONT_INFO_AFMPATH,
+    FONT_INFO_NITEMS
+} FontInfoItem;
+
 typedef struct {
     char *alias;
     char used;
     char chars_used[256];
+    char *info[FONT_INFO_NITEMS];
+    char **charnames;
 } FontDB;
 
 typedef struct {
@@ -85,6 +107,10 @@ typedef struct _CSGlyphCache {
     GLYPH *glyph;
 } CSGlyphCache;
 
+typedef struct _GlyphCache GlyphCache;
+
+typedef struct _DisplayList DisplayList;
+
 /* Canvas */
 struct _Canvas {
     /* drawing properties */
@@ -116,6 +142,9 @@ struct _Canvas {
     
     int draw_mode;
     int drypass;
+    
+    /* part of the page to be redrawn; invalid means the whole page */
+    view update_region;
 
     BBox_type bboxes[2];
 
@@ -157,6 +186,16 @@ struct _Canvas {
     unsigned long aacolors_low[T1_AALEVELS_LOW];
     int aacolors_high_ok;
     unsigned long aacolors_high[T1_AALEVELS_HIGH];
+    
+    /* rasterized strings kept across redraws */
+    GlyphCache *gcache;
+    
+    /* display list being recorded, if any */
+    DisplayList *dlist;
+    
+    /* extents of the symbols defined in the current pass */
+    unsigned int nsymbols;
+    view *symbols;
 };
 
 int clip_line(const Canvas *canvas,
@@ -181,7 +220,6 @@ void canvas_stats_reset(Canvas *canvas);
 int initgraphics(Canvas *canvas, const CanvasStats *cstats);
 void leavegraphics(Canvas *canvas, const CanvasStats *cstats);
 
-int is_valid_bbox(const view *v);
 
 void reset_bboxes(Canvas *canvas);
 void update_bboxes(Canvas *canvas, const VPoint *vp);
@@ -203,6 +241,32 @@ int canvas_set_pattern(Canvas *canvas, unsigned int n, const Pattern *pat);
 int canvas_set_linestyle(Canvas *canvas, unsigned int n, const LineStyle *ls);
 
 int init_t1(void);
+void font_db_entry_free(FontDB *f);
+GlyphCache *glyph_cache_new(unsigned long maxsize);
+void glyph_cache_free(GlyphCache *gcache);
+
+DisplayList *dlist_new(unsigned long maxsize);
+void dlist_free(DisplayList *dl);
+void dlist_add_pixel(DisplayList *dl, const DrawProps *dp, const VPoint *vp);
+void dlist_add_polyline(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vps, int n, int mode);
+void dlist_add_fillpolygon(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vps, int nc);
+void dlist_add_arc(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vp1, const VPoint *vp2, double a1, double a2, int fill,
+    int mode);
+void dlist_add_pixmap(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vp, const CPixmap *pm);
+void dlist_add_text(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vp, const char *s, int len, int font, const TextMatrix *tm,
+    int underline, int overline, int kerning);
+void dlist_add_symbol_begin(DisplayList *dl, const DrawProps *dp,
+    int id, const view *bbox);
+void dlist_add_symbol_end(DisplayList *dl, const DrawProps *dp);
+void dlist_add_symbol_put(DisplayList *dl, const DrawProps *dp,
+    int id, const VPoint *vp);
+int dlist_is_complete(const DisplayList *dl);
+void dlist_replay(Canvas *canvas, const DisplayList *dl);
 void initialize_patterns(Canvas *canvas);
 void initialize_linestyles(Canvas *canvas);
 
@@ -35,6 +35,7 @@
 #define QUARK_ETYPE_DELETE 2
 #define QUARK_ETYPE_MODIFY 3
 #define QUARK_ETYPE_MOVE   4
+#define QUARK_ETYPE_COMMIT 5
 
 /*
  * axis types
@@ -154,6 +155,7 @@ typedef struct _Quark Quark;
 typedef void  (*Quark_data_free)(AMem *amem, void *data); 
 typedef void *(*Quark_data_new)(AMem *amem); 
 typedef void *(*Quark_data_copy)(AMem *amem, void *data); 
+typedef void  (*Quark_data_touch)(AMem *amem, void *data); 
 
 typedef int (*Quark_cb)(Quark *q, int etype, void *data); 
 
@@ -164,6 +166,7 @@ typedef struct _QuarkFlavor {
     Quark_data_new  data_new;
     Quark_data_free data_free;
     Quark_data_copy data_copy;
+    Quark_data_touch data_touch; /* optional; marks blocks the data point to */
 } QuarkFlavor;
 
 typedef struct {
@@ -406,6 +409,15 @@ typedef struct {
     double fyg_med;
 } ctrans_cache;
 
+/* coordinate transform of a graph, resolved once for bulk conversions */
+typedef struct {
+    int coordinates;            /* COORDINATES_XY or COORDINATES_POLAR */
+    int xscale;                 /* scale mapping of X axes */
+    int yscale;                 /* scale mapping of Y axes */
+    world w;                    /* world bounds */
+    ctrans_cache cc;            /* cached transform coefficients */
+} ctrans_data;
+
 /*
  * a graph
  */
@@ -731,6 +743,7 @@ void quark_dirtystate_set(Quark *q, int flag);
 int quark_dirtystate_get(const Quark *q);
 
 unsigned int quark_get_statestamp(const Quark *q);
+unsigned int quark_get_ownstamp(const Quark *q);
 
 int quark_idstr_set(Quark *q, const char *s);
 char *quark_idstr_get(const Quark *q);
@@ -771,6 +784,10 @@ void *quark_get_udata(const Quark *q);
 int quark_is_first_child(const Quark *q);
 int quark_is_last_child(const Quark *q);
 
+void quark_transaction_begin(void);
+int quark_transaction_commit(void);
+int quark_transaction_active(void);
+
 /* Container */
 Quark *container_new(QuarkFactory *qfactory, int mmodel);
 
@@ -816,10 +833,26 @@ int project_get_color_by_name(const Quark *project, const char *name);
 #define FFORMAT_STRING   1
 #define FFORMAT_DATE     2
 
+/* summary statistics of a numerical column */
+typedef struct {
+    int valid;
+    unsigned int stamp;         /* statestamp of the SSD they belong to */
+    double min, max;            /* NaNs excluded */
+    unsigned int imin, imax;
+    double sum, sum2;
+    unsigned int nnan;
+    int mono;                   /* monotonicity(..., FALSE) */
+    int smono;                  /* monotonicity(..., TRUE) */
+    int monospaced;
+    double spacing;
+} ss_colstats;
+
 typedef struct {
     int format;
     char *label;
     void *data;
+    const void *mapped;         /* not yet loaded block of a binary project */
+    ss_colstats stats;          /* cached, see ssd_get_col_stats() */
 } ss_column;
 
 /* Spread-sheet data */
@@ -842,6 +875,9 @@ Quark *ssd_new(Quark *q);
 unsigned int ssd_get_ncols(const Quark *q);
 unsigned int ssd_get_nrows(const Quark *q);
 ss_column *ssd_get_col(const Quark *q, int col);
+int ssd_fetch_data(const Quark *q);
+const ss_colstats *ssd_get_col_stats(const Quark *q, int column);
+int ssd_set_col_mapped(Quark *q, int column, const void *block);
 int ssd_get_col_format(const Quark *q, int col);
 char *ssd_get_col_label(const Quark *q, int col);
 
@@ -851,9 +887,13 @@ int ssd_set_nrows(Quark *q, unsigned int nrows);
 int ssd_set_ncols(Quark *q, unsigned int ncols, const int *formats);
 
 ss_column *ssd_add_col(Quark *q, int format);
+ss_column *ssd_add_col_unloaded(Quark *q);
 int ssd_delete_col(Quark *q, int column);
 int ssd_delete_rows(Quark *q, unsigned int startno, unsigned int endno);
+int ssd_compact_rows(Quark *q, const char *keep);
 int ssd_reverse(Quark *q);
+int ssd_permute_rows(Quark *q, const unsigned int *ind);
+int ssd_sort(Quark *q, int sorton, int descending);
 int ssd_coalesce(Quark *toq, Quark *fromq);
 int ssd_transpose(Quark *q);
 
@@ -877,6 +917,10 @@ int ssd_get_hotlink_src(const Quark *q);
 
 Quark *get_parent_ssd(const Quark *q);
 
+int ssd_get_lod_indices(const Quark *q, int xcol, int ycol,
+    const double *xedges, unsigned int nedges,
+    unsigned int **indices, unsigned int *nindices);
+
 /* Frame */
 frame *frame_get_data(const Quark *q);
 
@@ -992,11 +1036,14 @@ int set_set_avalue(Quark *pset, const AValue *av);
 int set_set_errbar(Quark *pset, const Errbar *ebar);
 
 int set_set_length(Quark *p, unsigned int length);
+int set_append_rows(Quark *pset,
+    unsigned int ncols, unsigned int nrows, const double *data);
 int set_get_length(Quark *p);
 
 int set_get_ncols(const Quark *pset);
 
 double *set_get_col(Quark *p, unsigned int col);
+const ss_colstats *set_get_col_stats(Quark *pset, unsigned int col);
 void *set_get_acol(Quark *pset, int *format);
 
 int quark_get_number_of_descendant_sets(Quark *q);
@@ -1006,6 +1053,8 @@ int set_is_dataless(Quark *pset);
 
 #define set_is_drawable(p) (quark_is_active(p) && !set_is_dataless(p))
 
+int set_get_monotonicity(Quark *pset, unsigned int col, int strict);
+int set_is_monospaced(Quark *pset, unsigned int col, double *space);
 int set_get_minmax(Quark *pset,
     double *xmin, double *xmax, double *ymin, double *ymax);
 
@@ -1025,6 +1074,8 @@ int region_set_color(Quark *q, int color);
 int region_add_point(Quark *q, const WPoint *wp);
 
 int region_contains(const Quark *q, const WPoint *wp);
+int region_contains_points(const Quark *q,
+    const double *x, const double *y, unsigned int npoints, char *flags);
 
 /* DObject */
 void *object_odata_new(AMem *amem, OType type);
@@ -1103,6 +1154,15 @@ int Vpoint2Apoint(const Quark *q, const VPoint *vp, APoint *ap);
 
 int update_graph_ccache(Quark *gr);
 
+int ctrans_get_data(const Quark *q, ctrans_data *cd);
+int ctrans_is_valid_wpoint(const ctrans_data *cd, const WPoint *wp);
+int ctrans_wpoint2vpoint(const ctrans_data *cd, const WPoint *wp, VPoint *vp);
+int ctrans_wcols2vpoints(const ctrans_data *cd,
+    const double *x, const double *y, int n, VPoint *vps);
+
+int Wcols2Vpoints(const Quark *q,
+    const double *x, const double *y, int n, VPoint *vps);
+
 /* Misc (de)allocation utilities */
 Format *format_new(void);
 void format_free(Format *f);
@@ -62,6 +62,9 @@ struct _Quark {
 
     unsigned int dirtystate;
     unsigned int statestamp;
+    unsigned int ownstamp;
+    
+    unsigned int txindex;    /* slot in the transaction queue */
     
     void *data;              /* the actual payload      */
     
@@ -77,6 +80,7 @@ void project_data_free(AMem *amem, Project *pr);
 ss_data *ssd_data_new(AMem *amem);
 void ssd_data_free(AMem *amem, ss_data *ssd);
 ss_data *ssd_data_copy(AMem *amem, ss_data *ssd);
+void ssd_lod_purge(const ss_data *ssd);
 
 frame *frame_data_new(AMem *amem);
 void frame_data_free(AMem *amem, frame *f);
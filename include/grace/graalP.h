@@ -47,9 +47,23 @@ struct _GVar {
     GVarData data;
 };
 
+/* compiled arithmetic statement or expression */
+typedef struct _GProgram GProgram;
+
+/* outcome of running a compiled program */
+#define GPROG_DONE      0
+#define GPROG_FAILED    1   /* evaluation error, already reported */
+#define GPROG_FALLBACK  2   /* can't be handled; use the parser instead */
+
+/* max number of cached compiled programs */
+#define GRAAL_PROG_CACHE_SIZE   64
+
 struct _Graal {
     void *scanner;
     
+    GProgram *progs;            /* MRU list of compiled programs */
+    unsigned int nprogs;
+    
     DArray **darrs;
     unsigned int ndarrs;
     
@@ -95,5 +109,12 @@ int graal_get_RHS(const Graal *g);
 void graal_call_eval_proc(Graal *g, GVarType type, GVarData vardata);
 
 void gvar_clear(GVar *var);
+int gvar_take_arr(GVar *var, DArray *da);
+
+GProgram *graal_get_program(Graal *g, const char *s, int expr_only);
+void graal_free_programs(Graal *g);
+int gprogram_run(Graal *g, const GProgram *prog, void *context);
+int gprogram_eval(Graal *g, const GProgram *prog, void *context,
+    double *val, DArray *out);
 
 #endif /* __GRAALP_H_ */
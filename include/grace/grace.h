@@ -30,6 +30,7 @@
 
 #include "grace/core.h"
 #include "grace/graal.h"
+#include "grace/plot.h"
 
 typedef struct _Grace Grace;
 
@@ -44,6 +45,10 @@ typedef enum {
 typedef struct {
     Quark *q;
     GrFILE *grf;
+    
+    void *map;          /* mapped binary project, backing not loaded columns */
+    size_t maplen;
+    char *mapfile;      /* name of the mapped file */
 } GProject;
 
 /* grace.c */
@@ -62,6 +67,9 @@ Graal *grace_get_graal(const Grace *grace);
 QuarkFactory *grace_get_qfactory(const Grace *grace);
 
 int gproject_render(const GProject *gp);
+int gproject_get_damage(const GProject *gp, PageCache *pc, view *damage);
+int gproject_render_update(const GProject *gp,
+    PageCache *pc, const view *damage);
 
 Quark *gproject_get_top(const GProject *gp);
 
@@ -75,6 +83,7 @@ int grace_sync_canvas_devices(const GProject *gp);
 
 /* xml_out.c */
 int gproject_save(GProject *gp, GrFILE *grf);
+int gproject_save_bin(GProject *gp, GrFILE *grf);
 /* xml_in.c */
 GProject *gproject_load(Quark *parent, Grace *grace, GrFILE *grf, int mmodel);
 
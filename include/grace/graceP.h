@@ -37,6 +37,17 @@
 /* Version ID of the current XGR format */
 #define XGR_VERSION_ID  59901
 
+/*
+ * Binary project container: a header of the magic, a 4-byte version, 4
+ * reserved bytes and the 8-byte offset of the XML part (all integers are
+ * little-endian), followed by blocks of little-endian doubles holding the
+ * numerical columns, followed by the XML project, in which such a column is
+ * an empty element with the offset of its block
+ */
+#define XGB_MAGIC       "GRACEXGB"
+#define XGB_VERSION     1
+#define XGB_HEADER_SIZE 24
+
 /* Element names */
 #define EStrAGrid               "agrid"
 #define EStrAText               "atext"
@@ -34,9 +34,21 @@
 #define LFORMAT_TYPE_PLAIN      0
 #define LFORMAT_TYPE_EXTENDED   1
 
+typedef struct _PageCache PageCache;
+
 int drawgraph(Canvas *canvas, Graal *g, const Quark *project);
 
-char *create_fstring(const Quark *q, const Format *form, double loc, int type);
+PageCache *pagecache_new(void);
+void pagecache_free(PageCache *pc);
+void pagecache_invalidate(PageCache *pc);
+
+int drawgraph_damage(Canvas *canvas, Graal *g, const Quark *project,
+    PageCache *pc, view *damage);
+int drawgraph_update(Canvas *canvas, Graal *g, const Quark *project,
+    PageCache *pc, const view *damage);
+
+char *create_fstring(const Quark *q, const Format *form, double loc, int type,
+    char *s);
 
 void jdate_to_datetime(const Quark *q, double jday, int rounding,
                          int *y, int *m, int *d,
@@ -108,6 +108,495 @@ static unsigned int amem_redo_count(AMem *amem)
 }
 #endif
 
+/*
+ * Copy-on-write undo heap. Every block allocated through the AMem is
+ * registered; a snapshot records an immutable version of each live block.
+ * Versions are shared between consecutive snapshots as long as the block
+ * doesn't change, so the history only grows by the blocks (individual
+ * SSD columns, quark data, strings) that were actually modified. Blocks
+ * freed while still referenced by a snapshot are kept alive, so pointers
+ * remain valid across undo/redo.
+ *
+ * A snapshot compares a block against its saved version only if the block
+ * is small or dirty. Blocks are dirtied by (re)allocation and by
+ * amem_touch(), which must be called on in-place modifications of larger
+ * blocks (the quark layer does it for the quarks it marks as modified).
+ */
+typedef struct {
+    unsigned int refcount;      /* snapshots sharing the version */
+    size_t size;
+    void *data;
+} AMVersion;
+
+typedef struct _AMBlock {
+    void *ptr;
+    size_t size;
+    int live;
+    int dirty;                  /* possibly modified since the snapshot */
+    unsigned int refcount;      /* snapshots referring to the block */
+    AMVersion *saved;           /* version in the current snapshot */
+    struct _AMBlock *next;      /* hash chain */
+} AMBlock;
+
+typedef struct {
+    unsigned int nentries;
+    AMBlock **blocks;
+    AMVersion **versions;
+    size_t size;                /* total size of the versions */
+} AMSnapshot;
+
+typedef struct {
+    AMBlock **buckets;
+    unsigned int nbuckets;
+    unsigned int nblocks;
+
+    AMSnapshot *snapshots;
+    unsigned int nsnapshots;
+    unsigned int current;
+
+    size_t vsize;               /* total size of all stored versions */
+    size_t limit;               /* max. size of the versions in history */
+} AMCowHeap;
+
+#define AMCOW_MIN_BUCKETS   256
+/* blocks up to this size are always compared, being as cheap as tracking */
+#define AMCOW_SMALL_BLOCK   256
+
+static unsigned int amcow_hash(const AMCowHeap *heap, const void *ptr)
+{
+    unsigned long key = (unsigned long) ptr;
+    
+    key ^= key >> 4;
+    key *= 2654435761UL;
+    
+    return (unsigned int) (key ^ (key >> 16)) % heap->nbuckets;
+}
+
+static AMBlock *amcow_find(const AMCowHeap *heap, const void *ptr)
+{
+    AMBlock *b = heap->buckets[amcow_hash(heap, ptr)];
+    
+    while (b && b->ptr != ptr) {
+        b = b->next;
+    }
+    
+    return b;
+}
+
+static void amcow_link(AMCowHeap *heap, AMBlock *b)
+{
+    unsigned int h = amcow_hash(heap, b->ptr);
+    
+    b->next = heap->buckets[h];
+    heap->buckets[h] = b;
+}
+
+static void amcow_unlink(AMCowHeap *heap, AMBlock *b)
+{
+    AMBlock **pb = &heap->buckets[amcow_hash(heap, b->ptr)];
+    
+    while (*pb != b) {
+        pb = &(*pb)->next;
+    }
+    *pb = b->next;
+}
+
+static int amcow_rehash(AMCowHeap *heap, unsigned int nbuckets)
+{
+    AMBlock **old = heap->buckets;
+    unsigned int i, nold = heap->nbuckets;
+    
+    heap->buckets = xcalloc(nbuckets, sizeof(AMBlock *));
+    if (!heap->buckets) {
+        heap->buckets = old;
+        return RETURN_FAILURE;
+    }
+    heap->nbuckets = nbuckets;
+    
+    for (i = 0; i < nold; i++) {
+        AMBlock *b = old[i];
+        while (b) {
+            AMBlock *next = b->next;
+            amcow_link(heap, b);
+            b = next;
+        }
+    }
+    xfree(old);
+    
+    return RETURN_SUCCESS;
+}
+
+static AMBlock *amcow_register(AMCowHeap *heap, void *ptr, size_t size)
+{
+    AMBlock *b;
+    
+    if (heap->nblocks >= heap->nbuckets) {
+        amcow_rehash(heap, 2*heap->nbuckets);
+    }
+    
+    b = xmalloc(sizeof(AMBlock));
+    if (b) {
+        b->ptr      = ptr;
+        b->size     = size;
+        b->live     = TRUE;
+        b->dirty    = TRUE;
+        b->refcount = 0;
+        b->saved    = NULL;
+        amcow_link(heap, b);
+        heap->nblocks++;
+    }
+    
+    return b;
+}
+
+static void amcow_unregister(AMCowHeap *heap, AMBlock *b)
+{
+    amcow_unlink(heap, b);
+    heap->nblocks--;
+    xfree(b->ptr);
+    xfree(b);
+}
+
+static AMVersion *amcow_version_new(AMCowHeap *heap, const AMBlock *b)
+{
+    AMVersion *v = xmalloc(sizeof(AMVersion));
+    if (!v) {
+        return NULL;
+    }
+    v->data = xmalloc(b->size);
+    if (b->size && !v->data) {
+        xfree(v);
+        return NULL;
+    }
+    memcpy(v->data, b->ptr, b->size);
+    v->size     = b->size;
+    v->refcount = 1;
+    
+    heap->vsize += v->size;
+    
+    return v;
+}
+
+static void amcow_version_unref(AMCowHeap *heap, AMVersion *v)
+{
+    v->refcount--;
+    if (v->refcount == 0) {
+        heap->vsize -= v->size;
+        xfree(v->data);
+        xfree(v);
+    }
+}
+
+static void amcow_snapshot_free(AMCowHeap *heap, AMSnapshot *s)
+{
+    unsigned int i;
+    
+    for (i = 0; i < s->nentries; i++) {
+        AMBlock *b = s->blocks[i];
+        
+        amcow_version_unref(heap, s->versions[i]);
+        
+        b->refcount--;
+        if (b->refcount == 0 && !b->live) {
+            amcow_unregister(heap, b);
+        }
+    }
+    xfree(s->blocks);
+    xfree(s->versions);
+}
+
+/* bring the heap contents to the state recorded in snapshot s */
+static void amcow_restore(AMCowHeap *heap, const AMSnapshot *s)
+{
+    unsigned int i;
+    
+    for (i = 0; i < heap->nbuckets; i++) {
+        AMBlock *b;
+        for (b = heap->buckets[i]; b; b = b->next) {
+            b->live = FALSE;
+        }
+    }
+    
+    for (i = 0; i < s->nentries; i++) {
+        AMBlock *b = s->blocks[i];
+        AMVersion *v = s->versions[i];
+        
+        /* a clean large block still holds its saved version */
+        if (b->saved != v || b->dirty || b->size <= AMCOW_SMALL_BLOCK) {
+            memcpy(b->ptr, v->data, v->size);
+        }
+        b->live  = TRUE;
+        b->dirty = FALSE;
+        b->saved = v;
+    }
+    
+    /* blocks allocated after the snapshot and not referenced by any other */
+    for (i = 0; i < heap->nbuckets; i++) {
+        AMBlock *b = heap->buckets[i];
+        while (b) {
+            AMBlock *next = b->next;
+            if (!b->live) {
+                b->saved = NULL;
+                if (b->refcount == 0) {
+                    amcow_unregister(heap, b);
+                }
+            }
+            b = next;
+        }
+    }
+}
+
+static void *amem_cow_malloc(AMem *amem, size_t size)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    void *ptr;
+    
+    ptr = xmalloc(size);
+    if (ptr && !amcow_register(heap, ptr, size)) {
+        xfree(ptr);
+        ptr = NULL;
+    }
+    
+    return ptr;
+}
+
+static void amem_cow_free(AMem *amem, void *ptr)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    AMBlock *b;
+    
+    if (!ptr) {
+        return;
+    }
+    
+    b = amcow_find(heap, ptr);
+    if (!b) {
+        errmsg("Attempt to free an unregistered block");
+        return;
+    }
+    
+    b->live  = FALSE;
+    b->saved = NULL;
+    if (b->refcount == 0) {
+        amcow_unregister(heap, b);
+    }
+}
+
+static void *amem_cow_realloc(AMem *amem, void *ptr, size_t size)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    AMBlock *b;
+    void *newptr;
+    
+    if (!ptr) {
+        return amem_cow_malloc(amem, size);
+    }
+    if (size == 0) {
+        amem_cow_free(amem, ptr);
+        return NULL;
+    }
+    
+    b = amcow_find(heap, ptr);
+    if (!b) {
+        errmsg("Attempt to realloc an unregistered block");
+        return NULL;
+    }
+    
+    if (b->refcount == 0) {
+        /* not in history, can be resized in place */
+        newptr = xrealloc(ptr, size);
+        if (newptr) {
+            amcow_unlink(heap, b);
+            b->ptr   = newptr;
+            b->size  = size;
+            b->dirty = TRUE;
+            amcow_link(heap, b);
+        }
+    } else {
+        /* keep the old block for the snapshots referring to it */
+        newptr = amem_cow_malloc(amem, size);
+        if (newptr) {
+            memcpy(newptr, ptr, MIN2(size, b->size));
+            amem_cow_free(amem, ptr);
+        }
+    }
+    
+    return newptr;
+}
+
+static int amem_cow_snapshot(AMem *amem)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    AMSnapshot *s, *p;
+    unsigned int i, n;
+    
+    /* a new snapshot discards the redo history */
+    while (heap->nsnapshots > heap->current + 1) {
+        heap->nsnapshots--;
+        amcow_snapshot_free(heap, &heap->snapshots[heap->nsnapshots]);
+    }
+    
+    p = xrealloc(heap->snapshots, (heap->nsnapshots + 1)*sizeof(AMSnapshot));
+    if (!p) {
+        return RETURN_FAILURE;
+    }
+    heap->snapshots = p;
+    
+    s = &heap->snapshots[heap->nsnapshots];
+    s->nentries = 0;
+    s->size     = 0;
+    s->blocks   = xmalloc(heap->nblocks*sizeof(AMBlock *));
+    s->versions = xmalloc(heap->nblocks*sizeof(AMVersion *));
+    if (heap->nblocks && (!s->blocks || !s->versions)) {
+        xfree(s->blocks);
+        xfree(s->versions);
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0, n = 0; i < heap->nbuckets; i++) {
+        AMBlock *b;
+        for (b = heap->buckets[i]; b; b = b->next) {
+            AMVersion *v = b->saved;
+            
+            if (!b->live) {
+                continue;
+            }
+            
+            if (v && v->size == b->size &&
+                ((!b->dirty && b->size > AMCOW_SMALL_BLOCK) ||
+                 !memcmp(v->data, b->ptr, b->size))) {
+                v->refcount++;
+            } else {
+                v = amcow_version_new(heap, b);
+                if (!v) {
+                    s->nentries = n;
+                    amcow_snapshot_free(heap, s);
+                    return RETURN_FAILURE;
+                }
+            }
+            
+            b->saved = v;
+            b->dirty = FALSE;
+            b->refcount++;
+            
+            s->blocks[n]   = b;
+            s->versions[n] = v;
+            s->size += v->size;
+            n++;
+        }
+    }
+    s->nentries = n;
+    
+    heap->current = heap->nsnapshots;
+    heap->nsnapshots++;
+    
+    /* trim the oldest snapshots if the history is too large */
+    while (heap->current > 0 && heap->vsize - s->size > heap->limit) {
+        amcow_snapshot_free(heap, &heap->snapshots[0]);
+        heap->nsnapshots--;
+        heap->current--;
+        memmove(heap->snapshots, heap->snapshots + 1,
+            heap->nsnapshots*sizeof(AMSnapshot));
+        s = &heap->snapshots[heap->current];
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+static void amem_cow_touch(AMem *amem, const void *ptr)
+{
+    AMBlock *b = amcow_find((AMCowHeap *) amem->heap, ptr);
+    
+    if (b) {
+        b->dirty = TRUE;
+    }
+}
+
+static int amem_cow_undo(AMem *amem)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    
+    if (heap->nsnapshots == 0 || heap->current == 0) {
+        return RETURN_FAILURE;
+    }
+    
+    heap->current--;
+    amcow_restore(heap, &heap->snapshots[heap->current]);
+    
+    return RETURN_SUCCESS;
+}
+
+static int amem_cow_redo(AMem *amem)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    
+    if (heap->current + 1 >= heap->nsnapshots) {
+        return RETURN_FAILURE;
+    }
+    
+    heap->current++;
+    amcow_restore(heap, &heap->snapshots[heap->current]);
+    
+    return RETURN_SUCCESS;
+}
+
+static unsigned int amem_cow_undo_count(AMem *amem)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    
+    return heap->nsnapshots ? heap->current:0;
+}
+
+static unsigned int amem_cow_redo_count(AMem *amem)
+{
+    AMCowHeap *heap = (AMCowHeap *) amem->heap;
+    
+    return heap->nsnapshots ? heap->nsnapshots - 1 - heap->current:0;
+}
+
+static AMCowHeap *amcow_heap_new(void)
+{
+    AMCowHeap *heap = xmalloc(sizeof(AMCowHeap));
+    if (heap) {
+        memset(heap, 0, sizeof(AMCowHeap));
+        heap->limit    = (size_t) -1;
+        heap->buckets  = xcalloc(AMCOW_MIN_BUCKETS, sizeof(AMBlock *));
+        heap->nbuckets = AMCOW_MIN_BUCKETS;
+        if (!heap->buckets) {
+            xfree(heap);
+            heap = NULL;
+        }
+    }
+    
+    return heap;
+}
+
+static void amcow_heap_free(AMCowHeap *heap)
+{
+    unsigned int i;
+    
+    if (!heap) {
+        return;
+    }
+    
+    for (i = 0; i < heap->nsnapshots; i++) {
+        amcow_snapshot_free(heap, &heap->snapshots[i]);
+    }
+    xfree(heap->snapshots);
+    
+    for (i = 0; i < heap->nbuckets; i++) {
+        AMBlock *b = heap->buckets[i];
+        while (b) {
+            AMBlock *next = b->next;
+            xfree(b->ptr);
+            xfree(b);
+            b = next;
+        }
+    }
+    xfree(heap->buckets);
+    xfree(heap);
+}
+
 
 AMem *amem_amem_new(int model)
 {
@@ -139,6 +628,26 @@ AMem *amem_amem_new(int model)
         
             break;
 #endif
+        case AMEM_MODEL_COW:
+            amem->heap            = amcow_heap_new();
+            if (!amem->heap) {
+                xfree(amem);
+                return NULL;
+            }
+            
+            amem->undoable        = TRUE;
+            
+            amem->malloc_proc     = amem_cow_malloc;
+            amem->realloc_proc    = amem_cow_realloc;
+            amem->free_proc       = amem_cow_free;
+
+            amem->snapshot_proc   = amem_cow_snapshot;
+            amem->undo_proc       = amem_cow_undo;
+            amem->redo_proc       = amem_cow_redo;
+            amem->undo_count_proc = amem_cow_undo_count;
+            amem->redo_count_proc = amem_cow_redo_count;
+        
+            break;
         case AMEM_MODEL_SIMPLE:
         default:
             amem->heap         = NULL;
@@ -164,6 +673,9 @@ void amem_amem_free(AMem *amem)
             undo_destroy((UNDO *) amem->heap);
             break;
 #endif
+        case AMEM_MODEL_COW:
+            amcow_heap_free((AMCowHeap *) amem->heap);
+            break;
         default:
             break;
         }
@@ -183,12 +695,40 @@ int amem_set_undo_limit(AMem *amem, size_t max_memory)
         }
         break;
 #endif
+    case AMEM_MODEL_COW:
+        ((AMCowHeap *) amem->heap)->limit = max_memory;
+        return RETURN_SUCCESS;
+        break;
     default:
         return RETURN_FAILURE;
         break;
     }
 }
 
+/* total size of the data kept for undo/redo */
+size_t amem_get_history_size(AMem *amem)
+{
+    switch (amem->model) {
+    case AMEM_MODEL_COW:
+        return ((AMCowHeap *) amem->heap)->vsize;
+        break;
+    default:
+        return 0;
+        break;
+    }
+}
+
+/*
+ * report an in-place modification of a block, so that an undoable model
+ * records it in the next snapshot
+ */
+void amem_touch(AMem *amem, const void *ptr)
+{
+    if (ptr && amem->model == AMEM_MODEL_COW) {
+        amem_cow_touch(amem, ptr);
+    }
+}
+
 void *amem_malloc(AMem *amem, size_t size)
 {
     return amem->malloc_proc(amem, size);
@@ -0,0 +1,217 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ * 
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ * 
+ * Copyright (c) 2005 Grace Development Team
+ * 
+ * Maintained by Evgeny Stambulchik
+ * 
+ * 
+ *                           All Rights Reserved
+ * 
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ * 
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ * 
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Sorting by double keys: a parallel LSD radix sort of the key bit patterns
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "grace/baseP.h"
+
+#define DSORT_BITS      11
+#define DSORT_RADIX     (1 << DSORT_BITS)
+#define DSORT_PASSES    ((64 + DSORT_BITS - 1)/DSORT_BITS)
+
+/* number of keys below which threads aren't worth spawning */
+#define DSORT_CHUNK     65536
+
+typedef struct {
+    unsigned int n;
+    unsigned int shift;
+    const uint64_t *src_keys;
+    const unsigned int *src_ind;
+    uint64_t *dst_keys;
+    unsigned int *dst_ind;
+    unsigned int *counts;       /* njobs x DSORT_RADIX */
+} DSortPass;
+
+/*
+ * map a double to an unsigned integer of the same ordering: flip all bits
+ * of negatives and the sign bit of positives. Both zeros map to the same key,
+ * so they compare equal just like the values do. NaNs of either sign get the
+ * largest key, after +Inf.
+ */
+static uint64_t dsort_key(double v, int descending)
+{
+    uint64_t k;
+    
+    if (isnan(v)) {
+        k = ~(uint64_t) 0;
+        return descending ? ~k:k;
+    }
+    if (v == 0.0) {
+        v = 0.0;
+    }
+    memcpy(&k, &v, sizeof(k));
+    if (k >> 63) {
+        k = ~k;
+    } else {
+        k |= (uint64_t) 1 << 63;
+    }
+    
+    return descending ? ~k:k;
+}
+
+static void dsort_range(unsigned int job, unsigned int njobs, unsigned int n,
+    unsigned int *i1, unsigned int *i2)
+{
+    *i1 = (unsigned int) ((double) n*job/njobs);
+    *i2 = (unsigned int) ((double) n*(job + 1)/njobs);
+}
+
+static void dsort_count(unsigned int job, unsigned int njobs, void *udata)
+{
+    DSortPass *dp = (DSortPass *) udata;
+    unsigned int *counts = dp->counts + job*DSORT_RADIX;
+    unsigned int i, i1, i2;
+    
+    dsort_range(job, njobs, dp->n, &i1, &i2);
+    
+    memset(counts, 0, DSORT_RADIX*SIZEOF_INT);
+    for (i = i1; i < i2; i++) {
+        counts[(dp->src_keys[i] >> dp->shift) & (DSORT_RADIX - 1)]++;
+    }
+}
+
+static void dsort_scatter(unsigned int job, unsigned int njobs, void *udata)
+{
+    DSortPass *dp = (DSortPass *) udata;
+    unsigned int *offsets = dp->counts + job*DSORT_RADIX;
+    unsigned int i, i1, i2;
+    
+    dsort_range(job, njobs, dp->n, &i1, &i2);
+    
+    for (i = i1; i < i2; i++) {
+        uint64_t k = dp->src_keys[i];
+        unsigned int pos = offsets[(k >> dp->shift) & (DSORT_RADIX - 1)]++;
+        dp->dst_keys[pos] = k;
+        dp->dst_ind[pos]  = dp->src_ind[i];
+    }
+}
+
+/*
+ * fill ind[0...n-1] with the permutation that sorts keys in the ascending
+ * (or descending) order. The sort is stable; NaNs go to the end (start).
+ * Reentrant; large arrays are sorted by several threads.
+ */
+int dsort_index(const double *keys, unsigned int n, int descending,
+    unsigned int *ind)
+{
+    DSortPass dp;
+    uint64_t *k1, *k2;
+    unsigned int *ind2, njobs, pass, i, j, d;
+    
+    if (n == 0) {
+        return RETURN_SUCCESS;
+    }
+    if (!keys || !ind) {
+        return RETURN_FAILURE;
+    }
+    
+    njobs = MIN2(parallel_get_nthreads(), n/DSORT_CHUNK);
+    if (njobs < 1) {
+        njobs = 1;
+    }
+    
+    k1   = xmalloc(n*sizeof(uint64_t));
+    k2   = xmalloc(n*sizeof(uint64_t));
+    ind2 = xmalloc(n*SIZEOF_INT);
+    dp.counts = xmalloc(njobs*DSORT_RADIX*SIZEOF_INT);
+    if (!k1 || !k2 || !ind2 || !dp.counts) {
+        xfree(k1);
+        xfree(k2);
+        xfree(ind2);
+        xfree(dp.counts);
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0; i < n; i++) {
+        k1[i]  = dsort_key(keys[i], descending);
+        ind[i] = i;
+    }
+    
+    dp.n        = n;
+    dp.src_keys = k1;
+    dp.src_ind  = ind;
+    dp.dst_keys = k2;
+    dp.dst_ind  = ind2;
+    
+    for (pass = 0; pass < DSORT_PASSES; pass++) {
+        unsigned int pos = 0;
+        int trivial = FALSE;
+        
+        dp.shift = pass*DSORT_BITS;
+        parallel_run(njobs, dsort_count, &dp);
+        
+        /* turn the counts into per-job offsets, keeping the job order */
+        for (d = 0; d < DSORT_RADIX; d++) {
+            unsigned int total = 0;
+            for (j = 0; j < njobs; j++) {
+                total += dp.counts[j*DSORT_RADIX + d];
+            }
+            if (total == n) {
+                /* all keys share this digit */
+                trivial = TRUE;
+                break;
+            }
+            for (j = 0; j < njobs; j++) {
+                unsigned int c = dp.counts[j*DSORT_RADIX + d];
+                dp.counts[j*DSORT_RADIX + d] = pos;
+                pos += c;
+            }
+        }
+        if (trivial) {
+            continue;
+        }
+        
+        parallel_run(njobs, dsort_scatter, &dp);
+        
+        /* swap the buffers */
+        dp.src_keys = dp.dst_keys;
+        dp.dst_keys = (dp.src_keys == k1) ? k2:k1;
+        if (dp.src_ind == ind) {
+            dp.src_ind = ind2;
+            dp.dst_ind = ind;
+        } else {
+            dp.src_ind = ind;
+            dp.dst_ind = ind2;
+        }
+    }
+    
+    if (dp.src_ind != ind) {
+        memcpy(ind, dp.src_ind, n*SIZEOF_INT);
+    }
+    
+    xfree(k1);
+    xfree(k2);
+    xfree(ind2);
+    xfree(dp.counts);
+    
+    return RETURN_SUCCESS;
+}
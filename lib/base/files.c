@@ -34,6 +34,11 @@
 
 #include "grace/base.h"
 
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#  include <sys/mman.h>
+#  define USE_MAPPED_READ
+#endif
+
 /* replacement for fgets() to fix up reading DOS text files */
 char *grace_fgets(char *s, int size, FILE *stream)
 {
@@ -135,6 +140,53 @@ GrFILE *grfile_openw(const char *fname)
     return grf;
 }
 
+/*
+ * map a whole regular file read-only; where mmap() is unavailable, the file
+ * is read into memory instead
+ */
+void *grfile_map(GrFILE *grf, size_t *len)
+{
+    struct stat statb;
+    void *addr;
+    
+    if (!grf || !grf->fp || grf->pipe ||
+        fstat(fileno(grf->fp), &statb) != 0 || !S_ISREG(statb.st_mode) ||
+        statb.st_size <= 0 || (size_t) statb.st_size != statb.st_size) {
+        return NULL;
+    }
+    *len = statb.st_size;
+
+#ifdef USE_MAPPED_READ
+    addr = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fileno(grf->fp), 0);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+#else
+    addr = xmalloc(*len);
+    if (addr) {
+        long pos = ftell(grf->fp);
+        if (fseek(grf->fp, 0L, SEEK_SET) != 0 ||
+            fread(addr, 1, *len, grf->fp) != *len ||
+            fseek(grf->fp, pos, SEEK_SET) != 0) {
+            XCFREE(addr);
+        }
+    }
+#endif
+    
+    return addr;
+}
+
+void grfile_unmap(void *addr, size_t len)
+{
+    if (addr) {
+#ifdef USE_MAPPED_READ
+        munmap(addr, len);
+#else
+        xfree(addr);
+#endif
+    }
+}
+
 int grfile_close(GrFILE *grf)
 {
     if (grf && grf->fp) {
@@ -0,0 +1,164 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ * 
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ * 
+ * Copyright (c) 2012 Grace Development Team
+ * 
+ * Maintained by Evgeny Stambulchik
+ * 
+ * 
+ *                           All Rights Reserved
+ * 
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ * 
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ * 
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Running independent jobs in parallel */
+
+#include <config.h>
+
+#include <stdlib.h>
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+
+#include "grace/baseP.h"
+
+/* upper limit on the number of threads, whatever the system says */
+#define PARALLEL_MAX_THREADS    64
+
+static unsigned int parallel_nthreads = 0;
+
+/*
+ * number of threads worth running: the GRACE_NTHREADS environment variable
+ * if set, otherwise the number of online CPUs
+ */
+unsigned int parallel_get_nthreads(void)
+{
+    if (parallel_nthreads == 0) {
+        char *s = getenv("GRACE_NTHREADS");
+        long n = 1;
+        
+        if (s) {
+            n = atol(s);
+        }
+#if defined(HAVE_LIBPTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+        else {
+            n = sysconf(_SC_NPROCESSORS_ONLN);
+        }
+#endif
+        if (n < 1) {
+            n = 1;
+        }
+        parallel_nthreads = MIN2(n, PARALLEL_MAX_THREADS);
+    }
+    
+    return parallel_nthreads;
+}
+
+void parallel_set_nthreads(unsigned int nthreads)
+{
+    parallel_nthreads = MIN2(nthreads, PARALLEL_MAX_THREADS);
+}
+
+#ifdef HAVE_LIBPTHREAD
+typedef struct {
+    unsigned int job;
+    unsigned int njobs;
+    ParallelProc proc;
+    void *udata;
+} ParallelJob;
+
+static void *parallel_thread(void *arg)
+{
+    ParallelJob *pj = (ParallelJob *) arg;
+    
+    pj->proc(pj->job, pj->njobs, pj->udata);
+    
+    return NULL;
+}
+#endif
+
+/*
+ * run proc(job, njobs, udata) for job = 0...njobs-1, each in its own
+ * thread; the calling thread takes the first job. Returns when all jobs are
+ * finished. Without thread support, the jobs are run one after another.
+ */
+int parallel_run(unsigned int njobs, ParallelProc proc, void *udata)
+{
+    unsigned int i;
+    
+    if (!proc) {
+        return RETURN_FAILURE;
+    }
+    
+#ifdef HAVE_LIBPTHREAD
+    if (njobs > 1) {
+        ParallelJob *pjobs;
+        pthread_t *threads;
+        int *started;
+        
+        pjobs   = xmalloc(njobs*sizeof(ParallelJob));
+        threads = xmalloc(njobs*sizeof(pthread_t));
+        started = xcalloc(njobs, SIZEOF_INT);
+        if (!pjobs || !threads || !started) {
+            xfree(pjobs);
+            xfree(threads);
+            xfree(started);
+            return RETURN_FAILURE;
+        }
+        
+        for (i = 0; i < njobs; i++) {
+            pjobs[i].job   = i;
+            pjobs[i].njobs = njobs;
+            pjobs[i].proc  = proc;
+            pjobs[i].udata = udata;
+        }
+        
+        for (i = 1; i < njobs; i++) {
+            if (pthread_create(&threads[i], NULL,
+                parallel_thread, &pjobs[i]) == 0) {
+                started[i] = TRUE;
+            }
+        }
+        
+        proc(0, njobs, udata);
+        
+        for (i = 1; i < njobs; i++) {
+            if (started[i]) {
+                pthread_join(threads[i], NULL);
+            } else {
+                /* couldn't spawn a thread; do it ourselves */
+                proc(i, njobs, udata);
+            }
+        }
+        
+        xfree(pjobs);
+        xfree(threads);
+        xfree(started);
+        
+        return RETURN_SUCCESS;
+    }
+#endif
+
+    for (i = 0; i < njobs; i++) {
+        proc(i, njobs, udata);
+    }
+    
+    return RETURN_SUCCESS;
+}
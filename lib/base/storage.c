@@ -29,6 +29,10 @@
  *
  * DLL (Double Linked List) data storage
  *
+ * Alongside the list, the nodes are kept in an array in list order (so
+ * id-based access is O(1)) and in a hash keyed by the data pointer (so
+ * data-based lookups are O(1) on average).
+ *
  */
 
 #include <config.h>
@@ -39,7 +43,7 @@
 
 #define ADVANCED_MEMORY_HANDLERS
 
-#include "grace/base.h"
+#include "grace/baseP.h"
 
 #define STORAGE_SAFETY_CHECK(sto, retaction)                            \
     if (!sto) {                                                         \
@@ -102,6 +106,11 @@ Storage *storage_new(AMem *amem,
     sto->cp    = NULL;
     sto->count = 0;
     sto->ierrno = 0;
+    
+    sto->index    = NULL;
+    sto->nalloc   = 0;
+    sto->buckets  = NULL;
+    sto->nbuckets = 0;
     if (data_free == NULL) {
         sto->data_free = _data_free;
     } else {
@@ -163,16 +172,10 @@ int storage_rewind(Storage *sto)
 
 int storage_eod(Storage *sto)
 {
-    LLNode *cllnode;
-    
     STORAGE_SAFETY_CHECK(sto, return RETURN_FAILURE)
     
-    cllnode = sto->cp;
-    while (cllnode) {
-        if (!cllnode->next) {
-            sto->cp = cllnode;
-        }
-        cllnode = cllnode->next;
+    if (sto->count) {
+        sto->cp = sto->index[sto->count - 1];
     }
     
     return RETURN_SUCCESS;
@@ -185,11 +188,114 @@ int storage_count(Storage *sto)
     return sto->count;
 }
 
-static LLNode *storage_get_node_by_id(Storage *sto, int id)
+static unsigned int storage_hash(const Storage *sto, const void *data)
+{
+    unsigned long h = (unsigned long) data >> 3;
+    
+    h *= 2654435761UL;
+    
+    return (unsigned int) (h ^ (h >> 16)) & (sto->nbuckets - 1);
+}
+
+static void storage_hash_add(Storage *sto, LLNode *llnode)
+{
+    unsigned int h = storage_hash(sto, llnode->data);
+    
+    llnode->hnext = sto->buckets[h];
+    sto->buckets[h] = llnode;
+    amem_touch(sto->amem, sto->buckets);
+}
+
+static void storage_hash_remove(Storage *sto, LLNode *llnode)
+{
+    LLNode **pp = &sto->buckets[storage_hash(sto, llnode->data)];
+    
+    while (*pp) {
+        if (*pp == llnode) {
+            *pp = llnode->hnext;
+            break;
+        }
+        pp = &(*pp)->hnext;
+    }
+    llnode->hnext = NULL;
+    amem_touch(sto->amem, sto->buckets);
+}
+
+/* replace the data of a node, keeping the hash in sync */
+static void storage_set_node_data(Storage *sto, LLNode *llnode, void *data)
+{
+    storage_hash_remove(sto, llnode);
+    llnode->data = data;
+    storage_hash_add(sto, llnode);
+}
+
+static void storage_rehash(Storage *sto)
 {
-    LLNode *cllnode;
     int i;
     
+    memset(sto->buckets, 0, sto->nbuckets*sizeof(LLNode *));
+    amem_touch(sto->amem, sto->buckets);
+    for (i = 0; i < sto->count; i++) {
+        storage_hash_add(sto, sto->index[i]);
+    }
+}
+
+/* make room for n nodes in the index and the hash */
+static int storage_reserve(Storage *sto, int n)
+{
+    if (n > sto->nalloc) {
+        int nalloc = MAX2(2*sto->nalloc, 8);
+        LLNode **index;
+        
+        while (nalloc < n) {
+            nalloc *= 2;
+        }
+        index = amem_realloc(sto->amem, sto->index, nalloc*sizeof(LLNode *));
+        if (!index) {
+            sto->ierrno = STORAGE_ENOMEM;
+            return RETURN_FAILURE;
+        }
+        sto->index  = index;
+        sto->nalloc = nalloc;
+    }
+    
+    if ((unsigned int) n > sto->nbuckets) {
+        unsigned int nbuckets = MAX2(2*sto->nbuckets, 8);
+        LLNode **buckets;
+        
+        while (nbuckets < (unsigned int) n) {
+            nbuckets *= 2;
+        }
+        buckets = amem_realloc(sto->amem, sto->buckets,
+            nbuckets*sizeof(LLNode *));
+        if (!buckets) {
+            sto->ierrno = STORAGE_ENOMEM;
+            return RETURN_FAILURE;
+        }
+        sto->buckets  = buckets;
+        sto->nbuckets = nbuckets;
+        storage_rehash(sto);
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * update the ids of the nodes from position id on, after the index has been
+ * changed in place
+ */
+static void storage_renumber(Storage *sto, int id)
+{
+    int i;
+    
+    amem_touch(sto->amem, sto->index);
+    for (i = id; i < sto->count; i++) {
+        sto->index[i]->id = i;
+    }
+}
+
+static LLNode *storage_get_node_by_id(Storage *sto, int id)
+{
     STORAGE_SAFETY_CHECK(sto, return NULL)
     
     if (id < 0 || id >= sto->count) {
@@ -197,44 +303,31 @@ static LLNode *storage_get_node_by_id(Storage *sto, int id)
         return NULL;
     }
     
-    cllnode = sto->start;
-    for (i = 0; i < id; i++) {
-        if (!cllnode) {
-            sto->ierrno = STORAGE_EFATAL;
-            return NULL;
-        }
-        cllnode = cllnode->next;
-    }
-
-    return cllnode;
+    return sto->index[id];
 }
 
 static LLNode *storage_get_node_by_data(Storage *sto, const void *data)
 {
-    LLNode *cllnode;
+    LLNode *cllnode, *found = NULL;
     
     STORAGE_SAFETY_CHECK(sto, return NULL)
     
-    cllnode = sto->cp;
-    while (cllnode) {
-        if (cllnode->data == data) {
-            return cllnode;
-        } else {
-            cllnode = cllnode->next;
+    if (sto->count) {
+        cllnode = sto->buckets[storage_hash(sto, data)];
+        while (cllnode) {
+            /* of duplicates, the first one in the list wins */
+            if (cllnode->data == data && (!found || cllnode->id < found->id)) {
+                found = cllnode;
+            }
+            cllnode = cllnode->hnext;
         }
     }
-
-    cllnode = sto->start;
-    while (cllnode && cllnode != sto->cp) {
-        if (cllnode->data == data) {
-            return cllnode;
-        } else {
-            cllnode = cllnode->next;
-        }
+    
+    if (!found) {
+        sto->ierrno = STORAGE_ENOENT;
     }
-
-    sto->ierrno = STORAGE_ENOENT;
-    return NULL;
+    
+    return found;
 }
 
 int storage_data_exists(Storage *sto, const void *data)
@@ -356,6 +449,11 @@ static LLNode *storage_allocate_node(Storage *sto, void *data)
 static void storage_extract_node(Storage *sto, LLNode *llnode)
 {
     LLNode *prev, *next;
+    int id = llnode->id;
+    
+    storage_hash_remove(sto, llnode);
+    memmove(sto->index + id, sto->index + id + 1,
+        (sto->count - id - 1)*sizeof(LLNode *));
     
     next = llnode->next;
     prev = llnode->prev;
@@ -389,6 +487,7 @@ static void storage_extract_node(Storage *sto, LLNode *llnode)
     }
 
     sto->count--;
+    storage_renumber(sto, id);
 }
 
 static void storage_deallocate_node(Storage *sto, LLNode *llnode)
@@ -398,6 +497,7 @@ static void storage_deallocate_node(Storage *sto, LLNode *llnode)
     amem_free(sto->amem, llnode);
 }
 
+/* the caller must have reserved room for the node with storage_reserve() */
 static void storage_add_node(Storage *sto, LLNode *llnode, int forward)
 {
     if (forward) {
@@ -415,6 +515,11 @@ static void storage_add_node(Storage *sto, LLNode *llnode, int forward)
 
         llnode->prev = prev;
         llnode->next = NULL;
+        
+        sto->index[sto->count] = llnode;
+        amem_touch(sto->amem, sto->index);
+        llnode->id = sto->count;
+        sto->count++;
     } else {
         LLNode *next;
         
@@ -427,10 +532,15 @@ static void storage_add_node(Storage *sto, LLNode *llnode, int forward)
 
         llnode->next = next;
         llnode->prev = NULL;
+        
+        memmove(sto->index + 1, sto->index, sto->count*sizeof(LLNode *));
+        sto->index[0] = llnode;
+        sto->count++;
+        storage_renumber(sto, 0);
     }
+    storage_hash_add(sto, llnode);
 
     sto->cp = llnode;
-    sto->count++;
 }
 
 int storage_add(Storage *sto, void *data)
@@ -439,6 +549,10 @@ int storage_add(Storage *sto, void *data)
 
     STORAGE_SAFETY_CHECK(sto, return RETURN_FAILURE)
 
+    if (storage_reserve(sto, sto->count + 1) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
     new = storage_allocate_node(sto, data);
     if (new == NULL) {
         return RETURN_FAILURE;
@@ -454,9 +568,7 @@ static void storage_insert_node(Storage *sto, LLNode *llnode, int id)
     if (id < sto->count) {
         LLNode *cllnode, *prev;
 
-        storage_scroll_to_id(sto, id);
-
-        cllnode = sto->cp;
+        cllnode = sto->index[id];
 
         prev = cllnode->prev;
         if (prev) {
@@ -468,8 +580,14 @@ static void storage_insert_node(Storage *sto, LLNode *llnode, int id)
         llnode->next = cllnode;
         cllnode->prev = llnode;
 
-        sto->cp = llnode;
+        memmove(sto->index + id + 1, sto->index + id,
+            (sto->count - id)*sizeof(LLNode *));
+        sto->index[id] = llnode;
         sto->count++;
+        storage_renumber(sto, id);
+        storage_hash_add(sto, llnode);
+        
+        sto->cp = llnode;
     } else {
         storage_add_node(sto, llnode, TRUE);
     }
@@ -481,6 +599,10 @@ int storage_insert(Storage *sto, void *data, int id)
 
     STORAGE_SAFETY_CHECK(sto, return RETURN_FAILURE)
 
+    if (storage_reserve(sto, sto->count + 1) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
     new = storage_allocate_node(sto, data);
     if (!new) {
         return RETURN_FAILURE;
@@ -514,21 +636,31 @@ void storage_empty(Storage *sto)
     
     STORAGE_SAFETY_CHECK(sto, return)
     
+    /* detach all nodes at once (extracting them one by one from the head
+       would be quadratic), so data_free sees an empty storage */
     llnode = sto->start;
+    sto->count = 0;
+    sto->start = NULL;
+    sto->cp    = NULL;
+    if (sto->buckets) {
+        memset(sto->buckets, 0, sto->nbuckets*sizeof(LLNode *));
+        amem_touch(sto->amem, sto->buckets);
+    }
+    
     while (llnode) {
         next = llnode->next;
-        storage_deallocate_node(sto, llnode);
+        sto->data_free(sto->amem, llnode->data);
+        amem_free(sto->amem, llnode);
         llnode = next;
     }
-    sto->count = 0;
-    sto->start = NULL;
-    sto->cp    = NULL;
 }
 
 void storage_free(Storage *sto)
 {
     AMem *amem = sto->amem;
     storage_empty(sto);
+    amem_free(amem, sto->index);
+    amem_free(amem, sto->buckets);
     amem_free(amem, sto);
 }
 
@@ -598,8 +730,8 @@ int storage_move(Storage *sto, int forward)
         void *databuf;
         
         databuf = llnode1->data;
-        llnode1->data = llnode2->data;
-        llnode2->data = databuf;
+        storage_set_node_data(sto, llnode1, llnode2->data);
+        storage_set_node_data(sto, llnode2, databuf);
     
         return RETURN_SUCCESS;
     }
@@ -653,7 +785,7 @@ int storage_data_copy_by_id(Storage *sto, int id1, int id2)
         return RETURN_FAILURE;
     } else {
         sto->data_free(sto->amem, llnode2->data);
-        llnode2->data = data;
+        storage_set_node_data(sto, llnode2, data);
         return RETURN_SUCCESS;
     }
 }
@@ -686,8 +818,8 @@ int storage_data_swap(Storage *sto, int id1, int id2)
     } else {
         void *data;
         data = llnode1->data;
-        llnode1->data = llnode2->data;
-        llnode2->data = data;
+        storage_set_node_data(sto, llnode1, llnode2->data);
+        storage_set_node_data(sto, llnode2, data);
         return RETURN_SUCCESS;
     }
 }
@@ -732,7 +864,7 @@ int storage2_data_copy_by_id(Storage *sto1, int id1, Storage *sto2, int id2)
         return RETURN_FAILURE;
     } else {
         sto2->data_free(sto2->amem, llnode2->data);
-        llnode2->data = data;
+        storage_set_node_data(sto2, llnode2, data);
         return RETURN_SUCCESS;
     }
 }
@@ -768,8 +900,8 @@ int storage2_data_swap(Storage *sto1, int id1, Storage *sto2, int id2)
     }
     
     data = llnode1->data;
-    llnode1->data = llnode2->data;
-    llnode2->data = data;
+    storage_set_node_data(sto1, llnode1, llnode2->data);
+    storage_set_node_data(sto2, llnode2, data);
     return RETURN_SUCCESS;
 }
 
@@ -813,6 +945,10 @@ int storage2_data_move(Storage *sto1, Storage *sto2)
         return RETURN_FAILURE;
     }
     
+    if (storage_reserve(sto2, sto2->count + 1) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
     storage_extract_node(sto1, cllnode);
     
     storage_add_node(sto2, cllnode, TRUE);
@@ -867,22 +1003,13 @@ Storage *storage_copy(Storage *sto)
 
 int storage_get_id(Storage *sto)
 {
-    int id = 0;
-    LLNode *llnode;
-       
     STORAGE_SAFETY_CHECK(sto, return -1)
     
-    if (!sto->count) {
+    if (!sto->count || !sto->cp) {
         return -1;
     }
     
-    llnode = sto->start;
-    while (llnode && llnode != sto->cp) {
-        llnode = llnode->next;
-        id++;
-    }
-    
-    return id;
+    return sto->cp->id;
 }
 
 /**** convenience functions ****/
@@ -958,6 +1085,7 @@ int storage_sort(Storage *sto, Storage_comp_proc fcomp, void *udata)
     
     if (sto->count > 1) {
         _storage_sort(sto, sto->start, fcomp, udata);
+        storage_rehash(sto);
     }
     
     return RETURN_SUCCESS;
@@ -248,6 +248,8 @@ int isoneof(int c, char *s)
 static int need_locale = FALSE;
 static char *system_locale_string, *posix_locale_string;
 #endif
+/* decimal point of the system locale, cached for thread-safe formatting */
+static char system_decimal_point[8] = ".";
 
 int init_locale(void)
 {
@@ -261,6 +263,11 @@ int init_locale(void)
         /* don't enable need_locale, since the system locale is C */
         return RETURN_SUCCESS;
     } else {
+        struct lconv *lc = localeconv();
+        if (lc && !string_is_empty(lc->decimal_point) &&
+            strlen(lc->decimal_point) < sizeof(system_decimal_point)) {
+            strcpy(system_decimal_point, lc->decimal_point);
+        }
         system_locale_string = copy_string(NULL, s);
         s = setlocale(LC_NUMERIC, "C");
         posix_locale_string = copy_string(NULL, s);
@@ -285,6 +292,35 @@ void set_locale_num(int flag)
 #endif
 }
 
+/*
+ * replace the decimal points of a number formatted in the POSIX locale by
+ * that of the system locale; unlike set_locale_num(), this doesn't switch
+ * the locale of the process and thus is safe to call from worker threads
+ */
+char *localize_decimal_point(char *s, size_t size)
+{
+    size_t dplen = strlen(system_decimal_point), len;
+    char *p;
+    
+    if (!s || !strcmp(system_decimal_point, ".")) {
+        return s;
+    }
+    
+    len = strlen(s);
+    p = s;
+    while ((p = strchr(p, '.')) != NULL) {
+        if (len + dplen - 1 >= size) {
+            break;
+        }
+        memmove(p + dplen, p + 1, len - (p - s));
+        memcpy(p, system_decimal_point, dplen);
+        len += dplen - 1;
+        p += dplen;
+    }
+    
+    return s;
+}
+
 #ifdef __WIN32
 # include <windows.h>
 int init_gethostname(void)
@@ -100,6 +100,23 @@ int device_set_procs(Device_entry *d,
     return RETURN_SUCCESS;
 }
 
+/* symbol instancing is optional; all three procs must be given */
+int device_set_symbol_procs(Device_entry *d,
+    DevBeginSymbolProc   beginsymbol,
+    DevEndSymbolProc     endsymbol,
+    DevPutSymbolProc     putsymbol)
+{
+    if (!beginsymbol || !endsymbol || !putsymbol) {
+        return RETURN_FAILURE;
+    }
+    
+    d->beginsymbol = beginsymbol;
+    d->endsymbol   = endsymbol;
+    d->putsymbol   = putsymbol;
+    
+    return RETURN_SUCCESS;
+}
+
 int device_set_dpi(Device_entry *d, float dpi)
 {
     Page_geometry *pg = &d->pg;
@@ -166,6 +183,17 @@ Page_geometry *get_page_geometry(const Canvas *canvas)
     }
 }
 
+/* number of device pixels per viewport unit of the current device */
+double get_page_scale(const Canvas *canvas)
+{
+    Page_geometry *pg = get_page_geometry(canvas);
+    if (pg) {
+        return (double) MIN2(pg->width, pg->height);
+    } else {
+        return 0.0;
+    }
+}
+
 int get_device_page_dimensions(const Canvas *canvas,
     unsigned int dindex, int *wpp, int *hpp)
 {
@@ -296,6 +324,16 @@ int terminal_device(const Canvas *canvas)
     }
 }
 
+/* whether the current device renders onto a pixel grid */
+int raster_device(const Canvas *canvas)
+{
+    if (canvas->curdevice->type == DEVICE_TERM || canvas->curdevice->is_xrst) {
+        return TRUE;
+    } else {
+        return FALSE;
+    }
+}
+
 int device_is_aux(const Canvas *canvas, unsigned int dindex)
 {
     Device_entry *dev = get_device_props(canvas, dindex);
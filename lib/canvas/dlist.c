@@ -0,0 +1,404 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ *
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ *
+ * Copyright (c) 2012 Grace Development Team
+ *
+ * Maintained by Evgeny Stambulchik
+ *
+ *
+ *                           All Rights Reserved
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Display list of the device primitives, recorded during the dry pass of
+ * two-pass devices and replayed into the device in the second one
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "grace/baseP.h"
+#include "grace/canvasP.h"
+
+typedef enum {
+    DLIST_PIXEL,
+    DLIST_POLYLINE,
+    DLIST_FILLPOLYGON,
+    DLIST_ARC,
+    DLIST_FILLARC,
+    DLIST_PIXMAP,
+    DLIST_TEXT,
+    DLIST_SYMBOL_BEGIN,
+    DLIST_SYMBOL_END,
+    DLIST_SYMBOL_PUT
+} DListOp;
+
+typedef struct {
+    DListOp op;
+    unsigned int props;         /* index of the drawing properties */
+    int n;                      /* number of points; string length */
+    int mode;
+    VPoint vp1, vp2;
+    double a1, a2;
+    unsigned long data;         /* offset of the variable-size data */
+} DListItem;
+
+/* text arguments, followed by the string in the data pool */
+typedef struct {
+    TextMatrix tm;
+    int font;
+    int underline;
+    int overline;
+    int kerning;
+} DListText;
+
+struct _DisplayList {
+    unsigned int nitems;
+    unsigned int nitems_allocated;
+    DListItem *items;
+    
+    unsigned int nprops;
+    unsigned int nprops_allocated;
+    DrawProps *props;
+    
+    unsigned long poolsize;
+    unsigned long pool_allocated;
+    char *pool;
+    
+    unsigned long size;         /* total memory used */
+    unsigned long maxsize;
+    int overflow;               /* gave up recording */
+};
+
+/* keep the pool entries aligned for doubles */
+#define DLIST_ALIGN(n) (((n) + SIZEOF_DOUBLE - 1)/SIZEOF_DOUBLE*SIZEOF_DOUBLE)
+
+DisplayList *dlist_new(unsigned long maxsize)
+{
+    DisplayList *dl = xmalloc(sizeof(DisplayList));
+    if (dl) {
+        memset(dl, 0, sizeof(DisplayList));
+        dl->maxsize = maxsize;
+    }
+    
+    return dl;
+}
+
+void dlist_free(DisplayList *dl)
+{
+    if (dl) {
+        xfree(dl->items);
+        xfree(dl->props);
+        xfree(dl->pool);
+        xfree(dl);
+    }
+}
+
+/* once over the memory limit, drop everything and stop recording */
+static void dlist_overflow(DisplayList *dl)
+{
+    XCFREE(dl->items);
+    XCFREE(dl->props);
+    XCFREE(dl->pool);
+    dl->nitems = dl->nitems_allocated = 0;
+    dl->nprops = dl->nprops_allocated = 0;
+    dl->poolsize = dl->pool_allocated = 0;
+    dl->size = 0;
+    dl->overflow = TRUE;
+}
+
+static int dlist_grow(DisplayList *dl, void **p, unsigned int *nallocated,
+    unsigned int n, size_t elsize)
+{
+    if (n > *nallocated) {
+        unsigned int na = MAX2(2*(*nallocated), 64);
+        void *pnew;
+        
+        if (dl->size + (na - *nallocated)*elsize > dl->maxsize ||
+            !(pnew = xrealloc(*p, na*elsize))) {
+            dlist_overflow(dl);
+            return RETURN_FAILURE;
+        }
+        dl->size += (na - *nallocated)*elsize;
+        *p = pnew;
+        *nallocated = na;
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+/* reserve room for size bytes in the data pool; returns the offset */
+static int dlist_pool_alloc(DisplayList *dl, unsigned long size,
+    unsigned long *offset)
+{
+    size = DLIST_ALIGN(size);
+    if (dl->poolsize + size > dl->pool_allocated) {
+        unsigned long na = MAX2(2*dl->pool_allocated, dl->poolsize + size);
+        char *pnew;
+        
+        na = MAX2(na, 4096);
+        if (dl->size + (na - dl->pool_allocated) > dl->maxsize ||
+            !(pnew = xrealloc(dl->pool, na))) {
+            dlist_overflow(dl);
+            return RETURN_FAILURE;
+        }
+        dl->size += na - dl->pool_allocated;
+        dl->pool = pnew;
+        dl->pool_allocated = na;
+    }
+    
+    *offset = dl->poolsize;
+    dl->poolsize += size;
+    
+    return RETURN_SUCCESS;
+}
+
+static DListItem *dlist_add(DisplayList *dl, DListOp op, const DrawProps *dp)
+{
+    DListItem *item;
+    
+    if (!dl || dl->overflow) {
+        return NULL;
+    }
+    
+    /* the drawing properties are only stored when they change */
+    if (!dl->nprops ||
+        memcmp(&dl->props[dl->nprops - 1], dp, sizeof(DrawProps))) {
+        if (dlist_grow(dl, (void **) &dl->props, &dl->nprops_allocated,
+            dl->nprops + 1, sizeof(DrawProps)) != RETURN_SUCCESS) {
+            return NULL;
+        }
+        dl->props[dl->nprops++] = *dp;
+    }
+    
+    if (dlist_grow(dl, (void **) &dl->items, &dl->nitems_allocated,
+        dl->nitems + 1, sizeof(DListItem)) != RETURN_SUCCESS) {
+        return NULL;
+    }
+    
+    item = &dl->items[dl->nitems++];
+    memset(item, 0, sizeof(DListItem));
+    item->op    = op;
+    item->props = dl->nprops - 1;
+    
+    return item;
+}
+
+/* add an item with n points */
+static void dlist_add_points(DisplayList *dl, DListOp op, const DrawProps *dp,
+    const VPoint *vps, int n, int mode)
+{
+    DListItem *item = dlist_add(dl, op, dp);
+    unsigned long offset;
+    
+    if (item) {
+        if (dlist_pool_alloc(dl, n*sizeof(VPoint), &offset) != RETURN_SUCCESS) {
+            return;
+        }
+        memcpy(dl->pool + offset, vps, n*sizeof(VPoint));
+        item->n    = n;
+        item->mode = mode;
+        item->data = offset;
+    }
+}
+
+void dlist_add_pixel(DisplayList *dl, const DrawProps *dp, const VPoint *vp)
+{
+    DListItem *item = dlist_add(dl, DLIST_PIXEL, dp);
+    if (item) {
+        item->vp1 = *vp;
+    }
+}
+
+void dlist_add_polyline(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vps, int n, int mode)
+{
+    dlist_add_points(dl, DLIST_POLYLINE, dp, vps, n, mode);
+}
+
+void dlist_add_fillpolygon(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vps, int nc)
+{
+    dlist_add_points(dl, DLIST_FILLPOLYGON, dp, vps, nc, 0);
+}
+
+void dlist_add_arc(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vp1, const VPoint *vp2, double a1, double a2, int fill,
+    int mode)
+{
+    DListItem *item = dlist_add(dl, fill ? DLIST_FILLARC:DLIST_ARC, dp);
+    if (item) {
+        item->vp1  = *vp1;
+        item->vp2  = *vp2;
+        item->a1   = a1;
+        item->a2   = a2;
+        item->mode = mode;
+    }
+}
+
+void dlist_add_pixmap(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vp, const CPixmap *pm)
+{
+    DListItem *item = dlist_add(dl, DLIST_PIXMAP, dp);
+    unsigned long offset, bsize;
+    
+    if (item) {
+        bsize = PADBITS(pm->width*pm->bpp, pm->pad)*pm->height/8;
+        if (dlist_pool_alloc(dl, sizeof(CPixmap) + bsize, &offset) !=
+            RETURN_SUCCESS) {
+            return;
+        }
+        memcpy(dl->pool + offset, pm, sizeof(CPixmap));
+        memcpy(dl->pool + offset + sizeof(CPixmap), pm->bits, bsize);
+        item->vp1  = *vp;
+        item->data = offset;
+    }
+}
+
+void dlist_add_text(DisplayList *dl, const DrawProps *dp,
+    const VPoint *vp, const char *s, int len, int font, const TextMatrix *tm,
+    int underline, int overline, int kerning)
+{
+    DListItem *item = dlist_add(dl, DLIST_TEXT, dp);
+    unsigned long offset;
+    
+    if (item) {
+        DListText *t;
+        
+        if (dlist_pool_alloc(dl, sizeof(DListText) + len, &offset) !=
+            RETURN_SUCCESS) {
+            return;
+        }
+        t = (DListText *) (dl->pool + offset);
+        t->tm        = *tm;
+        t->font      = font;
+        t->underline = underline;
+        t->overline  = overline;
+        t->kerning   = kerning;
+        memcpy(dl->pool + offset + sizeof(DListText), s, len);
+        item->vp1  = *vp;
+        item->n    = len;
+        item->data = offset;
+    }
+}
+
+/* the symbol id goes to n; its extent to vp1-vp2 */
+void dlist_add_symbol_begin(DisplayList *dl, const DrawProps *dp,
+    int id, const view *bbox)
+{
+    DListItem *item = dlist_add(dl, DLIST_SYMBOL_BEGIN, dp);
+    if (item) {
+        item->n     = id;
+        item->vp1.x = bbox->xv1;
+        item->vp1.y = bbox->yv1;
+        item->vp2.x = bbox->xv2;
+        item->vp2.y = bbox->yv2;
+    }
+}
+
+void dlist_add_symbol_end(DisplayList *dl, const DrawProps *dp)
+{
+    dlist_add(dl, DLIST_SYMBOL_END, dp);
+}
+
+void dlist_add_symbol_put(DisplayList *dl, const DrawProps *dp,
+    int id, const VPoint *vp)
+{
+    DListItem *item = dlist_add(dl, DLIST_SYMBOL_PUT, dp);
+    if (item) {
+        item->n   = id;
+        item->vp1 = *vp;
+    }
+}
+
+int dlist_is_complete(const DisplayList *dl)
+{
+    return dl && !dl->overflow;
+}
+
+/* feed the recorded primitives to the current device */
+void dlist_replay(Canvas *canvas, const DisplayList *dl)
+{
+    Device_entry *dev = canvas->curdevice;
+    DrawProps saved_props = canvas->draw_props;
+    unsigned int i;
+    
+    for (i = 0; i < dl->nitems; i++) {
+        const DListItem *item = &dl->items[i];
+        const char *data = dl->pool + item->data;
+        
+        canvas->draw_props = dl->props[item->props];
+        
+        switch (item->op) {
+        case DLIST_PIXEL:
+            dev->drawpixel(canvas, dev->devdata, &item->vp1);
+            break;
+        case DLIST_POLYLINE:
+            dev->drawpolyline(canvas, dev->devdata,
+                (const VPoint *) data, item->n, item->mode);
+            break;
+        case DLIST_FILLPOLYGON:
+            dev->fillpolygon(canvas, dev->devdata,
+                (const VPoint *) data, item->n);
+            break;
+        case DLIST_ARC:
+            dev->drawarc(canvas, dev->devdata,
+                &item->vp1, &item->vp2, item->a1, item->a2);
+            break;
+        case DLIST_FILLARC:
+            dev->fillarc(canvas, dev->devdata,
+                &item->vp1, &item->vp2, item->a1, item->a2, item->mode);
+            break;
+        case DLIST_PIXMAP:
+            {
+                CPixmap pm = *((const CPixmap *) data);
+                pm.bits = (char *) data + sizeof(CPixmap);
+                dev->putpixmap(canvas, dev->devdata, &item->vp1, &pm);
+            }
+            break;
+        case DLIST_TEXT:
+            {
+                const DListText *t = (const DListText *) data;
+                dev->puttext(canvas, dev->devdata, &item->vp1,
+                    data + sizeof(DListText), item->n, t->font, &t->tm,
+                    t->underline, t->overline, t->kerning);
+            }
+            break;
+        case DLIST_SYMBOL_BEGIN:
+            {
+                view bbox;
+                bbox.xv1 = item->vp1.x;
+                bbox.yv1 = item->vp1.y;
+                bbox.xv2 = item->vp2.x;
+                bbox.yv2 = item->vp2.y;
+                dev->beginsymbol(canvas, dev->devdata, item->n, &bbox);
+            }
+            break;
+        case DLIST_SYMBOL_END:
+            dev->endsymbol(canvas, dev->devdata);
+            break;
+        case DLIST_SYMBOL_PUT:
+            dev->putsymbol(canvas, dev->devdata, item->n, &item->vp1);
+            break;
+        }
+    }
+    
+    canvas->draw_props = saved_props;
+}
@@ -68,6 +68,9 @@ static DrawProps default_draw_props =
 void canvas_dev_drawpixel(Canvas *canvas, const VPoint *vp)
 {
     canvas_stats_update(canvas, CANVAS_STATS_COLOR);
+    if (canvas->dlist) {
+        dlist_add_pixel(canvas->dlist, &canvas->draw_props, vp);
+    }
     if (!canvas->drypass) {
         canvas->curdevice->drawpixel(canvas, canvas->curdevice->devdata, vp);
     }
@@ -77,6 +80,9 @@ void canvas_dev_drawpolyline(Canvas *canvas,
     const VPoint *vps, int n, int mode)
 {
     canvas_stats_update(canvas, CANVAS_STATS_LINE);
+    if (canvas->dlist) {
+        dlist_add_polyline(canvas->dlist, &canvas->draw_props, vps, n, mode);
+    }
     if (!canvas->drypass) {
         canvas->curdevice->drawpolyline(canvas, canvas->curdevice->devdata,
             vps, n, mode);
@@ -86,6 +92,9 @@ void canvas_dev_drawpolyline(Canvas *canvas,
 void canvas_dev_fillpolygon(Canvas *canvas, const VPoint *vps, int nc)
 {
     canvas_stats_update(canvas, CANVAS_STATS_PEN);
+    if (canvas->dlist) {
+        dlist_add_fillpolygon(canvas->dlist, &canvas->draw_props, vps, nc);
+    }
     if (!canvas->drypass) {
         canvas->curdevice->fillpolygon(canvas, canvas->curdevice->devdata,
             vps, nc);
@@ -96,6 +105,10 @@ void canvas_dev_drawarc(Canvas *canvas,
     const VPoint *vp1, const VPoint *vp2, double a1, double a2)
 {
     canvas_stats_update(canvas, CANVAS_STATS_LINE);
+    if (canvas->dlist) {
+        dlist_add_arc(canvas->dlist, &canvas->draw_props,
+            vp1, vp2, a1, a2, FALSE, 0);
+    }
     if (!canvas->drypass) {
         canvas->curdevice->drawarc(canvas, canvas->curdevice->devdata,
             vp1, vp2, a1, a2);
@@ -106,6 +119,10 @@ void canvas_dev_fillarc(Canvas *canvas,
     const VPoint *vp1, const VPoint *vp2, double a1, double a2, int mode)
 {
     canvas_stats_update(canvas, CANVAS_STATS_PEN);
+    if (canvas->dlist) {
+        dlist_add_arc(canvas->dlist, &canvas->draw_props,
+            vp1, vp2, a1, a2, TRUE, mode);
+    }
     if (!canvas->drypass) {
         canvas->curdevice->fillarc(canvas, canvas->curdevice->devdata,
             vp1, vp2, a1, a2, mode);
@@ -132,6 +149,9 @@ void canvas_dev_putpixmap(Canvas *canvas, const VPoint *vp, const CPixmap *pm)
             }
         }
     }
+    if (canvas->dlist) {
+        dlist_add_pixmap(canvas->dlist, &canvas->draw_props, vp, pm);
+    }
     if (!canvas->drypass) {
         canvas->curdevice->putpixmap(canvas, canvas->curdevice->devdata, vp, pm);
     }
@@ -146,6 +166,10 @@ void canvas_dev_puttext(Canvas *canvas,
     } else {
         canvas_stats_update(canvas, CANVAS_STATS_PEN);
         canvas_char_stats_update(canvas, font, s, len);
+        if (canvas->dlist) {
+            dlist_add_text(canvas->dlist, &canvas->draw_props,
+                vp, s, len, font, tm, underline, overline, kerning);
+        }
         if (!canvas->drypass) {
             canvas->curdevice->puttext(canvas, canvas->curdevice->devdata,
                 vp, s, len, font, tm, underline, overline, kerning);
@@ -177,6 +201,8 @@ int canvas_init(void)
     return init_t1();
 }
 
+static const view invalid_view = {-1.0, -1.0, -1.0, -1.0};
+
 Canvas *canvas_new(void)
 {
     Canvas *canvas;
@@ -201,6 +227,14 @@ Canvas *canvas_new(void)
         canvas->fmap_proc    = fmap_proc_default;
         canvas->fscale       = 1.0;
         canvas->lscale       = 1.0;
+        
+        canvas_set_update_region(canvas, NULL);
+        
+        canvas->gcache = glyph_cache_new(GLYPH_CACHE_DEFAULT_SIZE);
+        if (!canvas->gcache) {
+            canvas_free(canvas);
+            return NULL;
+        }
     }
     
     return canvas;
@@ -211,12 +245,13 @@ void canvas_free(Canvas *canvas)
     if (canvas) {
         /* free fonts */
         while (canvas->nfonts) {
-            FontDB *f = &canvas->FontDBtable[canvas->nfonts - 1];
-            xfree(f->alias);
+            font_db_entry_free(&canvas->FontDBtable[canvas->nfonts - 1]);
             canvas->nfonts--;
         }
         xfree(canvas->FontDBtable);
         
+        glyph_cache_free(canvas->gcache);
+        
         /* free colors, patterns, linestyles */
         realloc_colors(canvas, 0);
         realloc_patterns(canvas, 0);
@@ -235,6 +270,8 @@ void canvas_free(Canvas *canvas)
         xfree(canvas->docname);
         xfree(canvas->description);
         
+        xfree(canvas->symbols);
+        
         /* ... and the structure itself */
         xfree(canvas);
     }
@@ -506,6 +543,28 @@ void canvas_set_pagefill(Canvas *canvas, int flag)
     canvas->pagefill = flag;
 }
 
+/*
+ * restrict the output of canvas_draw() to a part of the page; devices
+ * that support it clip their drawing to the region. NULL resets it to the
+ * whole page.
+ */
+void canvas_set_update_region(Canvas *canvas, const view *v)
+{
+    if (v) {
+        canvas->update_region = *v;
+    } else {
+        canvas->update_region = invalid_view;
+    }
+}
+
+/* returns FALSE if the whole page is to be drawn */
+int canvas_get_update_region(const Canvas *canvas, view *v)
+{
+    *v = canvas->update_region;
+    
+    return is_valid_bbox(v);
+}
+
 void canvas_set_prstream(Canvas *canvas, void *prstream)
 {
     canvas->prstream = prstream;
@@ -991,61 +1050,59 @@ static int is_inside_boundary(const VPoint *vp,
 /* TODO: implement fpcomp() */
 #define FPCMP_EPS      1.0e-6
 /*
- * line_intersect() returns pointer to the intersection point of two
- * lines defined by points vp1, vp2 and vp1p, vp2p respectively. 
- * If the lines don't intersect, return NULL.
+ * line_intersect() stores in vpi the intersection point of two
+ * lines defined by points vp1, vp2 and vp1p, vp2p respectively and
+ * returns TRUE. If the lines don't intersect, return FALSE.
  * If mode == LINE_INFINTE, the second line is assumed to be infinite.
  * Note!! If the lines have more than single intersection point (parallel
- * partially coinsiding lines), the function returns NULL, too.
+ * partially coinsiding lines), the function returns FALSE, too.
  * The routine uses the Liang-Barsky algorithm, slightly modified for the
  * sake of generality (but for the price of performance) 
  */
-VPoint *line_intersect(const VPoint *vp1, const VPoint *vp2,
-    const VPoint *vp1p, const VPoint *vp2p, int mode)
+int line_intersect(const VPoint *vp1, const VPoint *vp2,
+    const VPoint *vp1p, const VPoint *vp2p, int mode, VPoint *vpi)
 {
-    static VPoint vpbuf;
     double vprod, t, tp;
     
     vprod = (vp2p->x - vp1p->x)*(vp2->y - vp1->y) -
             (vp2->x - vp1->x)*(vp2p->y - vp1p->y);
     if (vprod == 0) {
-        return NULL;
+        return FALSE;
     } else {
         t = ((vp1->x - vp1p->x)*vp2p->y + 
              (vp2p->x - vp1->x)*vp1p->y - 
              (vp2p->x - vp1p->x)*vp1->y)/vprod;
         if ((t >= 0.0 - FPCMP_EPS) && (t <= 1.0 + FPCMP_EPS)) {
-            vpbuf.x = vp1->x + t*(vp2->x - vp1->x);
-            vpbuf.y = vp1->y + t*(vp2->y - vp1->y);
+            vpi->x = vp1->x + t*(vp2->x - vp1->x);
+            vpi->y = vp1->y + t*(vp2->y - vp1->y);
             
             if (mode == LINE_INFINITE) {
-                return &vpbuf;
+                return TRUE;
             } else {
                 if (vp1p->x != vp2p->x) {
-                    tp = (vpbuf.x - vp1p->x)/(vp2p->x - vp1p->x);
+                    tp = (vpi->x - vp1p->x)/(vp2p->x - vp1p->x);
                 } else {
-                    tp = (vpbuf.y - vp1p->y)/(vp2p->y - vp1p->y);
+                    tp = (vpi->y - vp1p->y)/(vp2p->y - vp1p->y);
                 }
                 
                 if ((tp >= 0.0 - FPCMP_EPS) && (tp <= 1.0 + FPCMP_EPS)) {
-                    return &vpbuf;
+                    return TRUE;
                 } else {
-                    return NULL;
+                    return FALSE;
                 }
             }
         } else {
-            return NULL;
+            return FALSE;
         }
     }
 }
 
-/* size of buffer array used in polygon clipping */
-static int polybuf_length;
-
-int intersect_polygon(VPoint *vps, int n, const VPoint *vp1p, const VPoint *vp2p)
+/* polybuf_length is the size of the vps buffer used in polygon clipping */
+int intersect_polygon(VPoint *vps, int polybuf_length, int n,
+    const VPoint *vp1p, const VPoint *vp2p)
 {
     int i, nc, ishift;
-    VPoint vp1, vp2, *vpp;
+    VPoint vp1, vp2, vpi;
     
     nc = 0;
     ishift = polybuf_length - n;
@@ -1060,18 +1117,17 @@ int intersect_polygon(VPoint *vps, int n, const VPoint *vp1p, const VPoint *vp2p
                 vps[nc] = vp2;
                 nc++;
             } else {
-                vpp = line_intersect(&vp1, &vp2, vp1p, vp2p, LINE_INFINITE);
-                if (vpp != NULL) {
-                    vps[nc] = *vpp;
+                if (line_intersect(&vp1, &vp2, vp1p, vp2p,
+                    LINE_INFINITE, &vpi)) {
+                    vps[nc] = vpi;
                     nc++;
                 }
                 vps[nc] = vp2;
                 nc++;
             }
         } else if (is_inside_boundary(&vp1, vp1p, vp2p)) {
-            vpp = line_intersect(&vp1, &vp2, vp1p, vp2p, LINE_INFINITE);
-            if (vpp != NULL) {
-                vps[nc] = *vpp;
+            if (line_intersect(&vp1, &vp2, vp1p, vp2p, LINE_INFINITE, &vpi)) {
+                vps[nc] = vpi;
                 nc++;
             }
         }
@@ -1086,8 +1142,6 @@ static int clip_polygon(VPoint *vps, int n, const view *clipview)
     int nc, na;
     VPoint vpsa[5];
     
-    polybuf_length = 2*n;
-    
     vpsa[0].x = clipview->xv1;
     vpsa[0].y = clipview->yv1;
     vpsa[1].x = clipview->xv2;
@@ -1100,7 +1154,7 @@ static int clip_polygon(VPoint *vps, int n, const view *clipview)
     
     nc = n;
     for (na = 0; na < 4; na++) {
-        nc = intersect_polygon(vps, nc, &vpsa[na], &vpsa[na + 1]);
+        nc = intersect_polygon(vps, 2*n, nc, &vpsa[na], &vpsa[na + 1]);
         if (nc < 2) {
             break;
         }
@@ -1146,7 +1200,7 @@ int clip_line(const Canvas *canvas,
     int ends_found = 0;
     int na;
     int vp1_ok = FALSE, vp2_ok = FALSE;
-    VPoint *vpp, vptmp[2], vpsa[5];
+    VPoint vptmp[2], vpsa[5];
     
     if (is_validVPoint(canvas, vp1)) {
         vp1_ok = TRUE;
@@ -1175,9 +1229,8 @@ int clip_line(const Canvas *canvas,
         
         na = 0;
         while ((ends_found < 2) && na < 4) {
-            if ((vpp = line_intersect(vp1, vp2, &vpsa[na], &vpsa[na + 1],
-                LINE_FINITE)) != NULL) {
-                vptmp[ends_found] = *vpp;
+            if (line_intersect(vp1, vp2, &vpsa[na], &vpsa[na + 1],
+                LINE_FINITE, &vptmp[ends_found])) {
                 ends_found++;
             }
             na++;
@@ -1876,7 +1929,6 @@ void initialize_linestyles(Canvas *canvas)
  * ---------------- bbox utilities --------------------
  */
 
-static const view invalid_view = {-1.0, -1.0, -1.0, -1.0};
 
 void reset_bbox(Canvas *canvas, int type)
 {
@@ -1972,6 +2024,16 @@ int merge_bboxes(const view *v1, const view *v2, view *v)
     }
 }
 
+int views_overlap(const view *v1, const view *v2)
+{
+    if (!is_valid_bbox(v1) || !is_valid_bbox(v2)) {
+        return FALSE;
+    } else {
+        return (v1->xv1 <= v2->xv2 && v2->xv1 <= v1->xv2 &&
+                v1->yv1 <= v2->yv2 && v2->yv1 <= v1->yv2);
+    }
+}
+
 void update_bbox(Canvas *canvas, int type, const VPoint *vp)
 {
     BBox_type *bbp;
@@ -2051,6 +2113,12 @@ void activate_bbox(Canvas *canvas, int type, int status)
     bbp->active = status;
 }
 
+/* Make the view invalid, i.e., empty */
+void view_invalidate(view *v)
+{
+    *v = invalid_view;
+}
+
 /* Extend all view boundaries with w */
 int view_extend(view *v, double w)
 {
@@ -2255,13 +2323,22 @@ static void canvas_stats_free(CanvasStats *cstats)
     }
 }
 
+/*
+ * Two-pass devices need the statistics of the whole drawing up front. The
+ * first, dry pass gathers them while recording the device primitives into a
+ * display list, which the second pass replays instead of running dproc
+ * again (unless the list has grown over DISPLAY_LIST_MAX_SIZE).
+ */
 int canvas_draw(Canvas *canvas, CanvasDrawProc dproc, void *data)
 {
     unsigned int npasses, passno;
     CanvasStats *cstats;
+    DisplayList *dl = NULL;
+    BBox_type bboxes[2];
     
     if (canvas->curdevice->twopass) {
         npasses = 2;
+        dl = dlist_new(DISPLAY_LIST_MAX_SIZE);
     } else {
         npasses = 1;
     }
@@ -2279,14 +2356,19 @@ int canvas_draw(Canvas *canvas, CanvasDrawProc dproc, void *data)
         activate_bbox(canvas, BBOX_TYPE_GLOB, FALSE);
         activate_bbox(canvas, BBOX_TYPE_TEMP, FALSE);
         canvas_stats_reset(canvas);
+        canvas->nsymbols = 0;
         
         if (!canvas->drypass) {
             if (cstats && !is_valid_bbox(&cstats->bbox)) {
                 errmsg("Nothing to draw?!");
+                canvas_stats_free(cstats);
+                dlist_free(dl);
                 return RETURN_FAILURE;
             }
             if (initgraphics(canvas, cstats) != RETURN_SUCCESS) {
                 errmsg("Device wasn't properly initialized");
+                canvas_stats_free(cstats);
+                dlist_free(dl);
                 return RETURN_FAILURE;
             }
         }
@@ -2315,6 +2397,12 @@ int canvas_draw(Canvas *canvas, CanvasDrawProc dproc, void *data)
                 vp1.y = 0.0;
                 get_page_viewport(canvas, &vp2.x, &vp2.y);
             }
+            if (is_valid_bbox(&canvas->update_region)) {
+                vp1.x = MAX2(vp1.x, canvas->update_region.xv1);
+                vp1.y = MAX2(vp1.y, canvas->update_region.yv1);
+                vp2.x = MIN2(vp2.x, canvas->update_region.xv2);
+                vp2.y = MIN2(vp2.y, canvas->update_region.yv2);
+            }
             
             setcolor(canvas, getbgcolor(canvas));
             setpattern(canvas, 1);
@@ -2324,7 +2412,18 @@ int canvas_draw(Canvas *canvas, CanvasDrawProc dproc, void *data)
 
         activate_bbox(canvas, BBOX_TYPE_GLOB, TRUE);
         
-        dproc(canvas, data);
+        if (canvas->drypass) {
+            canvas->dlist = dl;
+            dproc(canvas, data);
+            canvas->dlist = NULL;
+            memcpy(bboxes, canvas->bboxes, sizeof(bboxes));
+        } else if (dlist_is_complete(dl)) {
+            dlist_replay(canvas, dl);
+            /* the bounding boxes are those of the recorded drawing */
+            memcpy(canvas->bboxes, bboxes, sizeof(bboxes));
+        } else {
+            dproc(canvas, data);
+        }
         
         if (!cstats) {
             cstats = canvas_stats(canvas);
@@ -2336,6 +2435,132 @@ int canvas_draw(Canvas *canvas, CanvasDrawProc dproc, void *data)
     }
     
     canvas_stats_free(cstats);
+    dlist_free(dl);
     
     return RETURN_SUCCESS;
 }
+
+/*
+ * run dproc without producing any output, returning the bounding box of
+ * what it would draw
+ */
+int canvas_measure(Canvas *canvas,
+    CanvasDrawProc dproc, void *data, view *bbox)
+{
+    int drypass = canvas->drypass;
+    
+    canvas->drypass = TRUE;
+    
+    reset_bboxes(canvas);
+    activate_bbox(canvas, BBOX_TYPE_GLOB, TRUE);
+    activate_bbox(canvas, BBOX_TYPE_TEMP, FALSE);
+    
+    dproc(canvas, data);
+    
+    canvas->drypass = drypass;
+    
+    return get_bbox(canvas, BBOX_TYPE_GLOB, bbox);
+}
+
+/*
+ * Define a symbol drawn by dproc around the origin, to be stamped later with
+ * canvas_symbol_put(). Returns the symbol id or -1 if the device can't
+ * instance symbols, in which case the caller should draw each copy itself.
+ */
+int canvas_symbol_define(Canvas *canvas, CanvasDrawProc dproc, void *data)
+{
+    Device_entry *dev = canvas->curdevice;
+    BBox_type bboxes[2];
+    DrawProps draw_props;
+    DisplayList *dl;
+    int clipflag, id;
+    view bbox, *p;
+    
+    if (!dev || !dev->beginsymbol || !dev->endsymbol || !dev->putsymbol) {
+        return -1;
+    }
+    
+    memcpy(bboxes, canvas->bboxes, sizeof(bboxes));
+    draw_props = canvas->draw_props;
+    clipflag   = canvas->clipflag;
+    dl         = canvas->dlist;
+    
+    canvas->clipflag = FALSE;
+    canvas->dlist    = NULL;
+    if (canvas_measure(canvas, dproc, data, &bbox) != RETURN_SUCCESS ||
+        !is_valid_bbox(&bbox)) {
+        memcpy(canvas->bboxes, bboxes, sizeof(bboxes));
+        canvas->draw_props = draw_props;
+        canvas->clipflag   = clipflag;
+        canvas->dlist      = dl;
+        return -1;
+    }
+    canvas->draw_props = draw_props;
+    canvas->dlist      = dl;
+    
+    p = xrealloc(canvas->symbols, (canvas->nsymbols + 1)*sizeof(view));
+    if (!p) {
+        memcpy(canvas->bboxes, bboxes, sizeof(bboxes));
+        canvas->clipflag = clipflag;
+        return -1;
+    }
+    canvas->symbols = p;
+    id = canvas->nsymbols++;
+    canvas->symbols[id] = bbox;
+    
+    /* the definition itself doesn't contribute to the drawing extent */
+    activate_bbox(canvas, BBOX_TYPE_GLOB, FALSE);
+    activate_bbox(canvas, BBOX_TYPE_TEMP, FALSE);
+    
+    if (get_draw_mode(canvas)) {
+        if (canvas->dlist) {
+            dlist_add_symbol_begin(canvas->dlist,
+                &canvas->draw_props, id, &bbox);
+        }
+        if (!canvas->drypass) {
+            dev->beginsymbol(canvas, dev->devdata, id, &bbox);
+        }
+        
+        dproc(canvas, data);
+        
+        if (canvas->dlist) {
+            dlist_add_symbol_end(canvas->dlist, &canvas->draw_props);
+        }
+        if (!canvas->drypass) {
+            dev->endsymbol(canvas, dev->devdata);
+        }
+    }
+    
+    memcpy(canvas->bboxes, bboxes, sizeof(bboxes));
+    canvas->draw_props = draw_props;
+    canvas->clipflag   = clipflag;
+    
+    return id;
+}
+
+/* stamp symbol id with its origin at vp */
+void canvas_symbol_put(Canvas *canvas, int id, const VPoint *vp)
+{
+    Device_entry *dev = canvas->curdevice;
+    view v;
+    
+    if (id < 0 || (unsigned int) id >= canvas->nsymbols) {
+        return;
+    }
+    
+    if (get_draw_mode(canvas)) {
+        if (canvas->dlist) {
+            dlist_add_symbol_put(canvas->dlist, &canvas->draw_props, id, vp);
+        }
+        if (!canvas->drypass) {
+            dev->putsymbol(canvas, dev->devdata, id, vp);
+        }
+    }
+    
+    v = canvas->symbols[id];
+    v.xv1 += vp->x;
+    v.xv2 += vp->x;
+    v.yv1 += vp->y;
+    v.yv2 += vp->y;
+    update_bboxes_with_view(canvas, &v);
+}
@@ -39,8 +39,6 @@
 
 #define MIF_MARGIN 15.0
 
-static double page_side = 0.0;
-
 /* mapping between Grace and MIF fill patterns. This is really ugly but
  * MIF uses only 16 patterns which can only be customised on UNIX platforms
  * and there only for the whole FrameMaker-product and not for a single
@@ -118,11 +116,11 @@ static int mif_fillpattern(int fillpattern)
 }
 
 /*
- * escape special characters
+ * escape special characters; the returned string must be freed by the caller
  */
 static char *escape_specials(unsigned char *s, int len)
 {
-    static char *es = NULL;
+    char *es;
     int i, elen = 0;
     
     /* Define Array with all charactercodes from 128 to 255 for the
@@ -169,7 +167,10 @@ static char *escape_specials(unsigned char *s, int len)
         elen++;
     }
     
-    es = xrealloc(es, (elen + 1)*SIZEOF_CHAR);
+    es = xmalloc((elen + 1)*SIZEOF_CHAR);
+    if (!es) {
+        return NULL;
+    }
     
     elen = 0;
     
@@ -387,10 +388,25 @@ static void mif_drawpixel(const Canvas *canvas, void *data, const VPoint *vp)
 
 }
 
+static void mif_points(FILE *prstream, double side, const VPoint *vps, int n)
+{
+    OutBuf ob;
+    int i;
+    
+    outbuf_init(&ob, prstream);
+    for (i = 0; i < n; i++) {
+        outbuf_puts(&ob, "   <Point ");
+        outbuf_putf(&ob, vps[i].x*side + MIF_MARGIN, 8, 3);
+        outbuf_puts(&ob, " pt ");
+        outbuf_putf(&ob, (1.0 - vps[i].y)*side + MIF_MARGIN, 8, 3);
+        outbuf_puts(&ob, ">\n");
+    }
+    outbuf_flush(&ob);
+}
+
 static void mif_drawpolyline(const Canvas *canvas, void *data,
     const VPoint *vps, int n, int mode)
 {
-    int i;
     double side;
     FILE *prstream = canvas_get_prstream(canvas);
 
@@ -402,10 +418,7 @@ static void mif_drawpolyline(const Canvas *canvas, void *data,
         fprintf(prstream, "  <PolyLine\n");
     }
     mif_object_props(canvas, side, TRUE, FALSE);
-    for (i = 0; i < n; i++) {
-        fprintf(prstream, "   <Point %8.3f pt %8.3f>\n",
-                vps[i].x*side + MIF_MARGIN, (1.0 - vps[i].y)*side + MIF_MARGIN);
-    }
+    mif_points(prstream, side, vps, n);
     if (mode == POLYLINE_CLOSED) {
         fprintf(prstream, "  > # end of Polygon\n");
     } else {
@@ -434,7 +447,6 @@ static void mif_drawpolyline(const Canvas *canvas, void *data,
 static void mif_fillpolygon(const Canvas *canvas, void *data,
     const VPoint *vps, int nc)
 {
-    int i;
     double side;
     FILE *prstream = canvas_get_prstream(canvas);
 
@@ -442,10 +454,7 @@ static void mif_fillpolygon(const Canvas *canvas, void *data,
     
     fprintf(prstream, "  <Polygon\n");
     mif_object_props(canvas, side, FALSE, TRUE);
-    for (i = 0; i < nc; i++) {
-        fprintf(prstream, "   <Point %8.3f pt %8.3f>\n",
-                vps[i].x*side + MIF_MARGIN, (1.0 - vps[i].y)*side + MIF_MARGIN);
-    }
+    mif_points(prstream, side, vps, nc);
     fprintf(prstream, "  > # end of Polygon\n");
 }
 
@@ -635,7 +644,7 @@ static void mif_puttext(const Canvas *canvas, void *data,
     const VPoint *vp, const char *s, int len, int font, const TextMatrix *tm,
     int underline, int overline, int kerning)
 {
-    char *fontalias, *fontfullname;
+    char *fontalias, *fontfullname, *es;
     double angle, side, size;
     Pen pen;
     FILE *prstream = canvas_get_prstream(canvas);
@@ -722,8 +731,9 @@ static void mif_puttext(const Canvas *canvas, void *data,
             (kerning == TRUE) ? "Yes" : "No");
     fprintf(prstream, "    <FColor `Color%d'>\n", pen.color);
     fprintf(prstream, "   > # end of Font\n");
-    fprintf(prstream, "   <String `%s'>\n",
-            escape_specials((unsigned char *) s, len));
+    es = escape_specials((unsigned char *) s, len);
+    fprintf(prstream, "   <String `%s'>\n", es ? es : "");
+    xfree(es);
     fprintf(prstream, "  > # end of TextLine\n");
 }
 
@@ -763,9 +773,17 @@ static void mif_leavegraphics(const Canvas *canvas, void *data,
 int register_mif_drv(Canvas *canvas)
 {
     Device_entry *d;
+    double *page_side;
+
+    page_side = xmalloc(sizeof(double));
+    if (!page_side) {
+        return -1;
+    }
+    *page_side = 0.0;
 
-    d = device_new("MIF", DEVICE_FILE, TRUE, (void *) &page_side, NULL);
+    d = device_new("MIF", DEVICE_FILE, TRUE, (void *) page_side, xfree);
     if (!d) {
+        xfree(page_side);
         return -1;
     }
     
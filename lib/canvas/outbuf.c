@@ -0,0 +1,210 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ *
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ *
+ * Copyright (c) 2012 Grace Development Team
+ *
+ * Maintained by Evgeny Stambulchik
+ *
+ *
+ *                           All Rights Reserved
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Buffered output of numbers for the vector drivers. Fixed-point values are
+ * converted without going through printf(), yet give the very same digits
+ * as printf("%*.*f").
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+
+#include "grace/baseP.h"
+#define CANVAS_BACKEND_API
+#include "grace/canvas.h"
+
+#define OUTBUF_MAXPREC  9
+
+static const double pow10_tab[OUTBUF_MAXPREC + 1] = {
+    1.0e0, 1.0e1, 1.0e2, 1.0e3, 1.0e4, 1.0e5, 1.0e6, 1.0e7, 1.0e8, 1.0e9
+};
+
+void outbuf_init(OutBuf *ob, FILE *fp)
+{
+    ob->fp  = fp;
+    ob->len = 0;
+}
+
+void outbuf_flush(OutBuf *ob)
+{
+    if (ob->len) {
+        fwrite(ob->buf, 1, ob->len, ob->fp);
+        ob->len = 0;
+    }
+}
+
+static void outbuf_write(OutBuf *ob, const char *s, unsigned int len)
+{
+    if (ob->len + len > OUTBUF_SIZE) {
+        outbuf_flush(ob);
+        if (len > OUTBUF_SIZE) {
+            fwrite(s, 1, len, ob->fp);
+            return;
+        }
+    }
+    memcpy(ob->buf + ob->len, s, len);
+    ob->len += len;
+}
+
+void outbuf_puts(OutBuf *ob, const char *s)
+{
+    outbuf_write(ob, s, strlen(s));
+}
+
+void outbuf_putc(OutBuf *ob, char c)
+{
+    if (ob->len == OUTBUF_SIZE) {
+        outbuf_flush(ob);
+    }
+    ob->buf[ob->len++] = c;
+}
+
+/*
+ * v in units of 10^-prec, rounded as printf() would do it. Fails for values
+ * out of the range of long and for the (rare) ties too close to call in
+ * double precision.
+ */
+int outbuf_round(double v, int prec, long *n)
+{
+    double r, fl, f, eps;
+    
+    if (prec < 0 || prec > OUTBUF_MAXPREC) {
+        return RETURN_FAILURE;
+    }
+    
+    r = v*pow10_tab[prec];
+    if (!(fabs(r) < (double) (LONG_MAX/2))) {
+        /* including NaNs */
+        return RETURN_FAILURE;
+    }
+    
+    fl  = floor(r);
+    f   = r - fl;
+    eps = 4*DBL_EPSILON*(fabs(r) + 1.0);
+    if (fabs(f - 0.5) <= eps) {
+        return RETURN_FAILURE;
+    }
+    
+    *n = (long) fl + (f > 0.5 ? 1:0);
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * Format n*10^-prec into buf (at least 24 + prec bytes), returning the
+ * length. With compact, trailing zeros of the fraction are dropped.
+ */
+static int fixed_format(char *buf, long n, int neg, int prec, int compact)
+{
+    char digits[32];
+    unsigned long u;
+    int nd = 0, len = 0, i;
+    
+    if (n < 0) {
+        neg = TRUE;
+        u = -(unsigned long) n;
+    } else {
+        u = n;
+    }
+    
+    do {
+        digits[nd++] = '0' + u%10;
+        u /= 10;
+    } while (u);
+    while (nd <= prec) {
+        digits[nd++] = '0';
+    }
+    
+    if (compact) {
+        int nz = 0;
+        while (nz < prec && digits[nz] == '0') {
+            nz++;
+        }
+        if (nz == nd - 1 && digits[nd - 1] == '0') {
+            /* no "-0" */
+            neg = FALSE;
+        }
+        if (neg) {
+            buf[len++] = '-';
+        }
+        for (i = nd - 1; i >= nz; i--) {
+            if (i == prec - 1) {
+                buf[len++] = '.';
+            }
+            buf[len++] = digits[i];
+        }
+    } else {
+        if (neg) {
+            buf[len++] = '-';
+        }
+        for (i = nd - 1; i >= 0; i--) {
+            if (i == prec - 1) {
+                buf[len++] = '.';
+            }
+            buf[len++] = digits[i];
+        }
+    }
+    
+    return len;
+}
+
+/* same as fprintf(fp, "%*.*f", width, prec, v) */
+void outbuf_putf(OutBuf *ob, double v, int width, int prec)
+{
+    char buf[512];
+    long n;
+    int len;
+    
+    if (outbuf_round(v, prec, &n) == RETURN_SUCCESS) {
+        /* printf() keeps the sign of negative values rounded to zero */
+        int neg = (v < 0.0 || (v == 0.0 && 1.0/v < 0.0));
+        len = fixed_format(buf, n, neg, prec, FALSE);
+    } else {
+        len = sprintf(buf, "%.*f", prec, v);
+    }
+    
+    while (width > len) {
+        outbuf_putc(ob, ' ');
+        width--;
+    }
+    outbuf_write(ob, buf, len);
+}
+
+/* write n*10^-prec; compact drops the trailing zeros */
+void outbuf_putfixed(OutBuf *ob, long n, int prec, int compact)
+{
+    char buf[64];
+    int len;
+    
+    len = fixed_format(buf, n, FALSE, prec, compact);
+    outbuf_write(ob, buf, len);
+}
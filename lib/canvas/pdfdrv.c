@@ -78,6 +78,8 @@ static void pdf_data_free(void *data)
     if (pdfdata) {
         xfree(pdfdata->font_ids);
         xfree(pdfdata->pattern_ids);
+        xfree(pdfdata->symbol_ids);
+        xfree(pdfdata->symbol_bboxes);
         xfree(pdfdata);
     }
 }
@@ -119,6 +121,17 @@ static size_t pdf_writeproc(PDF *p, void *data, size_t size)
     return fwrite(data, 1, size, fp);
 }
 
+/* undefine all graphics state parameters */
+static void pdf_reset_state(PDF_data *pdfdata)
+{
+    pdfdata->color    = -1;
+    pdfdata->pattern  = -1;
+    pdfdata->linew    = -1.0;
+    pdfdata->lines    = -1;
+    pdfdata->linecap  = -1;
+    pdfdata->linejoin = -1;
+}
+
 int pdf_initgraphics(const Canvas *canvas, void *data, const CanvasStats *cstats)
 {
     PDF_data *pdfdata = (PDF_data *) data;
@@ -132,13 +145,8 @@ int pdf_initgraphics(const Canvas *canvas, void *data, const CanvasStats *cstats
     pdfdata->pixel_size  = 1.0/pdfdata->page_scale;
     pdfdata->page_scalef = (float) pdfdata->page_scale*72.0/pg->dpi;
 
-    /* undefine all graphics state parameters */
-    pdfdata->color    = -1;
-    pdfdata->pattern  = -1;
-    pdfdata->linew    = -1.0;
-    pdfdata->lines    = -1;
-    pdfdata->linecap  = -1;
-    pdfdata->linejoin = -1;
+    pdf_reset_state(pdfdata);
+    pdfdata->nsymbols = 0;
 
     pdfdata->phandle = PDF_new2(pdf_error_handler,
         NULL, NULL, NULL, canvas_get_prstream(canvas));
@@ -668,6 +676,73 @@ void pdf_puttext(const Canvas *canvas, void *data,
     PDF_restore(pdfdata->phandle);
 }
 
+/*
+ * Symbols are defined as templates (form XObjects). The template has its own
+ * graphics state, so the cached one is invalidated on both ends.
+ */
+static void pdf_beginsymbol(const Canvas *canvas, void *data,
+    int id, const view *bbox)
+{
+    PDF_data *pdfdata = (PDF_data *) data;
+    view v = *bbox;
+    int tmpl;
+    
+    /* leave room for the antialiased edges */
+    v.xv1 -= pdfdata->pixel_size;
+    v.xv2 += pdfdata->pixel_size;
+    v.yv1 -= pdfdata->pixel_size;
+    v.yv2 += pdfdata->pixel_size;
+    
+    tmpl = PDF_begin_template_ext(pdfdata->phandle,
+        v.xv2 - v.xv1, v.yv2 - v.yv1, "");
+    PDF_translate(pdfdata->phandle, -v.xv1, -v.yv1);
+    
+    pdf_reset_state(pdfdata);
+    
+    if ((unsigned int) id >= pdfdata->nsymbols) {
+        int *p;
+        view *pv;
+        
+        p = xrealloc(pdfdata->symbol_ids, (id + 1)*SIZEOF_INT);
+        if (p) {
+            pdfdata->symbol_ids = p;
+        }
+        pv = xrealloc(pdfdata->symbol_bboxes, (id + 1)*sizeof(view));
+        if (pv) {
+            pdfdata->symbol_bboxes = pv;
+        }
+        if (!p || !pv) {
+            return;
+        }
+        pdfdata->nsymbols = id + 1;
+    }
+    
+    pdfdata->symbol_ids[id]    = tmpl;
+    pdfdata->symbol_bboxes[id] = v;
+}
+
+static void pdf_endsymbol(const Canvas *canvas, void *data)
+{
+    PDF_data *pdfdata = (PDF_data *) data;
+    
+    PDF_end_template(pdfdata->phandle);
+    
+    pdf_reset_state(pdfdata);
+}
+
+static void pdf_putsymbol(const Canvas *canvas, void *data,
+    int id, const VPoint *vp)
+{
+    PDF_data *pdfdata = (PDF_data *) data;
+    
+    if ((unsigned int) id < pdfdata->nsymbols) {
+        /* the templates are in the (scaled) page units */
+        PDF_fit_image(pdfdata->phandle, pdfdata->symbol_ids[id],
+            vp->x + pdfdata->symbol_bboxes[id].xv1,
+            vp->y + pdfdata->symbol_bboxes[id].yv1, "");
+    }
+}
+
 void pdf_leavegraphics(const Canvas *canvas, void *data,
     const CanvasStats *cstats)
 {
@@ -685,6 +760,9 @@ void pdf_leavegraphics(const Canvas *canvas, void *data,
     PDF_delete(pdfdata->phandle);
     XCFREE(pdfdata->font_ids);
     XCFREE(pdfdata->pattern_ids);
+    XCFREE(pdfdata->symbol_ids);
+    XCFREE(pdfdata->symbol_bboxes);
+    pdfdata->nsymbols = 0;
 }
 
 static void pdf_error_handler(PDF *p, int type, const char *msg)
@@ -798,6 +876,8 @@ int register_pdf_drv(Canvas *canvas)
         pdf_putpixmap,
         pdf_puttext);
     
+    device_set_symbol_procs(d, pdf_beginsymbol, pdf_endsymbol, pdf_putsymbol);
+    
     return register_device(canvas, d);
 }
 
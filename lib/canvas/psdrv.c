@@ -185,6 +185,17 @@ static int ps_embedded_font(const char *fname, int embed_type)
     }
 }
 
+/* undefine all graphics state parameters */
+static void ps_reset_state(PS_data *psdata)
+{
+    psdata->color = -1;
+    psdata->pattern = -1;
+    psdata->linew = -1.0;
+    psdata->lines = -1;
+    psdata->linecap = -1;
+    psdata->linejoin = -1;
+}
+
 static int ps_initgraphics(const Canvas *canvas, void *data,
     const CanvasStats *cstats)
 {
@@ -214,13 +225,7 @@ static int ps_initgraphics(const Canvas *canvas, void *data,
         psdata->page_orientation = PAGE_ORIENT_PORTRAIT;
     }
     
-    /* undefine all graphics state parameters */
-    psdata->color = -1;
-    psdata->pattern = -1;
-    psdata->linew = -1.0;
-    psdata->lines = -1;
-    psdata->linecap = -1;
-    psdata->linejoin = -1;
+    ps_reset_state(psdata);
     
     /* CMYK is a PS2 feature */
     if (psdata->level2 == FALSE && psdata->colorspace == PS_COLORSPACE_CMYK) {
@@ -731,24 +736,47 @@ static void ps_drawpixel(const Canvas *canvas, void *data, const VPoint *vp)
     fprintf(prstream, "%.4f %.4f PXL\n", vp->x, vp->y);
 }
 
+static void ps_putpoint(OutBuf *ob, const VPoint *vp, const char *op)
+{
+    outbuf_putf(ob, vp->x, 0, 4);
+    outbuf_putc(ob, ' ');
+    outbuf_putf(ob, vp->y, 0, 4);
+    outbuf_putc(ob, ' ');
+    outbuf_puts(ob, op);
+}
+
+/* a new path through the points; closed paths return to the first one */
+static void ps_path(FILE *prstream, const VPoint *vps, int n, int closed)
+{
+    OutBuf ob;
+    int i;
+    
+    outbuf_init(&ob, prstream);
+    
+    outbuf_puts(&ob, "n\n");
+    ps_putpoint(&ob, &vps[0], "m\n");
+    for (i = 1; i < n; i++) {
+        ps_putpoint(&ob, &vps[i], "l\n");
+    }
+    if (closed) {
+        ps_putpoint(&ob, &vps[0], "l\n");
+    }
+    
+    outbuf_flush(&ob);
+}
+
 static void ps_drawpolyline(const Canvas *canvas, void *data,
     const VPoint *vps, int n, int mode)
 {
     PS_data *psdata = (PS_data *) data;
-    int i;
     FILE *prstream = canvas_get_prstream(canvas);
     
     ps_setdrawbrush(canvas, psdata);
     
     ps_setlineprops(canvas, psdata);
     
-    fprintf(prstream, "n\n");
-    fprintf(prstream, "%.4f %.4f m\n", vps[0].x, vps[0].y);
-    for (i = 1; i < n; i++) {
-        fprintf(prstream, "%.4f %.4f l\n", vps[i].x, vps[i].y);
-    }
+    ps_path(prstream, vps, n, mode == POLYLINE_CLOSED);
     if (mode == POLYLINE_CLOSED) {
-        fprintf(prstream, "%.4f %.4f l\n", vps[0].x, vps[0].y);
         fprintf(prstream, "c\n");
     }
     fprintf(prstream, "s\n");
@@ -758,7 +786,6 @@ static void ps_fillpolygon(const Canvas *canvas, void *data,
     const VPoint *vps, int nc)
 {
     PS_data *psdata = (PS_data *) data;
-    int i;
     Pen pen;
     FILE *prstream = canvas_get_prstream(canvas);
 
@@ -768,11 +795,7 @@ static void ps_fillpolygon(const Canvas *canvas, void *data,
         return;
     }
     
-    fprintf(prstream, "n\n");
-    fprintf(prstream, "%.4f %.4f m\n", vps[0].x, vps[0].y);
-    for (i = 1; i < nc; i++) {
-        fprintf(prstream, "%.4f %.4f l\n", vps[i].x, vps[i].y);
-    }
+    ps_path(prstream, vps, nc, FALSE);
     fprintf(prstream, "c\n");
 
     /* fill bg first if the pattern != solid */
@@ -1071,6 +1094,43 @@ static void ps_puttext(const Canvas *canvas, void *data,
     fprintf(prstream, "GR\n");
 }
 
+/*
+ * Symbols become procedures taking the origin from the stack. Their bodies
+ * aren't executed when defined, so the cached graphics state is invalidated
+ * on both ends of the definition.
+ */
+static void ps_beginsymbol(const Canvas *canvas, void *data,
+    int id, const view *bbox)
+{
+    PS_data *psdata = (PS_data *) data;
+    FILE *prstream = canvas_get_prstream(canvas);
+    
+    fprintf(prstream, "/Sym%d {\n", id);
+    fprintf(prstream, "GS\n");
+    fprintf(prstream, "translate\n");
+    
+    ps_reset_state(psdata);
+}
+
+static void ps_endsymbol(const Canvas *canvas, void *data)
+{
+    PS_data *psdata = (PS_data *) data;
+    FILE *prstream = canvas_get_prstream(canvas);
+    
+    fprintf(prstream, "GR\n");
+    fprintf(prstream, "} def\n");
+    
+    ps_reset_state(psdata);
+}
+
+static void ps_putsymbol(const Canvas *canvas, void *data,
+    int id, const VPoint *vp)
+{
+    FILE *prstream = canvas_get_prstream(canvas);
+    
+    fprintf(prstream, "%.4f %.4f Sym%d\n", vp->x, vp->y, id);
+}
+
 
 static void ps_leavegraphics(const Canvas *canvas, void *data,
     const CanvasStats *cstats)
@@ -1252,6 +1312,8 @@ int register_ps_drv(Canvas *canvas)
         ps_putpixmap,
         ps_puttext);
     
+    device_set_symbol_procs(d, ps_beginsymbol, ps_endsymbol, ps_putsymbol);
+    
     return register_device(canvas, d);
     
 }
@@ -1291,5 +1353,7 @@ int register_eps_drv(Canvas *canvas)
         ps_putpixmap,
         ps_puttext);
     
+    device_set_symbol_procs(d, ps_beginsymbol, ps_endsymbol, ps_putsymbol);
+    
     return register_device(canvas, d);
 }
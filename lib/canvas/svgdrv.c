@@ -137,6 +137,7 @@ typedef struct {
     int    linestyle;
     int    draw;
     int    fill;
+    int    compact;
 } Svg_data;
 
 static Svg_data *init_svg_data(const Canvas *canvas)
@@ -256,15 +257,19 @@ static void define_pattern(const Canvas *canvas, Svg_data *svgdata, unsigned int
 }
 
 /*
- * escape special characters and use Unicode for non ISO-8859-1 characters
+ * escape special characters and use Unicode for non ISO-8859-1 characters;
+ * the returned string must be freed by the caller
  */
 static char *escape_specials(const Canvas *canvas,
     unsigned char *s, int len, int font)
 {
-    static char *es = NULL;
+    char *es;
     int i, j;
 
-    es = xrealloc(es, (len * 8 + 1)*SIZEOF_CHAR);
+    es = xmalloc((len * 8 + 1)*SIZEOF_CHAR);
+    if (!es) {
+        return NULL;
+    }
     es[0] = '\0';
 
     for (i = 0; i < len; i++) {
@@ -338,6 +343,7 @@ static int svg_initgraphics(const Canvas *canvas, void *data,
     fprintf(prstream,
         "<!-- generated by %s -->\n", "Grace/libcanvas");
     fprintf(prstream, "<svg xml:space=\"preserve\" ");
+    fprintf(prstream, "xmlns:xlink=\"http://www.w3.org/1999/xlink\" ");
     fprintf(prstream,
         "width=\"%.4fin\" height=\"%.4fin\" viewBox=\"%.4f %.4f %.4f %.4f\">\n",
         page_width_in(canvas), page_height_in(canvas),
@@ -512,11 +518,60 @@ static void svg_drawpixel(const Canvas *canvas, void *data, const VPoint *vp)
             scaleval(data, 1.0), scaleval(data, 1.0));
 }
 
+/*
+ * The path data; the compact form uses relative moves between the rounded
+ * positions (so the precision isn't affected) and drops trailing zeros.
+ */
+static void svg_path(const Canvas *canvas, Svg_data *svgdata,
+    const VPoint *vps, int n, const char *indent)
+{
+    OutBuf ob;
+    long x, y, xprev = 0, yprev = 0;
+    int i, relative = FALSE;
+
+    outbuf_init(&ob, canvas_get_prstream(canvas));
+
+    for (i = 0; i < n; i++) {
+        double xs = scaleval(svgdata, vps[i].x), ys = scaleval(svgdata, vps[i].y);
+
+        if (i && i%10 == 0) {
+            outbuf_putc(&ob, '\n');
+            outbuf_puts(&ob, indent);
+        }
+
+        if (svgdata->compact &&
+            outbuf_round(xs, 4, &x) == RETURN_SUCCESS &&
+            outbuf_round(ys, 4, &y) == RETURN_SUCCESS) {
+            if (relative) {
+                outbuf_putc(&ob, 'l');
+                outbuf_putfixed(&ob, x - xprev, 4, TRUE);
+                outbuf_putc(&ob, ',');
+                outbuf_putfixed(&ob, y - yprev, 4, TRUE);
+            } else {
+                outbuf_putc(&ob, i ? 'L':'M');
+                outbuf_putfixed(&ob, x, 4, TRUE);
+                outbuf_putc(&ob, ',');
+                outbuf_putfixed(&ob, y, 4, TRUE);
+                relative = TRUE;
+            }
+            xprev = x;
+            yprev = y;
+        } else {
+            outbuf_putc(&ob, i ? 'L':'M');
+            outbuf_putf(&ob, xs, 0, 4);
+            outbuf_putc(&ob, ',');
+            outbuf_putf(&ob, ys, 0, 4);
+            relative = FALSE;
+        }
+    }
+
+    outbuf_flush(&ob);
+}
+
 static void svg_drawpolyline(const Canvas *canvas, void *data,
     const VPoint *vps, int n, int mode)
 {
     Svg_data *svgdata = (Svg_data *) data;
-    int i;
     FILE *prstream = canvas_get_prstream(canvas);
 
     if (n <= 0) {
@@ -524,15 +579,8 @@ static void svg_drawpolyline(const Canvas *canvas, void *data,
     }
 
     svg_group_props(canvas, svgdata, TRUE, FALSE);
-    fprintf(prstream, "   <path d=\"M%.4f,%.4f",
-            scaleval(data, vps[0].x), scaleval(data, vps[0].y));
-    for (i = 1; i < n; i++) {
-        if (i%10 == 0) {
-            fprintf(prstream, "\n            ");
-        }
-        fprintf(prstream,
-            "L%.4f,%.4f", scaleval(data, vps[i].x), scaleval(data, vps[i].y));
-    }
+    fprintf(prstream, "   <path d=\"");
+    svg_path(canvas, svgdata, vps, n, "            ");
     if (mode == POLYLINE_CLOSED) {
         fprintf(prstream, "z\"/>\n");
     } else {
@@ -544,7 +592,6 @@ static void svg_fillpolygon(const Canvas *canvas, void *data,
     const VPoint *vps, int nc)
 {
     Svg_data *svgdata = (Svg_data *) data;
-    int i;
     FILE *prstream = canvas_get_prstream(canvas);
 
     if (nc <= 0) {
@@ -552,15 +599,8 @@ static void svg_fillpolygon(const Canvas *canvas, void *data,
     }
 
     svg_group_props(canvas, svgdata, FALSE, TRUE);
-    fprintf(prstream, "   <path  d=\"M%.4f,%.4f",
-            scaleval(data, vps[0].x), scaleval(data, vps[0].y));
-    for (i = 1; i < nc; i++) {
-        if (i%10 == 0) {
-            fprintf(prstream, "\n             ");
-        }
-        fprintf(prstream,
-            "L%.4f,%.4f", scaleval(data, vps[i].x), scaleval(data, vps[i].y));
-    }
+    fprintf(prstream, "   <path  d=\"");
+    svg_path(canvas, svgdata, vps, nc, "             ");
     fprintf(prstream, "z\"/>\n");
 }
 
@@ -677,7 +717,7 @@ static void svg_puttext(const Canvas *canvas, void *data,
     int underline, int overline, int kerning)
 {
     char *fontalias, *fontfullname, *fontweight;
-    char *dash, *family, *familyff;
+    char *dash, *family, *familyff, *es;
     Svg_data *svgdata = (Svg_data *) data;
     double fsize = svgdata->side;
     FILE *prstream = canvas_get_prstream(canvas);
@@ -794,22 +834,79 @@ static void svg_puttext(const Canvas *canvas, void *data,
             -tm->cxy,-tm->cyy,
             scaleval(data, vp->x), scaleval(data, vp->y));
 
-    fprintf(prstream, "%s", escape_specials(canvas,
-        (unsigned char *) s, len, font));
+    es = escape_specials(canvas, (unsigned char *) s, len, font);
+    if (es) {
+        fprintf(prstream, "%s", es);
+        xfree(es);
+    }
 
     fprintf(prstream, "</text>\n");
 }
 
-static void svg_leavegraphics(const Canvas *canvas, void *data,
-    const CanvasStats *cstats)
+static int svg_op_parser(const Canvas *canvas, void *data, const char *opstring)
 {
     Svg_data *svgdata = (Svg_data *) data;
-    FILE *prstream = canvas_get_prstream(canvas);
 
+    if (!strcmp(opstring, "compact:on")) {
+        svgdata->compact = TRUE;
+        return RETURN_SUCCESS;
+    } else if (!strcmp(opstring, "compact:off")) {
+        svgdata->compact = FALSE;
+        return RETURN_SUCCESS;
+    } else {
+        return RETURN_FAILURE;
+    }
+}
+
+static void svg_close_group(const Canvas *canvas, Svg_data *svgdata)
+{
     if (svgdata->group_is_open == TRUE) {
-        fprintf(prstream, "  </g>\n");
+        fprintf(canvas_get_prstream(canvas), "  </g>\n");
         svgdata->group_is_open = FALSE;
     }
+}
+
+/* symbols are defined as groups and stamped with <use> */
+static void svg_beginsymbol(const Canvas *canvas, void *data,
+    int id, const view *bbox)
+{
+    Svg_data *svgdata = (Svg_data *) data;
+    FILE *prstream = canvas_get_prstream(canvas);
+
+    svg_close_group(canvas, svgdata);
+    fprintf(prstream, " <defs>\n");
+    fprintf(prstream, " <g id=\"sym%d\">\n", id);
+}
+
+static void svg_endsymbol(const Canvas *canvas, void *data)
+{
+    Svg_data *svgdata = (Svg_data *) data;
+    FILE *prstream = canvas_get_prstream(canvas);
+
+    svg_close_group(canvas, svgdata);
+    fprintf(prstream, " </g>\n");
+    fprintf(prstream, " </defs>\n");
+}
+
+static void svg_putsymbol(const Canvas *canvas, void *data,
+    int id, const VPoint *vp)
+{
+    Svg_data *svgdata = (Svg_data *) data;
+    FILE *prstream = canvas_get_prstream(canvas);
+
+    svg_close_group(canvas, svgdata);
+    fprintf(prstream,
+        "  <use xlink:href=\"#sym%d\" x=\"%.4f\" y=\"%.4f\"/>\n",
+        id, scaleval(svgdata, vp->x), scaleval(svgdata, vp->y));
+}
+
+static void svg_leavegraphics(const Canvas *canvas, void *data,
+    const CanvasStats *cstats)
+{
+    Svg_data *svgdata = (Svg_data *) data;
+    FILE *prstream = canvas_get_prstream(canvas);
+
+    svg_close_group(canvas, svgdata);
     fprintf(prstream, " </g>\n");
     fprintf(prstream, "</svg>\n");
 }
@@ -835,7 +932,7 @@ int register_svg_drv(Canvas *canvas)
     device_set_procs(d,
         svg_initgraphics,
         svg_leavegraphics,
-        NULL,
+        svg_op_parser,
         NULL,
         svg_drawpixel,
         svg_drawpolyline,
@@ -845,5 +942,7 @@ int register_svg_drv(Canvas *canvas)
         svg_putpixmap,
         svg_puttext);
     
+    device_set_symbol_procs(d, svg_beginsymbol, svg_endsymbol, svg_putsymbol);
+    
     return register_device(canvas, d);
 }
@@ -39,33 +39,87 @@
 # define T1_GetNoFonts T1_Get_no_fonts
 #endif
 
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+/* T1lib is NOT re-entrant; all calls into it are serialized */
+static pthread_mutex_t t1_mutex = PTHREAD_MUTEX_INITIALIZER;
+#  define T1LIB_LOCK()    pthread_mutex_lock(&t1_mutex)
+#  define T1LIB_UNLOCK()  pthread_mutex_unlock(&t1_mutex)
+#else
+#  define T1LIB_LOCK()
+#  define T1LIB_UNLOCK()
+#endif
+
 int init_t1(void)
 {
-    /* Set log-level */
-    T1_SetLogLevel(T1LOG_DEBUG);
+    int retval = RETURN_SUCCESS;
     
-    /* Initialize t1-library */
-    if (T1_InitLib(T1LOGFILE|IGNORE_CONFIGFILE) == NULL) {
-        return RETURN_FAILURE;
+    T1LIB_LOCK();
+    
+    /* T1lib is process-global; initialize it only once */
+    if (T1_CheckForInit() != 0) {
+        /* Set log-level */
+        T1_SetLogLevel(T1LOG_DEBUG);
+
+        /* Initialize t1-library */
+        if (T1_InitLib(T1LOGFILE|IGNORE_CONFIGFILE) == NULL) {
+            retval = RETURN_FAILURE;
+        } else {
+            /* Rasterization parameters */
+            T1_SetDeviceResolutions(72.0, 72.0);
+            T1_AASetBitsPerPixel(3*CANVAS_BPCC);
+            T1_SetBitmapPad(T1_DEFAULT_BITMAP_PAD);
+        }
     }
     
-    /* Rasterization parameters */
-    T1_SetDeviceResolutions(72.0, 72.0);
-    T1_AASetBitsPerPixel(3*CANVAS_BPCC);
-    T1_SetBitmapPad(T1_DEFAULT_BITMAP_PAD);
+    T1LIB_UNLOCK();
     
-    return RETURN_SUCCESS;
+    return retval;
+}
+
+static void font_db_entry_flush_encoding(FontDB *f)
+{
+    XCFREE(f->info[FONT_INFO_ENCSCHEME]);
+    if (f->charnames) {
+        unsigned int i;
+        for (i = 0; i < 256; i++) {
+            xfree(f->charnames[i]);
+        }
+        XCFREE(f->charnames);
+    }
+}
+
+void font_db_entry_free(FontDB *f)
+{
+    unsigned int i;
+    
+    font_db_entry_flush_encoding(f);
+    for (i = 0; i < FONT_INFO_NITEMS; i++) {
+        xfree(f->info[i]);
+    }
+    xfree(f->alias);
 }
 
 int canvas_set_encoding(Canvas *canvas, char *encfile)
 {
+    unsigned int i;
+    
     if (!encfile) {
         return RETURN_FAILURE;
     }
     
+    T1LIB_LOCK();
     canvas->DefEncoding = T1_LoadEncoding(encfile);
     if (canvas->DefEncoding) {
         T1_SetDefaultEncoding(canvas->DefEncoding);
+    }
+    T1LIB_UNLOCK();
+    
+    if (canvas->DefEncoding) {
+        for (i = 0; i < canvas->nfonts; i++) {
+            font_db_entry_flush_encoding(&canvas->FontDBtable[i]);
+        }
+        canvas_flush_glyph_cache(canvas);
         return RETURN_SUCCESS;
     } else {
         return RETURN_FAILURE;
@@ -76,6 +130,7 @@ int canvas_add_font(Canvas *canvas, char *ffile, const char *alias)
 {
     void *p;
     FontDB *f;
+    int retval = RETURN_SUCCESS;
     
     p = xrealloc(canvas->FontDBtable, (canvas->nfonts + 1)*sizeof(FontDB));
     if (!p) {
@@ -86,13 +141,28 @@ int canvas_add_font(Canvas *canvas, char *ffile, const char *alias)
     f = &canvas->FontDBtable[canvas->nfonts];
     memset(f, 0, sizeof(FontDB));
     
+    T1LIB_LOCK();
+    /* font IDs are global; another canvas may have added this font already */
+    if (T1_GetNoFonts() > (int) canvas->nfonts) {
+        char *fname = T1_GetFontFileName(canvas->nfonts);
+        if (!fname || strcmp(fname, ffile)) {
+            retval = RETURN_FAILURE;
+        }
+    } else
     if (T1_AddFont(ffile) < 0 || T1_GetNoFonts() != canvas->nfonts + 1) {
+        retval = RETURN_FAILURE;
+    }
+    T1LIB_UNLOCK();
+    
+    if (retval != RETURN_SUCCESS) {
         return RETURN_FAILURE;
     }
     
     f->alias = copy_string(NULL, alias);
     canvas->nfonts++;
     
+    canvas_flush_glyph_cache(canvas);
+    
     return RETURN_SUCCESS;
 }
 
@@ -126,41 +196,102 @@ int canvas_get_font_by_name(const Canvas *canvas, const char *fname)
     return BAD_FONT_ID;
 }
 
-char *get_fontfilename(const Canvas *canvas, int font, int abspath)
+/*
+ * T1lib returns font info in static buffers, so keep a private copy in the
+ * font DB of the canvas
+ */
+static char *get_font_info(const Canvas *canvas, int font, FontInfoItem item)
 {
-    if (abspath) {
-        return (T1_GetFontFilePath(font));
-    } else {
-        return (T1_GetFontFileName(font));
+    FontDB *f;
+    char *s;
+    
+    if (font < 0 || (unsigned int) font >= canvas->nfonts) {
+        return NULL;
+    }
+    
+    f = &canvas->FontDBtable[font];
+    if (f->info[item]) {
+        return f->info[item];
+    }
+    
+    T1LIB_LOCK();
+    switch (item) {
+    case FONT_INFO_NAME:
+        s = T1_GetFontName(font);
+        break;
+    case FONT_INFO_FULLNAME:
+        s = T1_GetFullName(font);
+        break;
+    case FONT_INFO_FAMILYNAME:
+        s = T1_GetFamilyName(font);
+        break;
+    case FONT_INFO_WEIGHT:
+        s = T1_GetWeight(font);
+        break;
+    case FONT_INFO_ENCSCHEME:
+        s = T1_GetEncodingScheme(font);
+        break;
+    case FONT_INFO_FILENAME:
+        s = T1_GetFontFileName(font);
+        break;
+    case FONT_INFO_FILEPATH:
+        s = T1_GetFontFilePath(font);
+        break;
+    case FONT_INFO_AFMNAME:
+        s = T1_GetAfmFileName(font);
+        break;
+    case FONT_INFO_AFMPATH:
+        s = T1_GetAfmFilePath(font);
+        break;
+    default:
+        s = NULL;
+        break;
     }
+    /* NULL may just mean the font is not loaded yet - don't cache it */
+    f->info[item] = copy_string(NULL, s);
+    T1LIB_UNLOCK();
+    
+    return f->info[item];
+}
+
+char *get_fontfilename(const Canvas *canvas, int font, int abspath)
+{
+    return get_font_info(canvas, font,
+        abspath ? FONT_INFO_FILEPATH:FONT_INFO_FILENAME);
 }
 
 char *get_afmfilename(const Canvas *canvas, int font, int abspath)
 {
+    FontInfoItem item = abspath ? FONT_INFO_AFMPATH:FONT_INFO_AFMNAME;
     char *s;
 
-    if (abspath) {
-        s = T1_GetAfmFilePath(font);
-    } else {
-        s = T1_GetAfmFileName(font);
-    }
+    s = get_font_info(canvas, font, item);
     
     if (s == NULL) {
+        /* guess the AFM file name from that of the font file */
         char *s1;
-        static char buf[256];
         int len;
         
         s = get_fontfilename(canvas, font, abspath);
+        if (s == NULL) {
+            return NULL;
+        }
         len = strlen(s);
         s1 = s + (len - 1);
         while(s1 && *s1 != '.') {
             len--;
             s1--;
         }
-        strncpy(buf, s, len);
-        buf[len] = '\0';
-        strcat(buf, "afm");
-        return buf;
+        s1 = xmalloc(len + 4);
+        if (s1 == NULL) {
+            return NULL;
+        }
+        strncpy(s1, s, len);
+        s1[len] = '\0';
+        strcat(s1, "afm");
+        canvas->FontDBtable[font].info[item] = s1;
+        
+        return s1;
     } else {
         return s;
     }
@@ -168,22 +299,22 @@ char *get_afmfilename(const Canvas *canvas, int font, int abspath)
 
 char *get_fontname(const Canvas *canvas, int font)
 {
-    return (T1_GetFontName(font));
+    return get_font_info(canvas, font, FONT_INFO_NAME);
 }
 
 char *get_fontfullname(const Canvas *canvas, int font)
 {
-    return (T1_GetFullName(font));
+    return get_font_info(canvas, font, FONT_INFO_FULLNAME);
 }
 
 char *get_fontfamilyname(const Canvas *canvas, int font)
 {
-    return (T1_GetFamilyName(font));
+    return get_font_info(canvas, font, FONT_INFO_FAMILYNAME);
 }
 
 char *get_fontweight(const Canvas *canvas, int font)
 {
-    return (T1_GetWeight(font));
+    return get_font_info(canvas, font, FONT_INFO_WEIGHT);
 }
 
 char *get_fontalias(const Canvas *canvas, int font)
@@ -193,7 +324,7 @@ char *get_fontalias(const Canvas *canvas, int font)
 
 char *get_encodingscheme(const Canvas *canvas, int font)
 {
-    return (T1_GetEncodingScheme(font));
+    return get_font_info(canvas, font, FONT_INFO_ENCSCHEME);
 }
 
 char **get_default_encoding(const Canvas *canvas)
@@ -203,45 +334,105 @@ char **get_default_encoding(const Canvas *canvas)
 
 double get_textline_width(const Canvas *canvas, int font)
 {
-    return (double) T1_GetUnderlineThickness(font)/1000.0;
+    int thickness;
+    
+    T1LIB_LOCK();
+    thickness = T1_GetUnderlineThickness(font);
+    T1LIB_UNLOCK();
+    
+    return (double) thickness/1000.0;
 }
 
 double get_underline_pos(const Canvas *canvas, int font)
 {
-    return (double) T1_GetLinePosition(font, T1_UNDERLINE)/1000.0;
+    int pos;
+    
+    T1LIB_LOCK();
+    pos = T1_GetLinePosition(font, T1_UNDERLINE);
+    T1LIB_UNLOCK();
+    
+    return (double) pos/1000.0;
 }
 
 double get_overline_pos(const Canvas *canvas, int font)
 {
-    return (double) T1_GetLinePosition(font, T1_OVERLINE)/1000.0;
+    int pos;
+    
+    T1LIB_LOCK();
+    pos = T1_GetLinePosition(font, T1_OVERLINE);
+    T1LIB_UNLOCK();
+    
+    return (double) pos/1000.0;
 }
 
 double get_italic_angle(const Canvas *canvas, int font)
 {
-    return (double) T1_GetItalicAngle(font);
+    float angle;
+    
+    T1LIB_LOCK();
+    angle = T1_GetItalicAngle(font);
+    T1LIB_UNLOCK();
+    
+    return (double) angle;
 }
 
 char *get_charname(const Canvas *canvas, int font, char c)
 {
-    return T1_GetCharName(font, c);
+    FontDB *f;
+    unsigned char uc = (unsigned char) c;
+    
+    if (font < 0 || (unsigned int) font >= canvas->nfonts) {
+        return NULL;
+    }
+    
+    f = &canvas->FontDBtable[font];
+    if (!f->charnames) {
+        f->charnames = xcalloc(256, sizeof(char *));
+        if (!f->charnames) {
+            return NULL;
+        }
+    }
+    
+    if (!f->charnames[uc]) {
+        T1LIB_LOCK();
+        f->charnames[uc] = copy_string(NULL, T1_GetCharName(font, c));
+        T1LIB_UNLOCK();
+    }
+    
+    return f->charnames[uc];
 }
 
 
 double *get_kerning_vector(const Canvas *canvas,
     const char *str, int len, int font)
 {
-    if (len < 2 || T1_GetNoKernPairs(font) <= 0) {
+    int npairs;
+    
+    if (len < 2) {
+        return NULL;
+    }
+    
+    T1LIB_LOCK();
+    npairs = T1_GetNoKernPairs(font);
+    T1LIB_UNLOCK();
+    
+    if (npairs <= 0) {
         return NULL;
     } else {
         int i, k, ktot;
         double *kvector;
         
         kvector = xmalloc(len*SIZEOF_DOUBLE);
+        if (!kvector) {
+            return NULL;
+        }
+        T1LIB_LOCK();
         for (i = 0, ktot = 0; i < len - 1; i++) {
             k = T1_GetKerning(font, str[i], str[i + 1]);
             ktot += k;
             kvector[i] = (double) k/1000;
         }
+        T1LIB_UNLOCK();
         if (ktot) {
             kvector[len - 1] = (double) ktot/1000;
         } else {
@@ -255,7 +446,13 @@ double *get_kerning_vector(const Canvas *canvas,
 char *font_subset(const Canvas *canvas,
     int font, char *mask, unsigned long *datalen)
 {
-    return T1_SubsetFont(font, mask, T1_SUBSET_DEFAULT, 64, 16384, datalen);
+    char *data;
+    
+    T1LIB_LOCK();
+    data = T1_SubsetFont(font, mask, T1_SUBSET_DEFAULT, 64, 16384, datalen);
+    T1LIB_UNLOCK();
+    
+    return data;
 }
 
 /* determinant */
@@ -352,23 +549,268 @@ static void set_aa_gray_values(Canvas *canvas,
     
     if (last_fg != fg || last_bg != bg || !(*colors_ok)) {
         make_color_scale(canvas, fg, bg, n, colors);
-
-        if (t1aa == T1_AA_LOW) {
-            T1_AASetGrayValues(colors[0],
-                               colors[1],
-                               colors[2],
-                               colors[3],
-                               colors[4]);
-        } else {
-            T1_AAHSetGrayValues(colors);
-        }
         
         *colors_ok = TRUE;
     }
+}
+
+/* Pass the AA colors to T1lib; must be called with T1lib locked */
+static void t1_set_aa_gray_values(const Canvas *canvas, int t1aa)
+{
+    if (t1aa == T1_AA_LOW) {
+        const unsigned long *colors = canvas->aacolors_low;
+        T1_AASetGrayValues(colors[0],
+                           colors[1],
+                           colors[2],
+                           colors[3],
+                           colors[4]);
+    } else {
+        T1_AAHSetGrayValues((unsigned long *) canvas->aacolors_high);
+    }
 
     T1_AASetLevel(t1aa);
 }
 
+/*
+ * Cache of rasterized strings. The key is everything T1lib gets to see:
+ * the string, the font, size, matrix and modifiers, the raster mode and,
+ * for antialiased output, the gray level pixel values.
+ */
+typedef struct {
+    int font;
+    int len;
+    int modflag;
+    float size;
+    int has_matrix;
+    T1_TMATRIX matrix;
+    int mono;
+    int t1aa;
+    unsigned long gray[T1_AALEVELS_HIGH];
+} GlyphKey;
+
+typedef struct _GlyphCacheEntry {
+    GlyphKey key;
+    char *s;
+    unsigned long hash;
+    
+    GLYPH *glyph;
+    unsigned long size;         /* memory taken, bytes */
+    
+    struct _GlyphCacheEntry *hnext;             /* hash chain */
+    struct _GlyphCacheEntry *prev, *next;       /* LRU list */
+} GlyphCacheEntry;
+
+#define GLYPH_CACHE_NBUCKETS    1024
+
+struct _GlyphCache {
+    GlyphCacheEntry *buckets[GLYPH_CACHE_NBUCKETS];
+    GlyphCacheEntry *head, *tail;       /* most and least recently used */
+    
+    unsigned long size;
+    unsigned long maxsize;
+    
+    unsigned long hits;
+    unsigned long misses;
+};
+
+static unsigned long glyph_key_hash(const GlyphKey *key, const char *s)
+{
+    const unsigned char *p;
+    unsigned long h = 2166136261UL;
+    unsigned int i;
+    
+    p = (const unsigned char *) key;
+    for (i = 0; i < sizeof(GlyphKey); i++) {
+        h = (h ^ p[i])*16777619UL;
+    }
+    p = (const unsigned char *) s;
+    for (i = 0; i < key->len; i++) {
+        h = (h ^ p[i])*16777619UL;
+    }
+    
+    return h;
+}
+
+static unsigned long glyph_memsize(const GLYPH *glyph)
+{
+    unsigned long size = sizeof(GLYPH) + sizeof(GlyphCacheEntry);
+    
+    if (glyph->bits) {
+        size += PAD((glyph->metrics.rightSideBearing -
+                     glyph->metrics.leftSideBearing)*glyph->bpp,
+                    T1_GetBitmapPad())*
+                (glyph->metrics.ascent - glyph->metrics.descent)/8;
+    }
+    
+    return size;
+}
+
+static void glyph_cache_unlink(GlyphCache *gcache, GlyphCacheEntry *e)
+{
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        gcache->head = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        gcache->tail = e->prev;
+    }
+    e->prev = e->next = NULL;
+}
+
+static void glyph_cache_push(GlyphCache *gcache, GlyphCacheEntry *e)
+{
+    e->prev = NULL;
+    e->next = gcache->head;
+    if (gcache->head) {
+        gcache->head->prev = e;
+    } else {
+        gcache->tail = e;
+    }
+    gcache->head = e;
+}
+
+static void glyph_cache_remove(GlyphCache *gcache, GlyphCacheEntry *e)
+{
+    GlyphCacheEntry **ep = &gcache->buckets[e->hash % GLYPH_CACHE_NBUCKETS];
+    
+    while (*ep != e) {
+        ep = &(*ep)->hnext;
+    }
+    *ep = e->hnext;
+    
+    glyph_cache_unlink(gcache, e);
+    gcache->size -= e->size;
+    
+    T1_FreeGlyph(e->glyph);
+    xfree(e->s);
+    xfree(e);
+}
+
+/* drop least recently used entries until the size fits maxsize */
+static void glyph_cache_trim(GlyphCache *gcache, unsigned long maxsize)
+{
+    while (gcache->tail && gcache->size > maxsize) {
+        glyph_cache_remove(gcache, gcache->tail);
+    }
+}
+
+GlyphCache *glyph_cache_new(unsigned long maxsize)
+{
+    GlyphCache *gcache;
+    
+    gcache = xmalloc(sizeof(GlyphCache));
+    if (gcache) {
+        memset(gcache, 0, sizeof(GlyphCache));
+        gcache->maxsize = maxsize;
+    }
+    
+    return gcache;
+}
+
+void glyph_cache_free(GlyphCache *gcache)
+{
+    if (gcache) {
+        glyph_cache_trim(gcache, 0);
+        xfree(gcache);
+    }
+}
+
+static GLYPH *glyph_cache_get(GlyphCache *gcache,
+    const GlyphKey *key, const char *s, unsigned long hash)
+{
+    GlyphCacheEntry *e = gcache->buckets[hash % GLYPH_CACHE_NBUCKETS];
+    
+    while (e) {
+        if (e->hash == hash &&
+            !memcmp(&e->key, key, sizeof(GlyphKey)) &&
+            !memcmp(e->s, s, key->len)) {
+            glyph_cache_unlink(gcache, e);
+            glyph_cache_push(gcache, e);
+            gcache->hits++;
+            return e->glyph;
+        }
+        e = e->hnext;
+    }
+    
+    gcache->misses++;
+    
+    return NULL;
+}
+
+static void glyph_cache_put(GlyphCache *gcache,
+    const GlyphKey *key, const char *s, unsigned long hash, const GLYPH *glyph)
+{
+    GlyphCacheEntry *e;
+    unsigned long size = glyph_memsize(glyph) + key->len;
+    
+    if (size > gcache->maxsize) {
+        return;
+    }
+    glyph_cache_trim(gcache, gcache->maxsize - size);
+    
+    e = xmalloc(sizeof(GlyphCacheEntry));
+    if (!e) {
+        return;
+    }
+    /* a plain assignment wouldn't necessarily copy the padding */
+    memcpy(&e->key, key, sizeof(GlyphKey));
+    e->hash  = hash;
+    e->size  = size;
+    e->s     = xmalloc(key->len);
+    e->glyph = T1_CopyGlyph((GLYPH *) glyph);
+    if (!e->s || !e->glyph) {
+        xfree(e->s);
+        if (e->glyph) {
+            T1_FreeGlyph(e->glyph);
+        }
+        xfree(e);
+        return;
+    }
+    memcpy(e->s, s, key->len);
+    
+    e->hnext = gcache->buckets[hash % GLYPH_CACHE_NBUCKETS];
+    gcache->buckets[hash % GLYPH_CACHE_NBUCKETS] = e;
+    glyph_cache_push(gcache, e);
+    gcache->size += size;
+}
+
+int canvas_set_glyph_cache_size(Canvas *canvas, unsigned long maxsize)
+{
+    GlyphCache *gcache = canvas->gcache;
+    
+    gcache->maxsize = maxsize;
+    glyph_cache_trim(gcache, maxsize);
+    
+    return RETURN_SUCCESS;
+}
+
+void canvas_flush_glyph_cache(Canvas *canvas)
+{
+    glyph_cache_trim(canvas->gcache, 0);
+}
+
+void canvas_get_glyph_cache_stats(const Canvas *canvas,
+    unsigned long *hits, unsigned long *misses, unsigned long *size)
+{
+    GlyphCache *gcache = canvas->gcache;
+    
+    if (hits) {
+        *hits = gcache->hits;
+    }
+    if (misses) {
+        *misses = gcache->misses;
+    }
+    if (size) {
+        *size = gcache->size;
+    }
+}
+
+/*
+ * The returned glyph is a private copy to be freed with T1_FreeGlyph()
+ */
 static GLYPH *GetGlyphString(Canvas *canvas,
     CStringSegment *cs, double dpv, FontRaster fontrast)
 {
@@ -386,6 +828,9 @@ static GLYPH *GetGlyphString(Canvas *canvas,
 
     int modflag;
     T1_TMATRIX matrix, *matrixP;
+    
+    GlyphKey key;
+    unsigned long hash;
 
     if (cs->len == 0) {
         return NULL;
@@ -451,15 +896,54 @@ static GLYPH *GetGlyphString(Canvas *canvas,
         mono = TRUE;
     }
     
+    memset(&key, 0, sizeof(GlyphKey));
+    key.font    = FontID;
+    key.len     = len;
+    key.modflag = modflag;
+    key.size    = Size;
+    if (matrixP) {
+        key.has_matrix = TRUE;
+        key.matrix     = matrix;
+    }
+    key.mono    = mono;
+    
     if (mono != TRUE) {
         set_aa_gray_values(canvas, fg, bg, t1aa);
         
+        key.t1aa = t1aa;
+        if (t1aa == T1_AA_LOW) {
+            memcpy(key.gray, canvas->aacolors_low,
+                T1_AALEVELS_LOW*sizeof(unsigned long));
+        } else {
+            memcpy(key.gray, canvas->aacolors_high,
+                T1_AALEVELS_HIGH*sizeof(unsigned long));
+        }
+    }
+    
+    hash = glyph_key_hash(&key, cs->s);
+    glyph = glyph_cache_get(canvas->gcache, &key, cs->s, hash);
+    if (glyph) {
+        return T1_CopyGlyph(glyph);
+    }
+    
+    /* T1lib keeps the rendered string in a static buffer */
+    T1LIB_LOCK();
+    if (mono != TRUE) {
+        t1_set_aa_gray_values(canvas, t1aa);
         glyph = T1_AASetString(FontID, cs->s, len,
                                    Space, modflag, Size, matrixP);
     } else {
         glyph = T1_SetString(FontID, cs->s, len,
                                    Space, modflag, Size, matrixP);
     }
+    if (glyph) {
+        glyph = T1_CopyGlyph(glyph);
+    }
+    T1LIB_UNLOCK();
+    
+    if (glyph) {
+        glyph_cache_put(canvas->gcache, &key, cs->s, hash, glyph);
+    }
  
     return glyph;
 }
@@ -566,6 +1050,7 @@ static void process_ligatures(CStringSegment *cs)
     char buf_char;
 
     ligtheString = xmalloc((cs->len + 1)*SIZEOF_CHAR);
+    T1LIB_LOCK();
     /* Loop through the characters */
     for (j = 0, m = 0; j < cs->len; j++, m++) {
         if ((k = T1_QueryLigs(cs->font, cs->s[j], &succs, &ligs)) > 0) {
@@ -590,6 +1075,7 @@ static void process_ligatures(CStringSegment *cs)
             ligtheString[m] = cs->s[j];
         }
     }
+    T1LIB_UNLOCK();
     ligtheString[m] = 0;
     
     xfree(cs->s);
@@ -714,7 +1200,7 @@ static int postprocess_cs(Canvas *canvas,
             cglyph->stop.x += vvpshift.x;
             cglyph->stop.y += vvpshift.y;
 
-            cglyph->glyph = T1_CopyGlyph(glyph);
+            cglyph->glyph = glyph;
         } else {
             cglyph->glyph = NULL;
         }
@@ -947,8 +1433,11 @@ CPixmap *canvas_raster_char(Canvas *canvas,
     size_t memsize;
     int pad = T1_GetBitmapPad();
     
+    /* the glyph is in a static buffer of T1lib; keep it locked till copied */
+    T1LIB_LOCK();
     glyph = T1_SetChar(font, c, size, &UNITY_MATRIX);
     if (!glyph || !glyph->bits) {
+        T1LIB_UNLOCK();
         return NULL;
     }
     
@@ -958,10 +1447,12 @@ CPixmap *canvas_raster_char(Canvas *canvas,
 
     pm = xmalloc(sizeof(CPixmap));
     if (!pm) {
+        T1LIB_UNLOCK();
         return NULL;
     }
     pm->bits = xmalloc(memsize);
     if (!pm->bits) {
+        T1LIB_UNLOCK();
         xfree(pm);
         return NULL;
     }
@@ -975,6 +1466,7 @@ CPixmap *canvas_raster_char(Canvas *canvas,
 
     *vshift = glyph->metrics.ascent;
     *hshift = glyph->metrics.leftSideBearing;
+    T1LIB_UNLOCK();
     
     return pm;
 }
@@ -36,18 +36,6 @@
 #define ADVANCED_MEMORY_HANDLERS
 #include "grace/coreP.h"
 
-typedef struct {
-    int xscale;
-    int yscale;
-    int coordinates;
-    double xv_med;
-    double yv_med;
-    double xv_rc;
-    double yv_rc;
-    double fxg_med;
-    double fyg_med;
-} ctrans_data;
-
 static const Quark *get_defining_graph(const Quark *q)
 {
     if (q && q->fid == QFlavorGraph) {
@@ -98,7 +86,11 @@ int object_get_loctype(const Quark *q)
     return COORD_VIEW;
 }
 
-static int get_ctrans_data(const Quark *q, ctrans_data *cd)
+/*
+ * resolve the coordinate transform of the graph q belongs to; the result
+ * can be reused for any number of conversions until the graph changes
+ */
+int ctrans_get_data(const Quark *q, ctrans_data *cd)
 {
     graph *g = graph_get_data(get_defining_graph(q));
     
@@ -108,14 +100,10 @@ static int get_ctrans_data(const Quark *q, ctrans_data *cd)
         } else {
             cd->coordinates = COORDINATES_XY;
         }
-        cd->xscale  = g->xscale;
-        cd->yscale  = g->yscale;
-        cd->xv_med  = g->ccache.xv_med;
-        cd->yv_med  = g->ccache.yv_med;
-        cd->xv_rc   = g->ccache.xv_rc;
-        cd->yv_rc   = g->ccache.yv_rc;
-        cd->fxg_med = g->ccache.fxg_med;
-        cd->fyg_med = g->ccache.fyg_med;
+        cd->xscale = g->xscale;
+        cd->yscale = g->yscale;
+        cd->w      = g->w;
+        cd->cc     = g->ccache;
         
         return RETURN_SUCCESS;
     } else {
@@ -162,25 +150,169 @@ int is_validWPoint(const Quark *q, const WPoint *wp)
     return is_wpoint_inside(wp, &w);
 }
 
-static int world2view(const Quark *q,
-    double x, double y, double *xv, double *yv)
+static double ctrans_xconv(const ctrans_data *cd, double wx)
 {
-    ctrans_data cd;
-    if (get_ctrans_data(q, &cd) != RETURN_SUCCESS) {
+    if ((cd->xscale == SCALE_LOG && wx <= 0.0) ||
+        (cd->xscale == SCALE_REC && wx == 0.0) ||
+        (cd->xscale == SCALE_LOGIT && wx <= 0.0) ||
+        (cd->xscale == SCALE_LOGIT && wx >= 1.0)){
+        return 0.0;
+    } else {
+        return (cd->cc.xv_med + cd->cc.xv_rc*(fscale(wx, cd->xscale) -
+            cd->cc.fxg_med));
+    }
+}
+
+static double ctrans_yconv(const ctrans_data *cd, double wy)
+{
+    if ((cd->yscale == SCALE_LOG && wy <= 0.0) ||
+        (cd->yscale == SCALE_REC && wy == 0.0) ||
+        (cd->yscale == SCALE_LOGIT && wy <= 0.0) ||
+        (cd->yscale == SCALE_LOGIT && wy >= 1.0)) {
+        return 0.0;
+    } else {
+        return (cd->cc.yv_med + cd->cc.yv_rc*(fscale(wy, cd->yscale) -
+            cd->cc.fyg_med));
+    }
+}
+
+/*
+ * ctrans_is_valid_wpoint() checks if a point is inside of the world
+ * rectangle of a resolved transform
+ */
+int ctrans_is_valid_wpoint(const ctrans_data *cd, const WPoint *wp)
+{
+    return is_wpoint_inside(wp, &cd->w);
+}
+
+/*
+ * convert point's world coordinates to viewport using a resolved transform
+ */
+int ctrans_wpoint2vpoint(const ctrans_data *cd, const WPoint *wp, VPoint *vp)
+{
+    if (cd->coordinates == COORDINATES_POLAR) {
+        if (polar2xy(cd->cc.xv_rc*wp->x, cd->cc.yv_rc*wp->y,
+            &vp->x, &vp->y) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        vp->x += cd->cc.xv_med;
+        vp->y += cd->cc.yv_med;
+    } else {
+        vp->x = ctrans_xconv(cd, wp->x);
+        vp->y = ctrans_yconv(cd, wp->y);
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * map a world column to one coordinate of an array of viewport points;
+ * the scale type is switched on once, outside of the inner loops
+ */
+static void ctrans_conv_col(const double *w, int n, int scale,
+    double v_med, double v_rc, double fg_med, double *v)
+{
+    int i;
+    
+    /* v points to the x or y member of VPoint's, hence the stride */
+#define VCOORD(i) v[(i)*(sizeof(VPoint)/sizeof(double))]
+    switch (scale) {
+    case SCALE_NORMAL:
+        for (i = 0; i < n; i++) {
+            VCOORD(i) = v_med + v_rc*(w[i] - fg_med);
+        }
+        break;
+    case SCALE_LOG:
+        for (i = 0; i < n; i++) {
+            double wc = w[i];
+            if (wc > 0.0) {
+                VCOORD(i) = v_med + v_rc*(log10(wc) - fg_med);
+            } else {
+                VCOORD(i) = 0.0;
+            }
+        }
+        break;
+    case SCALE_REC:
+        for (i = 0; i < n; i++) {
+            double wc = w[i];
+            if (wc != 0.0) {
+                VCOORD(i) = v_med + v_rc*(1.0/wc - fg_med);
+            } else {
+                VCOORD(i) = 0.0;
+            }
+        }
+        break;
+    case SCALE_LOGIT:
+        for (i = 0; i < n; i++) {
+            double wc = w[i];
+            if (wc > 0.0 && wc < 1.0) {
+                VCOORD(i) = v_med + v_rc*(log(wc/(1.0 - wc)) - fg_med);
+            } else {
+                VCOORD(i) = 0.0;
+            }
+        }
+        break;
+    default:
+        errmsg("internal error in ctrans_conv_col()");
+        for (i = 0; i < n; i++) {
+            VCOORD(i) = 0.0;
+        }
+        break;
+    }
+#undef VCOORD
+}
+
+/*
+ * convert n points given by columns of world coordinates x and y to
+ * viewport, using a resolved transform. Points that can't be mapped (e.g.,
+ * negative radii of polar graphs) are put at the viewport origin, the same
+ * as non-positive values on a log axis.
+ */
+int ctrans_wcols2vpoints(const ctrans_data *cd,
+    const double *x, const double *y, int n, VPoint *vps)
+{
+    int i;
+    
+    if (!cd || !x || !y || n < 0 || (n && !vps)) {
         return RETURN_FAILURE;
     }
     
-    if (cd.coordinates == COORDINATES_POLAR) {
-        if (polar2xy(cd.xv_rc*x, cd.yv_rc*y, xv, yv) != RETURN_SUCCESS) {
-            return (RETURN_FAILURE);
+    if (cd->coordinates == COORDINATES_POLAR) {
+        double xv_rc = cd->cc.xv_rc, yv_rc = cd->cc.yv_rc;
+        double xv_med = cd->cc.xv_med, yv_med = cd->cc.yv_med;
+        for (i = 0; i < n; i++) {
+            double phi = xv_rc*x[i], rho = yv_rc*y[i];
+            if (rho < 0.0) {
+                vps[i].x = 0.0;
+                vps[i].y = 0.0;
+            } else {
+                vps[i].x = xv_med + rho*cos(phi);
+                vps[i].y = yv_med + rho*sin(phi);
+            }
         }
-        *xv += cd.xv_med;
-        *yv += cd.yv_med;
     } else {
-        *xv = xy_xconv(q, x);
-        *yv = xy_yconv(q, y);
+        ctrans_conv_col(x, n, cd->xscale,
+            cd->cc.xv_med, cd->cc.xv_rc, cd->cc.fxg_med, &vps[0].x);
+        ctrans_conv_col(y, n, cd->yscale,
+            cd->cc.yv_med, cd->cc.yv_rc, cd->cc.fyg_med, &vps[0].y);
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * convert whole columns of world coordinates to viewport; the parent graph
+ * is looked up only once
+ */
+int Wcols2Vpoints(const Quark *q,
+    const double *x, const double *y, int n, VPoint *vps)
+{
+    ctrans_data cd;
+    if (ctrans_get_data(q, &cd) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
     }
-    return (RETURN_SUCCESS);
+    
+    return ctrans_wcols2vpoints(&cd, x, y, n, vps);
 }
 
 /*
@@ -189,35 +321,21 @@ static int world2view(const Quark *q,
 double xy_xconv(const Quark *q, double wx)
 {
     ctrans_data cd;
-    if (get_ctrans_data(q, &cd) != RETURN_SUCCESS) {
+    if (ctrans_get_data(q, &cd) != RETURN_SUCCESS) {
         return FALSE;
     }
     
-    if ((cd.xscale == SCALE_LOG && wx <= 0.0) ||
-        (cd.xscale == SCALE_REC && wx == 0.0) ||
-        (cd.xscale == SCALE_LOGIT && wx <= 0.0) ||
-        (cd.xscale == SCALE_LOGIT && wx >= 1.0)){
-        return 0.0;
-    } else {
-        return (cd.xv_med + cd.xv_rc*(fscale(wx, cd.xscale) - cd.fxg_med));
-    }
+    return ctrans_xconv(&cd, wx);
 }
 
 double xy_yconv(const Quark *q, double wy)
 {
     ctrans_data cd;
-    if (get_ctrans_data(q, &cd) != RETURN_SUCCESS) {
+    if (ctrans_get_data(q, &cd) != RETURN_SUCCESS) {
         return FALSE;
     }
     
-    if ((cd.yscale == SCALE_LOG && wy <= 0.0) ||
-        (cd.yscale == SCALE_REC && wy == 0.0) ||
-        (cd.yscale == SCALE_LOGIT && wy <= 0.0) ||
-        (cd.yscale == SCALE_LOGIT && wy >= 1.0)) {
-        return 0.0;
-    } else {
-        return (cd.yv_med + cd.yv_rc*(fscale(wy, cd.yscale) - cd.fyg_med));
-    }
+    return ctrans_yconv(&cd, wy);
 }
 
 
@@ -226,7 +344,12 @@ double xy_yconv(const Quark *q, double wy)
  */
 int Wpoint2Vpoint(const Quark *q, const WPoint *wp, VPoint *vp)
 {
-    return world2view(q, wp->x, wp->y, &vp->x, &vp->y);
+    ctrans_data cd;
+    if (ctrans_get_data(q, &cd) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    return ctrans_wpoint2vpoint(&cd, wp, vp);
 }
 
 /* check that FPoint is ok */
@@ -399,18 +522,18 @@ double ifscale(double vc, int scale)
 int Vpoint2Wpoint(const Quark *q, const VPoint *vp, WPoint *wp)
 {
     ctrans_data cd;
-    if (get_ctrans_data(q, &cd) != RETURN_SUCCESS) {
+    if (ctrans_get_data(q, &cd) != RETURN_SUCCESS) {
         return RETURN_FAILURE;
     }
     
     if (cd.coordinates == COORDINATES_POLAR) {
-        xy2polar(vp->x - cd.xv_med, vp->y - cd.yv_med, &wp->x, &wp->y);
-        wp->x /= cd.xv_rc;
-        wp->y /= cd.yv_rc;
+        xy2polar(vp->x - cd.cc.xv_med, vp->y - cd.cc.yv_med, &wp->x, &wp->y);
+        wp->x /= cd.cc.xv_rc;
+        wp->y /= cd.cc.yv_rc;
     } else {
-        wp->x = ifscale(cd.fxg_med + (1.0/cd.xv_rc)*(vp->x - cd.xv_med),
+        wp->x = ifscale(cd.cc.fxg_med + (1.0/cd.cc.xv_rc)*(vp->x - cd.cc.xv_med),
             cd.xscale);
-        wp->y = ifscale(cd.fyg_med + (1.0/cd.yv_rc)*(vp->y - cd.yv_med),
+        wp->y = ifscale(cd.cc.fyg_med + (1.0/cd.cc.yv_rc)*(vp->y - cd.cc.yv_med),
             cd.yscale);
     }
     
@@ -131,6 +131,11 @@ DObject *object_data_copy(AMem *amem, DObject *osrc)
     return odest;
 }
 
+static void object_data_touch(AMem *amem, DObject *o)
+{
+    amem_touch(amem, o->odata);
+}
+
 void object_data_free(AMem *amem, DObject *o)
 {
     if (o) {
@@ -145,7 +150,8 @@ int object_qf_register(QuarkFactory *qfactory)
         QFlavorDObject,
         (Quark_data_new) object_data_new,
         (Quark_data_free) object_data_free,
-        (Quark_data_copy) object_data_copy
+        (Quark_data_copy) object_data_copy,
+        (Quark_data_touch) object_data_touch
     };
 
     return quark_flavor_add(qfactory, &qf);
@@ -0,0 +1,412 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ *
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ *
+ * Copyright (c) 2012 Grace Development Team
+ *
+ * Maintained by Evgeny Stambulchik
+ *
+ *
+ *                           All Rights Reserved
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ *
+ * Level-of-detail min/max pyramids for drawing huge XY sets
+ *
+ * For a pair of SSD columns with the abscissas sorted, the pyramid keeps
+ * the row indices of the minimal and maximal ordinate in buckets of
+ * LOD_BASE << level consecutive rows. Given the boundaries of the device
+ * pixel columns, the rows to be drawn are then the first, lowest, highest
+ * and last ones in each pixel column, found in O(log N) per column. A
+ * polyline through those rows covers exactly the same pixels as the one
+ * through all of them.
+ *
+ * The pyramids are kept in a small LRU table, keyed by the SSD data and
+ * validated against the quark state stamp, so nothing is stored in (undoable)
+ * AMem memory.
+ *
+ */
+
+#include <config.h>
+
+#include <string.h>
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+
+#include "grace/coreP.h"
+
+/* number of rows in a bucket of the finest level */
+#define LOD_BASE        16
+
+/* number of pyramids kept around */
+#define LOD_CACHE_SIZE  8
+
+typedef struct {
+    unsigned int nbuckets;
+    unsigned int *imin;
+    unsigned int *imax;
+} LODLevel;
+
+typedef struct {
+    const ss_data *ssd;         /* owner */
+    unsigned int stamp;         /* state stamp of the SSD quark when built */
+    int xcol, ycol;
+    const double *x, *y;
+    unsigned int nrows;
+
+    int sorted;                 /* whether x is non-decreasing */
+
+    unsigned int nlevels;
+    LODLevel *levels;
+
+    unsigned long lastused;
+} LODPyramid;
+
+static LODPyramid lod_cache[LOD_CACHE_SIZE];
+static unsigned long lod_clock = 0;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t lod_mutex = PTHREAD_MUTEX_INITIALIZER;
+#  define LOD_LOCK()    pthread_mutex_lock(&lod_mutex)
+#  define LOD_UNLOCK()  pthread_mutex_unlock(&lod_mutex)
+#else
+#  define LOD_LOCK()
+#  define LOD_UNLOCK()
+#endif
+
+static void lod_pyramid_free(LODPyramid *lp)
+{
+    unsigned int l;
+
+    for (l = 0; l < lp->nlevels; l++) {
+        xfree(lp->levels[l].imin);
+        xfree(lp->levels[l].imax);
+    }
+    xfree(lp->levels);
+
+    memset(lp, 0, sizeof(LODPyramid));
+}
+
+static int lod_pyramid_build(LODPyramid *lp)
+{
+    const double *y = lp->y;
+    unsigned int i, j, nb;
+
+    lp->sorted = TRUE;
+    for (i = 1; i < lp->nrows; i++) {
+        if (!(lp->x[i] >= lp->x[i - 1])) {
+            lp->sorted = FALSE;
+            return RETURN_SUCCESS;
+        }
+    }
+
+    nb = (lp->nrows + LOD_BASE - 1)/LOD_BASE;
+    while (nb) {
+        LODLevel *level;
+        void *p = xrealloc(lp->levels, (lp->nlevels + 1)*sizeof(LODLevel));
+        if (!p) {
+            return RETURN_FAILURE;
+        }
+        lp->levels = p;
+        level = &lp->levels[lp->nlevels];
+        lp->nlevels++;
+
+        level->nbuckets = nb;
+        level->imin = xmalloc(nb*SIZEOF_INT);
+        level->imax = xmalloc(nb*SIZEOF_INT);
+        if (!level->imin || !level->imax) {
+            return RETURN_FAILURE;
+        }
+
+        if (lp->nlevels == 1) {
+            for (j = 0; j < nb; j++) {
+                unsigned int i1 = j*LOD_BASE;
+                unsigned int i2 = MIN2(i1 + LOD_BASE, lp->nrows);
+                unsigned int imin = i1, imax = i1;
+                for (i = i1 + 1; i < i2; i++) {
+                    if (y[i] < y[imin]) {
+                        imin = i;
+                    }
+                    if (y[i] > y[imax]) {
+                        imax = i;
+                    }
+                }
+                level->imin[j] = imin;
+                level->imax[j] = imax;
+            }
+        } else {
+            LODLevel *prev = level - 1;
+            for (j = 0; j < nb; j++) {
+                unsigned int imin = prev->imin[2*j], imax = prev->imax[2*j];
+                if (2*j + 1 < prev->nbuckets) {
+                    if (y[prev->imin[2*j + 1]] < y[imin]) {
+                        imin = prev->imin[2*j + 1];
+                    }
+                    if (y[prev->imax[2*j + 1]] > y[imax]) {
+                        imax = prev->imax[2*j + 1];
+                    }
+                }
+                level->imin[j] = imin;
+                level->imax[j] = imax;
+            }
+        }
+
+        if (nb == 1) {
+            break;
+        }
+        nb = (nb + 1)/2;
+    }
+
+    return RETURN_SUCCESS;
+}
+
+/* rows with the lowest and highest y among rows a...b-1 (b > a) */
+static void lod_query(const LODPyramid *lp, unsigned int a, unsigned int b,
+    unsigned int *imin, unsigned int *imax)
+{
+    const double *y = lp->y;
+    unsigned int i, ua, ub, l;
+
+    *imin = *imax = a;
+
+    ua = (a + LOD_BASE - 1)/LOD_BASE;
+    ub = b/LOD_BASE;
+    if (ua >= ub) {
+        for (i = a + 1; i < b; i++) {
+            if (y[i] < y[*imin]) {
+                *imin = i;
+            }
+            if (y[i] > y[*imax]) {
+                *imax = i;
+            }
+        }
+        return;
+    }
+
+    /* the unaligned head and tail */
+    for (i = a + 1; i < ua*LOD_BASE; i++) {
+        if (y[i] < y[*imin]) {
+            *imin = i;
+        }
+        if (y[i] > y[*imax]) {
+            *imax = i;
+        }
+    }
+    for (i = ub*LOD_BASE; i < b; i++) {
+        if (y[i] < y[*imin]) {
+            *imin = i;
+        }
+        if (y[i] > y[*imax]) {
+            *imax = i;
+        }
+    }
+
+    /* and the complete buckets in between, bottom-up */
+    for (l = 0; ua < ub; l++) {
+        const LODLevel *level = &lp->levels[l];
+        if (ua & 1) {
+            if (y[level->imin[ua]] < y[*imin]) {
+                *imin = level->imin[ua];
+            }
+            if (y[level->imax[ua]] > y[*imax]) {
+                *imax = level->imax[ua];
+            }
+            ua++;
+        }
+        if (ub & 1) {
+            ub--;
+            if (y[level->imin[ub]] < y[*imin]) {
+                *imin = level->imin[ub];
+            }
+            if (y[level->imax[ub]] > y[*imax]) {
+                *imax = level->imax[ub];
+            }
+        }
+        ua /= 2;
+        ub /= 2;
+    }
+}
+
+/* first row with x >= xc (or x > xc, if closed) */
+static unsigned int lod_bound(const double *x, unsigned int n, double xc,
+    int closed)
+{
+    unsigned int lo = 0, hi = n;
+
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo)/2;
+        if (x[mid] < xc || (closed && x[mid] == xc)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* find (or build) an up-to-date pyramid; to be called with the lock held */
+static LODPyramid *lod_pyramid_get(const Quark *q, int xcol, int ycol)
+{
+    ss_data *ssd = ssd_get_data(q);
+    unsigned int stamp = quark_get_statestamp(q);
+    LODPyramid *lp, *lru = NULL;
+    unsigned int i;
+
+    for (i = 0; i < LOD_CACHE_SIZE; i++) {
+        lp = &lod_cache[i];
+        if (lp->ssd == ssd && lp->xcol == xcol && lp->ycol == ycol) {
+            if (lp->stamp == stamp            &&
+                lp->nrows == ssd->nrows       &&
+                lp->x == ssd->cols[xcol].data &&
+                lp->y == ssd->cols[ycol].data) {
+                lp->lastused = ++lod_clock;
+                return lp;
+            } else {
+                lod_pyramid_free(lp);
+            }
+        }
+        if (!lru || (lru->ssd && (!lp->ssd || lp->lastused < lru->lastused))) {
+            lru = lp;
+        }
+    }
+
+    lp = lru;
+    lod_pyramid_free(lp);
+
+    lp->ssd   = ssd;
+    lp->stamp = stamp;
+    lp->xcol  = xcol;
+    lp->ycol  = ycol;
+    lp->x     = ssd->cols[xcol].data;
+    lp->y     = ssd->cols[ycol].data;
+    lp->nrows = ssd->nrows;
+
+    if (lod_pyramid_build(lp) != RETURN_SUCCESS) {
+        lod_pyramid_free(lp);
+        return NULL;
+    }
+
+    lp->lastused = ++lod_clock;
+
+    return lp;
+}
+
+/*
+ * Select the rows of the (xcol, ycol) pair of numerical columns needed to
+ * draw them as a polyline across nedges - 1 pixel columns, whose boundaries
+ * are given, in increasing order, by xedges[]. Besides the first, lowest,
+ * highest and last rows of each pixel column, the nearest rows outside the
+ * range are included. The indices are returned in increasing order in a
+ * newly allocated array. Fails if the abscissas are not sorted.
+ */
+int ssd_get_lod_indices(const Quark *q, int xcol, int ycol,
+    const double *xedges, unsigned int nedges,
+    unsigned int **indices, unsigned int *nindices)
+{
+    ss_data *ssd = ssd_get_data(q);
+    LODPyramid *lp;
+    unsigned int *ind, n = 0, i, nrows, a, b;
+
+    *indices  = NULL;
+    *nindices = 0;
+
+    if (!ssd || nedges < 2 ||
+        xcol < 0 || xcol >= ssd->ncols || ycol < 0 || ycol >= ssd->ncols ||
+        ssd->cols[xcol].format == FFORMAT_STRING ||
+        ssd->cols[ycol].format == FFORMAT_STRING ||
+        !ssd_get_col(q, xcol) || !ssd_get_col(q, ycol)) {
+        return RETURN_FAILURE;
+    }
+
+    nrows = ssd->nrows;
+    if (nrows == 0) {
+        return RETURN_SUCCESS;
+    }
+
+    ind = xmalloc((4*(nedges - 1) + 2)*SIZEOF_INT);
+    if (!ind) {
+        return RETURN_FAILURE;
+    }
+
+    LOD_LOCK();
+
+    lp = lod_pyramid_get(q, xcol, ycol);
+    if (!lp || !lp->sorted) {
+        LOD_UNLOCK();
+        xfree(ind);
+        return RETURN_FAILURE;
+    }
+
+    a = lod_bound(lp->x, nrows, xedges[0], FALSE);
+    if (a > 0) {
+        ind[n++] = a - 1;
+    }
+    for (i = 1; i < nedges && a < nrows; i++) {
+        unsigned int imin, imax, i1, i2;
+
+        /* the last column is closed on the right */
+        b = a + lod_bound(lp->x + a, nrows - a, xedges[i], i == nedges - 1);
+        if (b == a) {
+            continue;
+        }
+
+        lod_query(lp, a, b, &imin, &imax);
+        i1 = MIN2(imin, imax);
+        i2 = MAX2(imin, imax);
+
+        ind[n++] = a;
+        if (i1 != a) {
+            ind[n++] = i1;
+        }
+        if (i2 != i1) {
+            ind[n++] = i2;
+        }
+        if (b - 1 != i2) {
+            ind[n++] = b - 1;
+        }
+
+        a = b;
+    }
+    if (a < nrows) {
+        ind[n++] = a;
+    }
+
+    LOD_UNLOCK();
+
+    *indices  = ind;
+    *nindices = n;
+
+    return RETURN_SUCCESS;
+}
+
+/* forget pyramids of SSD data being freed */
+void ssd_lod_purge(const ss_data *ssd)
+{
+    unsigned int i;
+
+    LOD_LOCK();
+    for (i = 0; i < LOD_CACHE_SIZE; i++) {
+        if (lod_cache[i].ssd == ssd) {
+            lod_pyramid_free(&lod_cache[i]);
+        }
+    }
+    LOD_UNLOCK();
+}
@@ -107,6 +107,12 @@ void project_data_free(AMem *amem, Project *pr)
     amem_free(amem, pr);
 }
 
+static void project_data_touch(AMem *amem, Project *pr)
+{
+    amem_touch(amem, pr->fontmap);
+    amem_touch(amem, pr->colormap);
+}
+
 Project *project_get_data(const Quark *q)
 {
     if (q && q->fid == QFlavorProject) {
@@ -122,7 +128,8 @@ int project_qf_register(QuarkFactory *qfactory)
         QFlavorProject,
         (Quark_data_new) project_data_new,
         (Quark_data_free) project_data_free,
-        NULL
+        NULL,
+        (Quark_data_touch) project_data_touch
     };
 
     return quark_flavor_add(qfactory, &qf);
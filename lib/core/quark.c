@@ -25,10 +25,14 @@
  *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include <config.h>
+
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
 
-#define ADVANCED_MEMORY_HANDLERS
 #include "grace/coreP.h"
 
 static void quark_storage_free(AMem *amem, void *data)
@@ -36,17 +40,125 @@ static void quark_storage_free(AMem *amem, void *data)
     quark_free((Quark *) data);
 }
 
-static void quark_call_cblist(Quark *q, int etype)
+/*
+ * Change notification transactions. While a transaction is open, the
+ * events destined for container (listener) callbacks are collected per
+ * quark and delivered in one pass on commit, followed by a single
+ * QUARK_ETYPE_COMMIT to each container notified. The state is global
+ * and not locked, so transactions are for the main (GUI) thread only;
+ * quarks freed by batch workers are never queued.
+ */
+#define QUARK_TX_NEW    0x1
+#define QUARK_TX_MODIFY 0x2
+#define QUARK_TX_MOVE   0x4
+
+typedef struct {
+    Quark *q;
+    unsigned int flags;
+} QuarkTxEntry;
+
+static struct {
+    unsigned int depth;
+    
+    Quark *current;          /* the quark being reported on commit */
+    
+    QuarkTxEntry *items;
+    unsigned int nitems;
+    unsigned int nalloc;
+    
+    Quark **containers;
+    unsigned int ncontainers;
+    unsigned int ncalloc;
+} quark_tx;
+
+static QuarkTxEntry *quark_tx_entry(const Quark *q)
+{
+    if (q->txindex < quark_tx.nitems && quark_tx.items[q->txindex].q == q) {
+        return &quark_tx.items[q->txindex];
+    } else {
+        return NULL;
+    }
+}
+
+static void quark_tx_forget(Quark *q)
 {
+    QuarkTxEntry *e = quark_tx_entry(q);
     unsigned int i;
-    Quark *p = (Quark *) q;
+    
+    if (e) {
+        e->q = NULL;
+    }
+    if (quark_tx.current == q) {
+        quark_tx.current = NULL;
+    }
+    
+    for (i = 0; i < quark_tx.ncontainers; i++) {
+        if (quark_tx.containers[i] == q) {
+            quark_tx.containers[i] = NULL;
+        }
+    }
+}
 
-    if (q->fid == QFlavorContainer) {
-        return;
+static int quark_tx_append(Quark *q, unsigned int flags)
+{
+    QuarkTxEntry *e;
+    
+    if (quark_tx.nitems >= quark_tx.nalloc) {
+        unsigned int nalloc = quark_tx.nalloc ? 2*quark_tx.nalloc : 64;
+        QuarkTxEntry *items;
+        
+        items = xrealloc(quark_tx.items, nalloc*sizeof(QuarkTxEntry));
+        if (!items) {
+            return RETURN_FAILURE;
+        }
+        quark_tx.items  = items;
+        quark_tx.nalloc = nalloc;
+    }
+    
+    e = &quark_tx.items[quark_tx.nitems];
+    e->q     = q;
+    e->flags = flags;
+    q->txindex = quark_tx.nitems;
+    quark_tx.nitems++;
+    
+    return RETURN_SUCCESS;
+}
+
+static void quark_tx_add_container(Quark *p)
+{
+    unsigned int i;
+    
+    for (i = 0; i < quark_tx.ncontainers; i++) {
+        if (quark_tx.containers[i] == p) {
+            return;
+        }
+    }
+    
+    if (quark_tx.ncontainers >= quark_tx.ncalloc) {
+        unsigned int ncalloc = quark_tx.ncalloc ? 2*quark_tx.ncalloc : 4;
+        Quark **containers;
+        
+        containers = xrealloc(quark_tx.containers, ncalloc*sizeof(Quark *));
+        if (!containers) {
+            return;
+        }
+        quark_tx.containers = containers;
+        quark_tx.ncalloc    = ncalloc;
     }
+    
+    quark_tx.containers[quark_tx.ncontainers++] = p;
+}
+
+static void quark_call_containers(Quark *q, int etype)
+{
+    unsigned int i;
+    Quark *p = quark_parent_get(q);
 
     while (p) {
         if (p->fid == QFlavorContainer) {
+            if (quark_tx.depth) {
+                quark_tx_add_container(p);
+            }
             for (i = 0; i < p->cbcount; i++) {
                 QuarkCBEntry *cbentry = &p->cblist[i];
                 cbentry->cb(q, etype, cbentry->cbdata);
@@ -54,6 +166,101 @@ static void quark_call_cblist(Quark *q, int etype)
         }
         p = quark_parent_get(p);
     }
+}
+
+static int quark_is_descendant(const Quark *q, const Quark *ancestor)
+{
+    while ((q = quark_parent_get(q)) != NULL) {
+        if (q == ancestor) {
+            return TRUE;
+        }
+    }
+    
+    return FALSE;
+}
+
+/*
+ * Move the entry of q to the end of the queue, followed by those of its
+ * descendants, which can only have been queued after q's creation or move
+ */
+static int quark_tx_requeue(Quark *q, unsigned int flags)
+{
+    unsigned int i, i0 = q->txindex, n = quark_tx.nitems;
+    
+    quark_tx.items[i0].q = NULL;
+    if (quark_tx_append(q, flags) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    for (i = i0 + 1; i < n; i++) {
+        Quark *d = quark_tx.items[i].q;
+        if (d && quark_is_descendant(d, q)) {
+            quark_tx.items[i].q = NULL;
+            if (quark_tx_append(d, quark_tx.items[i].flags) !=
+                RETURN_SUCCESS) {
+                return RETURN_FAILURE;
+            }
+        }
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * Returns TRUE if the event has been queued for the container callbacks
+ */
+static int quark_tx_record(Quark *q, int etype)
+{
+    QuarkTxEntry *e = quark_tx_entry(q);
+    unsigned int flag;
+    
+    switch (etype) {
+    case QUARK_ETYPE_NEW:
+        flag = QUARK_TX_NEW;
+        break;
+    case QUARK_ETYPE_MODIFY:
+        flag = QUARK_TX_MODIFY;
+        break;
+    case QUARK_ETYPE_MOVE:
+        flag = QUARK_TX_MOVE;
+        break;
+    case QUARK_ETYPE_DELETE:
+        /* containers that never saw the quark needn't hear of its death */
+        if (!e || !(e->flags & QUARK_TX_NEW)) {
+            quark_call_containers(q, etype);
+        }
+        return TRUE;
+    default:
+        return FALSE;
+    }
+    
+    if (e) {
+        if (flag == QUARK_TX_MOVE) {
+            /* requeue (with the subtree), so that the move - or creation,
+               which reports the final position - follows creation of the
+               new parent */
+            return (quark_tx_requeue(q, e->flags | flag) == RETURN_SUCCESS);
+        } else {
+            /* a new quark is reported as is at the end */
+            e->flags |= flag;
+            return TRUE;
+        }
+    }
+    
+    return (quark_tx_append(q, flag) == RETURN_SUCCESS);
+}
+
+static void quark_call_cblist(Quark *q, int etype)
+{
+    unsigned int i;
+
+    if (q->fid == QFlavorContainer) {
+        return;
+    }
+
+    if (!quark_tx.depth || !quark_tx_record(q, etype)) {
+        quark_call_containers(q, etype);
+    }
 
     for (i = 0; i < q->cbcount; i++) {
         QuarkCBEntry *cbentry = &q->cblist[i];
@@ -61,6 +268,79 @@ static void quark_call_cblist(Quark *q, int etype)
     }
 }
 
+void quark_transaction_begin(void)
+{
+    quark_tx.depth++;
+}
+
+int quark_transaction_commit(void)
+{
+    unsigned int i;
+    
+    if (!quark_tx.depth) {
+        return RETURN_FAILURE;
+    }
+    if (quark_tx.depth > 1) {
+        quark_tx.depth--;
+        return RETURN_SUCCESS;
+    }
+    
+    /* events raised by the listeners themselves are queued and processed
+       in the same pass */
+    for (i = 0; i < quark_tx.nitems; i++) {
+        QuarkTxEntry *e = &quark_tx.items[i];
+        Quark *q = e->q;
+        unsigned int flags = e->flags;
+        
+        if (!q) {
+            continue;
+        }
+        e->q = NULL;
+        
+        quark_tx.current = q;
+        if (flags & QUARK_TX_NEW) {
+            quark_call_containers(q, QUARK_ETYPE_NEW);
+        } else {
+            if (flags & QUARK_TX_MOVE) {
+                quark_call_containers(q, QUARK_ETYPE_MOVE);
+            }
+            /* a listener may have deleted it meanwhile */
+            if ((flags & QUARK_TX_MODIFY) && quark_tx.current) {
+                quark_call_containers(q, QUARK_ETYPE_MODIFY);
+            }
+        }
+    }
+    quark_tx.current = NULL;
+    quark_tx.nitems = 0;
+    quark_tx.nalloc = 0;
+    XCFREE(quark_tx.items);
+    
+    quark_tx.depth = 0;
+    
+    for (i = 0; i < quark_tx.ncontainers; i++) {
+        Quark *p = quark_tx.containers[i];
+        unsigned int j;
+        
+        if (!p) {
+            continue;
+        }
+        for (j = 0; j < p->cbcount; j++) {
+            QuarkCBEntry *cbentry = &p->cblist[j];
+            cbentry->cb(p, QUARK_ETYPE_COMMIT, cbentry->cbdata);
+        }
+    }
+    quark_tx.ncontainers = 0;
+    quark_tx.ncalloc = 0;
+    XCFREE(quark_tx.containers);
+    
+    return RETURN_SUCCESS;
+}
+
+int quark_transaction_active(void)
+{
+    return (quark_tx.depth > 0);
+}
+
 static Quark *quark_new_raw(AMem *amem,
     Quark *parent, unsigned int fid, void *data, int id)
 {
@@ -174,6 +454,7 @@ void quark_free(Quark *q)
         storage_free(q->children);
         
         quark_call_cblist(q, QUARK_ETYPE_DELETE);
+        quark_tx_forget(q);
 
         if (qf->data_free) {
             qf->data_free(amem, q->data);
@@ -286,6 +567,33 @@ Quark *quark_copy(const Quark *q)
     return quark_copy2(q, q->parent, quark_get_id(q) + 1);
 }
 
+/*
+ * state stamps are drawn from a single counter, so a (quark, stamp) pair
+ * identifies a state of the quark even across undo/redo; the counter is
+ * shared by the projects of concurrent batch workers, hence the lock
+ */
+static unsigned int quark_statestamp = 0;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t statestamp_mutex = PTHREAD_MUTEX_INITIALIZER;
+#  define STATESTAMP_LOCK()    pthread_mutex_lock(&statestamp_mutex)
+#  define STATESTAMP_UNLOCK()  pthread_mutex_unlock(&statestamp_mutex)
+#else
+#  define STATESTAMP_LOCK()
+#  define STATESTAMP_UNLOCK()
+#endif
+
+static unsigned int quark_statestamp_next(void)
+{
+    unsigned int stamp;
+    
+    STATESTAMP_LOCK();
+    stamp = ++quark_statestamp;
+    STATESTAMP_UNLOCK();
+    
+    return stamp;
+}
+
 static int dirtystate_hook(unsigned int step, void *data, void *udata)
 {
     Quark *q = (Quark *) data;
@@ -295,19 +603,39 @@ static int dirtystate_hook(unsigned int step, void *data, void *udata)
     return TRUE;
 }
 
+/* let the memory model know the quark's data may have changed in place */
+static void quark_data_touch(Quark *q)
+{
+    QuarkFlavor *qf = quark_flavor_get(q->qfactory, q->fid);
+    
+    amem_touch(q->amem, q->data);
+    if (qf && qf->data_touch) {
+        qf->data_touch(q->amem, q->data);
+    }
+}
+
+static void quark_dirtystate_raise(Quark *q, unsigned int stamp)
+{
+    quark_data_touch(q);
+    q->dirtystate++;
+    q->statestamp = stamp;
+    if (q->parent) {
+        quark_dirtystate_raise(q->parent, quark_statestamp_next());
+    }
+    quark_call_cblist(q, QUARK_ETYPE_MODIFY);
+}
+
 void quark_dirtystate_set(Quark *q, int flag)
 {
     if (flag) {
-        q->dirtystate++;
-        q->statestamp++;
-        if (q->parent) {
-            quark_dirtystate_set(q->parent, TRUE);
-        }
+        /* the change originates here; the ancestors only inherit it */
+        q->ownstamp = quark_statestamp_next();
+        quark_dirtystate_raise(q, q->ownstamp);
     } else {
         q->dirtystate = 0;
         storage_traverse(q->children, dirtystate_hook, NULL);
+        quark_call_cblist(q, QUARK_ETYPE_MODIFY);
     }
-    quark_call_cblist(q, QUARK_ETYPE_MODIFY);
 }
 
 int quark_dirtystate_get(const Quark *q)
@@ -320,6 +648,12 @@ unsigned int quark_get_statestamp(const Quark *q)
     return q->statestamp;
 }
 
+/* stamp of the last change made to the quark itself, not to a descendant */
+unsigned int quark_get_ownstamp(const Quark *q)
+{
+    return q->ownstamp;
+}
+
 int quark_set_active2(Quark *q, int onoff)
 {
     if (q) {
@@ -575,6 +909,18 @@ int quark_child_exist(const Quark *parent, const Quark *child)
     }
 }
 
+static int fetch_hook(Quark *q, void *udata, QTraverseClosure *closure)
+{
+    int *retval = (int *) udata;
+    
+    if (q->fid == QFlavorSSD && ssd_fetch_data(q) != RETURN_SUCCESS) {
+        *retval = RETURN_FAILURE;
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
 int quark_reparent(Quark *q, Quark *newparent)
 {
     Quark *parent;
@@ -586,6 +932,15 @@ int quark_reparent(Quark *q, Quark *newparent)
     if (parent == newparent) {
         return RETURN_SUCCESS;
     } else {
+        if (get_parent_project(parent) != get_parent_project(newparent)) {
+            /* columns mapped from a binary project file can't outlive it */
+            int retval = RETURN_SUCCESS;
+            quark_traverse(q, fetch_hook, &retval);
+            if (retval != RETURN_SUCCESS) {
+                return RETURN_FAILURE;
+            }
+        }
+        
         storage_extract_data(parent->children, q);
         
         parent->refcount--;
@@ -33,7 +33,6 @@
 
 #include <string.h>
 
-#define ADVANCED_MEMORY_HANDLERS
 #include "grace/coreP.h"
 
 static void set_region_defaults(region *r)
@@ -277,3 +276,230 @@ int region_contains(const Quark *q, const WPoint *wp)
     
     return FALSE;
 }
+
+
+/*
+ * Classifying many points at once. The non-horizontal polygon edges are
+ * bucketed by the ordinate range they span, so that each point is tested
+ * (with the very same intersect_to_left()) only against the few edges of
+ * its bucket, which are all the edges that can cross its ordinate.
+ */
+
+/* points per thread below which spawning one isn't worth it */
+#define REGION_CHUNK 65536
+
+typedef struct {
+    const WPoint *wps;
+    int n;
+    
+    double ymin, ymax;
+    double scale;               /* bucket = (y - ymin)*scale */
+    unsigned int nbuckets;
+    unsigned int *start;        /* edges[start[b]...start[b + 1]) */
+    unsigned int *edges;        /* indices of the first edge vertices */
+} EdgeBuckets;
+
+typedef struct {
+    const region *r;
+    const EdgeBuckets *eb;
+    const double *x;
+    const double *y;
+    unsigned int npoints;
+    char *flags;
+} RegionJob;
+
+/* monotonic in y, so an edge spanning y is found in y's bucket */
+static unsigned int edge_bucket(const EdgeBuckets *eb, double y)
+{
+    double b = (y - eb->ymin)*eb->scale;
+    
+    if (!(b > 0.0)) {
+        return 0;
+    } else if (b >= eb->nbuckets - 1) {
+        return eb->nbuckets - 1;
+    } else {
+        return (unsigned int) b;
+    }
+}
+
+static void edge_buckets_free(EdgeBuckets *eb)
+{
+    xfree(eb->start);
+    xfree(eb->edges);
+}
+
+static int edge_buckets_init(EdgeBuckets *eb, const WPoint *wps, int n)
+{
+    unsigned int b, nedges;
+    int i;
+    
+    memset(eb, 0, sizeof(EdgeBuckets));
+    eb->wps = wps;
+    eb->n   = n;
+    
+    eb->ymin = eb->ymax = wps[0].y;
+    for (i = 1; i < n; i++) {
+        if (wps[i].y < eb->ymin) {
+            eb->ymin = wps[i].y;
+        } else if (wps[i].y > eb->ymax) {
+            eb->ymax = wps[i].y;
+        }
+    }
+    eb->nbuckets = n;
+    if (eb->ymax > eb->ymin) {
+        eb->scale = eb->nbuckets/(eb->ymax - eb->ymin);
+    }
+    
+    /* count, allocate, fill */
+    eb->start = xcalloc(eb->nbuckets + 1, SIZEOF_INT);
+    if (!eb->start) {
+        return RETURN_FAILURE;
+    }
+    nedges = 0;
+    for (i = 0; i < n; i++) {
+        const WPoint *wp1 = &wps[i], *wp2 = &wps[(i + 1) % n];
+        unsigned int b1, b2;
+        if (wp1->y == wp2->y) {
+            continue;
+        }
+        b1 = edge_bucket(eb, MIN2(wp1->y, wp2->y));
+        b2 = edge_bucket(eb, MAX2(wp1->y, wp2->y));
+        for (b = b1; b <= b2; b++) {
+            eb->start[b + 1]++;
+        }
+        nedges += b2 - b1 + 1;
+    }
+    for (b = 0; b < eb->nbuckets; b++) {
+        eb->start[b + 1] += eb->start[b];
+    }
+    
+    eb->edges = xmalloc(MAX2(nedges, 1)*SIZEOF_INT);
+    if (!eb->edges) {
+        edge_buckets_free(eb);
+        return RETURN_FAILURE;
+    }
+    for (i = 0; i < n; i++) {
+        const WPoint *wp1 = &wps[i], *wp2 = &wps[(i + 1) % n];
+        unsigned int b1, b2;
+        if (wp1->y == wp2->y) {
+            continue;
+        }
+        b1 = edge_bucket(eb, MIN2(wp1->y, wp2->y));
+        b2 = edge_bucket(eb, MAX2(wp1->y, wp2->y));
+        for (b = b1; b <= b2; b++) {
+            /* start[b] serves as the fill pointer... */
+            eb->edges[eb->start[b]++] = i;
+        }
+    }
+    /* ...and is restored here */
+    for (b = eb->nbuckets; b > 0; b--) {
+        eb->start[b] = eb->start[b - 1];
+    }
+    eb->start[0] = 0;
+    
+    return RETURN_SUCCESS;
+}
+
+static int inbound_bucketed(const WPoint *wp, const EdgeBuckets *eb)
+{
+    unsigned int b, k;
+    int l = 0;
+    
+    if (wp->y != wp->y) {
+        /* NaN; vertical edges would still "cross" it */
+        return inbound(wp, eb->wps, eb->n);
+    }
+    if (wp->y < eb->ymin || wp->y > eb->ymax) {
+        return FALSE;
+    }
+    
+    b = edge_bucket(eb, wp->y);
+    for (k = eb->start[b]; k < eb->start[b + 1]; k++) {
+        unsigned int i = eb->edges[k];
+        l += intersect_to_left(wp, &eb->wps[i], &eb->wps[(i + 1) % eb->n]);
+    }
+    
+    return l % 2;
+}
+
+static void region_contains_job(unsigned int job, unsigned int njobs,
+    void *udata)
+{
+    RegionJob *rj = (RegionJob *) udata;
+    const region *r = rj->r;
+    unsigned int i, i1, i2;
+    WPoint wp;
+    
+    i1 = (unsigned int) ((double) rj->npoints*job/njobs);
+    i2 = (unsigned int) ((double) rj->npoints*(job + 1)/njobs);
+    
+    if (rj->eb) {
+        for (i = i1; i < i2; i++) {
+            wp.x = rj->x[i];
+            wp.y = rj->y[i];
+            rj->flags[i] = inbound_bucketed(&wp, rj->eb);
+        }
+    } else
+    if (r->type == REGION_POLYGON) {
+        for (i = i1; i < i2; i++) {
+            wp.x = rj->x[i];
+            wp.y = rj->y[i];
+            rj->flags[i] = isleft(&wp, &r->wps[0], &r->wps[1]);
+        }
+    } else {
+        for (i = i1; i < i2; i++) {
+            wp.x = rj->x[i];
+            wp.y = rj->y[i];
+            rj->flags[i] = inband(&wp, &r->wps[0], &r->wps[1]);
+        }
+    }
+}
+
+/*
+ * flags[i] = region_contains(q, (x[i], y[i])) for i = 0...npoints-1
+ */
+int region_contains_points(const Quark *q,
+    const double *x, const double *y, unsigned int npoints, char *flags)
+{
+    region *r = region_get_data(q);
+    RegionJob rj;
+    EdgeBuckets eb;
+    unsigned int njobs;
+    
+    if (!r || !x || !y || !flags) {
+        return RETURN_FAILURE;
+    }
+    
+    if ((r->type == REGION_POLYGON && r->n < 2) ||
+        (r->type == REGION_BAND && r->n != 2) ||
+        (r->type != REGION_POLYGON && r->type != REGION_BAND)) {
+        memset(flags, FALSE, npoints);
+        return RETURN_SUCCESS;
+    }
+    
+    rj.r       = r;
+    rj.eb      = NULL;
+    rj.x       = x;
+    rj.y       = y;
+    rj.npoints = npoints;
+    rj.flags   = flags;
+    
+    if (r->type == REGION_POLYGON && r->n > 2) {
+        if (edge_buckets_init(&eb, r->wps, r->n) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        rj.eb = &eb;
+    }
+    
+    njobs = MIN2(parallel_get_nthreads(), npoints/REGION_CHUNK);
+    if (njobs < 1) {
+        njobs = 1;
+    }
+    parallel_run(njobs, region_contains_job, &rj);
+    
+    if (rj.eb) {
+        edge_buckets_free(&eb);
+    }
+    
+    return RETURN_SUCCESS;
+}
@@ -430,6 +430,43 @@ int set_set_length(Quark *pset, unsigned int len)
     return ssd_set_nrows(ss, len);
 }
 
+/*
+ * append nrows rows of ncols values each (stored row after row) to the
+ * first ncols columns of a set
+ */
+int set_append_rows(Quark *pset,
+    unsigned int ncols, unsigned int nrows, const double *data)
+{
+    Quark *ss = get_parent_ssd(pset);
+    double *cols[MAX_SET_COLS];
+    unsigned int i, k, len;
+    
+    if (!ss || ncols == 0 || (int) ncols > set_get_ncols(pset)) {
+        return RETURN_FAILURE;
+    }
+    
+    len = ssd_get_nrows(ss);
+    if (ssd_set_nrows(ss, len + nrows) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    for (k = 0; k < ncols; k++) {
+        cols[k] = set_get_col(pset, k);
+        if (!cols[k]) {
+            return RETURN_FAILURE;
+        }
+        cols[k] += len;
+    }
+    
+    for (i = 0; i < nrows; i++) {
+        for (k = 0; k < ncols; k++) {
+            cols[k][i] = *data++;
+        }
+    }
+    
+    return RETURN_SUCCESS;
+}
+
 int set_set_type(Quark *pset, int type)
 { 
     set *p = set_get_data(pset);
@@ -468,6 +505,17 @@ double *set_get_col(Quark *pset, unsigned int col)
     }
 }
 
+const ss_colstats *set_get_col_stats(Quark *pset, unsigned int col)
+{
+    Quark *ss = get_parent_ssd(pset);
+    set *p = set_get_data(pset);
+    if (p && ss && col < MAX_SET_COLS) {
+        return ssd_get_col_stats(ss, p->ds.cols[col]);
+    } else {
+        return NULL;
+    }
+}
+
 void *set_get_acol(Quark *pset, int *format)
 {
     Quark *ss = get_parent_ssd(pset);
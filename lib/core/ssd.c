@@ -32,6 +32,7 @@
  */
 
 #include <string.h>
+#include <math.h>
 
 #define ADVANCED_MEMORY_HANDLERS
 #include "grace/coreP.h"
@@ -48,6 +49,52 @@ ss_data *ssd_data_new(AMem *amem)
     return ssd;
 }
 
+/* decode a little-endian block of doubles */
+static double *ss_column_load(AMem *amem, const void *block, unsigned int nrows)
+{
+    double *dp = amem_malloc(amem, nrows*SIZEOF_DOUBLE);
+    if (dp) {
+#ifdef WORDS_BIGENDIAN
+        const unsigned char *src = block;
+        unsigned int i, k;
+        for (i = 0; i < nrows; i++) {
+            unsigned char *dst = (unsigned char *) &dp[i];
+            for (k = 0; k < SIZEOF_DOUBLE; k++) {
+                dst[k] = src[SIZEOF_DOUBLE - 1 - k];
+            }
+            src += SIZEOF_DOUBLE;
+        }
+#else
+        memcpy(dp, block, nrows*SIZEOF_DOUBLE);
+#endif
+    }
+    
+    return dp;
+}
+
+/*
+ * bring a mapped (or a not yet allocated, zero) column into memory; this is
+ * not a modification of the data
+ */
+static int ss_column_fetch(AMem *amem, unsigned int nrows, ss_column *col)
+{
+    if (col->mapped) {
+        double *dp = ss_column_load(amem, col->mapped, nrows);
+        if (!dp) {
+            return RETURN_FAILURE;
+        }
+        col->data   = dp;
+        col->mapped = NULL;
+    } else if (!col->data && nrows && col->format != FFORMAT_STRING) {
+        col->data = amem_calloc(amem, nrows, SIZEOF_DOUBLE);
+        if (!col->data) {
+            return RETURN_FAILURE;
+        }
+    }
+    
+    return RETURN_SUCCESS;
+}
+
 static void ss_column_free(AMem *amem, unsigned int nrows, ss_column *col)
 {
     unsigned int j;
@@ -65,6 +112,8 @@ void ssd_data_free(AMem *amem, ss_data *ssd)
 {
     if (ssd) {
         unsigned int i;
+        
+        ssd_lod_purge(ssd);
 
         for (i = 0; i < ssd->ncols; i++) {
             ss_column *col = &ssd->cols[i];
@@ -80,6 +129,17 @@ void ssd_data_free(AMem *amem, ss_data *ssd)
     }
 }
 
+/* columns are written in place through the pointers to them */
+static void ssd_data_touch(AMem *amem, ss_data *ssd)
+{
+    unsigned int i;
+    
+    amem_touch(amem, ssd->cols);
+    for (i = 0; i < ssd->ncols; i++) {
+        amem_touch(amem, ssd->cols[i].data);
+    }
+}
+
 ss_data *ssd_data_copy(AMem *amem, ss_data *ssd)
 {
     ss_data *ssd_new;
@@ -102,8 +162,14 @@ ss_data *ssd_data_copy(AMem *amem, ss_data *ssd)
         ss_column *col_new = &ssd_new->cols[i];
         col_new->format = col->format;
         col_new->label  = amem_strdup(amem, col->label);
+        col_new->mapped = NULL;
+        col_new->stats.valid = FALSE;
         if (col->format == FFORMAT_STRING) {
             col_new->data = copy_string_column(amem, col->data, ssd->nrows);
+        } else if (col->mapped) {
+            col_new->data = ss_column_load(amem, col->mapped, ssd->nrows);
+        } else if (!col->data) {
+            col_new->data = amem_calloc(amem, ssd->nrows, SIZEOF_DOUBLE);
         } else {
             col_new->data = copy_data_column(amem, col->data, ssd->nrows);
         }
@@ -138,7 +204,8 @@ int ssd_qf_register(QuarkFactory *qfactory)
         QFlavorSSD,
         (Quark_data_new) ssd_data_new,
         (Quark_data_free) ssd_data_free,
-        (Quark_data_copy) ssd_data_copy
+        (Quark_data_copy) ssd_data_copy,
+        (Quark_data_touch) ssd_data_touch
     };
 
     return quark_flavor_add(qfactory, &qf);
@@ -214,6 +281,10 @@ int ssd_set_nrows(Quark *q, unsigned int nrows)
         return RETURN_SUCCESS;
     }
     
+    if (ssd_fetch_data(q) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
     for (i = 0; i < ssd->ncols; i++) {
         ss_column *col = &ssd->cols[i];
         if (col->format == FFORMAT_STRING) {
@@ -275,13 +346,157 @@ int ssd_set_ncols(Quark *q, unsigned int ncols, const int *formats)
 ss_column *ssd_get_col(const Quark *q, int col)
 {
     ss_data *ssd = ssd_get_data(q);
-    if (ssd && col >= 0 && col < ssd->ncols) {
+    if (ssd && col >= 0 && col < ssd->ncols &&
+        ss_column_fetch(q->amem, ssd->nrows, &ssd->cols[col]) ==
+            RETURN_SUCCESS) {
         return &ssd->cols[col];
     } else {
         return NULL;
     }
 }
 
+/*
+ * load all columns still backed by a mapped binary project; to be called
+ * before accessing ssd->cols[] directly
+ */
+int ssd_fetch_data(const Quark *q)
+{
+    ss_data *ssd = ssd_get_data(q);
+    unsigned int i;
+    
+    if (!ssd) {
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0; i < ssd->ncols; i++) {
+        if (ss_column_fetch(q->amem, ssd->nrows, &ssd->cols[i]) !=
+            RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+static void ss_column_stats(const double *x, unsigned int n, ss_colstats *st)
+{
+    unsigned int i, nvalid = 0;
+    int mono_ok = TRUE, smono_ok = TRUE;
+    double eps = 0.0;
+    
+    st->min = st->max = 0.0;
+    st->imin = st->imax = 0;
+    st->sum = st->sum2 = 0.0;
+    st->nnan = 0;
+    st->mono = st->smono = 0;
+    st->monospaced = FALSE;
+    st->spacing = 0.0;
+    
+    if (n >= 2) {
+        st->mono = st->smono = sign(x[1] - x[0]);
+        st->monospaced = TRUE;
+        st->spacing = x[1] - x[0];
+        eps = fabs(x[n - 1] - x[0])*1.0e-6;
+    }
+    
+    for (i = 0; i < n; i++) {
+        double v = x[i];
+        
+        if (v != v) {
+            st->nnan++;
+        } else {
+            if (!nvalid) {
+                st->min = st->max = v;
+                st->imin = st->imax = i;
+            } else if (v < st->min) {
+                st->min = v;
+                st->imin = i;
+            } else if (v > st->max) {
+                st->max = v;
+                st->imax = i;
+            }
+            st->sum  += v;
+            st->sum2 += v*v;
+            nvalid++;
+        }
+        
+        /* the same criteria as monotonicity() and monospaced() use */
+        if (i >= 2) {
+            double dx = v - x[i - 1];
+            int s1 = sign(dx);
+            if (smono_ok && s1 != st->smono) {
+                smono_ok = FALSE;
+            }
+            if (mono_ok && s1 != st->mono) {
+                if (st->mono == 0) {
+                    st->mono = s1;
+                } else if (s1 != 0) {
+                    mono_ok = FALSE;
+                }
+            }
+            if (st->monospaced && fabs(dx - st->spacing) > eps) {
+                st->monospaced = FALSE;
+            }
+        }
+    }
+    
+    if (!mono_ok) {
+        st->mono = 0;
+    }
+    if (!smono_ok) {
+        st->smono = 0;
+    }
+}
+
+/*
+ * summary statistics of a numerical column, computed on demand and kept
+ * until the SSD is modified
+ */
+const ss_colstats *ssd_get_col_stats(const Quark *q, int column)
+{
+    ss_column *col = ssd_get_col(q, column);
+    unsigned int stamp = quark_get_statestamp(q);
+    
+    if (!col || col->format == FFORMAT_STRING) {
+        return NULL;
+    }
+    
+    if (!col->stats.valid || col->stats.stamp != stamp) {
+        ss_column_stats(col->data, ssd_get_nrows(q), &col->stats);
+        col->stats.stamp = stamp;
+        col->stats.valid = TRUE;
+    }
+    
+    return &col->stats;
+}
+
+/*
+ * back a numerical column by a block of nrows little-endian doubles, which
+ * must stay valid for the lifetime of the SSD; the block is loaded only when
+ * the column is first accessed
+ */
+int ssd_set_col_mapped(Quark *q, int column, const void *block)
+{
+    ss_data *ssd = ssd_get_data(q);
+    ss_column *col;
+    
+    if (!ssd || !block || column < 0 || column >= ssd->ncols) {
+        return RETURN_FAILURE;
+    }
+    
+    col = &ssd->cols[column];
+    if (col->format == FFORMAT_STRING) {
+        return RETURN_FAILURE;
+    }
+    
+    if (ssd->nrows) {
+        AMEM_CFREE(q->amem, col->data);
+        col->mapped = block;
+    }
+    
+    return RETURN_SUCCESS;
+}
+
 int ssd_get_column_by_name(const Quark *q, const char *name)
 {
     unsigned int i;
@@ -331,19 +546,18 @@ int ssd_set_darray(Quark *q, int column, const DArray *da)
     }
 }
 
-ss_column *ssd_add_col(Quark *q, int format)
+static ss_column *ssd_add_col_storage(Quark *q, int format, int alloc)
 {
     ss_data *ssd = ssd_get_data(q);
     if (ssd) {
-        void *p1, *p2;
+        void *p1, *p2 = NULL;
         p1 = amem_realloc(q->amem, ssd->cols, (ssd->ncols + 1)*sizeof(ss_column));
-        if (format == FFORMAT_STRING) {
-            p2 = amem_calloc(q->amem, ssd->nrows, SIZEOF_VOID_P);
-        } else {
-            p2 = amem_calloc(q->amem, ssd->nrows, SIZEOF_DOUBLE);
+        if (alloc) {
+            p2 = amem_calloc(q->amem, ssd->nrows,
+                format == FFORMAT_STRING ? SIZEOF_VOID_P:SIZEOF_DOUBLE);
         }
 
-        if (!p1 || !p2) {
+        if (!p1 || (alloc && !p2)) {
             amem_free(q->amem, p1);
             amem_free(q->amem, p2);
             return NULL;
@@ -352,6 +566,8 @@ ss_column *ssd_add_col(Quark *q, int format)
             ssd->cols = p1;
             col = &ssd->cols[ssd->ncols];
             col->data = p2;
+            col->mapped = NULL;
+            col->stats.valid = FALSE;
             col->format = format;
             col->label = NULL;
             ssd->ncols++;
@@ -365,6 +581,20 @@ ss_column *ssd_add_col(Quark *q, int format)
     }
 }
 
+ss_column *ssd_add_col(Quark *q, int format)
+{
+    return ssd_add_col_storage(q, format, TRUE);
+}
+
+/*
+ * add a numerical column to be backed by ssd_set_col_mapped(); unless it is,
+ * its (zero) data are allocated only on first access
+ */
+ss_column *ssd_add_col_unloaded(Quark *q)
+{
+    return ssd_add_col_storage(q, FFORMAT_NUMBER, FALSE);
+}
+
 int ssd_set_value(Quark *q, int row, int column, double value)
 {
     ss_column *col = ssd_get_col(q, column);
@@ -123,30 +123,59 @@ int set_is_dataless(Quark *pset)
     }
 }
 
+/*
+ * monotonicity of a set column: -1/+1 if decreasing/increasing, 0 otherwise
+ */
+int set_get_monotonicity(Quark *pset, unsigned int col, int strict)
+{
+    const ss_colstats *st = set_get_col_stats(pset, col);
+    
+    if (!st) {
+        return 0;
+    }
+    if (set_get_length(pset) < 2) {
+        errmsg("Monotonicity of an array of length < 2 is meaningless");
+        return 0;
+    }
+    
+    return strict ? st->smono:st->mono;
+}
+
+int set_is_monospaced(Quark *pset, unsigned int col, double *space)
+{
+    const ss_colstats *st = set_get_col_stats(pset, col);
+    
+    if (!st) {
+        return FALSE;
+    }
+    if (set_get_length(pset) < 2) {
+        errmsg("Monospacing of an array of length < 2 is meaningless");
+        return FALSE;
+    }
+    
+    *space = st->spacing;
+    
+    return st->monospaced;
+}
+
 /*
  * get the min/max values of a set
  */
 int set_get_minmax(Quark *pset,
     double *xmin, double *xmax, double *ymin, double *ymax)
 {
-    double *x, *y;
-    int len;
-    double x1, x2, y1, y2;
-    int imin, imax; /* dummy */
+    const ss_colstats *xst, *yst;
 
     if (!pset) {
         return RETURN_FAILURE;
     }
     
-    x = set_get_col(pset, DATA_X);
-    y = set_get_col(pset, DATA_Y);
-    len = set_get_length(pset);
-    minmax(x, len, &x1, &x2, &imin, &imax);
-    minmax(y, len, &y1, &y2, &imin, &imax);
-    *xmin = x1;
-    *xmax = x2;
-    *ymin = y1;
-    *ymax = y2;
+    xst = set_get_col_stats(pset, DATA_X);
+    yst = set_get_col_stats(pset, DATA_Y);
+    *xmin = xst ? xst->min:0.0;
+    *xmax = xst ? xst->max:0.0;
+    *ymin = yst ? yst->min:0.0;
+    *ymax = yst ? yst->max:0.0;
     
     return RETURN_SUCCESS;
 }
@@ -247,6 +276,10 @@ int ssd_delete_rows(Quark *q, unsigned int startno, unsigned int endno)
         /* trivial case */
         return ssd_set_nrows(q, startno);
     }
+
+    if (ssd_fetch_data(q) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
     
     dist = endno - startno + 1;
     
@@ -273,12 +306,62 @@ int ssd_delete_rows(Quark *q, unsigned int startno, unsigned int endno)
     return RETURN_SUCCESS;
 }
 
+/*
+ * keep only the rows for which keep[i] is set, preserving their order;
+ * columns of all formats are compacted, so the rows stay aligned
+ */
+int ssd_compact_rows(Quark *q, const char *keep)
+{
+    ss_data *ssd = ssd_get_data(q);
+    unsigned int i, j, k, newlen;
+
+    if (!ssd || !keep || ssd_fetch_data(q) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0, newlen = 0; i < ssd->nrows; i++) {
+        if (keep[i]) {
+            newlen++;
+        }
+    }
+    if (newlen == ssd->nrows) {
+        return RETURN_SUCCESS;
+    }
+    
+    for (k = 0; k < ssd->ncols; k++) {
+        ss_column *col = &ssd->cols[k];
+        if (col->format == FFORMAT_STRING) {
+            char **s = col->data;
+            for (i = 0, j = 0; i < ssd->nrows; i++) {
+                if (keep[i]) {
+                    s[j++] = s[i];
+                } else {
+                    amem_free(q->amem, s[i]);
+                }
+            }
+            /* already freed or moved; don't let ssd_set_nrows() free them */
+            for (; j < ssd->nrows; j++) {
+                s[j] = NULL;
+            }
+        } else {
+            double *x = col->data;
+            for (i = 0, j = 0; i < ssd->nrows; i++) {
+                if (keep[i]) {
+                    x[j++] = x[i];
+                }
+            }
+        }
+    }
+    
+    return ssd_set_nrows(q, newlen);
+}
+
 int ssd_reverse(Quark *q)
 {
     ss_data *ssd = ssd_get_data(q);
     int nrows, ncols, i, j, k;
 
-    if (!ssd) {
+    if (!ssd || ssd_fetch_data(q) != RETURN_SUCCESS) {
         return RETURN_FAILURE;
     }
     
@@ -306,6 +389,119 @@ int ssd_reverse(Quark *q)
     return RETURN_SUCCESS;
 }
 
+typedef struct {
+    unsigned int nrows;
+    const unsigned int *ind;
+    size_t size;                /* element size */
+    const void *src;
+    void *dst;
+} permute_t;
+
+static void permute_rows(unsigned int job, unsigned int njobs, void *udata)
+{
+    permute_t *p = (permute_t *) udata;
+    unsigned int i, i1, i2;
+    
+    i1 = (unsigned int) ((double) p->nrows*job/njobs);
+    i2 = (unsigned int) ((double) p->nrows*(job + 1)/njobs);
+    
+    if (p->size == SIZEOF_DOUBLE) {
+        const double *x = p->src;
+        double *y = p->dst;
+        for (i = i1; i < i2; i++) {
+            y[i] = x[p->ind[i]];
+        }
+    } else {
+        const char **s = (const char **) p->src;
+        char **t = p->dst;
+        for (i = i1; i < i2; i++) {
+            t[i] = (char *) s[p->ind[i]];
+        }
+    }
+}
+
+/*
+ * reorder the rows so that row i becomes the former row ind[i]; ind must be
+ * a permutation of 0...nrows-1. Columns of all formats are gathered by
+ * several threads.
+ */
+int ssd_permute_rows(Quark *q, const unsigned int *ind)
+{
+    ss_data *ssd = ssd_get_data(q);
+    permute_t p;
+    unsigned int k, njobs;
+    void *buf;
+
+    if (!ssd || !ind || ssd_fetch_data(q) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    if (ssd->nrows < 2) {
+        return RETURN_SUCCESS;
+    }
+    
+    buf = xmalloc(ssd->nrows*MAX2(SIZEOF_DOUBLE, SIZEOF_VOID_P));
+    if (!buf) {
+        return RETURN_FAILURE;
+    }
+    
+    njobs = MIN2(parallel_get_nthreads(), ssd->nrows/65536);
+    if (njobs < 1) {
+        njobs = 1;
+    }
+    
+    p.nrows = ssd->nrows;
+    p.ind   = ind;
+    p.dst   = buf;
+    for (k = 0; k < ssd->ncols; k++) {
+        ss_column *col = &ssd->cols[k];
+        
+        p.src  = col->data;
+        p.size = (col->format == FFORMAT_STRING) ? SIZEOF_VOID_P:SIZEOF_DOUBLE;
+        parallel_run(njobs, permute_rows, &p);
+        memcpy(col->data, buf, ssd->nrows*p.size);
+    }
+    
+    xfree(buf);
+    
+    quark_dirtystate_set(q, TRUE);
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * sort all rows by the values of the (numeric) column sorton; rows with
+ * equal keys keep their relative order
+ */
+int ssd_sort(Quark *q, int sorton, int descending)
+{
+    ss_column *col = ssd_get_col(q, sorton);
+    unsigned int nrows = ssd_get_nrows(q);
+    unsigned int *ind;
+    int res;
+    
+    if (!col || col->format == FFORMAT_STRING ||
+        ssd_fetch_data(q) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    if (nrows < 2) {
+        return RETURN_SUCCESS;
+    }
+    
+    ind = xmalloc(nrows*SIZEOF_INT);
+    if (!ind) {
+        return RETURN_FAILURE;
+    }
+    
+    res = dsort_index(col->data, nrows, descending, ind);
+    if (res == RETURN_SUCCESS) {
+        res = ssd_permute_rows(q, ind);
+    }
+    
+    xfree(ind);
+    
+    return res;
+}
+
 int ssd_is_numeric(const Quark *q)
 {
     unsigned int i, ncols = ssd_get_ncols(q);
@@ -324,7 +520,7 @@ int ssd_transpose(Quark *q)
     ss_data *ssd_new, *ssd_old;
     unsigned int ncols, nrows, i, j;
     
-    if (!ssd_is_numeric(q)) {
+    if (!ssd_is_numeric(q) || ssd_fetch_data(q) != RETURN_SUCCESS) {
         return RETURN_FAILURE;
     }
     
@@ -414,6 +610,9 @@ int ssd_coalesce(Quark *toq, Quark *fromq)
     ncols = ssd_get_ncols(toq);
     
     ssd = ssd_get_data(fromq);
+    if (ssd_fetch_data(fromq) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
     for (i = 0; i < ssd->ncols; i++) {
         ss_column *col = &ssd->cols[i];
         
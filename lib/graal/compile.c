@@ -0,0 +1,1413 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ *
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ *
+ * Copyright (c) 2012 Grace Development Team
+ *
+ * Maintained by Evgeny Stambulchik
+ *
+ *
+ *                           All Rights Reserved
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Compiled evaluation of plain arithmetic statements and expressions;
+ * comparisons and logical operations are compiled, too, but only used
+ * element-wise on arrays (for scalars, the parser keeps the boolean type)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "grace/baseP.h"
+#include "grace/graalP.h"
+
+/* number of rows evaluated in one pass over the program */
+#define GPROG_BLOCK     256
+
+/* min number of rows worth splitting between threads */
+#define GPROG_PARALLEL_MIN  (64*GPROG_BLOCK)
+
+typedef enum {
+    GOpConst,
+    GOpLoad,
+    GOpNeg,
+    GOpAdd,
+    GOpSub,
+    GOpMul,
+    GOpDiv,
+    GOpPow,
+    GOpNot,
+    /* comparisons and logical operations, yielding 0 or 1 */
+    GOpLt,
+    GOpGt,
+    GOpLe,
+    GOpGe,
+    GOpEq,
+    GOpNe,
+    GOpAnd,
+    GOpOr
+} GOpCode;
+
+typedef struct {
+    GOpCode op;
+    unsigned int arg;       /* operand slot of GOpLoad */
+    double val;             /* value of GOpConst */
+} GInstr;
+
+/* a variable (npath == 0) or a property of an object */
+typedef struct {
+    unsigned int npath;
+    char **path;            /* "this" or object name, then column children */
+    char *name;
+} GOperand;
+
+struct _GProgram {
+    char *text;
+    int expr_only;
+    unsigned long hash;
+    
+    int compiled;           /* FALSE if outside of the supported subset */
+    
+    GOperand target;        /* LHS of a statement */
+    
+    unsigned int noperands;
+    GOperand *operands;
+    
+    unsigned int ninstrs;
+    GInstr *instrs;
+    
+    unsigned int depth;     /* max stack depth */
+    
+    GProgram *next;
+};
+
+/* evaluation errors */
+typedef enum {
+    GErrNone,
+    GErrDivZero,
+    GErrNegPow,
+    GErrZeroPow,
+    GErrNoMem
+} GError;
+
+/* a resolved operand or a stack entry */
+typedef struct {
+    int isvec;
+    int isbool;             /* result of a comparison */
+    double val;
+    const double *v;
+    unsigned int size;
+    DArray *da;             /* to be freed */
+} GValue;
+
+
+/*
+ * Tokenizer; follows the rules of graal.l
+ */
+typedef enum {
+    GTokEnd,
+    GTokNumber,
+    GTokName,
+    GTokChar,
+    GTokBad
+} GTokType;
+
+/* two-character operators (the value of GLexer.c) */
+#define GCHAR_EQ    ('=' << 8 | '=')
+#define GCHAR_NE    ('!' << 8 | '=')
+#define GCHAR_LE    ('<' << 8 | '=')
+#define GCHAR_GE    ('>' << 8 | '=')
+#define GCHAR_AND   ('&' << 8 | '&')
+#define GCHAR_OR    ('|' << 8 | '|')
+
+typedef struct {
+    const char *s;
+    GTokType type;
+    double num;
+    char *name;
+    int c;
+} GLexer;
+
+#define IS_DIGIT(c)     ((c) >= '0' && (c) <= '9')
+#define IS_ALPHA(c)     (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z'))
+
+static void glex_next(GLexer *lex)
+{
+    const char *s = lex->s, *p;
+    
+    XCFREE(lex->name);
+    
+    while (*s == ' ' || *s == '\t' || *s == '\n') {
+        s++;
+    }
+    p = s;
+    
+    if (*s == '\0') {
+        lex->type = GTokEnd;
+    } else
+    if (IS_DIGIT(*s) || (*s == '.' && IS_DIGIT(s[1]))) {
+        char buf[64];
+        
+        while (IS_DIGIT(*p)) {
+            p++;
+        }
+        if (*p == '.' && IS_DIGIT(p[1])) {
+            p++;
+            while (IS_DIGIT(*p)) {
+                p++;
+            }
+        }
+        if (*p == 'e' || *p == 'E') {
+            const char *q = p + 1;
+            if (*q == '+' || *q == '-') {
+                q++;
+            }
+            if (IS_DIGIT(*q)) {
+                while (IS_DIGIT(*q)) {
+                    q++;
+                }
+                p = q;
+            }
+        }
+        
+        if (p - s < (int) sizeof(buf)) {
+            memcpy(buf, s, p - s);
+            buf[p - s] = '\0';
+            lex->num = atof(buf);
+            lex->type = GTokNumber;
+        } else {
+            lex->type = GTokBad;
+        }
+    } else
+    if (IS_ALPHA(*s) || *s == '$') {
+        p++;
+        while (IS_ALPHA(*p) || IS_DIGIT(*p) || *p == '_') {
+            p++;
+        }
+        lex->name = xmalloc(p - s + 1);
+        if (lex->name) {
+            memcpy(lex->name, s, p - s);
+            lex->name[p - s] = '\0';
+            lex->type = GTokName;
+        } else {
+            lex->type = GTokBad;
+        }
+    } else
+    if (*s != '\0' && s[1] != '\0' &&
+        ((strchr("=!<>", *s) && s[1] == '=') ||
+         (*s == '&' && s[1] == '&') || (*s == '|' && s[1] == '|'))) {
+        lex->c = *s << 8 | s[1];
+        lex->type = GTokChar;
+        p += 2;
+    } else
+    if (strchr("+-*/^()=.:;<>!", *s) && !(*s == '.' && s[1] == '.')) {
+        lex->c = *s;
+        lex->type = GTokChar;
+        p++;
+    } else {
+        lex->type = GTokBad;
+    }
+    
+    lex->s = p;
+}
+
+static int glex_is_char(const GLexer *lex, int c)
+{
+    return (lex->type == GTokChar && lex->c == c);
+}
+
+/* a name in the given context; keywords aren't */
+static int glex_is_name(const GLexer *lex, GContext context)
+{
+    const char *s = lex->name;
+    
+    if (lex->type != GTokName) {
+        return FALSE;
+    }
+    
+    if (strings_are_equal(s, "true") || strings_are_equal(s, "false") ||
+        strings_are_equal(s, "if")   || strings_are_equal(s, "else")  ||
+        strings_are_equal(s, "this")) {
+        return FALSE;
+    }
+    if (context == GContextNone && strings_are_equal(s, "length")) {
+        return FALSE;
+    }
+    
+    return TRUE;
+}
+
+
+/*
+ * Compiler: a recursive-descent parser of the subset emitting postfix code
+ */
+typedef struct {
+    GLexer lex;
+    GProgram *prog;
+    unsigned int depth;
+} GCompiler;
+
+static void goperand_free(GOperand *o)
+{
+    unsigned int i;
+    
+    for (i = 0; i < o->npath; i++) {
+        xfree(o->path[i]);
+    }
+    xfree(o->path);
+    xfree(o->name);
+}
+
+static int goperand_equal(const GOperand *o1, const GOperand *o2)
+{
+    unsigned int i;
+    
+    if (o1->npath != o2->npath || !strings_are_equal(o1->name, o2->name)) {
+        return FALSE;
+    }
+    for (i = 0; i < o1->npath; i++) {
+        if (!strings_are_equal(o1->path[i], o2->path[i])) {
+            return FALSE;
+        }
+    }
+    
+    return TRUE;
+}
+
+static int gcompiler_emit(GCompiler *gc, GOpCode op, unsigned int arg,
+    double val)
+{
+    GProgram *prog = gc->prog;
+    GInstr *p, *instr;
+    
+    p = xrealloc(prog->instrs, (prog->ninstrs + 1)*sizeof(GInstr));
+    if (!p) {
+        return RETURN_FAILURE;
+    }
+    prog->instrs = p;
+    
+    instr = &prog->instrs[prog->ninstrs];
+    instr->op  = op;
+    instr->arg = arg;
+    instr->val = val;
+    prog->ninstrs++;
+    
+    switch (op) {
+    case GOpConst:
+    case GOpLoad:
+        gc->depth++;
+        if (gc->depth > prog->depth) {
+            prog->depth = gc->depth;
+        }
+        break;
+    case GOpNeg:
+    case GOpNot:
+        break;
+    default:
+        gc->depth--;
+        break;
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+/* parse (a path to) a variable or an object property; the first name
+   has already been fetched */
+static int gcompiler_operand(GCompiler *gc, GOperand *o)
+{
+    GLexer *lex = &gc->lex;
+    int is_this = (lex->type == GTokName &&
+        strings_are_equal(lex->name, "this"));
+    
+    memset(o, 0, sizeof(GOperand));
+    
+    if (!is_this && !glex_is_name(lex, GContextNone)) {
+        return RETURN_FAILURE;
+    }
+    o->name = lex->name;
+    lex->name = NULL;
+    glex_next(lex);
+    
+    if (!glex_is_char(lex, '.') && !glex_is_char(lex, ':')) {
+        /* a plain variable */
+        return is_this ? RETURN_FAILURE:RETURN_SUCCESS;
+    }
+    
+    while (TRUE) {
+        void *p = xrealloc(o->path, (o->npath + 1)*SIZEOF_VOID_P);
+        if (!p) {
+            return RETURN_FAILURE;
+        }
+        o->path = p;
+        o->path[o->npath] = o->name;
+        o->npath++;
+        o->name = NULL;
+        
+        if (glex_is_char(lex, ':')) {
+            glex_next(lex);
+            if (!glex_is_name(lex, GContextColumn)) {
+                return RETURN_FAILURE;
+            }
+        } else
+        if (glex_is_char(lex, '.')) {
+            glex_next(lex);
+            if (!glex_is_name(lex, GContextDot)) {
+                return RETURN_FAILURE;
+            }
+            o->name = lex->name;
+            lex->name = NULL;
+            glex_next(lex);
+            
+            return RETURN_SUCCESS;
+        } else {
+            return RETURN_FAILURE;
+        }
+        
+        o->name = lex->name;
+        lex->name = NULL;
+        glex_next(lex);
+    }
+}
+
+/* binary operators by precedence level, the lowest first; comparisons
+   are non-associative */
+#define GPREC_OR    0
+#define GPREC_AND   1
+#define GPREC_CMP   2
+#define GPREC_ADD   3
+#define GPREC_MUL   4
+
+static int gcompiler_expr(GCompiler *gc, int prec);
+
+static int gcompiler_primary(GCompiler *gc)
+{
+    GLexer *lex = &gc->lex;
+    GProgram *prog = gc->prog;
+    
+    if (lex->type == GTokNumber) {
+        double val = lex->num;
+        glex_next(lex);
+        return gcompiler_emit(gc, GOpConst, 0, val);
+    } else
+    if (glex_is_char(lex, '(')) {
+        glex_next(lex);
+        if (gcompiler_expr(gc, GPREC_OR) != RETURN_SUCCESS ||
+            !glex_is_char(lex, ')')) {
+            return RETURN_FAILURE;
+        }
+        glex_next(lex);
+        return RETURN_SUCCESS;
+    } else
+    if (lex->type == GTokName) {
+        GOperand o;
+        unsigned int i;
+        void *p;
+        
+        if (gcompiler_operand(gc, &o) != RETURN_SUCCESS) {
+            goperand_free(&o);
+            return RETURN_FAILURE;
+        }
+        
+        for (i = 0; i < prog->noperands; i++) {
+            if (goperand_equal(&prog->operands[i], &o)) {
+                goperand_free(&o);
+                return gcompiler_emit(gc, GOpLoad, i, 0.0);
+            }
+        }
+        
+        p = xrealloc(prog->operands, (prog->noperands + 1)*sizeof(GOperand));
+        if (!p) {
+            goperand_free(&o);
+            return RETURN_FAILURE;
+        }
+        prog->operands = p;
+        prog->operands[prog->noperands] = o;
+        prog->noperands++;
+        
+        return gcompiler_emit(gc, GOpLoad, i, 0.0);
+    } else {
+        return RETURN_FAILURE;
+    }
+}
+
+/* unary minus binds weaker than '^' but stronger than '*' */
+static int gcompiler_unary(GCompiler *gc)
+{
+    GLexer *lex = &gc->lex;
+    
+    if (glex_is_char(lex, '!')) {
+        glex_next(lex);
+        if (gcompiler_unary(gc) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        return gcompiler_emit(gc, GOpNot, 0, 0.0);
+    } else
+    if (glex_is_char(lex, '-')) {
+        glex_next(lex);
+        if (gcompiler_unary(gc) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        return gcompiler_emit(gc, GOpNeg, 0, 0.0);
+    } else
+    if (glex_is_char(lex, '+')) {
+        glex_next(lex);
+        return gcompiler_unary(gc);
+    } else {
+        if (gcompiler_primary(gc) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        if (glex_is_char(lex, '^')) {
+            glex_next(lex);
+            /* right-associative */
+            if (gcompiler_unary(gc) != RETURN_SUCCESS) {
+                return RETURN_FAILURE;
+            }
+            return gcompiler_emit(gc, GOpPow, 0, 0.0);
+        }
+        
+        return RETURN_SUCCESS;
+    }
+}
+
+static int gcompiler_binop(const GLexer *lex, int prec, GOpCode *op)
+{
+    if (lex->type != GTokChar) {
+        return FALSE;
+    }
+    
+    switch (prec) {
+    case GPREC_OR:
+        *op = GOpOr;
+        return lex->c == GCHAR_OR;
+    case GPREC_AND:
+        *op = GOpAnd;
+        return lex->c == GCHAR_AND;
+    case GPREC_CMP:
+        switch (lex->c) {
+        case '<':
+            *op = GOpLt;
+            return TRUE;
+        case '>':
+            *op = GOpGt;
+            return TRUE;
+        case GCHAR_LE:
+            *op = GOpLe;
+            return TRUE;
+        case GCHAR_GE:
+            *op = GOpGe;
+            return TRUE;
+        case GCHAR_EQ:
+            *op = GOpEq;
+            return TRUE;
+        case GCHAR_NE:
+            *op = GOpNe;
+            return TRUE;
+        default:
+            return FALSE;
+        }
+    case GPREC_ADD:
+        *op = (lex->c == '+') ? GOpAdd:GOpSub;
+        return lex->c == '+' || lex->c == '-';
+    case GPREC_MUL:
+        *op = (lex->c == '*') ? GOpMul:GOpDiv;
+        return lex->c == '*' || lex->c == '/';
+    default:
+        return FALSE;
+    }
+}
+
+static int gcompiler_expr(GCompiler *gc, int prec)
+{
+    GLexer *lex = &gc->lex;
+    GOpCode op;
+    
+    if (prec > GPREC_MUL) {
+        return gcompiler_unary(gc);
+    }
+    
+    if (gcompiler_expr(gc, prec + 1) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    while (gcompiler_binop(lex, prec, &op)) {
+        glex_next(lex);
+        if (gcompiler_expr(gc, prec + 1) != RETURN_SUCCESS ||
+            gcompiler_emit(gc, op, 0, 0.0) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        if (prec == GPREC_CMP && gcompiler_binop(lex, prec, &op)) {
+            return RETURN_FAILURE;
+        }
+    }
+    
+    return RETURN_SUCCESS;
+}
+
+static int gprogram_compile(GProgram *prog)
+{
+    GCompiler gc;
+    GLexer *lex = &gc.lex;
+    int retval = RETURN_SUCCESS;
+    
+    memset(&gc, 0, sizeof(GCompiler));
+    gc.prog = prog;
+    lex->s = prog->text;
+    glex_next(lex);
+    
+    if (!prog->expr_only) {
+        if (gcompiler_operand(&gc, &prog->target) != RETURN_SUCCESS ||
+            !glex_is_char(lex, '=')) {
+            retval = RETURN_FAILURE;
+        } else {
+            glex_next(lex);
+        }
+    }
+    
+    if (retval == RETURN_SUCCESS) {
+        retval = gcompiler_expr(&gc, GPREC_OR);
+    }
+    
+    if (retval == RETURN_SUCCESS && !prog->expr_only &&
+        glex_is_char(lex, ';')) {
+        glex_next(lex);
+    }
+    if (lex->type != GTokEnd) {
+        retval = RETURN_FAILURE;
+    }
+    
+    XCFREE(lex->name);
+    
+    return retval;
+}
+
+static void gprogram_free(GProgram *prog)
+{
+    unsigned int i;
+    
+    for (i = 0; i < prog->noperands; i++) {
+        goperand_free(&prog->operands[i]);
+    }
+    xfree(prog->operands);
+    goperand_free(&prog->target);
+    xfree(prog->instrs);
+    xfree(prog->text);
+    xfree(prog);
+}
+
+static unsigned long gprogram_hash(const char *s)
+{
+    unsigned long h = 5381;
+    
+    while (*s) {
+        h = h*33 + (unsigned char) *s;
+        s++;
+    }
+    
+    return h;
+}
+
+/* Fetch the compiled program for s from the cache, compiling it if needed.
+   Returns NULL if s is outside of the compilable subset. */
+GProgram *graal_get_program(Graal *g, const char *s, int expr_only)
+{
+    GProgram *prog, *prev = NULL;
+    unsigned long hash;
+    
+    if (!g || !s) {
+        return NULL;
+    }
+    
+    hash = gprogram_hash(s);
+    
+    prog = g->progs;
+    while (prog) {
+        if (prog->hash == hash && prog->expr_only == expr_only &&
+            strings_are_equal(prog->text, s)) {
+            if (prev) {
+                prev->next = prog->next;
+                prog->next = g->progs;
+                g->progs = prog;
+            }
+            return prog->compiled ? prog:NULL;
+        }
+        prev = prog;
+        prog = prog->next;
+    }
+    
+    prog = xmalloc(sizeof(GProgram));
+    if (!prog) {
+        return NULL;
+    }
+    memset(prog, 0, sizeof(GProgram));
+    prog->text = copy_string(NULL, s);
+    prog->expr_only = expr_only;
+    prog->hash = hash;
+    if (!prog->text) {
+        xfree(prog);
+        return NULL;
+    }
+    
+    /* failures are cached as well, to not retry them every time */
+    prog->compiled = (gprogram_compile(prog) == RETURN_SUCCESS);
+    
+    prog->next = g->progs;
+    g->progs = prog;
+    g->nprogs++;
+    
+    if (g->nprogs > GRAAL_PROG_CACHE_SIZE) {
+        GProgram *p = g->progs;
+        while (p->next->next) {
+            p = p->next;
+        }
+        gprogram_free(p->next);
+        p->next = NULL;
+        g->nprogs--;
+    }
+    
+    return prog->compiled ? prog:NULL;
+}
+
+void graal_free_programs(Graal *g)
+{
+    while (g->progs) {
+        GProgram *prog = g->progs;
+        g->progs = prog->next;
+        gprogram_free(prog);
+    }
+    g->nprogs = 0;
+}
+
+
+/*
+ * Runtime
+ */
+static void *gprogram_resolve_obj(Graal *g, const GOperand *o, void *context)
+{
+    void *obj;
+    unsigned int i;
+    
+    if (strings_are_equal(o->path[0], "this")) {
+        obj = context;
+    } else {
+        obj = graal_get_user_obj(g, context, o->path[0]);
+    }
+    
+    for (i = 1; obj && i < o->npath; i++) {
+        obj = graal_get_user_obj(g, obj, o->path[i]);
+    }
+    
+    return obj;
+}
+
+/* fetch the current value of an operand; FALSE if it isn't numeric */
+static int gprogram_resolve(Graal *g, const GOperand *o, void *context,
+    GValue *val)
+{
+    memset(val, 0, sizeof(GValue));
+    
+    if (o->npath == 0) {
+        GVar *var;
+        
+        /* the name is taken by an object */
+        if (graal_get_user_obj(g, context, o->name)) {
+            return FALSE;
+        }
+        
+        var = graal_get_var(g, o->name, FALSE);
+        if (!var) {
+            return FALSE;
+        }
+        switch (var->type) {
+        case GVarNum:
+            val->val = var->data.num;
+            return TRUE;
+        case GVarArr:
+            val->isvec = TRUE;
+            val->v     = var->data.arr->x;
+            val->size  = var->data.arr->size;
+            return TRUE;
+        default:
+            return FALSE;
+        }
+    } else {
+        GVarData prop;
+        void *obj = gprogram_resolve_obj(g, o, context);
+        
+        if (!obj) {
+            return FALSE;
+        }
+        
+        switch (graal_get_user_obj_prop(g, obj, o->name, &prop)) {
+        case GVarNum:
+            val->val = prop.num;
+            return TRUE;
+        case GVarArr:
+            if (!prop.arr) {
+                return FALSE;
+            }
+            val->isvec = TRUE;
+            val->da    = prop.arr;
+            val->v     = prop.arr->x;
+            val->size  = prop.arr->size;
+            return TRUE;
+        case GVarStr:
+            xfree(prop.str);
+            return FALSE;
+        default:
+            return FALSE;
+        }
+    }
+}
+
+static void gprogram_release(const GProgram *prog, GValue *vals)
+{
+    unsigned int i;
+    
+    for (i = 0; i < prog->noperands; i++) {
+        darray_free(vals[i].da);
+    }
+    xfree(vals);
+}
+
+/* resolve operands and check the types of all operations the way the
+   grammar would; returns NULL if the parser has to handle the case */
+static GValue *gprogram_prepare(Graal *g, const GProgram *prog, void *context,
+    int *isvec, unsigned int *size)
+{
+    GValue *vals, *stack;
+    unsigned int i, sp = 0;
+    int ok = TRUE;
+    
+    vals = xcalloc(prog->noperands + 1, sizeof(GValue));
+    stack = xcalloc(prog->depth + 1, sizeof(GValue));
+    if (!vals || !stack) {
+        xfree(vals);
+        xfree(stack);
+        return NULL;
+    }
+    
+    for (i = 0; ok && i < prog->noperands; i++) {
+        ok = gprogram_resolve(g, &prog->operands[i], context, &vals[i]);
+    }
+    
+    for (i = 0; ok && i < prog->ninstrs; i++) {
+        const GInstr *instr = &prog->instrs[i];
+        GValue *a, *b;
+        
+        switch (instr->op) {
+        case GOpConst:
+            stack[sp].isvec  = FALSE;
+            stack[sp].isbool = FALSE;
+            sp++;
+            break;
+        case GOpLoad:
+            stack[sp].isvec  = vals[instr->arg].isvec;
+            stack[sp].isbool = FALSE;
+            stack[sp].size   = vals[instr->arg].size;
+            sp++;
+            break;
+        case GOpNeg:
+            ok = !stack[sp - 1].isbool;
+            break;
+        case GOpNot:
+            ok = stack[sp - 1].isbool;
+            break;
+        case GOpLt:
+        case GOpGt:
+        case GOpLe:
+        case GOpGe:
+        case GOpEq:
+        case GOpNe:
+        case GOpAnd:
+        case GOpOr:
+            sp--;
+            a = &stack[sp - 1];
+            b = &stack[sp];
+            if (instr->op == GOpAnd || instr->op == GOpOr) {
+                ok = a->isbool && b->isbool;
+            } else
+            if (instr->op == GOpEq || instr->op == GOpNe) {
+                ok = (a->isbool == b->isbool);
+            } else {
+                ok = !a->isbool && !b->isbool;
+            }
+            if (a->isvec && b->isvec && a->size != b->size) {
+                ok = FALSE;
+            } else
+            if (b->isvec) {
+                a->isvec = TRUE;
+                a->size  = b->size;
+            }
+            a->isbool = TRUE;
+            break;
+        default:
+            sp--;
+            a = &stack[sp - 1];
+            b = &stack[sp];
+            if (a->isbool || b->isbool) {
+                ok = FALSE;
+            } else
+            if (a->isvec && b->isvec) {
+                if (instr->op == GOpPow || a->size != b->size) {
+                    ok = FALSE;
+                }
+            } else
+            if (b->isvec) {
+                if (instr->op == GOpDiv || instr->op == GOpPow) {
+                    ok = FALSE;
+                } else {
+                    a->isvec = TRUE;
+                    a->size  = b->size;
+                }
+            }
+            break;
+        }
+    }
+    
+    /* a scalar boolean is left to the parser, to keep its type */
+    if (ok && stack[0].isbool && !stack[0].isvec) {
+        ok = FALSE;
+    }
+    
+    if (ok) {
+        *isvec = stack[0].isvec;
+        *size  = stack[0].size;
+    }
+    
+    xfree(stack);
+    
+    if (!ok) {
+        gprogram_release(prog, vals);
+        return NULL;
+    }
+    
+    return vals;
+}
+
+static GError gprogram_check_pow(double x, double y)
+{
+    if (x < 0 && rint(y) != y) {
+        return GErrNegPow;
+    } else if (x == 0.0 && y <= 0.0) {
+        return GErrZeroPow;
+    } else {
+        return GErrNone;
+    }
+}
+
+static void gprogram_report(GError err)
+{
+    switch (err) {
+    case GErrDivZero:
+        errmsg("divide by zero");
+        break;
+    case GErrNegPow:
+        errmsg("negative value raised to non-integer power");
+        break;
+    case GErrZeroPow:
+        errmsg("zero raised to non-positive power");
+        break;
+    case GErrNoMem:
+        errmsg("Not enough memory");
+        break;
+    default:
+        break;
+    }
+}
+
+static double gprogram_compare(GOpCode op, double x, double y)
+{
+    switch (op) {
+    case GOpLt:
+        return x < y;
+    case GOpGt:
+        return x > y;
+    case GOpLe:
+        return x <= y;
+    case GOpGe:
+        return x >= y;
+    case GOpEq:
+        return x == y;
+    case GOpNe:
+        return x != y;
+    case GOpAnd:
+        return x && y;
+    case GOpOr:
+        return x || y;
+    default:
+        return 0.0;
+    }
+}
+
+/* evaluate a binary operation on a block of len rows into r */
+static GError gprogram_binop(GOpCode op, GValue *a, const GValue *b,
+    double *r, unsigned int len)
+{
+    unsigned int k;
+    GError err;
+    
+    if (op >= GOpLt) {
+        if (!a->isvec && !b->isvec) {
+            a->val = gprogram_compare(op, a->val, b->val);
+        } else {
+            for (k = 0; k < len; k++) {
+                r[k] = gprogram_compare(op,
+                    a->isvec ? a->v[k]:a->val, b->isvec ? b->v[k]:b->val);
+            }
+            a->isvec = TRUE;
+            a->v = r;
+        }
+        
+        return GErrNone;
+    }
+    
+    if (!a->isvec && !b->isvec) {
+        double x = a->val, y = b->val;
+        switch (op) {
+        case GOpAdd:
+            a->val = x + y;
+            break;
+        case GOpSub:
+            a->val = x - y;
+            break;
+        case GOpMul:
+            a->val = x*y;
+            break;
+        case GOpDiv:
+            if (y == 0.0) {
+                return GErrDivZero;
+            }
+            a->val = x/y;
+            break;
+        case GOpPow:
+            if ((err = gprogram_check_pow(x, y)) != GErrNone) {
+                return err;
+            }
+            a->val = pow(x, y);
+            break;
+        default:
+            return GErrNone;
+        }
+        
+        return GErrNone;
+    }
+    
+    if (a->isvec && b->isvec) {
+        const double *x = a->v, *y = b->v;
+        switch (op) {
+        case GOpAdd:
+            for (k = 0; k < len; k++) {
+                r[k] = x[k] + y[k];
+            }
+            break;
+        case GOpSub:
+            for (k = 0; k < len; k++) {
+                r[k] = x[k] - y[k];
+            }
+            break;
+        case GOpMul:
+            for (k = 0; k < len; k++) {
+                r[k] = x[k]*y[k];
+            }
+            break;
+        case GOpDiv:
+            for (k = 0; k < len; k++) {
+                if (y[k] == 0.0) {
+                    return GErrDivZero;
+                }
+                r[k] = x[k]/y[k];
+            }
+            break;
+        default:
+            return GErrNone;
+        }
+    } else
+    if (a->isvec) {
+        const double *x = a->v;
+        double s = b->val;
+        switch (op) {
+        case GOpAdd:
+            for (k = 0; k < len; k++) {
+                r[k] = x[k] + s;
+            }
+            break;
+        case GOpSub:
+            for (k = 0; k < len; k++) {
+                r[k] = x[k] - s;
+            }
+            break;
+        case GOpMul:
+            for (k = 0; k < len; k++) {
+                r[k] = x[k]*s;
+            }
+            break;
+        case GOpDiv:
+            if (s == 0.0) {
+                return GErrDivZero;
+            }
+            s = 1.0/s;
+            for (k = 0; k < len; k++) {
+                r[k] = x[k]*s;
+            }
+            break;
+        case GOpPow:
+            for (k = 0; k < len; k++) {
+                if ((err = gprogram_check_pow(x[k], s)) != GErrNone) {
+                    return err;
+                }
+                r[k] = pow(x[k], s);
+            }
+            break;
+        default:
+            return GErrNone;
+        }
+    } else {
+        const double *y = b->v;
+        double s = a->val;
+        switch (op) {
+        case GOpAdd:
+            for (k = 0; k < len; k++) {
+                r[k] = y[k] + s;
+            }
+            break;
+        case GOpSub:
+            for (k = 0; k < len; k++) {
+                r[k] = s - y[k];
+            }
+            break;
+        case GOpMul:
+            for (k = 0; k < len; k++) {
+                r[k] = y[k]*s;
+            }
+            break;
+        default:
+            return GErrNone;
+        }
+        a->isvec = TRUE;
+    }
+    
+    a->v = r;
+    
+    return GErrNone;
+}
+
+/* run the program over blocks [b1, b2) of rows; a vector result goes to
+   out, a scalar one to val */
+static GError gprogram_exec_blocks(const GProgram *prog, const GValue *vals,
+    unsigned int size, unsigned int b1, unsigned int b2,
+    double *out, double *val)
+{
+    GValue *stack;
+    double *regs;
+    unsigned int b;
+    GError err = GErrNone;
+    
+    stack = xcalloc(prog->depth, sizeof(GValue));
+    regs = xmalloc(prog->depth*GPROG_BLOCK*SIZEOF_DOUBLE);
+    if (!stack || !regs) {
+        xfree(stack);
+        xfree(regs);
+        return GErrNoMem;
+    }
+    
+    for (b = b1; err == GErrNone && b < b2; b++) {
+        unsigned int i, k, sp = 0, i0, len;
+        
+        i0 = b*GPROG_BLOCK;
+        len = MIN2(GPROG_BLOCK, size - i0);
+        
+        for (i = 0; err == GErrNone && i < prog->ninstrs; i++) {
+            const GInstr *instr = &prog->instrs[i];
+            GValue *a;
+            double *r;
+            
+            switch (instr->op) {
+            case GOpConst:
+                stack[sp].isvec = FALSE;
+                stack[sp].val = instr->val;
+                sp++;
+                break;
+            case GOpLoad:
+                stack[sp] = vals[instr->arg];
+                if (stack[sp].isvec) {
+                    stack[sp].v += i0;
+                }
+                sp++;
+                break;
+            case GOpNeg:
+                a = &stack[sp - 1];
+                if (a->isvec) {
+                    r = regs + (sp - 1)*GPROG_BLOCK;
+                    for (k = 0; k < len; k++) {
+                        r[k] = -a->v[k];
+                    }
+                    a->v = r;
+                } else {
+                    a->val = -a->val;
+                }
+                break;
+            case GOpNot:
+                a = &stack[sp - 1];
+                if (a->isvec) {
+                    r = regs + (sp - 1)*GPROG_BLOCK;
+                    for (k = 0; k < len; k++) {
+                        r[k] = !a->v[k];
+                    }
+                    a->v = r;
+                } else {
+                    a->val = !a->val;
+                }
+                break;
+            default:
+                sp--;
+                r = regs + (sp - 1)*GPROG_BLOCK;
+                err = gprogram_binop(instr->op,
+                    &stack[sp - 1], &stack[sp], r, len);
+                break;
+            }
+        }
+        
+        if (err == GErrNone) {
+            if (stack[0].isvec) {
+                if (len) {
+                    memcpy(out + i0, stack[0].v, len*SIZEOF_DOUBLE);
+                }
+            } else {
+                *val = stack[0].val;
+            }
+        }
+    }
+    
+    xfree(regs);
+    xfree(stack);
+    
+    return err;
+}
+
+typedef struct {
+    const GProgram *prog;
+    const GValue *vals;
+    unsigned int size;
+    unsigned int nblocks;
+    double *out;
+    GError *errs;           /* per job */
+} GExecJobs;
+
+/* parallel worker: evaluate the job-th contiguous range of blocks */
+static void gprogram_exec_job(unsigned int job, unsigned int njobs,
+    void *udata)
+{
+    GExecJobs *jobs = (GExecJobs *) udata;
+    unsigned int b1, b2;
+    double dummy;
+    
+    b1 = (unsigned int) ((double) jobs->nblocks*job/njobs);
+    b2 = (unsigned int) ((double) jobs->nblocks*(job + 1)/njobs);
+    
+    jobs->errs[job] = gprogram_exec_blocks(jobs->prog, jobs->vals,
+        jobs->size, b1, b2, jobs->out, &dummy);
+}
+
+/* stream the program over all rows, a block at a time, splitting large
+   vectors between threads; errors are reported as the parser would */
+static int gprogram_exec(const GProgram *prog, const GValue *vals,
+    unsigned int size, double *out, double *val)
+{
+    unsigned int nblocks, njobs = 1;
+    GError err;
+    
+    nblocks = (size + GPROG_BLOCK - 1)/GPROG_BLOCK;
+    
+    if (out && size >= GPROG_PARALLEL_MIN) {
+        njobs = MIN2(parallel_get_nthreads(), nblocks);
+    }
+    
+    if (njobs > 1) {
+        GExecJobs jobs;
+        unsigned int i;
+        
+        jobs.prog    = prog;
+        jobs.vals    = vals;
+        jobs.size    = size;
+        jobs.nblocks = nblocks;
+        jobs.out     = out;
+        jobs.errs    = xcalloc(njobs, sizeof(GError));
+        if (jobs.errs) {
+            parallel_run(njobs, gprogram_exec_job, &jobs);
+            
+            /* report the error of the first failed range */
+            err = GErrNone;
+            for (i = 0; err == GErrNone && i < njobs; i++) {
+                err = jobs.errs[i];
+            }
+            xfree(jobs.errs);
+            
+            gprogram_report(err);
+            
+            return (err == GErrNone) ? RETURN_SUCCESS:RETURN_FAILURE;
+        }
+    }
+    
+    err = gprogram_exec_blocks(prog, vals, size, 0, MAX2(nblocks, 1),
+        out, val);
+    gprogram_report(err);
+    
+    return (err == GErrNone) ? RETURN_SUCCESS:RETURN_FAILURE;
+}
+
+/* Evaluate a compiled expression into a scalar val or, if out is given,
+   into the out array (a scalar result is broadcast) */
+int gprogram_eval(Graal *g, const GProgram *prog, void *context,
+    double *val, DArray *out)
+{
+    GValue *vals;
+    int isvec;
+    unsigned int size;
+    double v;
+    int retval;
+    
+    if (!g || !prog) {
+        return GPROG_FALLBACK;
+    }
+    
+    graal_set_context(g, context);
+    
+    vals = gprogram_prepare(g, prog, context, &isvec, &size);
+    if (!vals) {
+        return GPROG_FALLBACK;
+    }
+    
+    if (isvec && (!out || out->size != size)) {
+        gprogram_release(prog, vals);
+        return GPROG_FALLBACK;
+    }
+    
+    retval = gprogram_exec(prog, vals, size, isvec ? out->x:NULL, &v);
+    
+    gprogram_release(prog, vals);
+    
+    if (retval != RETURN_SUCCESS) {
+        return GPROG_FAILED;
+    }
+    
+    if (!isvec) {
+        if (out) {
+            darray_set_const(out, v);
+        }
+        if (val) {
+            *val = v;
+        }
+    }
+    
+    return GPROG_DONE;
+}
+
+/* Run a compiled assignment statement */
+int gprogram_run(Graal *g, const GProgram *prog, void *context)
+{
+    const GOperand *target;
+    GValue *vals;
+    GVar *var = NULL;
+    void *obj = NULL;
+    DArray *da = NULL;
+    int isvec, retval;
+    unsigned int size;
+    double v;
+    
+    if (!g || !prog || prog->expr_only) {
+        return GPROG_FALLBACK;
+    }
+    
+    graal_set_context(g, context);
+    
+    target = &prog->target;
+    if (target->npath == 0) {
+        if (graal_get_user_obj(g, context, target->name)) {
+            return GPROG_FALLBACK;
+        }
+    } else {
+        obj = gprogram_resolve_obj(g, target, context);
+        if (!obj) {
+            return GPROG_FALLBACK;
+        }
+    }
+    
+    vals = gprogram_prepare(g, prog, context, &isvec, &size);
+    if (!vals) {
+        return GPROG_FALLBACK;
+    }
+    
+    if (isvec) {
+        da = darray_new(size);
+        if (!da) {
+            gprogram_release(prog, vals);
+            return GPROG_FAILED;
+        }
+    }
+    
+    retval = gprogram_exec(prog, vals, size, isvec ? da->x:NULL, &v);
+    
+    gprogram_release(prog, vals);
+    
+    if (retval != RETURN_SUCCESS) {
+        darray_free(da);
+        return GPROG_FAILED;
+    }
+    
+    if (obj) {
+        GVarData prop;
+        if (isvec) {
+            prop.arr = da;
+        } else {
+            prop.num = v;
+        }
+        if (graal_set_user_obj_prop(g, obj, target->name,
+            isvec ? GVarArr:GVarNum, prop) != RETURN_SUCCESS) {
+            errmsg("assignment failed");
+        }
+        darray_free(da);
+        
+        return GPROG_DONE;
+    } else {
+        int existed;
+        
+        var = graal_get_var(g, target->name, FALSE);
+        existed = (var != NULL);
+        if (!existed) {
+            var = graal_get_var(g, target->name, TRUE);
+        }
+        
+        if (!var) {
+            darray_free(da);
+            return GPROG_FAILED;
+        }
+        
+        if (isvec) {
+            retval = gvar_take_arr(var, da);
+        } else {
+            retval = gvar_set_num(var, v);
+        }
+        
+        if (retval != RETURN_SUCCESS) {
+            errmsg(existed ? "assignment failed - check types":"assignment failed");
+            return GPROG_FAILED;
+        }
+        
+        return GPROG_DONE;
+    }
+}
@@ -46,6 +46,7 @@ void graal_free(Graal *g)
         graal_scanner_delete(g);
         graal_free_vars(g);
         graal_free_darrs(g);
+        graal_free_programs(g);
         xfree(g);
     }
 }
@@ -54,7 +55,21 @@ int graal_parse_line(Graal *g, const char *s, void *context)
 {
     if (g && s) {
         int retval;
-        char *buf = copy_string(NULL, s);
+        char *buf;
+        GProgram *prog = graal_get_program(g, s, FALSE);
+        
+        if (prog) {
+            switch (gprogram_run(g, prog, context)) {
+            case GPROG_DONE:
+                return RETURN_SUCCESS;
+            case GPROG_FAILED:
+                return RETURN_FAILURE;
+            default:
+                break;
+            }
+        }
+        
+        buf = copy_string(NULL, s);
         buf = concat_strings(buf, ";");
         retval = graal_parse(g, buf, context);
         xfree(buf);
@@ -230,6 +245,22 @@ int gvar_set_arr(GVar *var, DArray *da)
     }
 }
 
+/* same as gvar_set_arr(), but takes ownership of da (freed on failure) */
+int gvar_take_arr(GVar *var, DArray *da)
+{
+    if (var && (var->type == GVarNil || var->type == GVarArr)) {
+        if (var->type == GVarArr) {
+            darray_free(var->data.arr);
+        }
+        var->type = GVarArr;
+        var->data.arr = da;
+        return RETURN_SUCCESS;
+    } else {
+        darray_free(da);
+        return RETURN_FAILURE;
+    }
+}
+
 int graal_register_darr(Graal *g, DArray *da)
 {
     void *p;
@@ -274,9 +305,34 @@ int graal_transform_arr(Graal *g,
     if (var) {
         DArray *res;
         char *buf;
+        GProgram *prog;
         
         gvar_set_arr(var, da);
         
+        /* evaluate by the compiled program if possible; into a scratch
+           array, so that da is left intact if the evaluation fails */
+        prog = graal_get_program(g, formula, TRUE);
+        if (prog) {
+            DArray *tmp = darray_new(da->size);
+            int status;
+            if (!tmp) {
+                return RETURN_FAILURE;
+            }
+            status = gprogram_eval(g, prog, context, NULL, tmp);
+            if (status == GPROG_DONE) {
+                memcpy(da->x, tmp->x, da->size*SIZEOF_DOUBLE);
+            }
+            darray_free(tmp);
+            switch (status) {
+            case GPROG_DONE:
+                return RETURN_SUCCESS;
+            case GPROG_FAILED:
+                return RETURN_FAILURE;
+            default:
+                break;
+            }
+        }
+        
         buf = copy_string(NULL, varname);
         buf = concat_strings(buf, " = ");
         buf = concat_strings(buf, formula);
@@ -303,6 +359,25 @@ int graal_eval_expr(Graal *g, const char *formula, double *val, void *context)
     char *buf;
     int retval;
     GVar *var;
+    GProgram *prog;
+    
+    prog = graal_get_program(g, formula, TRUE);
+    if (prog) {
+        double v;
+        switch (gprogram_eval(g, prog, context, &v, NULL)) {
+        case GPROG_DONE:
+            var = graal_get_var(g, "$d", TRUE);
+            if (var && gvar_set_num(var, v) == RETURN_SUCCESS) {
+                *val = v;
+                return RETURN_SUCCESS;
+            }
+            break;
+        case GPROG_FAILED:
+            return RETURN_FAILURE;
+        default:
+            break;
+        }
+    }
     
     buf = copy_string(NULL, "$d = ");
     buf = concat_strings(buf, formula);
@@ -518,6 +518,7 @@ vexpr:      array { $$ = $1; }
         |   vexpr '*' expr {
                 $$ = darray_copy($1);
                 if ($$) {
+                    REGISTER_DARR($$);
                     darray_mul_val($$, $3);
                 }
             }
@@ -577,7 +578,11 @@ vexpr:      array { $$ = $1; }
                     yyerror("zero raised to non-positive power");
                     YYABORT;
                 } else {
-                    darray_pow($$, $3);
+                    $$ = darray_copy($1);
+                    if ($$) {
+                        REGISTER_DARR($$);
+                        darray_pow($$, $3);
+                    }
                 }
             }
 	|   '-' vexpr %prec UMINUS {
@@ -26,8 +26,13 @@
  */
 
 #include <ctype.h>
+#include <float.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "grace/graceP.h"
+#include "pow5.h"
 
 /*
  * expand years according to the following rules :
@@ -78,15 +83,196 @@ static int check_date(const Project *pr,
 }
 
 
+/* significant digits kept in the slow path; enough to round any double */
+#define PARSE_FLOAT_MAXDIGITS 768
+
+/* powers of ten exactly representable as doubles */
+static const double exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Clinger's fast path: a mantissa and a power of ten that are both exact
+ * doubles give a correctly rounded product (or quotient) in one operation.
+ * This needs the FPU to round to double precision.
+ */
+static int parse_float_fast(uint64_t mant, int exp10, double *value)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if (mant > ((uint64_t) 1 << 53)) {
+        return RETURN_FAILURE;
+    }
+    
+    if (exp10 > 22 && exp10 <= 22 + 15) {
+        /* move the excess to the mantissa if it stays exact */
+        uint64_t m = mant;
+        while (exp10 > 22) {
+            m *= 10;
+            if (m > ((uint64_t) 1 << 53)) {
+                return RETURN_FAILURE;
+            }
+            exp10--;
+        }
+        mant = m;
+    }
+    
+    if (exp10 >= 0 && exp10 <= 22) {
+        *value = (double) mant*exact_pow10[exp10];
+        return RETURN_SUCCESS;
+    } else
+    if (exp10 < 0 && exp10 >= -22) {
+        *value = (double) mant/exact_pow10[-exp10];
+        return RETURN_SUCCESS;
+    }
+#endif
+    return RETURN_FAILURE;
+}
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 uint128_t;
+#endif
+
+/* 64x64 -> 128 bit multiplication; returns the high word */
+static uint64_t mul64(uint64_t a, uint64_t b, uint64_t *lo)
+{
+#ifdef __SIZEOF_INT128__
+    uint128_t p = (uint128_t) a*b;
+    *lo = (uint64_t) p;
+    return (uint64_t) (p >> 64);
+#else
+    uint64_t a0 = a & 0xffffffff, a1 = a >> 32;
+    uint64_t b0 = b & 0xffffffff, b1 = b >> 32;
+    uint64_t p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+    uint64_t mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+    *lo = (mid << 32) | (p00 & 0xffffffff);
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+/*
+ * Eisel-Lemire algorithm: the leading bits of the 128-bit product of the
+ * normalized mantissa and a truncated power of ten determine the correctly
+ * rounded double, unless the product is too close to a rounding boundary;
+ * those rare cases, subnormals and overflows are left to the caller
+ */
+static int parse_float_eisel_lemire(uint64_t mant, int exp10, double *value)
+{
+    const uint64_t *pow10;
+    uint64_t hi, lo, bits, m;
+    int clz, exp2, msb;
+    
+    if (exp10 < POW5_MIN_EXP10 || exp10 > POW5_MAX_EXP10 || mant == 0) {
+        return RETURN_FAILURE;
+    }
+    pow10 = pow5_128[exp10 - POW5_MIN_EXP10];
+    
+    /* normalize the mantissa */
+    clz = 0;
+    while (!(mant & ((uint64_t) 1 << 63))) {
+        mant <<= 1;
+        clz++;
+    }
+    /* 217706/2^16 ~ log2(10) */
+    exp2 = ((217706*exp10) >> 16) + 64 + 1023 - clz;
+    
+    hi = mul64(mant, pow10[0], &lo);
+    if ((hi & 0x1ff) == 0x1ff && lo + mant < mant) {
+        /* the truncation of the power may matter; use all of its 128 bits */
+        uint64_t yhi, ylo;
+        yhi = mul64(mant, pow10[1], &ylo);
+        if (lo + yhi < lo) {
+            hi++;
+        }
+        lo += yhi;
+        if ((hi & 0x1ff) == 0x1ff && lo + 1 == 0 && ylo + mant < mant) {
+            return RETURN_FAILURE;
+        }
+    }
+    
+    /* keep 54 bits */
+    msb = (int) (hi >> 63);
+    m = hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+    
+    if (lo == 0 && (hi & 0x1ff) == 0 && (m & 3) == 1) {
+        /* exactly halfway between two doubles? */
+        return RETURN_FAILURE;
+    }
+    
+    /* round to 53 bits */
+    m += m & 1;
+    m >>= 1;
+    if (m >> 53) {
+        m >>= 1;
+        exp2++;
+    }
+    if (exp2 <= 0 || exp2 >= 0x7ff) {
+        return RETURN_FAILURE;
+    }
+    
+    bits = ((uint64_t) exp2 << 52) | (m & (((uint64_t) 1 << 52) - 1));
+    memcpy(value, &bits, sizeof(double));
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * the general case: rewrite the number as an integer mantissa and decimal
+ * exponent, which is locale-independent, and let strtod() round it
+ */
+static double parse_float_slow(const char *s, const char *end, int raw_exp)
+{
+    char buf[PARSE_FLOAT_MAXDIGITS + 32];
+    int nb = 0, exp10 = raw_exp, in_frac = FALSE, sticky = FALSE;
+    
+    for (; s < end; s++) {
+        if (*s == '.') {
+            in_frac = TRUE;
+        } else if (nb == 0 && *s == '0') {
+            /* leading zero */
+            if (in_frac) {
+                exp10--;
+            }
+        } else if (nb < PARSE_FLOAT_MAXDIGITS) {
+            buf[nb++] = *s;
+            if (in_frac) {
+                exp10--;
+            }
+        } else {
+            if (!in_frac) {
+                exp10++;
+            }
+            if (*s != '0') {
+                sticky = TRUE;
+            }
+        }
+    }
+    
+    if (nb == 0) {
+        return 0.0;
+    }
+    if (sticky) {
+        /* digits beyond the precision limit only break the ties */
+        buf[nb++] = '1';
+        exp10--;
+    }
+    sprintf(buf + nb, "e%d", exp10);
+    
+    return strtod(buf, NULL);
+}
+
 /*
  * lexical analyzer for float data. Knows about fortran exponent
  * markers. Store address of following data in *after, only in case of
- * success (thus it is allowed to have after == &s)
+ * success (thus it is allowed to have after == &s). The result is
+ * correctly rounded.
  */
 int parse_float(const char* s, double *value, const char **after)
 {
-    int neg_mant, neg_exp, digits, dot_exp, raw_exp;
-    const char *after_dot;
+    int neg_mant, neg_exp, digits, nsig, dot_exp, raw_exp, exp10, truncated;
+    uint64_t mant;
+    const char *mstart, *mend;
 
     /* we skip leading whitespace */
     while (isspace(*s)) {
@@ -104,23 +290,52 @@ int parse_float(const char* s, double *value, const char **after)
         }
     }
 
-    /* mantissa */
+    /* mantissa; up to 19 significant digits are accumulated exactly */
+    mstart = s;
     digits = 0;
-    *value = 0.0;
-    while (isdigit(*s)) {
-        *value = *value*10.0 + (*s++ - '0');
+    nsig = 0;
+    dot_exp = 0;
+    truncated = FALSE;
+    mant = 0;
+    while (*s == '0') {
+        s++;
+        digits++;
+    }
+    while (*s >= '0' && *s <= '9') {
+        if (nsig < 19) {
+            mant = mant*10 + (*s - '0');
+            nsig++;
+        } else {
+            dot_exp++;
+            if (*s != '0') {
+                truncated = TRUE;
+            }
+        }
+        s++;
         digits++;
     }
     if (*s == '.') {
-        after_dot = ++s;
-        while (isdigit(*s)) {
-            *value = *value*10.0 + (*s++ - '0');
+        s++;
+        if (nsig == 0) {
+            while (*s == '0') {
+                dot_exp--;
+                s++;
+                digits++;
+            }
+        }
+        while (*s >= '0' && *s <= '9') {
+            if (nsig < 19) {
+                mant = mant*10 + (*s - '0');
+                nsig++;
+                dot_exp--;
+            } else if (*s != '0') {
+                truncated = TRUE;
+            }
+            s++;
             digits++;
         }
-        dot_exp = after_dot - s;
-    } else {
-        dot_exp = 0;
     }
+    mend = s;
     if (digits == 0) {
         /* there should be at least one digit (either before or after dot) */
         return RETURN_FAILURE;
@@ -139,8 +354,12 @@ int parse_float(const char* s, double *value, const char **after)
                 s++;
             }
         }
-        while (isdigit(*s)) {
-            raw_exp = raw_exp*10 + (*s++ - '0');
+        while (*s >= '0' && *s <= '9') {
+            /* anything beyond over/underflows anyway */
+            if (raw_exp < 100000) {
+                raw_exp = raw_exp*10 + (*s - '0');
+            }
+            s++;
         }
         if (neg_exp) {
             raw_exp = -raw_exp;
@@ -148,7 +367,27 @@ int parse_float(const char* s, double *value, const char **after)
     }
 
     /* read float */
-    *value = (neg_mant ? -(*value) : (*value)) * pow (10.0, dot_exp + raw_exp);
+    exp10 = dot_exp + raw_exp;
+    if (mant == 0 && !truncated) {
+        *value = 0.0;
+    } else
+    if (!truncated) {
+        if (parse_float_fast(mant, exp10, value) != RETURN_SUCCESS &&
+            parse_float_eisel_lemire(mant, exp10, value) != RETURN_SUCCESS) {
+            *value = parse_float_slow(mstart, mend, raw_exp);
+        }
+    } else {
+        /* the dropped digits don't matter if both neighbours round alike */
+        double v1;
+        if (parse_float_eisel_lemire(mant, exp10, value) != RETURN_SUCCESS ||
+            parse_float_eisel_lemire(mant + 1, exp10, &v1) != RETURN_SUCCESS ||
+            *value != v1) {
+            *value = parse_float_slow(mstart, mend, raw_exp);
+        }
+    }
+    if (neg_mant) {
+        *value = -(*value);
+    }
 
     if (after != NULL) {
         /* the caller wants to know what follows the float number */
@@ -269,7 +508,7 @@ int parse_date(const Quark *q, const char* s, Dates_format preferred, int absolu
     Project *pr = project_get_data(q);
     int i, n;
     int ky, km, kd;
-    static Dates_format trials [] = {FMT_nohint, FMT_iso, FMT_european, FMT_us};
+    Dates_format trials [] = {FMT_nohint, FMT_iso, FMT_european, FMT_us};
     Int_token tab [5];
     long j;
     double sec;
@@ -295,7 +534,7 @@ int parse_date(const Quark *q, const char* s, Dates_format preferred, int absolu
       case 6 :
           /* we now have a complete date */
 
-          /* try the user's choice first */
+          /* try the user's choice first (a local copy keeps us reentrant) */
           trials[0] = preferred;
 
           for (i = 0; i < 4; i++) {
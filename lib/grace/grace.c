@@ -334,6 +334,50 @@ int gproject_render(const GProject *gp)
     return res;
 }
 
+/* see drawgraph_damage() */
+int gproject_get_damage(const GProject *gp, PageCache *pc, view *damage)
+{
+    int res;
+    
+    Grace *grace = grace_from_gproject(gp);
+    
+    if (!grace) {
+        view_invalidate(damage);
+        return TRUE;
+    }
+    
+    canvas_set_udata(grace->canvas, (GProject *) gp);
+    
+    res = drawgraph_damage(grace->canvas, grace->graal, gp->q, pc, damage);
+    
+    canvas_set_udata(grace->canvas, NULL);
+    
+    return res;
+}
+
+/* render the damaged part of the page only; see drawgraph_update() */
+int gproject_render_update(const GProject *gp,
+    PageCache *pc, const view *damage)
+{
+    int res;
+    
+    Grace *grace = grace_from_gproject(gp);
+    
+    if (!grace) {
+        return RETURN_FAILURE;
+    }
+    
+    canvas_set_udata(grace->canvas, (GProject *) gp);
+    
+    canvas_set_docname(grace->canvas, gproject_get_docname(gp));
+    
+    res = drawgraph_update(grace->canvas, grace->graal, gp->q, pc, damage);
+    
+    canvas_set_udata(grace->canvas, NULL);
+    
+    return res;
+}
+
 GProject *gproject_new(Quark *parent, const Grace *grace, int mmodel)
 {
     GProject *gp = xmalloc(sizeof(GProject));
@@ -354,6 +398,8 @@ void gproject_free(GProject *gp)
     if (gp) {
         quark_free(gp->q);
         grfile_free(gp->grf);
+        grfile_unmap(gp->map, gp->maplen);
+        xfree(gp->mapfile);
         xfree(gp);
     }
 }
@@ -37,9 +37,6 @@
 
 #define BUFLEN   512
 
-/* T1lib is NOT re-entrant... */
-static int font_db_inited = FALSE;
-
 int grace_init_font_db(const Grace *grace)
 {
     int i, nfonts;
@@ -47,7 +44,7 @@ int grace_init_font_db(const Grace *grace)
     FILE *fp;
     int res;
     
-    if (font_db_inited) {
+    if (number_of_fonts(grace->canvas) > 0) {
         return RETURN_SUCCESS;
     }
     
@@ -96,8 +93,6 @@ int grace_init_font_db(const Grace *grace)
     
     fclose(fp);
     
-    font_db_inited = TRUE;
-    
     return RETURN_SUCCESS;
 }
 
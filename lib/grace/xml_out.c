@@ -33,6 +33,13 @@
  * XML project output
  */
 
+typedef struct {
+    XFile *xf;
+    FILE *bin;              /* where to write the data blocks */
+    int binary;             /* whether numerical columns go to data blocks */
+    unsigned long offset;   /* offset of the next data block */
+} ProjectSaveData;
+
 static void xmlio_set_active(Attributes *attrs, int active)
 {
     attributes_set_bval(attrs, AStrActive, active);
@@ -640,8 +647,9 @@ int save_set_properties(XFile *xf, Quark *pset)
     return RETURN_SUCCESS;
 }
 
-static int save_ssd(XFile *xf, Quark *q)
+static int save_ssd(ProjectSaveData *sd, Quark *q)
 {
+    XFile *xf = sd->xf;
     Attributes *attrs;
     unsigned int i, j, ncols, nrows;
     unsigned int prec;
@@ -669,6 +677,16 @@ static int save_ssd(XFile *xf, Quark *q)
         attributes_reset(attrs);
         attributes_set_sval(attrs, AStrLabel, col->label);
         ename = col->format == FFORMAT_STRING ? EStrScolumn:EStrDcolumn;
+        
+        if (sd->binary && col->format != FFORMAT_STRING && nrows) {
+            char buf[32];
+            sprintf(buf, "%lu", sd->offset);
+            attributes_set_sval(attrs, AStrOffset, buf);
+            xfile_empty_element(xf, ename, attrs);
+            sd->offset += (unsigned long) nrows*SIZEOF_DOUBLE;
+            continue;
+        }
+        
         xfile_begin_element(xf, ename, attrs);
         
         for (j = 0; j < nrows; j++) {
@@ -747,7 +765,8 @@ int save_preferences(XFile *xf)
 static int project_save_hook(Quark *q,
     void *udata, QTraverseClosure *closure)
 {
-    XFile *xf = (XFile *) udata;
+    ProjectSaveData *sd = (ProjectSaveData *) udata;
+    XFile *xf = sd->xf;
     Project *pr;
     frame *f;
     set *p;
@@ -827,7 +846,7 @@ static int project_save_hook(Quark *q,
 
             xfile_begin_element(xf, EStrSSD, attrs);
             {
-                save_ssd(xf, q);
+                save_ssd(sd, q);
             }
             
             closure->post = TRUE;
@@ -1037,16 +1056,12 @@ static int project_save_hook(Quark *q,
 }
 
 
-int gproject_save(GProject *gp, GrFILE *grf)
+static int project_save_xml(GProject *gp, GrFILE *grf, ProjectSaveData *sd)
 {
     Quark *project;
     XFile *xf;
     Attributes *attrs;
 
-    if (!gp || !grf) {
-        return RETURN_FAILURE;
-    }
-    
     project = gp->q;
     
     xf = xfile_new(grf->fp);
@@ -1067,7 +1082,8 @@ int gproject_save(GProject *gp, GrFILE *grf)
     attributes_set_ival(attrs, AStrVersion, XGR_VERSION_ID);
     xfile_begin(xf, EStrGrace, attrs);
 
-    quark_traverse(project, project_save_hook, xf);
+    sd->xf = xf;
+    quark_traverse(project, project_save_hook, sd);
         
     attributes_free(attrs);
     
@@ -1080,3 +1096,130 @@ int gproject_save(GProject *gp, GrFILE *grf)
     
     return RETURN_SUCCESS;
 }
+
+int gproject_save(GProject *gp, GrFILE *grf)
+{
+    ProjectSaveData sd;
+
+    if (!gp || !grf) {
+        return RETURN_FAILURE;
+    }
+    
+    memset(&sd, 0, sizeof(sd));
+    
+    return project_save_xml(gp, grf, &sd);
+}
+
+static void xgb_put_uint(unsigned char *buf, unsigned long value, int nbytes)
+{
+    int i;
+    for (i = 0; i < nbytes; i++) {
+        buf[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+static int xgb_write_block(FILE *fp, const ss_column *col, unsigned int nrows)
+{
+    if (col->mapped) {
+        /* not loaded yet, thus already in the file format */
+        return fwrite(col->mapped, SIZEOF_DOUBLE, nrows, fp) == nrows ?
+            RETURN_SUCCESS:RETURN_FAILURE;
+    } else {
+#ifdef WORDS_BIGENDIAN
+        const unsigned char *src = col->data;
+        unsigned char buf[SIZEOF_DOUBLE*256];
+        unsigned int i, k, n = 0;
+        
+        for (i = 0; i < nrows; i++) {
+            for (k = 0; k < SIZEOF_DOUBLE; k++) {
+                buf[n++] = src[SIZEOF_DOUBLE - 1 - k];
+            }
+            src += SIZEOF_DOUBLE;
+            if (n == sizeof(buf) || i == nrows - 1) {
+                if (fwrite(buf, 1, n, fp) != n) {
+                    return RETURN_FAILURE;
+                }
+                n = 0;
+            }
+        }
+        return RETURN_SUCCESS;
+#else
+        return fwrite(col->data, SIZEOF_DOUBLE, nrows, fp) == nrows ?
+            RETURN_SUCCESS:RETURN_FAILURE;
+#endif
+    }
+}
+
+/* size (or, with sd->bin set, write) the data blocks, in the same order as
+   save_ssd() refers to them */
+static int project_blocks_hook(Quark *q,
+    void *udata, QTraverseClosure *closure)
+{
+    ProjectSaveData *sd = (ProjectSaveData *) udata;
+    ss_data *ssd = ssd_get_data(q);
+    unsigned int i;
+    
+    if (!ssd || !ssd->nrows) {
+        return TRUE;
+    }
+    
+    for (i = 0; i < ssd->ncols; i++) {
+        ss_column *col = &ssd->cols[i];
+        if (col->format == FFORMAT_STRING) {
+            continue;
+        }
+        if (sd->bin && xgb_write_block(sd->bin, col, ssd->nrows) !=
+            RETURN_SUCCESS) {
+            errmsg("Error writing project data");
+            return FALSE;
+        }
+        sd->offset += (unsigned long) ssd->nrows*SIZEOF_DOUBLE;
+    }
+    
+    return TRUE;
+}
+
+/*
+ * save the project into a binary container (see graceP.h), which lets
+ * gproject_load() map numerical columns rather than parse them
+ */
+int gproject_save_bin(GProject *gp, GrFILE *grf)
+{
+    ProjectSaveData sd;
+    unsigned char header[XGB_HEADER_SIZE];
+    unsigned long xml_offset;
+
+    if (!gp || !grf) {
+        return RETURN_FAILURE;
+    }
+    
+    memset(&sd, 0, sizeof(sd));
+    
+    /* first, find where the XML part starts */
+    sd.offset = XGB_HEADER_SIZE;
+    quark_traverse(gp->q, project_blocks_hook, &sd);
+    xml_offset = sd.offset;
+    
+    memset(header, 0, XGB_HEADER_SIZE);
+    memcpy(header, XGB_MAGIC, 8);
+    xgb_put_uint(header + 8, XGB_VERSION, 4);
+    xgb_put_uint(header + 16, xml_offset, 8);
+    if (fwrite(header, 1, XGB_HEADER_SIZE, grf->fp) != XGB_HEADER_SIZE) {
+        errmsg("Error writing project data");
+        return RETURN_FAILURE;
+    }
+    
+    sd.bin = grf->fp;
+    sd.offset = XGB_HEADER_SIZE;
+    quark_traverse(gp->q, project_blocks_hook, &sd);
+    if (sd.offset != xml_offset) {
+        return RETURN_FAILURE;
+    }
+    
+    sd.bin = NULL;
+    sd.binary = TRUE;
+    sd.offset = XGB_HEADER_SIZE;
+    
+    return project_save_xml(gp, grf, &sd);
+}
@@ -498,6 +498,7 @@ static void calculate_tickgrid(Quark *q, plot_rt_t *plot_rt)
     tickmarks *t;
     int res;
     AMem *amem;
+    char fbuf[MAX_STRING_LENGTH];
     
     t = axisgrid_get_data(q);
 
@@ -617,7 +618,7 @@ reenter:
                         t->tloc[itick].label, 
                         create_fstring(get_parent_project(q),
                             &t->tl_format,
-                            wtmaj, LFORMAT_TYPE_EXTENDED));
+                            wtmaj, LFORMAT_TYPE_EXTENDED, fbuf));
                     itmaj++;
                 }
             }
@@ -630,7 +631,8 @@ reenter:
                         t->tloc[itick].label, 
                         create_fstring(get_parent_project(q),
                             &t->tl_format,
-                            t->tloc[itick].wtpos, LFORMAT_TYPE_EXTENDED));
+                            t->tloc[itick].wtpos, LFORMAT_TYPE_EXTENDED,
+                            fbuf));
                 }
             }
         }
@@ -134,29 +134,38 @@ static void dproc(Canvas *canvas, void *data)
     quark_traverse(pdata->project, plotone_hook, &plot_rt);
 }
 
+static int prepare_canvas(Canvas *canvas, const Quark *project)
+{
+    Project *pr = project_get_data(project);
+    int i;
+
+    if (!pr) {
+        return RETURN_FAILURE;
+    }
+    
+    /* Reset colormap */
+    canvas_cmap_reset(canvas);
+    for (i = 0; i < pr->ncolors; i++) {
+        Colordef *c = &pr->colormap[i];
+        canvas_store_color(canvas, c->id, &c->rgb);
+    }
+
+    canvas_set_pagefill(canvas, pr->bgfill);
+    setbgcolor(canvas, pr->bgcolor);
+    canvas_set_fontsize_scale(canvas,  pr->fscale);
+    canvas_set_linewidth_scale(canvas, pr->lscale);
+    
+    return RETURN_SUCCESS;
+}
+
 /*
  * draw all active graphs
  */
 int drawgraph(Canvas *canvas, Graal *g, const Quark *project)
 {
-    Project *pr = project_get_data(project);
-
-    if (pr) {
+    if (prepare_canvas(canvas, project) == RETURN_SUCCESS) {
         plot_data pdata;
-        int i;
         
-        /* Reset colormap */
-        canvas_cmap_reset(canvas);
-        for (i = 0; i < pr->ncolors; i++) {
-            Colordef *c = &pr->colormap[i];
-            canvas_store_color(canvas, c->id, &c->rgb);
-        }
-
-        canvas_set_pagefill(canvas, pr->bgfill);
-        setbgcolor(canvas, pr->bgcolor);
-        canvas_set_fontsize_scale(canvas,  pr->fscale);
-        canvas_set_linewidth_scale(canvas, pr->lscale);
-
         pdata.project = (Quark *) project;
         pdata.graal   = g;
         
@@ -166,6 +175,276 @@ int drawgraph(Canvas *canvas, Graal *g, const Quark *project)
     }
 }
 
+/*
+ * Page cache for incremental redraws. For each top-level child of the
+ * project (normally, a frame) it remembers the state stamp the child was
+ * drawn at and the bounding box it covered. A child whose stamp has
+ * changed is dirty; the union of its old and new bounding boxes is the
+ * damage to be redrawn, together with whatever else overlaps it.
+ */
+typedef struct {
+    const Quark *q;
+    unsigned int stamp;
+    view bbox;
+} PageItem;
+
+struct _PageCache {
+    int valid;
+    const Quark *project;
+    unsigned int ownstamp;
+    
+    unsigned int nitems;
+    PageItem *items;
+};
+
+/* margin added around the damage, to cover line caps, antialiasing etc. */
+#define PAGE_DAMAGE_MARGIN  0.01
+
+PageCache *pagecache_new(void)
+{
+    PageCache *pc = xmalloc(sizeof(PageCache));
+    if (pc) {
+        memset(pc, 0, sizeof(PageCache));
+    }
+    
+    return pc;
+}
+
+void pagecache_free(PageCache *pc)
+{
+    if (pc) {
+        xfree(pc->items);
+        xfree(pc);
+    }
+}
+
+/* forces the next update to redraw the whole page */
+void pagecache_invalidate(PageCache *pc)
+{
+    if (pc) {
+        pc->valid = FALSE;
+    }
+}
+
+typedef enum {
+    PAGE_DRAW_ALL,      /* draw everything, recording the items */
+    PAGE_DRAW_DIRTY,    /* only measure the dirty items (dry run) */
+    PAGE_DRAW_DAMAGED   /* draw the items overlapping the damage */
+} PageDrawMode;
+
+typedef struct {
+    plot_rt_t plot_rt;
+    PageCache *pc;
+    Quark *project;
+    PageDrawMode mode;
+    view damage;
+    unsigned int curitem;
+    int post;               /* whether plotone_hook wants its post call */
+} page_rt_t;
+
+static int page_hook(Quark *q, void *udata, QTraverseClosure *closure)
+{
+    page_rt_t *page_rt = (page_rt_t *) udata;
+    Canvas *canvas = page_rt->plot_rt.canvas;
+    PageCache *pc = page_rt->pc;
+    PageItem *item;
+    
+    if (closure->depth != 1) {
+        return plotone_hook(q, &page_rt->plot_rt, closure);
+    }
+    
+    if (!closure->post) {
+        int draw;
+        
+        page_rt->curitem = closure->step;
+        item = &pc->items[closure->step];
+        
+        switch (page_rt->mode) {
+        case PAGE_DRAW_DIRTY:
+            draw = (item->stamp != quark_get_statestamp(q));
+            if (draw) {
+                merge_bboxes(&page_rt->damage, &item->bbox, &page_rt->damage);
+            }
+            break;
+        case PAGE_DRAW_DAMAGED:
+            draw = views_overlap(&item->bbox, &page_rt->damage);
+            break;
+        default:
+            item->q = q;
+            draw = TRUE;
+            break;
+        }
+        
+        if (!draw) {
+            closure->descend = FALSE;
+            return TRUE;
+        }
+        
+        freeze_bbox(canvas, BBOX_TYPE_GLOB);
+        reset_bbox(canvas, BBOX_TYPE_GLOB);
+        
+        if (plotone_hook(q, &page_rt->plot_rt, closure) != TRUE) {
+            return FALSE;
+        }
+        page_rt->post = closure->post;
+        closure->post = TRUE;
+    } else {
+        item = &pc->items[page_rt->curitem];
+        
+        if (page_rt->post) {
+            plotone_hook(q, &page_rt->plot_rt, closure);
+        }
+        
+        if (page_rt->mode != PAGE_DRAW_DAMAGED) {
+            get_bbox(canvas, BBOX_TYPE_GLOB, &item->bbox);
+            item->stamp = quark_get_statestamp(q);
+        }
+        if (page_rt->mode == PAGE_DRAW_DIRTY) {
+            merge_bboxes(&page_rt->damage, &item->bbox, &page_rt->damage);
+        }
+        
+        melt_bbox(canvas, BBOX_TYPE_GLOB);
+    }
+    
+    return TRUE;
+}
+
+static void page_dproc(Canvas *canvas, void *data)
+{
+    page_rt_t *page_rt = (page_rt_t *) data;
+    
+    page_rt->plot_rt.canvas = canvas;
+
+    quark_traverse(page_rt->project, page_hook, page_rt);
+}
+
+typedef struct {
+    const PageCache *pc;
+    int match;
+} page_match_t;
+
+static int page_match_hook(unsigned int step, void *data, void *udata)
+{
+    page_match_t *pm = (page_match_t *) udata;
+    
+    if (pm->pc->items[step].q != data) {
+        pm->match = FALSE;
+        return FALSE;
+    } else {
+        return TRUE;
+    }
+}
+
+static int pagecache_matches(const PageCache *pc, const Quark *project)
+{
+    page_match_t pm;
+    
+    if (!pc->valid || pc->project != project ||
+        pc->ownstamp != quark_get_ownstamp(project) ||
+        pc->nitems != quark_count_children(project)) {
+        return FALSE;
+    }
+    
+    pm.pc    = pc;
+    pm.match = TRUE;
+    storage_traverse(quark_get_children(project), page_match_hook, &pm);
+    
+    return pm.match;
+}
+
+/*
+ * Find the part of the page that must be redrawn to bring it up to date
+ * with the project since the last drawgraph_update() with the same cache.
+ * Returns FALSE if nothing has changed; otherwise, damage is set to the
+ * region to redraw, or to an invalid view if the whole page is affected.
+ * The cache already records the new state, so drawgraph_update() must
+ * follow.
+ */
+int drawgraph_damage(Canvas *canvas, Graal *g, const Quark *project,
+    PageCache *pc, view *damage)
+{
+    page_rt_t page_rt;
+    view bbox;
+    
+    view_invalidate(damage);
+    
+    if (!pagecache_matches(pc, project)) {
+        pc->valid = FALSE;
+        return TRUE;
+    }
+    
+    if (prepare_canvas(canvas, project) != RETURN_SUCCESS) {
+        return TRUE;
+    }
+    
+    memset(&page_rt, 0, sizeof(page_rt_t));
+    page_rt.plot_rt.graal = g;
+    page_rt.pc      = pc;
+    page_rt.project = (Quark *) project;
+    page_rt.mode    = PAGE_DRAW_DIRTY;
+    view_invalidate(&page_rt.damage);
+    
+    canvas_measure(canvas, page_dproc, &page_rt, &bbox);
+    
+    if (!is_valid_bbox(&page_rt.damage)) {
+        return FALSE;
+    }
+    
+    *damage = page_rt.damage;
+    view_extend(damage, PAGE_DAMAGE_MARGIN);
+    
+    return TRUE;
+}
+
+/*
+ * Redraw the damaged part of the page (as found by drawgraph_damage()), or
+ * all of it if damage is NULL or invalid, updating the cache
+ */
+int drawgraph_update(Canvas *canvas, Graal *g, const Quark *project,
+    PageCache *pc, const view *damage)
+{
+    page_rt_t page_rt;
+    unsigned int nitems;
+    int res;
+    
+    if (prepare_canvas(canvas, project) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    memset(&page_rt, 0, sizeof(page_rt_t));
+    page_rt.plot_rt.graal = g;
+    page_rt.pc      = pc;
+    page_rt.project = (Quark *) project;
+    
+    if (pc->valid && damage && is_valid_bbox(damage)) {
+        page_rt.mode   = PAGE_DRAW_DAMAGED;
+        page_rt.damage = *damage;
+        canvas_set_update_region(canvas, damage);
+    } else {
+        nitems = quark_count_children(project);
+        if (nitems > pc->nitems) {
+            PageItem *p = xrealloc(pc->items, nitems*sizeof(PageItem));
+            if (!p) {
+                return RETURN_FAILURE;
+            }
+            pc->items = p;
+        }
+        memset(pc->items, 0, nitems*sizeof(PageItem));
+        pc->nitems   = nitems;
+        pc->project  = project;
+        pc->ownstamp = quark_get_ownstamp(project);
+        page_rt.mode = PAGE_DRAW_ALL;
+    }
+    
+    res = canvas_draw(canvas, page_dproc, &page_rt);
+    
+    canvas_set_update_region(canvas, NULL);
+    
+    pc->valid = (res == RETURN_SUCCESS);
+    
+    return res;
+}
+
 
 int draw_graph(Quark *gr, plot_rt_t *plot_rt)
 {
@@ -541,6 +820,49 @@ void fillframe(Canvas *canvas, Quark *q)
     }
 }    
 
+/*
+ * transform n data points of a set (stacked on top of the reference ones
+ * for stacked charts) to viewport, shifting them by the plot offset. The
+ * returned array should be xfree'd by the caller.
+ */
+static VPoint *set_data2vpoints(const ctrans_data *cd,
+    const plot_rt_t *plot_rt, const double *x, const double *y, int n,
+    int stacked)
+{
+    VPoint *vps;
+    double *ystacked = NULL;
+    int i;
+    
+    vps = xmalloc(n*sizeof(VPoint));
+    if (!vps) {
+        return NULL;
+    }
+    
+    if (stacked == TRUE) {
+        ystacked = xmalloc(n*sizeof(double));
+        if (!ystacked) {
+            xfree(vps);
+            return NULL;
+        }
+        for (i = 0; i < n; i++) {
+            ystacked[i] = y[i] + plot_rt->refy[i];
+        }
+        y = ystacked;
+    }
+    
+    ctrans_wcols2vpoints(cd, x, y, n, vps);
+    
+    xfree(ystacked);
+    
+    if (plot_rt->offset != 0.0) {
+        for (i = 0; i < n; i++) {
+            vps[i].x += plot_rt->offset;
+        }
+    }
+    
+    return vps;
+}
+
 /*
  * draw a set filling polygon
  */
@@ -555,9 +877,10 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
     double ybase;
     world w;
     WPoint wptmp;
-    VPoint *vps;
+    VPoint *vps, *vpsdata;
     double xmin, xmax, ymin, ymax;
     int stacked_chart;
+    ctrans_data cd;
     
     if (p->line.filltype == SETFILL_NONE) {
         return;
@@ -578,10 +901,20 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
         stacked_chart = FALSE;
     }
     
+    if (!x || !y || ctrans_get_data(gr, &cd) != RETURN_SUCCESS) {
+        return;
+    }
+    
     setclipping(canvas, TRUE);
     
-    graph_get_world(gr, &w);
+    w = cd.w;
 
+    vpsdata = set_data2vpoints(&cd, plot_rt, x, y, setlen, stacked_chart);
+    if (setlen && vpsdata == NULL) {
+        errmsg("Can't xmalloc in drawsetfill");
+        return;
+    }
+    
     switch (line_type) {
     case LINE_TYPE_STRAIGHT:
     case LINE_TYPE_SEGMENT2:
@@ -594,23 +927,18 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
         vps = (VPoint *) xmalloc((len + 2) * sizeof(VPoint));
         if (vps == NULL) {
             errmsg("Can't xmalloc in drawsetfill");
+            xfree(vpsdata);
             return;
         }
  
-        for (i = 0; i < setlen; i++) {
-            wptmp.x = x[i];
-            wptmp.y = y[i];
-            if (stacked_chart == TRUE) {
-                wptmp.y += plot_rt->refy[i];
-            }
-            Wpoint2Vpoint(gr, &wptmp, &vps[i]);
-            vps[i].x += plot_rt->offset;
+        if (setlen) {
+            memcpy(vps, vpsdata, setlen*sizeof(VPoint));
         }
         if (stacked_chart == TRUE && p->line.filltype == SETFILL_BASELINE) {
             for (i = 0; i < setlen; i++) {
                 wptmp.x = x[setlen - i - 1];
                 wptmp.y = plot_rt->refy[setlen - i - 1];
-                Wpoint2Vpoint(gr, &wptmp, &vps[setlen + i]);
+                ctrans_wpoint2vpoint(&cd, &wptmp, &vps[setlen + i]);
                 vps[setlen + i].x += plot_rt->offset;
             }
         }
@@ -621,17 +949,12 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
         vps = (VPoint *) xmalloc((len + 2) * sizeof(VPoint));
         if (vps == NULL) {
             errmsg("Can't xmalloc in drawsetfill");
+            xfree(vpsdata);
             return;
         }
  
         for (i = 0; i < setlen; i++) {
-            wptmp.x = x[i];
-            wptmp.y = y[i];
-            if (stacked_chart == TRUE) {
-                wptmp.y += plot_rt->refy[i];
-            }
-            Wpoint2Vpoint(gr, &wptmp, &vps[2*i]);
-            vps[2*i].x += plot_rt->offset;
+            vps[2*i] = vpsdata[i];
         }
         for (i = 1; i < len; i += 2) {
             if (line_type == LINE_TYPE_LEFTSTAIR) {
@@ -644,9 +967,12 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
         }
         break;
     default:
+        xfree(vpsdata);
         return;
     }
     
+    xfree(vpsdata);
+    
     switch (p->line.filltype) {
     case SETFILL_POLYGON:
         polylen = len;
@@ -660,11 +986,11 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
             polylen = len + 2;
             wptmp.x = MIN2(xmax, w.xg2);
             wptmp.y = ybase;
-            Wpoint2Vpoint(gr, &wptmp, &vps[len]);
+            ctrans_wpoint2vpoint(&cd, &wptmp, &vps[len]);
             vps[len].x += plot_rt->offset;
             wptmp.x = MAX2(xmin, w.xg1);
             wptmp.y = ybase;
-            Wpoint2Vpoint(gr, &wptmp, &vps[len + 1]);
+            ctrans_wpoint2vpoint(&cd, &wptmp, &vps[len + 1]);
             vps[len + 1].x += plot_rt->offset;
         }
         break;
@@ -683,6 +1009,113 @@ void drawsetfill(Quark *pset, plot_rt_t *plot_rt)
 /*
  * draw set's connecting line
  */
+/* sets with fewer points per device pixel column are drawn as they are */
+#define LOD_MIN_DENSITY 4
+
+/*
+ * draw a straight-line set through the first, lowest, highest and last points
+ * of each device pixel column only; this is pixel-wise identical to drawing
+ * all of them, but much cheaper for huge X-sorted sets. Vector devices have
+ * no pixel grid to snap to, so they always get the full-resolution path
+ */
+static int drawsetline_lod(Quark *pset, plot_rt_t *plot_rt,
+    const ctrans_data *cd, int setlen)
+{
+    Canvas *canvas = plot_rt->canvas;
+    Quark *gr = get_parent_graph(pset);
+    Quark *ss = get_parent_ssd(pset);
+    set *p = set_get_data(pset);
+    double page_scale, vx1, vx2, *xedges, *x, *y, *xd, *yd;
+    int k1, k2, nedges, i;
+    unsigned int *ind, nind;
+    VPoint vp, *vps;
+    WPoint wp;
+    
+    if (raster_device(canvas) != TRUE) {
+        return RETURN_FAILURE;
+    }
+    
+    if (!ss || cd->coordinates != COORDINATES_XY ||
+        graph_get_type(gr) == GRAPH_CHART || plot_rt->offset != 0.0 ||
+        (cd->xscale != SCALE_NORMAL && cd->xscale != SCALE_LOG) ||
+        (cd->yscale != SCALE_NORMAL && cd->yscale != SCALE_LOG)) {
+        return RETURN_FAILURE;
+    }
+    
+    /* device pixels per viewport unit */
+    page_scale = get_page_scale(canvas);
+    
+    wp.x = cd->w.xg1;
+    wp.y = cd->w.yg1;
+    ctrans_wpoint2vpoint(cd, &wp, &vp);
+    vx1 = vp.x;
+    wp.x = cd->w.xg2;
+    ctrans_wpoint2vpoint(cd, &wp, &vp);
+    vx2 = vp.x;
+    if (vx1 > vx2) {
+        fswap(&vx1, &vx2);
+    }
+    
+    /* pixel k covers [k - 1/2, k + 1/2) in device units */
+    k1 = (int) floor(vx1*page_scale - 0.5);
+    k2 = (int) ceil(vx2*page_scale - 0.5);
+    nedges = k2 - k1 + 1;
+    if (nedges < 2 || setlen < LOD_MIN_DENSITY*(nedges - 1)) {
+        return RETURN_FAILURE;
+    }
+    
+    xedges = xmalloc(nedges*SIZEOF_DOUBLE);
+    if (!xedges) {
+        return RETURN_FAILURE;
+    }
+    vp.y = 0.0;
+    for (i = 0; i < nedges; i++) {
+        vp.x = (k1 + i + 0.5)/page_scale;
+        Vpoint2Wpoint(gr, &vp, &wp);
+        xedges[i] = wp.x;
+    }
+    if (xedges[0] > xedges[nedges - 1]) {
+        for (i = 0; i < nedges/2; i++) {
+            fswap(&xedges[i], &xedges[nedges - 1 - i]);
+        }
+    }
+    
+    if (ssd_get_lod_indices(ss, p->ds.cols[DATA_X], p->ds.cols[DATA_Y],
+        xedges, nedges, &ind, &nind) != RETURN_SUCCESS) {
+        xfree(xedges);
+        return RETURN_FAILURE;
+    }
+    xfree(xedges);
+    
+    x = set_get_col(pset, DATA_X);
+    y = set_get_col(pset, DATA_Y);
+    xd  = xmalloc(nind*SIZEOF_DOUBLE);
+    yd  = xmalloc(nind*SIZEOF_DOUBLE);
+    vps = xmalloc(nind*sizeof(VPoint));
+    if (nind && (!xd || !yd || !vps)) {
+        xfree(xd);
+        xfree(yd);
+        xfree(vps);
+        xfree(ind);
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0; i < nind; i++) {
+        xd[i] = x[ind[i]];
+        yd[i] = y[ind[i]];
+    }
+    ctrans_wcols2vpoints(cd, xd, yd, nind, vps);
+    
+    DrawPolyline(canvas, vps, nind, POLYLINE_OPEN);
+    
+    xfree(xd);
+    xfree(yd);
+    xfree(vps);
+    xfree(ind);
+    
+    return RETURN_SUCCESS;
+}
+
 void drawsetline(Quark *pset, plot_rt_t *plot_rt)
 {
     Canvas *canvas = plot_rt->canvas;
@@ -691,7 +1124,7 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
     int setlen, len;
     int i;
     int line_type = p->line.type;
-    VPoint vps[4], *vpstmp, vprev = {0.0, 0.0};
+    VPoint vps[4], *vpstmp, *vpsdata, vprev = {0.0, 0.0};
     WPoint wp;
     double *x, *y;
     double lw;
@@ -699,6 +1132,7 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
     double xmin, xmax, ymin, ymax;
     int skip = p->symskip + 1;
     int stacked_chart;
+    ctrans_data cd;
     
     if (graph_get_type(gr) == GRAPH_CHART) {
         x = plot_rt->refx;
@@ -709,7 +1143,7 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
     }
     y = set_get_col(pset, DATA_Y);
     
-    if (!x || !y) {
+    if (!x || !y || ctrans_get_data(gr, &cd) != RETURN_SUCCESS) {
         return;
     }
     
@@ -731,6 +1165,21 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
 
     setline(canvas, &p->line.line);
 
+    if (line_type == LINE_TYPE_STRAIGHT && stacked_chart == FALSE &&
+        p->line.droplines == FALSE &&
+        p->line.line.style == 1 && p->line.line.pen.pattern != 0 &&
+        drawsetline_lod(pset, plot_rt, &cd, setlen) == RETURN_SUCCESS) {
+        /* already drawn from the decimated data */
+        line_type = LINE_TYPE_NONE;
+        vpsdata = NULL;
+    } else {
+        vpsdata = set_data2vpoints(&cd, plot_rt, x, y, setlen, stacked_chart);
+        if (setlen && vpsdata == NULL) {
+            errmsg("xmalloc failed in drawsetline()");
+            return;
+        }
+    }
+
     if (stacked_chart == TRUE) {
         lw = getlinewidth(canvas);
     } else {
@@ -750,14 +1199,7 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
                 break;
             }
             for (i = 0; i < setlen; i++) {
-                wp.x = x[i];
-                wp.y = y[i];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i];
-                }
-                Wpoint2Vpoint(gr, &wp, &vpstmp[i]);
-                vpstmp[i].x += plot_rt->offset;
-                
+                vpstmp[i] = vpsdata[i];
                 vpstmp[i].y -= lw/2.0;
             }
             DrawPolyline(canvas, vpstmp, setlen, POLYLINE_OPEN);
@@ -765,20 +1207,8 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
             break;
         case LINE_TYPE_SEGMENT2:
             for (i = 0; i < setlen - 1; i += 2) {
-                wp.x = x[i];
-                wp.y = y[i];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[0]);
-                vps[0].x += plot_rt->offset;
-                wp.x = x[i + 1];
-                wp.y = y[i + 1];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i + 1];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[1]);
-                vps[1].x += plot_rt->offset;
+                vps[0] = vpsdata[i];
+                vps[1] = vpsdata[i + 1];
                 
                 vps[0].y -= lw/2.0;
                 vps[1].y -= lw/2.0;
@@ -788,27 +1218,9 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
             break;
         case LINE_TYPE_SEGMENT3:
             for (i = 0; i < setlen - 2; i += 3) {
-                wp.x = x[i];
-                wp.y = y[i];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[0]);
-                vps[0].x += plot_rt->offset;
-                wp.x = x[i + 1];
-                wp.y = y[i + 1];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i + 1];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[1]);
-                vps[1].x += plot_rt->offset;
-                wp.x = x[i + 2];
-                wp.y = y[i + 2];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i + 2];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[2]);
-                vps[2].x += plot_rt->offset;
+                vps[0] = vpsdata[i];
+                vps[1] = vpsdata[i + 1];
+                vps[2] = vpsdata[i + 2];
                 DrawPolyline(canvas, vps, 3, POLYLINE_OPEN);
                 
                 vps[0].y -= lw/2.0;
@@ -816,20 +1228,8 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
                 vps[2].y -= lw/2.0;
             }
             if (i == setlen - 2) {
-                wp.x = x[i];
-                wp.y = y[i];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[0]);
-                vps[0].x += plot_rt->offset;
-                wp.x = x[i + 1];
-                wp.y = y[i + 1];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i + 1];
-                }
-                Wpoint2Vpoint(gr, &wp, &vps[1]);
-                vps[1].x += plot_rt->offset;
+                vps[0] = vpsdata[i];
+                vps[1] = vpsdata[i + 1];
                 
                 vps[0].y -= lw/2.0;
                 vps[1].y -= lw/2.0;
@@ -846,13 +1246,7 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
                 break;
             }
             for (i = 0; i < setlen; i++) {
-                wp.x = x[i];
-                wp.y = y[i];
-                if (stacked_chart == TRUE) {
-                    wp.y += plot_rt->refy[i];
-                }
-                Wpoint2Vpoint(gr, &wp, &vpstmp[2*i]);
-                vpstmp[2*i].x += plot_rt->offset;
+                vpstmp[2*i] = vpsdata[i];
             }
             for (i = 1; i < len; i += 2) {
                 if (line_type == LINE_TYPE_LEFTSTAIR) {
@@ -880,15 +1274,9 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
             } else {
                 wp.y = ybase;
             }
-            Wpoint2Vpoint(gr, &wp, &vps[0]);
+            ctrans_wpoint2vpoint(&cd, &wp, &vps[0]);
             vps[0].x += plot_rt->offset;
-            wp.x = x[i];
-            wp.y = y[i];
-            if (stacked_chart == TRUE) {
-                wp.y += plot_rt->refy[i];
-            }
-            Wpoint2Vpoint(gr, &wp, &vps[1]);
-            vps[1].x += plot_rt->offset;
+            vps[1] = vpsdata[i];
             
             vps[1].y -= lw/2.0;
  
@@ -901,21 +1289,30 @@ void drawsetline(Quark *pset, plot_rt_t *plot_rt)
         }
     }
     
+    xfree(vpsdata);
+    
     set_get_minmax(pset, &xmin, &xmax, &ymin, &ymax);
        
     if (p->line.baseline == TRUE && stacked_chart != TRUE) {
         wp.x = xmin;
         wp.y = ybase;
-        Wpoint2Vpoint(gr, &wp, &vps[0]);
+        ctrans_wpoint2vpoint(&cd, &wp, &vps[0]);
         vps[0].x += plot_rt->offset;
         wp.x = xmax;
-        Wpoint2Vpoint(gr, &wp, &vps[1]);
+        ctrans_wpoint2vpoint(&cd, &wp, &vps[1]);
         vps[1].x += plot_rt->offset;
  
         DrawLine(canvas, &vps[0], &vps[1]);
     }
 }    
 
+static void symbol_dproc(Canvas *canvas, void *data)
+{
+    VPoint vp = {0.0, 0.0};
+    
+    drawxysym(canvas, &vp, (const Symbol *) data);
+}
+
 /* draw the symbols */
 void drawsetsyms(Quark *pset, plot_rt_t *plot_rt)
 {
@@ -924,12 +1321,13 @@ void drawsetsyms(Quark *pset, plot_rt_t *plot_rt)
     set *p = set_get_data(pset);
     int setlen;
     int i;
-    VPoint vp, vprev = {0.0, 0.0};
+    VPoint vp, *vpsdata, vprev = {0.0, 0.0};
     WPoint wp;
     double *x, *y, *z, *c;
     int skip = p->symskip + 1;
-    int stacked_chart;
+    int stacked_chart, symid;
     double znorm = graph_get_znorm(gr);
+    ctrans_data cd;
     
     if (graph_get_type(gr) == GRAPH_CHART) {
         x = plot_rt->refx;
@@ -940,7 +1338,7 @@ void drawsetsyms(Quark *pset, plot_rt_t *plot_rt)
     }
     y = set_get_col(pset, DATA_Y);
 
-    if (!x || !y) {
+    if (!x || !y || ctrans_get_data(gr, &cd) != RETURN_SUCCESS) {
         return;
     }
         
@@ -972,8 +1370,22 @@ void drawsetsyms(Quark *pset, plot_rt_t *plot_rt)
               
         Symbol sym = p->sym;
         
+        vpsdata = set_data2vpoints(&cd, plot_rt, x, y, setlen, stacked_chart);
+        if (setlen && vpsdata == NULL) {
+            errmsg("xmalloc failed in drawsetsyms()");
+            return;
+        }
+        
         setline(canvas, &sym.line);
         setfont(canvas, sym.charfont);
+        
+        /* identical symbols are defined once and stamped, if possible */
+        if (!z && !c) {
+            symid = canvas_symbol_define(canvas, symbol_dproc, &sym);
+        } else {
+            symid = -1;
+        }
+        
         for (i = 0; i < setlen; i += skip) {
             wp.x = x[i];
             wp.y = y[i];
@@ -981,12 +1393,11 @@ void drawsetsyms(Quark *pset, plot_rt_t *plot_rt)
                 wp.y += plot_rt->refy[i];
             }
             
-            if (!is_validWPoint(gr, &wp)){
+            if (!ctrans_is_valid_wpoint(&cd, &wp)){
                 continue;
             }
         
-            Wpoint2Vpoint(gr, &wp, &vp);
-            vp.x += plot_rt->offset;
+            vp = vpsdata[i];
 
             if (i && hypot(vp.x - vprev.x, vp.y - vprev.y) < p->symskipmindist)
                  continue;
@@ -999,10 +1410,15 @@ void drawsetsyms(Quark *pset, plot_rt_t *plot_rt)
                 int color = (int) rint(c[i]);
                 sym.fillpen.color = color;
             }
+            if (symid >= 0) {
+                canvas_symbol_put(canvas, symid, &vp);
+            } else
             if (drawxysym(canvas, &vp, &sym) != RETURN_SUCCESS) {
-                return;
+                break;
             }
-        } 
+        }
+        
+        xfree(vpsdata);
     }
 }
 
@@ -1099,7 +1515,7 @@ void drawsetavalues(Quark *pset, plot_rt_t *plot_rt)
     AValue avalue;
     void *pdata;
     int aformat;
-    char **s, *str, *buf;
+    char **s, *str, *buf, fbuf[MAX_STRING_LENGTH];
     int stacked_chart;
 
     avalue = p->avalue;
@@ -1165,7 +1581,7 @@ void drawsetavalues(Quark *pset, plot_rt_t *plot_rt)
         default:
             z = (double *) pdata;
             buf = create_fstring(pr, &avalue.format, z[i], 
-                                                 LFORMAT_TYPE_EXTENDED);
+                                                 LFORMAT_TYPE_EXTENDED, fbuf);
             break;
         }
         
@@ -1188,9 +1604,10 @@ void drawseterrbars(Quark *pset, plot_rt_t *plot_rt)
     double *x, *y;
     double *dx_plus, *dx_minus, *dy_plus, *dy_minus;
     WPoint wp1, wp2;
-    VPoint vp1, vp2, vprev = {0.0, 0.0};
+    VPoint vp1, vp2, *vpsdata, vprev = {0.0, 0.0};
     int stacked_chart;
     int skip = p->symskip + 1;
+    ctrans_data cd;
     
     if (p->errbar.active != TRUE) {
         return;
@@ -1205,7 +1622,7 @@ void drawseterrbars(Quark *pset, plot_rt_t *plot_rt)
     }
     y = set_get_col(pset, DATA_Y);
     
-    if (!x || !y) {
+    if (!x || !y || ctrans_get_data(gr, &cd) != RETURN_SUCCESS) {
         return;
     }
     
@@ -1234,6 +1651,12 @@ void drawseterrbars(Quark *pset, plot_rt_t *plot_rt)
         return;
     }
     
+    vpsdata = set_data2vpoints(&cd, plot_rt, x, y, n, stacked_chart);
+    if (n && vpsdata == NULL) {
+        errmsg("xmalloc failed in drawseterrbars()");
+        return;
+    }
+    
     setclipping(canvas, TRUE);
     
     for (i = 0; i < n; i += skip) {
@@ -1242,12 +1665,11 @@ void drawseterrbars(Quark *pset, plot_rt_t *plot_rt)
         if (stacked_chart == TRUE) {
             wp1.y += plot_rt->refy[i];
         }
-        if (is_validWPoint(gr, &wp1) == FALSE) {
+        if (ctrans_is_valid_wpoint(&cd, &wp1) == FALSE) {
             continue;
         }
 
-        Wpoint2Vpoint(gr, &wp1, &vp1);
-        vp1.x += plot_rt->offset;
+        vp1 = vpsdata[i];
 
         if (i && hypot(vp1.x - vprev.x, vp1.y - vprev.y) < p->symskipmindist)
              continue;
@@ -1256,32 +1678,34 @@ void drawseterrbars(Quark *pset, plot_rt_t *plot_rt)
         if (dx_plus != NULL) {
             wp2 = wp1;
             wp2.x += fabs(dx_plus[i]);
-            Wpoint2Vpoint(gr, &wp2, &vp2);
+            ctrans_wpoint2vpoint(&cd, &wp2, &vp2);
             vp2.x += plot_rt->offset;
             drawerrorbar(canvas, &vp1, &vp2, &p->errbar);
         }
         if (dx_minus != NULL) {
             wp2 = wp1;
             wp2.x -= fabs(dx_minus[i]);
-            Wpoint2Vpoint(gr, &wp2, &vp2);
+            ctrans_wpoint2vpoint(&cd, &wp2, &vp2);
             vp2.x += plot_rt->offset;
             drawerrorbar(canvas, &vp1, &vp2, &p->errbar);
         }
         if (dy_plus != NULL) {
             wp2 = wp1;
             wp2.y += fabs(dy_plus[i]);
-            Wpoint2Vpoint(gr, &wp2, &vp2);
+            ctrans_wpoint2vpoint(&cd, &wp2, &vp2);
             vp2.x += plot_rt->offset;
             drawerrorbar(canvas, &vp1, &vp2, &p->errbar);
         }
         if (dy_minus != NULL) {
             wp2 = wp1;
             wp2.y -= fabs(dy_minus[i]);
-            Wpoint2Vpoint(gr, &wp2, &vp2);
+            ctrans_wpoint2vpoint(&cd, &wp2, &vp2);
             vp2.x += plot_rt->offset;
             drawerrorbar(canvas, &vp1, &vp2, &p->errbar);
         }
     }
+    
+    xfree(vpsdata);
 }
 
 /*
@@ -1578,12 +2002,13 @@ void drawsetboxplot(Quark *pset, plot_rt_t *plot_rt)
 {
     Canvas *canvas = plot_rt->canvas;
     set *p = set_get_data(pset);
-    int i;
+    int i, n;
     double *x, *md, *lb, *ub, *lw, *uw;
     double size = 0.01*p->sym.size;
     int skip = p->symskip + 1;
     WPoint wp;
-    VPoint vp1, vp2, vprev = {0.0, 0.0};
+    VPoint vp1, vp2, *vpsmd, vprev = {0.0, 0.0};
+    ctrans_data cd;
 
     x  = set_get_col(pset, DATA_X);
     md = set_get_col(pset, DATA_Y);
@@ -1592,34 +2017,42 @@ void drawsetboxplot(Quark *pset, plot_rt_t *plot_rt)
     lw = set_get_col(pset, DATA_Y3);
     uw = set_get_col(pset, DATA_Y4);
 
-    if (!x || !md || !lb || !ub || !lw || !uw) {
+    if (!x || !md || !lb || !ub || !lw || !uw ||
+        ctrans_get_data(pset, &cd) != RETURN_SUCCESS) {
         return;
     }
     
+    n = set_get_length(pset);
+    vpsmd = xmalloc(n*sizeof(VPoint));
+    if (n && vpsmd == NULL) {
+        errmsg("xmalloc failed in drawsetboxplot()");
+        return;
+    }
+    ctrans_wcols2vpoints(&cd, x, md, n, vpsmd);
+    
     setclipping(canvas, TRUE);
 
-    for (i = 0; i < set_get_length(pset); i += skip) {
+    for (i = 0; i < n; i += skip) {
         wp.x =  x[i];
 
-        wp.y = md[i]; /* use median-line y for symskipmindist */
-        Wpoint2Vpoint(pset, &wp, &vp1);
+        vp1 = vpsmd[i]; /* use median-line y for symskipmindist */
         if (i && hypot(vp1.x - vprev.x, vp1.y - vprev.y) < p->symskipmindist)
              continue;
         vprev = vp1;
 
         wp.y = lb[i];
-        Wpoint2Vpoint(pset, &wp, &vp1);
+        ctrans_wpoint2vpoint(&cd, &wp, &vp1);
         wp.y = ub[i];
-        Wpoint2Vpoint(pset, &wp, &vp2);
+        ctrans_wpoint2vpoint(&cd, &wp, &vp2);
         
         /* whiskers */
         if (p->errbar.active == TRUE) {
             VPoint vp3;
             wp.y = lw[i];
-            Wpoint2Vpoint(pset, &wp, &vp3);
+            ctrans_wpoint2vpoint(&cd, &wp, &vp3);
             drawerrorbar(canvas, &vp1, &vp3, &p->errbar);
             wp.y = uw[i];
-            Wpoint2Vpoint(pset, &wp, &vp3);
+            ctrans_wpoint2vpoint(&cd, &wp, &vp3);
             drawerrorbar(canvas, &vp2, &vp3, &p->errbar);
         }
 
@@ -1633,13 +2066,14 @@ void drawsetboxplot(Quark *pset, plot_rt_t *plot_rt)
         DrawRect(canvas, &vp1, &vp2);
 
         /* median line */
-        wp.y = md[i];
-        Wpoint2Vpoint(pset, &wp, &vp1);
+        vp1 = vpsmd[i];
         vp2 = vp1;
         vp1.x -= size;
         vp2.x += size;
         DrawLine(canvas, &vp1, &vp2);
     }
+    
+    xfree(vpsmd);
 }
 
 void draw_pie_chart_set(Quark *pset, plot_rt_t *plot_rt)
@@ -1656,7 +2090,7 @@ void draw_pie_chart_set(Quark *pset, plot_rt_t *plot_rt)
     AValue avalue;
     void *pdata;
     int aformat;
-    char *str, *buf;
+    char *str, *buf, fbuf[MAX_STRING_LENGTH];
     set *p;
     Quark *gr, *pr;
     Canvas *canvas = plot_rt->canvas;
@@ -1771,7 +2205,7 @@ void draw_pie_chart_set(Quark *pset, plot_rt_t *plot_rt)
             default:
                 z = (double *) pdata;
                 buf = create_fstring(pr, &avalue.format, z[i], 
-                                                     LFORMAT_TYPE_EXTENDED);
+                                                     LFORMAT_TYPE_EXTENDED, fbuf);
                 break;
             }
 
@@ -124,6 +124,10 @@ size_t strfgeo(char *str, size_t max, const char *format, double value, int prec
                 np = 0;
                 break;
             }
+            if (np > 0) {
+                localize_decimal_point(s, max - out_size);
+                np = strlen(s);
+            }
             out_size += np;
             s += np;
         } else {
@@ -182,11 +186,15 @@ static int dayofweek(double j)
     return (i <= 0) ? 6 - (6 - i)%7 : i%7;
 }
 
-/* create format string */
-char *create_fstring(const Quark *q, const Format *form, double loc, int type)
+/*
+ * format a number into the caller-owned buffer s of MAX_STRING_LENGTH bytes;
+ * numbers are printed in the POSIX locale and then get the decimal point of
+ * the system one, so labels can be formatted concurrently
+ */
+char *create_fstring(const Quark *q, const Format *form, double loc, int type,
+    char *s)
 {
     char format[64], *prefix;
-    static char s[MAX_STRING_LENGTH];
     double tmp;
     int m, d, y, h, mm, sec;
     int exponent;
@@ -200,9 +208,6 @@ char *create_fstring(const Quark *q, const Format *form, double loc, int type)
         yprec = 4;
     }
 
-    /* for locale decimal points */
-    set_locale_num(TRUE);
-
     strcpy(format, "%.*lf");
     switch (form->type) {
     case FORMAT_DECIMAL:
@@ -445,8 +450,11 @@ char *create_fstring(const Quark *q, const Format *form, double loc, int type)
         break;
     }
 
-    /* revert to POSIX */
-    set_locale_num(FALSE);
+    /* for locale decimal points; dates are left alone, since their
+       templates may contain literal dots, and strfgeo() does it itself */
+    if (form->type != FORMAT_DATETIME && form->type != FORMAT_GEOGRAPHIC) {
+        localize_decimal_point(s, MAX_STRING_LENGTH);
+    }
     
     return(s);
 }
@@ -0,0 +1,325 @@
+/*
+ * Grace - GRaphing, Advanced Computation and Exploration of data
+ *
+ * Home page: http://plasma-gate.weizmann.ac.il/Grace/
+ *
+ * Copyright (c) 2012 Grace Development Team
+ *
+ * Maintained by Evgeny Stambulchik
+ *
+ *
+ *                           All Rights Reserved
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ *
+ * Batch export of a manifest of projects
+ *
+ * Each non-empty line of the manifest, except for comments starting with
+ * '#', describes one job:
+ *
+ *   project device output [device options]
+ *
+ * The jobs are run by a pool of workers, each with its own GraceApp (and
+ * hence its own Grace, Canvas and Graal).
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+
+#include "graceapp.h"
+#include "files.h"
+#include "batch.h"
+
+#define BATCH_MAX_LINE  (4*GR_MAXPATHLEN)
+
+typedef struct {
+    char *project;
+    char *device;
+    char *output;
+    char *options;
+    
+    int done;
+    int status;
+    double elapsed;
+} BatchJob;
+
+typedef struct {
+    unsigned int njobs;
+    BatchJob *jobs;
+    
+    unsigned int next;          /* the first job not yet taken */
+} BatchQueue;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* the agr parser keeps its state in globals; projects are loaded in turn */
+static pthread_mutex_t load_mutex  = PTHREAD_MUTEX_INITIALIZER;
+#  define BATCH_LOCK(m)     pthread_mutex_lock(&m)
+#  define BATCH_UNLOCK(m)   pthread_mutex_unlock(&m)
+#else
+#  define BATCH_LOCK(m)
+#  define BATCH_UNLOCK(m)
+#endif
+
+static void batch_queue_free(BatchQueue *q)
+{
+    unsigned int i;
+    
+    for (i = 0; i < q->njobs; i++) {
+        BatchJob *job = &q->jobs[i];
+        xfree(job->project);
+        xfree(job->device);
+        xfree(job->output);
+        xfree(job->options);
+    }
+    xfree(q->jobs);
+}
+
+static int batch_queue_read(BatchQueue *q, const char *manifest)
+{
+    FILE *fp;
+    char buf[BATCH_MAX_LINE], *s;
+    char project[BATCH_MAX_LINE], device[BATCH_MAX_LINE],
+        output[BATCH_MAX_LINE];
+    int lineno = 0, pos;
+    
+    memset(q, 0, sizeof(BatchQueue));
+    
+    fp = fopen(manifest, "r");
+    if (!fp) {
+        sprintf(buf, "Can't open batch manifest %s", manifest);
+        errmsg(buf);
+        return RETURN_FAILURE;
+    }
+    
+    while (fgets(buf, BATCH_MAX_LINE, fp)) {
+        BatchJob *job;
+        void *p;
+        
+        lineno++;
+        
+        s = buf;
+        while (*s == ' ' || *s == '\t') {
+            s++;
+        }
+        if (*s == '#' || *s == '\n' || *s == '\r' || *s == '\0') {
+            continue;
+        }
+        
+        if (sscanf(s, "%s %s %s %n", project, device, output, &pos) != 3) {
+            sprintf(buf, "Malformed line %d in batch manifest", lineno);
+            errmsg(buf);
+            fclose(fp);
+            batch_queue_free(q);
+            return RETURN_FAILURE;
+        }
+        
+        p = xrealloc(q->jobs, (q->njobs + 1)*sizeof(BatchJob));
+        if (!p) {
+            fclose(fp);
+            batch_queue_free(q);
+            return RETURN_FAILURE;
+        }
+        q->jobs = p;
+        job = &q->jobs[q->njobs];
+        memset(job, 0, sizeof(BatchJob));
+        q->njobs++;
+        
+        job->project = copy_string(NULL, project);
+        job->device  = copy_string(NULL, device);
+        job->output  = copy_string(NULL, output);
+        
+        /* the rest of the line, if any, are the device options */
+        s += pos;
+        s[strcspn(s, "\r\n")] = '\0';
+        if (!string_is_empty(s)) {
+            job->options = copy_string(NULL, s);
+        }
+        job->status = RETURN_FAILURE;
+    }
+    
+    fclose(fp);
+    
+    return RETURN_SUCCESS;
+}
+
+static BatchJob *batch_queue_take(BatchQueue *q)
+{
+    BatchJob *job = NULL;
+    
+    BATCH_LOCK(batch_mutex);
+    if (q->next < q->njobs) {
+        job = &q->jobs[q->next];
+        q->next++;
+    }
+    BATCH_UNLOCK(batch_mutex);
+    
+    return job;
+}
+
+static GraceApp *batch_gapp_new(void)
+{
+    GraceApp *gapp;
+    
+    gapp = gapp_new();
+    if (!gapp) {
+        return NULL;
+    }
+    
+    gapp->gui->noask = TRUE;
+    
+    /* the terminal device must come first */
+    gapp->rt->tdevice = register_dummy_drv(grace_get_canvas(gapp->grace));
+    if (gapp_register_hardcopy_drivers(gapp, TRUE) != RETURN_SUCCESS) {
+        gapp_free(gapp);
+        return NULL;
+    }
+    
+    return gapp;
+}
+
+static int batch_run_job(GraceApp *gapp, const BatchJob *job)
+{
+    Canvas *canvas = grace_get_canvas(gapp->grace);
+    RunTime *rt = gapp->rt;
+    GProject *gp;
+    char buf[BATCH_MAX_LINE + 64];
+    int res;
+    
+    if (strlen(job->output) >= GR_MAXPATHLEN) {
+        sprintf(buf, "Output file name %s is too long", job->output);
+        errmsg(buf);
+        return RETURN_FAILURE;
+    }
+    
+    if (set_printer_by_name(gapp, job->device) != RETURN_SUCCESS) {
+        sprintf(buf, "Unknown or unsupported device %s", job->device);
+        errmsg(buf);
+        return RETURN_FAILURE;
+    }
+    if (job->options &&
+        parse_device_options(canvas, rt->hdevice, job->options) !=
+        RETURN_SUCCESS) {
+        errmsg("Failed parsing device options");
+        return RETURN_FAILURE;
+    }
+    
+    BATCH_LOCK(load_mutex);
+    gp = load_any_project(gapp, job->project);
+    BATCH_UNLOCK(load_mutex);
+    if (!gp) {
+        sprintf(buf, "Failed loading project file %s", job->project);
+        errmsg(buf);
+        return RETURN_FAILURE;
+    }
+    
+    set_ptofile(gapp, TRUE);
+    strcpy(rt->print_file, job->output);
+    
+    res = do_hardcopy(gp);
+    
+    gproject_free(gp);
+    
+    return res;
+}
+
+static void batch_worker(unsigned int worker, unsigned int nworkers,
+    void *udata)
+{
+    BatchQueue *q = (BatchQueue *) udata;
+    GraceApp *gapp = NULL;
+    BatchJob *job;
+    
+    while ((job = batch_queue_take(q)) != NULL) {
+        struct timeval start, stop;
+        
+        gettimeofday(&start, NULL);
+        
+        if (!gapp) {
+            gapp = batch_gapp_new();
+        }
+        if (gapp) {
+            job->status = batch_run_job(gapp, job);
+            
+            /* device options are sticky; don't let them leak into other jobs */
+            if (job->options) {
+                gapp_free(gapp);
+                gapp = NULL;
+            }
+        } else {
+            errmsg("Failed to allocate run-time structures");
+            job->status = RETURN_FAILURE;
+        }
+        
+        gettimeofday(&stop, NULL);
+        job->elapsed = (stop.tv_sec - start.tv_sec) +
+            1.0e-6*(stop.tv_usec - start.tv_usec);
+        job->done = TRUE;
+    }
+    
+    gapp_free(gapp);
+}
+
+/*
+ * Run all jobs of the manifest and report how each of them went;
+ * returns RETURN_FAILURE if any job failed
+ */
+int batch_export(const char *manifest)
+{
+    BatchQueue q;
+    unsigned int i, nworkers, nfailed = 0;
+    struct timeval start, stop;
+    
+    if (batch_queue_read(&q, manifest) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    gettimeofday(&start, NULL);
+    nworkers = MIN2(parallel_get_nthreads(), q.njobs);
+    if (nworkers > 0) {
+        parallel_run(nworkers, batch_worker, &q);
+    }
+    gettimeofday(&stop, NULL);
+    
+    for (i = 0; i < q.njobs; i++) {
+        BatchJob *job = &q.jobs[i];
+        
+        if (job->done && job->status == RETURN_SUCCESS) {
+            fprintf(stdout, "%s -> %s (%s): %.3f s\n",
+                job->project, job->output, job->device, job->elapsed);
+        } else {
+            fprintf(stdout, "%s -> %s (%s): FAILED\n",
+                job->project, job->output, job->device);
+            nfailed++;
+        }
+    }
+    fprintf(stdout, "%u job(s), %u failed, %u worker(s): %.3f s\n",
+        q.njobs, nfailed, nworkers, (stop.tv_sec - start.tv_sec) +
+        1.0e-6*(stop.tv_usec - start.tv_usec));
+    
+    batch_queue_free(&q);
+    
+    return nfailed ? RETURN_FAILURE:RETURN_SUCCESS;
+}
@@ -38,6 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #ifdef HAVE_GSL
 # include <gsl/gsl_sf.h>
@@ -694,42 +695,180 @@ int apply_window(double *v, int len, int window, double beta)
     return RETURN_SUCCESS;
 }
 
-int histogram(int ndata, double *data, int nbins, double *bins, int *hist)
+/* data chunk below which threads aren't worth spawning */
+#define HISTO_CHUNK     65536
+
+typedef struct {
+    int ndata;
+    const double *data;
+    const double *weights;
+    int nbins;
+    const double *bins;
+    int bsign;
+    int uniform;
+    double space;
+    double **hist;              /* per-job accumulators */
+} HistoJob;
+
+/*
+ * bin index of v, or -1 if it's outside; a value on a boundary between
+ * two bins is counted in the former of them
+ */
+static int histo_bin(const HistoJob *hj, double v)
+{
+    const double *bins = hj->bins;
+    int nbins = hj->nbins, j;
+    
+    if (hj->bsign > 0) {
+        if (!(v >= bins[0] && v <= bins[nbins])) {
+            return -1;
+        }
+    } else {
+        if (!(v <= bins[0] && v >= bins[nbins])) {
+            return -1;
+        }
+    }
+    
+    if (hj->uniform) {
+        /* direct guess, then fix up against the actual bin edges */
+        j = (int) ((v - bins[0])/hj->space);
+        if (j < 0) {
+            j = 0;
+        } else if (j > nbins - 1) {
+            j = nbins - 1;
+        }
+        if (hj->bsign > 0) {
+            while (j > 0 && v <= bins[j]) {
+                j--;
+            }
+            while (j < nbins - 1 && v > bins[j + 1]) {
+                j++;
+            }
+        } else {
+            while (j > 0 && v >= bins[j]) {
+                j--;
+            }
+            while (j < nbins - 1 && v < bins[j + 1]) {
+                j++;
+            }
+        }
+    } else {
+        /* the first bin whose far edge isn't passed by v */
+        int low = 0, high = nbins - 1;
+        while (low < high) {
+            int mid = (low + high)/2;
+            if (hj->bsign > 0 ? v > bins[mid + 1] : v < bins[mid + 1]) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        j = low;
+    }
+    
+    return j;
+}
+
+static void histo_accumulate(unsigned int job, unsigned int njobs, void *udata)
 {
-    int i, j, bsign;
-    double minval, maxval;
+    HistoJob *hj = (HistoJob *) udata;
+    double *hist = hj->hist[job];
+    int i, j, i1, i2;
+    
+    i1 = (int) ((double) hj->ndata*job/njobs);
+    i2 = (int) ((double) hj->ndata*(job + 1)/njobs);
+    
+    if (hj->weights) {
+        for (i = i1; i < i2; i++) {
+            j = histo_bin(hj, hj->data[i]);
+            if (j >= 0) {
+                hist[j] += hj->weights[i];
+            }
+        }
+    } else {
+        for (i = i1; i < i2; i++) {
+            j = histo_bin(hj, hj->data[i]);
+            if (j >= 0) {
+                hist[j] += 1.0;
+            }
+        }
+    }
+}
+
+/*
+ * histogram of data (optionally weighted) over nbins bins with monotonic
+ * boundaries bins[0...nbins]; equidistant bins are indexed directly,
+ * others by bisection. Large inputs are split between threads, each filling
+ * its own counters; these are merged (and summed up if cumulative) into hist.
+ */
+int histogram(int ndata, const double *data, const double *weights,
+    int nbins, const double *bins, int cumulative, double *hist)
+{
+    HistoJob hj;
+    unsigned int njobs, k;
+    int j;
     
     if (nbins < 1) {
         errmsg("Number of bins < 1");
         return RETURN_FAILURE;
     }
     
-    bsign = monotonicity(bins, nbins + 1, TRUE);
-    if (bsign == 0) {
+    hj.bsign = monotonicity((double *) bins, nbins + 1, TRUE);
+    if (hj.bsign == 0) {
         errmsg("Non-monotonic bins");
         return RETURN_FAILURE;
     }
     
-    for (i = 0; i < nbins; i++) {
-        hist[i] = 0;
+    hj.ndata   = ndata;
+    hj.data    = data;
+    hj.weights = weights;
+    hj.nbins   = nbins;
+    hj.bins    = bins;
+    if (nbins > 1) {
+        hj.uniform = monospaced((double *) bins, nbins + 1, &hj.space);
+    } else {
+        hj.uniform = FALSE;
     }
     
-    /* TODO: binary search */
-    for (i = 0; i < ndata; i++) {
-        for (j = 0; j < nbins; j++) {
-            if (bsign > 0) {
-                minval = bins[j];
-                maxval = bins[j + 1];
-            } else {
-                minval = bins[j + 1];
-                maxval = bins[j];
-            }
-            if (data[i] >= minval && data[i] <= maxval) {
-                hist[j] += 1;
-                break;
-            }
+    njobs = MIN2(parallel_get_nthreads(), ndata/HISTO_CHUNK);
+    if (njobs < 1) {
+        njobs = 1;
+    }
+    
+    hj.hist = xmalloc(njobs*sizeof(double *));
+    if (!hj.hist) {
+        return RETURN_FAILURE;
+    }
+    /* the first job accumulates right into the output */
+    hj.hist[0] = hist;
+    for (k = 1; k < njobs; k++) {
+        hj.hist[k] = xcalloc(nbins, SIZEOF_DOUBLE);
+        if (!hj.hist[k]) {
+            njobs = k;
+            break;
         }
     }
+    
+    for (j = 0; j < nbins; j++) {
+        hist[j] = 0.0;
+    }
+    
+    parallel_run(njobs, histo_accumulate, &hj);
+    
+    for (j = 0; j < nbins; j++) {
+        for (k = 1; k < njobs; k++) {
+            hist[j] += hj.hist[k][j];
+        }
+        if (cumulative && j > 0) {
+            hist[j] += hist[j - 1];
+        }
+    }
+    
+    for (k = 1; k < njobs; k++) {
+        xfree(hj.hist[k]);
+    }
+    xfree(hj.hist);
+    
     return RETURN_SUCCESS;
 }
 
@@ -1123,7 +1262,7 @@ int do_linearc(Quark *psrc, Quark *pdest,
     destlen = srclen + convlen - 1;
 
     xsrc  = set_get_col(psrc, DATA_X);
-    if (monospaced(xsrc, srclen, &xspace1) != TRUE) {
+    if (set_is_monospaced(psrc, DATA_X, &xspace1) != TRUE) {
         errmsg("Abscissas of the set are not monospaced");
         return RETURN_FAILURE;
     } else {
@@ -1134,7 +1273,7 @@ int do_linearc(Quark *psrc, Quark *pdest,
     }
 
     xconv = set_get_col(pconv, DATA_X);
-    if (monospaced(xconv, convlen, &xspace2) != TRUE) {
+    if (set_is_monospaced(pconv, DATA_X, &xspace2) != TRUE) {
         errmsg("Abscissas of the set are not monospaced");
         return RETURN_FAILURE;
     } else {
@@ -1207,7 +1346,7 @@ int do_xcor(Quark *psrc, Quark *pdest,
     }
 
     xsrc = set_get_col(psrc, DATA_X);
-    if (monospaced(xsrc, len, &xspace1) != TRUE) {
+    if (set_is_monospaced(psrc, DATA_X, &xspace1) != TRUE) {
         errmsg("Abscissas of the source set are not monospaced");
         return RETURN_FAILURE;
     } else {
@@ -1235,7 +1374,7 @@ int do_xcor(Quark *psrc, Quark *pdest,
         }
 
         xcor = set_get_col(pcor, DATA_X);
-        if (monospaced(xcor, len, &xspace2) != TRUE) {
+        if (set_is_monospaced(pcor, DATA_X, &xspace2) != TRUE) {
             errmsg("Abscissas of the set are not monospaced");
             return RETURN_FAILURE;
         } else {
@@ -1413,6 +1552,7 @@ int do_int(Quark *psrc, Quark *pdest,
 	    return RETURN_FAILURE;
         } else {
 	    *sum = trapint(x, y, getx(pdest), gety(pdest), len);
+	    quark_dirtystate_set(pdest, TRUE);
 	    sprintf(buf, "Integral of set %s", QIDSTR(psrc));
 	    // set_set_comment(pdest, buf);
 	}
@@ -1425,15 +1565,417 @@ int do_int(Quark *psrc, Quark *pdest,
 /*
  * running properties
  */
+
+/* compensated (Neumaier) summation step */
+static void kahan_add(double *sum, double *comp, double v)
+{
+    double t = *sum + v;
+    if (fabs(*sum) >= fabs(v)) {
+        *comp += (*sum - t) + v;
+    } else {
+        *comp += (v - t) + *sum;
+    }
+    *sum = t;
+}
+
+/*
+ * sliding sum (or mean, if norm is set); the window is re-summed from
+ * scratch every runlen steps to bound the error of the add/remove updates,
+ * and on every step while it holds a non-finite value
+ */
+static void run_sum(const double *x, unsigned int newlen, unsigned int runlen,
+    int norm, double *out)
+{
+    unsigned int i, k;
+    double s = 0.0, c = 0.0;
+
+    for (i = 0; i < newlen; i++) {
+        if (i % runlen == 0 || !finite(s + c)) {
+            s = c = 0.0;
+            for (k = i; k < i + runlen; k++) {
+                kahan_add(&s, &c, x[k]);
+            }
+        } else {
+            kahan_add(&s, &c, x[i + runlen - 1]);
+            kahan_add(&s, &c, -x[i - 1]);
+        }
+        out[i] = norm ? (s + c)/runlen:(s + c);
+    }
+}
+
+/* sum of squared deviations from the mean of x[0..n-1] */
+static double window_m2(const double *x, unsigned int n, double *mean)
+{
+    unsigned int k;
+    double s = 0.0, c = 0.0, m2 = 0.0;
+
+    for (k = 0; k < n; k++) {
+        kahan_add(&s, &c, x[k]);
+    }
+    *mean = (s + c)/n;
+    for (k = 0; k < n; k++) {
+        m2 += (x[k] - *mean)*(x[k] - *mean);
+    }
+
+    return m2;
+}
+
+/*
+ * sliding standard deviation by Welford's updates, resynced as above; once
+ * m2 falls to the level of the cancellation error of the updates (relative
+ * to mean^2), it is recomputed from the window so that (near-)constant
+ * windows do not yield the accumulated rounding residue
+ */
+#define RUN_STD_EPS 1.0e-10
+
+static void run_std(const double *x, unsigned int newlen, unsigned int runlen,
+    double *out)
+{
+    unsigned int i;
+    double mean = 0.0, m2 = 0.0;
+
+    for (i = 0; i < newlen; i++) {
+        if (i % runlen == 0 || !finite(m2)) {
+            m2 = window_m2(&x[i], runlen, &mean);
+        } else {
+            double xo = x[i - 1], xn = x[i + runlen - 1];
+            double mean_old = mean;
+            mean += (xn - xo)/runlen;
+            m2 += (xn - xo)*(xn - mean + xo - mean_old);
+            if (m2 <= RUN_STD_EPS*mean*mean*runlen) {
+                m2 = window_m2(&x[i], runlen, &mean);
+            }
+        }
+        if (runlen > 1 && m2 > 0.0) {
+            out[i] = sqrt(m2/(runlen - 1));
+        } else {
+            out[i] = 0.0;
+        }
+    }
+}
+
+/* sliding extremum; indices of the candidates are kept in a monotonic deque */
+static int run_minmax(const double *x, unsigned int newlen,
+    unsigned int runlen, int ismax, double *out)
+{
+    unsigned int len = newlen + runlen - 1, head = 0, tail = 0, k;
+    unsigned int *dq;
+
+    dq = xmalloc(len*SIZEOF_INT);
+    if (!dq) {
+        return RETURN_FAILURE;
+    }
+
+    for (k = 0; k < len; k++) {
+        if (ismax) {
+            while (tail > head && x[dq[tail - 1]] <= x[k]) {
+                tail--;
+            }
+        } else {
+            while (tail > head && x[dq[tail - 1]] >= x[k]) {
+                tail--;
+            }
+        }
+        dq[tail++] = k;
+        if (dq[head] + runlen <= k) {
+            head++;
+        }
+        if (k + 1 >= runlen) {
+            out[k + 1 - runlen] = x[dq[head]];
+        }
+    }
+
+    xfree(dq);
+
+    return RETURN_SUCCESS;
+}
+
+/*
+ * sliding median: the lower half of the window is kept in a max-heap, the
+ * upper one in a min-heap; both hold indices into x, and the position of
+ * each window element (addressed by its index modulo runlen) is tracked
+ * so that the one leaving the window can be removed directly
+ */
+typedef struct {
+    const double *x;
+    unsigned int runlen;
+    unsigned int *heap[2];      /* 0 - lower half, 1 - upper half */
+    unsigned int n[2];
+    unsigned int *pos;
+    char *side;
+} MedianHeaps;
+
+static int mh_above(const MedianHeaps *mh, int h, unsigned int a, unsigned int b)
+{
+    return h ? mh->x[a] < mh->x[b]:mh->x[a] > mh->x[b];
+}
+
+static void mh_set(MedianHeaps *mh, int h, unsigned int k, unsigned int idx)
+{
+    unsigned int slot = idx % mh->runlen;
+    mh->heap[h][k] = idx;
+    mh->pos[slot] = k;
+    mh->side[slot] = h;
+}
+
+static void mh_sift(MedianHeaps *mh, int h, unsigned int k)
+{
+    unsigned int *heap = mh->heap[h], n = mh->n[h], idx = heap[k];
+
+    while (k > 0 && mh_above(mh, h, idx, heap[(k - 1)/2])) {
+        mh_set(mh, h, k, heap[(k - 1)/2]);
+        k = (k - 1)/2;
+    }
+    while (2*k + 1 < n) {
+        unsigned int child = 2*k + 1;
+        if (child + 1 < n && mh_above(mh, h, heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!mh_above(mh, h, heap[child], idx)) {
+            break;
+        }
+        mh_set(mh, h, k, heap[child]);
+        k = child;
+    }
+    mh_set(mh, h, k, idx);
+}
+
+static void mh_push(MedianHeaps *mh, int h, unsigned int idx)
+{
+    unsigned int k = mh->n[h]++;
+    mh_set(mh, h, k, idx);
+    mh_sift(mh, h, k);
+}
+
+static unsigned int mh_remove(MedianHeaps *mh, int h, unsigned int k)
+{
+    unsigned int idx = mh->heap[h][k];
+
+    mh->n[h]--;
+    if (k < mh->n[h]) {
+        mh_set(mh, h, k, mh->heap[h][mh->n[h]]);
+        mh_sift(mh, h, k);
+    }
+
+    return idx;
+}
+
+static void mh_balance(MedianHeaps *mh)
+{
+    while (mh->n[0] > mh->n[1] + 1) {
+        mh_push(mh, 1, mh_remove(mh, 0, 0));
+    }
+    while (mh->n[1] > mh->n[0]) {
+        mh_push(mh, 0, mh_remove(mh, 1, 0));
+    }
+}
+
+static void mh_insert(MedianHeaps *mh, unsigned int idx)
+{
+    if (mh->n[0] == 0 || mh->x[idx] <= mh->x[mh->heap[0][0]]) {
+        mh_push(mh, 0, idx);
+    } else {
+        mh_push(mh, 1, idx);
+    }
+    mh_balance(mh);
+}
+
+static void mh_erase(MedianHeaps *mh, unsigned int idx)
+{
+    unsigned int slot = idx % mh->runlen;
+    mh_remove(mh, mh->side[slot], mh->pos[slot]);
+    mh_balance(mh);
+}
+
+static int run_median(const double *x, unsigned int newlen,
+    unsigned int runlen, double *out)
+{
+    MedianHeaps mh;
+    unsigned int i, k;
+
+    mh.x      = x;
+    mh.runlen = runlen;
+    mh.n[0]   = mh.n[1] = 0;
+    mh.heap[0] = xmalloc(runlen*SIZEOF_INT);
+    mh.heap[1] = xmalloc(runlen*SIZEOF_INT);
+    mh.pos     = xmalloc(runlen*SIZEOF_INT);
+    mh.side    = xmalloc(runlen*SIZEOF_CHAR);
+    if (!mh.heap[0] || !mh.heap[1] || !mh.pos || !mh.side) {
+        xfree(mh.heap[0]);
+        xfree(mh.heap[1]);
+        xfree(mh.pos);
+        xfree(mh.side);
+        return RETURN_FAILURE;
+    }
+
+    for (k = 0; k < runlen; k++) {
+        mh_insert(&mh, k);
+    }
+    for (i = 0; i < newlen; i++) {
+        if (i > 0) {
+            mh_erase(&mh, i - 1);
+            mh_insert(&mh, i + runlen - 1);
+        }
+        /* same convention as in vmedian() */
+        if (mh.n[0] > mh.n[1]) {
+            out[i] = x[mh.heap[0][0]];
+        } else {
+            out[i] = (x[mh.heap[0][0]] + x[mh.heap[1][0]])/2;
+        }
+    }
+
+    xfree(mh.heap[0]);
+    xfree(mh.heap[1]);
+    xfree(mh.pos);
+    xfree(mh.side);
+
+    return RETURN_SUCCESS;
+}
+
+/*
+ * property (one of RUN_*) of each of the newlen windows of runlen
+ * consecutive points of x; out must not overlap x
+ */
+int running_stat(const double *x, unsigned int newlen, unsigned int runlen,
+    int type, double *out)
+{
+    if (runlen < 1) {
+        return RETURN_FAILURE;
+    }
+
+    switch (type) {
+    case RUN_AVG:
+        run_sum(x, newlen, runlen, TRUE, out);
+        break;
+    case RUN_SUM:
+        run_sum(x, newlen, runlen, FALSE, out);
+        break;
+    case RUN_STD:
+        run_std(x, newlen, runlen, out);
+        break;
+    case RUN_MIN:
+        return run_minmax(x, newlen, runlen, FALSE, out);
+    case RUN_MAX:
+        return run_minmax(x, newlen, runlen, TRUE, out);
+    case RUN_MED:
+        return run_median(x, newlen, runlen, out);
+    default:
+        return RETURN_FAILURE;
+    }
+
+    return RETURN_SUCCESS;
+}
+
+/* formulas of the form "FUNC($t)" handled by running_stat(); -1 otherwise */
+static int run_formula_type(const char *formula)
+{
+    const struct {
+        const char *name;
+        int type;
+    } funcs[] = {
+        {"AVG",    RUN_AVG},
+        {"MEAN",   RUN_AVG},
+        {"SUM",    RUN_SUM},
+        {"SD",     RUN_STD},
+        {"STD",    RUN_STD},
+        {"MIN",    RUN_MIN},
+        {"MAX",    RUN_MAX},
+        {"MEDIAN", RUN_MED}
+    };
+    const char *s = formula;
+    char name[16];
+    unsigned int i, n = 0;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    while (((*s >= 'A' && *s <= 'Z') || (*s >= 'a' && *s <= 'z')) &&
+        n < sizeof(name) - 1) {
+        name[n++] = toupper(*s);
+        s++;
+    }
+    name[n] = '\0';
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (*s != '(') {
+        return -1;
+    }
+    s++;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (strncmp(s, "$t", 2)) {
+        return -1;
+    }
+    s += 2;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (*s != ')') {
+        return -1;
+    }
+    s++;
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    if (*s != '\0') {
+        return -1;
+    }
+
+    for (i = 0; i < sizeof(funcs)/sizeof(funcs[0]); i++) {
+        if (strings_are_equal(name, funcs[i].name)) {
+            return funcs[i].type;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * evaluate an arbitrary formula of the window array "$t"; the variable is
+ * set up once and refilled in place, and graal keeps the formula compiled
+ * between the calls
+ */
+static int run_formula(Quark *psrc, const double *x, unsigned int newlen,
+    unsigned int runlen, const char *formula, double *out)
+{
+    GraceApp *gapp = gapp_from_quark(psrc);
+    Graal *g = grace_get_graal(gapp->grace);
+    GVar *t;
+    DArray win, *da;
+    unsigned int i;
+
+    win.size      = runlen;
+    win.asize     = runlen;
+    win.x         = (double *) x;
+    win.allocated = FALSE;
+
+    t = graal_get_var(g, "$t", TRUE);
+    if (!t || gvar_set_arr(t, &win) != RETURN_SUCCESS ||
+        gvar_get_arr(t, &da) != RETURN_SUCCESS || !da) {
+        errmsg("Internal error");
+        return RETURN_FAILURE;
+    }
+
+    for (i = 0; i < newlen; i++) {
+        if (i > 0) {
+            memcpy(da->x, &x[i], runlen*SIZEOF_DOUBLE);
+        }
+        if (graal_eval_expr(g, formula, &out[i], psrc) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+    }
+
+    return RETURN_SUCCESS;
+}
+
 int do_runavg(Quark *psrc, Quark *pdest,
     int runlen, char *formula, int xplace)
 {
-#if 0
-    int i, nc, ncols, len, newlen;
-    double *x1, *x2;
-    GVar *t;
+    int nc, ncols, len, newlen, type;
+    double *res;
     char buf[256];
-    RunTime *rt = rt_from_quark(psrc);
 
     if (runlen < 1) {
 	errmsg("Length of running average < 1");
@@ -1445,73 +1987,72 @@ int do_runavg(Quark *psrc, Quark *pdest,
 	errmsg("Length of running average > set length");
 	return RETURN_FAILURE;
     }
-    
+
     if (string_is_empty(formula)) {
 	errmsg("Empty formula");
 	return RETURN_FAILURE;
     }
 
     newlen = len - runlen + 1;
-    if (set_set_length(pdest, newlen) != RETURN_SUCCESS) {
-	return RETURN_FAILURE;
-    }
-    
     ncols = set_get_ncols(psrc);
-    if (set_get_ncols(pdest) != ncols) {
-        set_set_type(pdest, set_get_type(psrc));
-    }
-    
-    t = graal_get_var(rt->graal, "$t");
-    if (t == NULL) {
-        errmsg("Internal error");
+    type = run_formula_type(formula);
+
+    /* all columns are computed before pdest (possibly psrc) is touched */
+    res = xmalloc(ncols*newlen*SIZEOF_DOUBLE);
+    if (!res) {
         return RETURN_FAILURE;
     }
-    
-    if (t->length != 0) {
-        XCFREE(t->data);
-    }
-    t->length = runlen;
 
-    // set_parser_setno(psrc);
     for (nc = 1; nc < ncols; nc++) {
-        double *d1, *d2;
-        d1 = set_get_col(psrc, nc);
-        d2 = set_get_col(pdest, nc);
-        for (i = 0; i < newlen; i++) {
-            t->data = &(d1[i]);
-            if (graal_eval_expr(rt->graal, formula, &(d2[i])) !=
-                RETURN_SUCCESS) {
-                t->length = 0;
-                t->data = NULL;
-                return RETURN_FAILURE;
-            }
+        const double *d = set_get_col(psrc, nc);
+        int retval;
+        if (type >= 0) {
+            retval = running_stat(d, newlen, runlen, type, &res[nc*newlen]);
+        } else {
+            retval = run_formula(psrc, d, newlen, runlen, formula,
+                &res[nc*newlen]);
+        }
+        if (retval != RETURN_SUCCESS) {
+            xfree(res);
+            return RETURN_FAILURE;
         }
     }
-    
-    /* undefine the virtual array */
-    t->length = 0;
-    t->data = NULL;
 
-    x1 = set_get_col(psrc, DATA_X);
-    x2 = set_get_col(pdest, DATA_X);
-    for (i = 0; i < newlen; i++) {
-        double dummy;
-        switch (xplace) {
-        case RUN_XPLACE_LEFT:
-            x2[i] = x1[i];
-            break;
-        case RUN_XPLACE_RIGHT:
-            x2[i] = x1[i + runlen - 1];
-            break;
-        default:
-            stasum(&(x1[i]), runlen, &(x2[i]), &dummy);
-            break;
+    switch (xplace) {
+    case RUN_XPLACE_LEFT:
+        memcpy(res, set_get_col(psrc, DATA_X), newlen*SIZEOF_DOUBLE);
+        break;
+    case RUN_XPLACE_RIGHT:
+        memcpy(res, set_get_col(psrc, DATA_X) + runlen - 1,
+            newlen*SIZEOF_DOUBLE);
+        break;
+    default:
+        running_stat(set_get_col(psrc, DATA_X), newlen, runlen, RUN_AVG, res);
+        break;
+    }
+
+    if (set_set_length(pdest, newlen) != RETURN_SUCCESS) {
+        xfree(res);
+	return RETURN_FAILURE;
+    }
+    if (set_get_ncols(pdest) != ncols) {
+        set_set_type(pdest, set_get_type(psrc));
+    }
+
+    for (nc = 0; nc < ncols; nc++) {
+        double *d = set_get_col(pdest, nc);
+        if (d) {
+            memcpy(d, &res[nc*newlen], newlen*SIZEOF_DOUBLE);
         }
     }
+
+    xfree(res);
     
+    quark_dirtystate_set(pdest, TRUE);
+
     sprintf(buf, "%d-pt. running %s on %s", runlen, formula, QIDSTR(psrc));
     // set_set_comment(pdest, buf);
-#endif    
+
     return RETURN_SUCCESS;
 }
 
@@ -1525,7 +2066,7 @@ int do_fourier(Quark *psrc, Quark *pdest,
     int output)
 {
     int i, inlen, buflen, outlen, ncols;
-    double *in_x, *in_re, *in_im, *buf_re, *buf_im, *out_x, *out_y, *out_y1;
+    double *in_re, *in_im, *buf_re, *buf_im, *out_x, *out_y, *out_y1;
     double xspace, amp_correction;
     char buf[256];
 
@@ -1547,8 +2088,7 @@ int do_fourier(Quark *psrc, Quark *pdest,
         in_im = set_get_col(psrc, DATA_Y1);
     }
     
-    in_x = set_get_col(psrc, DATA_X);
-    if (monospaced(in_x, inlen, &xspace) != TRUE) {
+    if (set_is_monospaced(psrc, DATA_X, &xspace) != TRUE) {
         errmsg("Abscissas of the set are not monospaced, can't use for sampling");
         return RETURN_FAILURE;
     } else {
@@ -1725,8 +2265,7 @@ int do_histo(Quark *psrc, Quark *pdest,
 	      double *bins, int nbins, int cumulative, int normalize)
 {
     int i, ndata;
-    int *hist;
-    double *x, *y, *data;
+    double *x, *y, *data, *hist;
     set *p;
     char buf[256];
     
@@ -1738,45 +2277,40 @@ int do_histo(Quark *psrc, Quark *pdest,
     ndata = set_get_length(psrc);
     data = gety(psrc);
     
-    hist = xmalloc(nbins*SIZEOF_INT);
+    /* bin before resizing the destination, which may share the ssd
+       (and hence the data) with the source */
+    hist = xmalloc(nbins*SIZEOF_DOUBLE);
     if (hist == NULL) {
-        errmsg("xmalloc failed in do_histo()");
         return RETURN_FAILURE;
     }
-
-    if (histogram(ndata, data, nbins, bins, hist) == RETURN_FAILURE){
+    if (histogram(ndata, data, NULL, nbins, bins, cumulative, hist) ==
+        RETURN_FAILURE) {
         xfree(hist);
         return RETURN_FAILURE;
     }
     
-    set_set_length(pdest, nbins + 1);
+    if (set_set_length(pdest, nbins + 1) != RETURN_SUCCESS) {
+        xfree(hist);
+        return RETURN_FAILURE;
+    }
     x = getx(pdest);
     y = gety(pdest);
+    memcpy(y + 1, hist, nbins*SIZEOF_DOUBLE);
+    xfree(hist);
     
     x[0] = bins[0];
     y[0] = 0.0;
     for (i = 1; i < nbins + 1; i++) {
         x[i] = bins[i];
-        y[i] = hist[i - 1];
-        if (cumulative) {
-            y[i] += y[i - 1];
-        }
-    }
-    
-    if (normalize) {
-        for (i = 1; i < nbins + 1; i++) {
-            double factor;
+        if (normalize) {
             if (cumulative) {
-                factor = 1.0/ndata;
+                y[i] /= ndata;
             } else {
-                factor = 1.0/((bins[i] - bins[i - 1])*ndata);
+                y[i] /= (bins[i] - bins[i - 1])*ndata;
             }
-            y[i] *= factor;
         }
     }
     
-    xfree(hist);
-
     p = set_get_data(pdest);
     p->sym.type = SYM_NONE;
     p->line.type = LINE_TYPE_LEFTSTAIR;
@@ -1787,79 +2321,123 @@ int do_histo(Quark *psrc, Quark *pdest,
     p->sym.line.style = 1;
     sprintf(buf, "Histogram from %s", QIDSTR(psrc));
     // set_set_comment(pdest, buf);
+    
+    quark_dirtystate_set(pdest, TRUE);
 
     return RETURN_SUCCESS;
 }
 
 
 /*
- * sample a set by a logical expression
+ * sample a set by a logical expression; the expression is evaluated over
+ * the whole set at once, then the rows are compacted in a single pass
  */
 int do_sample(Quark *psrc, Quark *pdest, char *formula)
 {
-#if 0
-    int len, newlen, ncols, i, nc;
-    int reslen;
-    double *result;
+    GraceApp *gapp = gapp_from_quark(psrc);
+    Quark *ss = get_parent_ssd(psrc);
+    int len, newlen, ncols, i, j, nc, retval;
+    double *scols[MAX_SET_COLS], *dcols[MAX_SET_COLS], row[MAX_SET_COLS];
+    char *keep;
+    DArray *mask;
     char buf[256];
 
     if (string_is_empty(formula)) {
 	errmsg("Empty formula");
 	return RETURN_FAILURE;
     }
-    if (set_parser_setno(psrc) != RETURN_SUCCESS) {
-	errmsg("Bad set");
-	return RETURN_FAILURE;
-    }
+    
     len = set_get_length(psrc);
+    ncols = set_get_ncols(psrc);
     
-    if (v_scanner(formula, &reslen, &result) != RETURN_SUCCESS) {
-	return RETURN_FAILURE;
+    if (len == 0) {
+        /* nothing to sample from */
+        if (get_parent_ssd(pdest) != ss) {
+            return set_set_length(pdest, 0);
+        } else {
+            return RETURN_SUCCESS;
+        }
     }
-    if (reslen != len) {
-	errmsg("Internal error");
-	xfree(result);
+    
+    mask = darray_new(len);
+    keep = xmalloc(len*SIZEOF_CHAR);
+    if (!mask || (len && !keep)) {
+        darray_free(mask);
+        xfree(keep);
+        return RETURN_FAILURE;
+    }
+    if (graal_transform_arr(grace_get_graal(gapp->grace),
+        formula, "$t", mask, psrc) != RETURN_SUCCESS) {
+        darray_free(mask);
+        xfree(keep);
         return RETURN_FAILURE;
     }
     
     newlen = 0;
     for (i = 0; i < len; i++) {
-	if ((int) rint(result[i])) {
+	keep[i] = ((int) rint(mask->x[i]) != 0);
+        if (keep[i]) {
 	    newlen++;
 	}
     }
+    darray_free(mask);
 
-    ncols = set_get_ncols(psrc);
     if (set_get_ncols(pdest) != ncols) {
         set_set_type(pdest, set_get_type(psrc));
     }
     
-    if (set_set_length(pdest, newlen) != RETURN_SUCCESS) {
-        xfree(result);
+    if (get_parent_ssd(pdest) != ss &&
+        set_set_length(pdest, newlen) != RETURN_SUCCESS) {
+        xfree(keep);
         return RETURN_FAILURE;
     }
-
+    
     for (nc = 0; nc < ncols; nc++) {
-        double *d1, *d2;
-        int j;
-        j = 0;
-        d1 = set_get_col(psrc, nc);
-        d2 = set_get_col(pdest, nc);
-        for (i = 0; i < len; i++) {
-	    if ((int) rint(result[i])) {
-	        d2[j] = d1[i];
+        scols[nc] = set_get_col(psrc, nc);
+        dcols[nc] = set_get_col(pdest, nc);
+        if (newlen && (!scols[nc] || !dcols[nc])) {
+            xfree(keep);
+            return RETURN_FAILURE;
+        }
+    }
+    
+    if (get_parent_ssd(pdest) != ss) {
+        for (i = 0, j = 0; i < len; i++) {
+	    if (keep[i]) {
+                for (nc = 0; nc < ncols; nc++) {
+                    dcols[nc][j] = scols[nc][i];
+                }
                 j++;
 	    }
         }
+        retval = RETURN_SUCCESS;
+    } else {
+        /* resizing would truncate the source; instead, rows of the whole ssd
+           are dropped, keeping all its columns (strings, annotations, other
+           sets) aligned */
+        if (pdest != psrc) {
+            for (i = 0; i < len; i++) {
+                for (nc = 0; nc < ncols; nc++) {
+                    row[nc] = scols[nc][i];
+                }
+                for (nc = 0; nc < ncols; nc++) {
+                    dcols[nc][i] = row[nc];
+                }
+            }
+        }
+        retval = ssd_compact_rows(ss, keep);
     }
     
-    xfree(result);
+    xfree(keep);
+    
+    if (retval == RETURN_SUCCESS) {
+        quark_dirtystate_set(pdest, TRUE);
+    }
     
     sprintf(buf, "Sample from %s, using '%s'", QIDSTR(psrc), formula);
     // set_set_comment(pdest, buf);
     
-#endif    
-    return RETURN_SUCCESS;
+    return retval;
 }
 
 /*
@@ -1896,7 +2474,7 @@ int do_prune(Quark *psrc, Quark *pdest,
     x = getx(psrc);
     y = gety(psrc);
 
-    if (interp && monotonicity(x, len, FALSE) == 0) {
+    if (interp && set_get_monotonicity(psrc, DATA_X, FALSE) == 0) {
 	errmsg("Can't prune a non-monotonic set using interpolation");
 	return RETURN_FAILURE;
     }
@@ -2047,7 +2625,6 @@ int get_restriction_array(Quark *pset, Quark *r, int negate, char **rarray)
 {
     int i, n;
     double *x, *y;
-    WPoint wp;
     
     if (!r) {
         *rarray = NULL;
@@ -2068,10 +2645,15 @@ int get_restriction_array(Quark *pset, Quark *r, int negate, char **rarray)
     x = set_get_col(pset, DATA_X);
     y = set_get_col(pset, DATA_Y);
     
-    for (i = 0; i < n; i++) {
-        wp.x = x[i];
-        wp.y = y[i];
-        (*rarray)[i] = region_contains(r, &wp) ? !negate : negate;
+    if (region_contains_points(r, x, y, n, *rarray) != RETURN_SUCCESS) {
+        XCFREE(*rarray);
+        return RETURN_FAILURE;
+    }
+    
+    if (negate) {
+        for (i = 0; i < n; i++) {
+            (*rarray)[i] = !(*rarray)[i];
+        }
     }
 
     return RETURN_SUCCESS;
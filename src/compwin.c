@@ -797,6 +797,8 @@ void create_diff_frame(Widget but, void *data)
 #define RUN_TYPE_STDDEV     2
 #define RUN_TYPE_MIN        3
 #define RUN_TYPE_MAX        4
+#define RUN_TYPE_MEDIAN     5
+#define RUN_TYPE_SUM        6
 
 typedef struct {
     SpinStructure *length;
@@ -828,6 +830,12 @@ static void run_type_cb(OptionStructure *opt, int value, void *data)
     case RUN_TYPE_MAX:
         formula = "MAX($t)";
         break;
+    case RUN_TYPE_MEDIAN:
+        formula = "MEDIAN($t)";
+        break;
+    case RUN_TYPE_SUM:
+        formula = "SUM($t)";
+        break;
     default:
         formula = NULL;
         break;
@@ -854,7 +862,9 @@ static void *run_build_cb(TransformStructure *tdialog)
             {RUN_TYPE_AVERAGE, "Average"  },
             {RUN_TYPE_STDDEV,  "Std. dev."},
             {RUN_TYPE_MIN,     "Minimum"  },
-            {RUN_TYPE_MAX,     "Maximum"  }
+            {RUN_TYPE_MAX,     "Maximum"  },
+            {RUN_TYPE_MEDIAN,  "Median"   },
+            {RUN_TYPE_SUM,     "Sum"      }
         };
         OptionItem xopitems[] = {
             {RUN_XPLACE_LEFT,    "Left"   },
@@ -863,7 +873,7 @@ static void *run_build_cb(TransformStructure *tdialog)
         };
 	
 	rc = CreateVContainer(tdialog->frame);
-        type = CreateOptionChoice(rc, "Type:", 0, 5, topitems);
+        type = CreateOptionChoice(rc, "Type:", 0, 7, topitems);
         AddOptionChoiceCB(type, run_type_cb, (void *) ui);
 	ui->formula = CreateText(rc, "Formula:");
 	ui->length = CreateSpinChoice(rc, "Length of sample", 6, SPIN_TYPE_INT,
@@ -1207,7 +1217,8 @@ static void *samp_build_cb(TransformStructure *tdialog)
 
     ui = xmalloc(sizeof(Samp_ui));
     if (ui) {
-	ui->formula = CreateText(tdialog->frame, "Logical expression:");
+	ui->formula = CreateText(tdialog->frame,
+            "Logical expression (e.g. x > 0 && y <= 1):");
     }
 
     return (void *) ui;
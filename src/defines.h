@@ -71,6 +71,7 @@
 #define RUN_MIN         2
 #define RUN_MAX         3
 #define RUN_STD         4
+#define RUN_SUM         5
 
 /* types of autscales */
 #define AUTOSCALE_NONE    0
@@ -188,6 +189,12 @@ typedef struct _Input_buffer {
     int           used;   /* number of bytes used in the buffer */
     char         *buf;    /* buffer for already read lines */
     unsigned long id;     /* id for X library */
+    char         *target; /* target set of the pending binary rows */
+    unsigned int  ncols;  /* number of values per pending row */
+    unsigned int  nrows;  /* number of pending rows */
+    unsigned int  nalloc; /* allocated size of the pending buffer */
+    double       *pending;/* binary rows not yet appended to the target */
+    int           resync; /* discarding input up to the next newline */
 } Input_buffer;
 
 #endif /* __DEFINES_H_ */
@@ -35,6 +35,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "utils.h"
 #include "core_utils.h"
@@ -105,8 +106,233 @@ typedef struct {
     int part;
     view bbox;
     int found;
+    unsigned int nsets;         /* sets visited so far */
 } canvas_target;
 
+/*
+ * Hit-testing index of set points: the viewport positions of the points of
+ * a set, bucketed into a uniform grid. The indices of all sets of the
+ * project are dropped as soon as anything in it changes, and rebuilt one by
+ * one as the sets are looked at.
+ */
+#define SET_GRID_MAX    1024
+
+#define VPOINT_IS_FINITE(vp) ((vp).x - (vp).x == 0.0 && (vp).y - (vp).y == 0.0)
+
+typedef struct {
+    Quark *pset;
+    double symsize;
+    VPoint *vps;                /* the points in viewport coordinates */
+    view bbox;                  /* bounding box of the points */
+    unsigned int nx, ny;        /* grid dimensions; zero if no points */
+    double cx, cy;              /* cell dimensions */
+    unsigned int *cells;        /* start of each cell in inds[] */
+    unsigned int *inds;         /* point indices, ascending within a cell */
+} SetGrid;
+
+static struct {
+    Quark *project;
+    unsigned int stamp;
+    unsigned int ngrids;
+    SetGrid *grids;
+} set_grids;
+
+static void set_grid_free(SetGrid *sg)
+{
+    xfree(sg->vps);
+    xfree(sg->cells);
+    xfree(sg->inds);
+    memset(sg, 0, sizeof(SetGrid));
+}
+
+static unsigned int set_grid_cell(double v, double v1, double c, unsigned int n)
+{
+    double k = (v - v1)/c;
+    if (k <= 0.0) {
+        return 0;
+    } else if (k >= n - 1) {
+        return n - 1;
+    } else {
+        return (unsigned int) k;
+    }
+}
+
+static int set_grid_build(SetGrid *sg, Quark *pset, double symsize)
+{
+    double *x = set_get_col(pset, DATA_X), *y = set_get_col(pset, DATA_Y);
+    int len = set_get_length(pset);
+    unsigned int i, n, m, g, k, ncells;
+    
+    sg->pset    = pset;
+    sg->symsize = symsize;
+    
+    if (!x || !y || len <= 0) {
+        return RETURN_SUCCESS;
+    }
+    n = len;
+    
+    sg->vps = xmalloc(n*sizeof(VPoint));
+    if (!sg->vps || Wcols2Vpoints(pset, x, y, n, sg->vps) != RETURN_SUCCESS) {
+        set_grid_free(sg);
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0, m = 0; i < n; i++) {
+        VPoint *vp = &sg->vps[i];
+        if (!VPOINT_IS_FINITE(*vp)) {
+            continue;
+        }
+        if (m == 0) {
+            sg->bbox.xv1 = sg->bbox.xv2 = vp->x;
+            sg->bbox.yv1 = sg->bbox.yv2 = vp->y;
+        } else {
+            sg->bbox.xv1 = MIN2(sg->bbox.xv1, vp->x);
+            sg->bbox.xv2 = MAX2(sg->bbox.xv2, vp->x);
+            sg->bbox.yv1 = MIN2(sg->bbox.yv1, vp->y);
+            sg->bbox.yv2 = MAX2(sg->bbox.yv2, vp->y);
+        }
+        m++;
+    }
+    if (m == 0) {
+        return RETURN_SUCCESS;
+    }
+    
+    /* about two points per cell, but no cells smaller than a symbol */
+    g = MIN2(MAX2((unsigned int) sqrt(m/2.0), 1), SET_GRID_MAX);
+    sg->cx = MAX2((sg->bbox.xv2 - sg->bbox.xv1)/g, symsize);
+    sg->cy = MAX2((sg->bbox.yv2 - sg->bbox.yv1)/g, symsize);
+    if (sg->cx <= 0.0) {
+        sg->cx = 1.0;
+    }
+    if (sg->cy <= 0.0) {
+        sg->cy = 1.0;
+    }
+    sg->nx = MIN2((unsigned int) ((sg->bbox.xv2 - sg->bbox.xv1)/sg->cx), g) + 1;
+    sg->ny = MIN2((unsigned int) ((sg->bbox.yv2 - sg->bbox.yv1)/sg->cy), g) + 1;
+    ncells = sg->nx*sg->ny;
+    
+    sg->cells = xcalloc(ncells + 1, SIZEOF_INT);
+    sg->inds  = xmalloc(m*SIZEOF_INT);
+    if (!sg->cells || !sg->inds) {
+        set_grid_free(sg);
+        return RETURN_FAILURE;
+    }
+    
+    /* counting sort of the points by cell, keeping their order */
+    for (i = 0; i < n; i++) {
+        VPoint *vp = &sg->vps[i];
+        if (VPOINT_IS_FINITE(*vp)) {
+            k = set_grid_cell(vp->y, sg->bbox.yv1, sg->cy, sg->ny)*sg->nx +
+                set_grid_cell(vp->x, sg->bbox.xv1, sg->cx, sg->nx);
+            sg->cells[k + 1]++;
+        }
+    }
+    for (k = 0; k < ncells; k++) {
+        sg->cells[k + 1] += sg->cells[k];
+    }
+    for (i = 0; i < n; i++) {
+        VPoint *vp = &sg->vps[i];
+        if (VPOINT_IS_FINITE(*vp)) {
+            k = set_grid_cell(vp->y, sg->bbox.yv1, sg->cy, sg->ny)*sg->nx +
+                set_grid_cell(vp->x, sg->bbox.xv1, sg->cx, sg->nx);
+            sg->inds[sg->cells[k]++] = i;
+        }
+    }
+    /* the fill loop has shifted each start to the next cell */
+    for (k = ncells; k > 0; k--) {
+        sg->cells[k] = sg->cells[k - 1];
+    }
+    sg->cells[0] = 0;
+    
+    return RETURN_SUCCESS;
+}
+
+/* find the index of the last point whose symbol covers vp, or -1 */
+static int set_grid_find(const SetGrid *sg, const VPoint *vp, view *v)
+{
+    double s = sg->symsize;
+    unsigned int ix1, ix2, iy1, iy2, ix, iy, j;
+    int found = -1;
+    
+    if (!sg->nx ||
+        vp->x < sg->bbox.xv1 - s || vp->x > sg->bbox.xv2 + s ||
+        vp->y < sg->bbox.yv1 - s || vp->y > sg->bbox.yv2 + s) {
+        return -1;
+    }
+    
+    ix1 = set_grid_cell(vp->x - s, sg->bbox.xv1, sg->cx, sg->nx);
+    ix2 = set_grid_cell(vp->x + s, sg->bbox.xv1, sg->cx, sg->nx);
+    iy1 = set_grid_cell(vp->y - s, sg->bbox.yv1, sg->cy, sg->ny);
+    iy2 = set_grid_cell(vp->y + s, sg->bbox.yv1, sg->cy, sg->ny);
+    
+    for (iy = iy1; iy <= iy2; iy++) {
+        for (ix = ix1; ix <= ix2; ix++) {
+            unsigned int k = iy*sg->nx + ix;
+            for (j = sg->cells[k]; j < sg->cells[k + 1]; j++) {
+                unsigned int i = sg->inds[j];
+                view vi;
+                if ((int) i <= found) {
+                    continue;
+                }
+                vi.xv1 = vi.xv2 = sg->vps[i].x;
+                vi.yv1 = vi.yv2 = sg->vps[i].y;
+                view_extend(&vi, s);
+                if (is_vpoint_inside(&vi, vp, 0.0)) {
+                    found = i;
+                    *v = vi;
+                }
+            }
+        }
+    }
+    
+    return found;
+}
+
+/* drop the indices if the project has changed since they were built */
+static void set_grids_validate(Quark *project)
+{
+    unsigned int i, stamp = quark_get_statestamp(project);
+    
+    if (set_grids.project != project || set_grids.stamp != stamp) {
+        for (i = 0; i < set_grids.ngrids; i++) {
+            set_grid_free(&set_grids.grids[i]);
+        }
+        set_grids.project = project;
+        set_grids.stamp   = stamp;
+    }
+}
+
+/*
+ * the index of the nsets-th set of the traversal; as long as the project
+ * stays the same, so does the traversal order
+ */
+static SetGrid *set_grid_get(canvas_target *ct, Quark *pset, double symsize)
+{
+    unsigned int k = ct->nsets++;
+    SetGrid *sg;
+    
+    if (k >= set_grids.ngrids) {
+        SetGrid *p = xrealloc(set_grids.grids, (k + 1)*sizeof(SetGrid));
+        if (!p) {
+            return NULL;
+        }
+        memset(p + set_grids.ngrids, 0,
+            (k + 1 - set_grids.ngrids)*sizeof(SetGrid));
+        set_grids.grids  = p;
+        set_grids.ngrids = k + 1;
+    }
+    
+    sg = &set_grids.grids[k];
+    if (sg->pset != pset || sg->symsize != symsize) {
+        set_grid_free(sg);
+        if (set_grid_build(sg, pset, symsize) != RETURN_SUCCESS) {
+            return NULL;
+        }
+    }
+    
+    return sg;
+}
+
 static void target_consider(canvas_target *ct, Quark *q, int part,
     const view *v)
 {
@@ -124,7 +350,6 @@ static int target_hook(Quark *q, void *udata, QTraverseClosure *closure)
     view v;
     AText *at;
     DObject *o;
-    double *x, *y;
     
     if (!quark_is_active(q)) {
         closure->descend = FALSE;
@@ -189,21 +414,12 @@ static int target_hook(Quark *q, void *udata, QTraverseClosure *closure)
         target_consider(ct, q, 0, &o->bb);
         break;
     case QFlavorSet:
-        x = set_get_col(q, DATA_X);
-        y = set_get_col(q, DATA_Y);
-        if (x && y) {
-            int i;
-            WPoint wp;
-            VPoint vp;
+        {
             set *p = set_get_data(q);
             double symsize = MAX2(0.01*p->sym.size, 0.005);
-            for (i = 0; i < set_get_length(q); i++) {
-                wp.x = x[i];
-                wp.y = y[i];
-                Wpoint2Vpoint(q, &wp, &vp);
-                v.xv1 = v.xv2 = vp.x;
-                v.yv1 = v.yv2 = vp.y;
-                view_extend(&v, symsize);
+            SetGrid *sg = set_grid_get(ct, q, symsize);
+            int i;
+            if (sg && (i = set_grid_find(sg, &ct->vp, &v)) >= 0) {
                 target_consider(ct, q, i, &v);
             }
         }
@@ -216,6 +432,8 @@ static int target_hook(Quark *q, void *udata, QTraverseClosure *closure)
 static int find_target(GProject *gp, canvas_target *ct)
 {
     ct->found = FALSE;
+    ct->nsets = 0;
+    set_grids_validate(gproject_get_top(gp));
     quark_traverse(gproject_get_top(gp), target_hook, ct);
 
     return ct->found ? RETURN_SUCCESS:RETURN_FAILURE;
@@ -893,7 +1111,7 @@ void update_locator_lab(Quark *cg, VPoint *vpp)
         is_vpoint_inside(&v, &vp, 0.0) == TRUE       &&
         (locator = graph_get_locator(cg)) != NULL    &&
         locator->type != GLOCATOR_TYPE_NONE) {
-        char bufx[64], bufy[64], *s, *prefix, *sx, *sy;
+        char bufx[MAX_STRING_LENGTH], bufy[MAX_STRING_LENGTH], *prefix, *sx, *sy;
         WPoint wp;
         double wx, wy, xtmp, ytmp;
 
@@ -924,12 +1142,10 @@ void update_locator_lab(Quark *cg, VPoint *vpp)
         default:
             return;
         }
-        s = create_fstring(get_parent_project(cg),
-            &locator->fx, xtmp, LFORMAT_TYPE_PLAIN);
-        strcpy(bufx, s);
-        s = create_fstring(get_parent_project(cg),
-            &locator->fy, ytmp, LFORMAT_TYPE_PLAIN);
-        strcpy(bufy, s);
+        create_fstring(get_parent_project(cg),
+            &locator->fx, xtmp, LFORMAT_TYPE_PLAIN, bufx);
+        create_fstring(get_parent_project(cg),
+            &locator->fy, ytmp, LFORMAT_TYPE_PLAIN, bufy);
 
         sprintf(buf, "%s: %s%s, %s%s = (%s, %s)", QIDSTR(cg),
             prefix, sx, prefix, sy, bufx, bufy);
@@ -525,9 +525,14 @@ static int explorer_cb(Quark *q, int etype, void *udata)
 
         explorer_restore_quark_state(eui);
         break;
+    case QUARK_ETYPE_COMMIT:
+        break;
     }
 
-    TreeRefresh(eui->tree);
+    /* within a transaction, redraw once the whole change set is in */
+    if (etype == QUARK_ETYPE_COMMIT || !quark_transaction_active()) {
+        TreeRefresh(eui->tree);
+    }
 
     return TRUE;
 }
@@ -82,6 +82,11 @@ typedef struct {
     Widget          delete_btn;
 
     int             cb_column;
+    
+    Quark           *pr;        /* resolved once per update */
+    unsigned int    prec;
+    int             nrow_labels;
+    struct _SSDCellCache *cache;
 } SSDataUI;
 
 typedef struct {
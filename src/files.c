@@ -48,6 +48,10 @@
 #ifdef HAVE_FCNTL_H
 #  include <fcntl.h>
 #endif
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#  include <sys/mman.h>
+#  define USE_MAPPED_READ
+#endif
 
 #include "graceapp.h"
 #include "utils.h"
@@ -73,11 +77,31 @@
 #endif
 #define CHUNKSIZE 2*PIPE_BUF
 
+/*
+ * binary append frames on real-time inputs:
+ *   byte  0     RTI_FRAME_MARKER
+ *   byte  1     length L of the target set identifier
+ *   bytes 2-3   number of values per row (little-endian)
+ *   bytes 4-7   number of rows (little-endian)
+ *   bytes 8-    the identifier (L bytes, dot-separated idstr path),
+ *               followed by the rows as doubles in the host byte order
+ * the limits below are mirrored by GRACE_APPEND_MAX_COLS/FRAME in grace_np.h
+ */
+#define RTI_FRAME_MARKER '\001'
+#define RTI_FRAME_HEADER 8
+#define RTI_FRAME_MAX    (16*1024*1024)
+
+/*
+ * number of bytes of a memory-mapped data block parsed as a unit of work
+ */
+#define ROWCHUNK_SIZE (1 << 20)
+
 char *close_input;		/* name of real-time input to close */
 
 struct timeval read_begin = {0l, 0l};	/* used to check too long inputs */
 
-static Input_buffer dummy_ib = {-1, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0l};
+static Input_buffer dummy_ib =
+    {-1, 0, 0, 0, 0, 0, NULL, 0, 0, NULL, 0l, NULL, 0, 0, 0, NULL, FALSE};
 
 int nb_rt = 0;		        /* number of real time file descriptors */
 Input_buffer *ib_tbl = 0;	/* table for each open input */
@@ -89,6 +113,7 @@ static int expand_line_buffer(char **adrBuf, int *ptrSize, char **adrPtr);
 static int reopen_real_time_input(GraceApp *gr, Input_buffer *ib);
 static int read_real_time_lines(Input_buffer *ib);
 static int process_complete_lines(GraceApp *gapp, Input_buffer *ib);
+static int flush_binary_rows(GraceApp *gapp, Input_buffer *ib);
 
 static int read_long_line(FILE *fp, char **linebuf, int *buflen);
 
@@ -144,7 +169,7 @@ static int expand_line_buffer(char **adrBuf, int *ptrSize, char **adrPtr)
     char *newbuf;
     int   newsize;
 
-    newsize = *ptrSize + CHUNKSIZE;
+    newsize = (*ptrSize < CHUNKSIZE) ? *ptrSize + CHUNKSIZE : 2*(*ptrSize);
     newbuf = xmalloc(newsize);
     if (newbuf == 0) {
         return RETURN_FAILURE;
@@ -157,7 +182,7 @@ static int expand_line_buffer(char **adrBuf, int *ptrSize, char **adrPtr)
         }
     } else {
         /* we are expanding an existing line */
-        strncpy(newbuf, *adrBuf, *ptrSize);
+        memcpy(newbuf, *adrBuf, *ptrSize);
         if (adrPtr) {
             *adrPtr += newbuf - *adrBuf;
         }
@@ -233,6 +258,10 @@ void unregister_real_time_input(const char *name)
             ib->fd = -1;
             xfree(ib->name);
             ib->name = NULL;
+            XCFREE(ib->target);
+            XCFREE(ib->pending);
+            ib->nrows  = 0;
+            ib->nalloc = 0;
         } else 
         if (l2 > 0) {
             /* this descriptor (if not dummy!) is still in use */
@@ -298,6 +327,7 @@ int register_real_time_input(GraceApp *gapp, int fd, const char *name, int reope
     ib->reopen = reopen;
     ib->name   = copy_string(ib->name, name);
     ib->used   = 0;
+    ib->resync = FALSE;
 #ifndef NONE_GUI
     xregister_rti (ib);
 #endif
@@ -351,91 +381,251 @@ static int read_real_time_lines(Input_buffer *ib)
 
 
 /*
- * process complete lines that have already been read
+ * length of a complete binary frame, 0 if more data are needed or -1 if
+ * the header is invalid
+ */
+static long binary_frame_length(const char *s, long len)
+{
+    const unsigned char *h = (const unsigned char *) s;
+    unsigned long ncols, nrows, flen;
+    
+    if (len < RTI_FRAME_HEADER) {
+        return 0;
+    }
+    
+    ncols = h[2] | (h[3] << 8);
+    nrows = h[4] | (h[5] << 8) | (h[6] << 16) | ((unsigned long) h[7] << 24);
+    if (h[1] == 0 || ncols == 0 || ncols > MAX_SET_COLS ||
+        nrows > RTI_FRAME_MAX/(ncols*SIZEOF_DOUBLE)) {
+        return -1;
+    }
+    
+    flen = RTI_FRAME_HEADER + h[1] + nrows*ncols*SIZEOF_DOUBLE;
+    
+    return (len < (long) flen) ? 0 : (long) flen;
+}
+
+/*
+ * find a set given a dot-separated path of idstr's
+ */
+static Quark *find_binary_target(Quark *project, const char *path)
+{
+    Quark *q = project;
+    char *s, *token;
+    
+    s = copy_string(NULL, path);
+    token = strtok(s, ".");
+    while (q && token) {
+        q = quark_find_descendant_by_idstr(q, token);
+        token = strtok(NULL, ".");
+    }
+    xfree(s);
+    
+    if (q && quark_fid_get(q) == QFlavorSet) {
+        return q;
+    } else {
+        return NULL;
+    }
+}
+
+/*
+ * append the rows queued by binary frames to their target set
+ */
+static int flush_binary_rows(GraceApp *gapp, Input_buffer *ib)
+{
+    Quark *pset;
+    char buf[256];
+    int retval;
+    
+    if (ib->nrows == 0) {
+        return RETURN_SUCCESS;
+    }
+    
+    pset = find_binary_target(gproject_get_top(gapp->gp), ib->target);
+    if (!pset) {
+        sprintf(buf, "%s : no set \"%.64s\" to append data to",
+                ib->name, ib->target);
+        errmsg(buf);
+        retval = RETURN_FAILURE;
+    } else {
+        retval = set_append_rows(pset, ib->ncols, ib->nrows, ib->pending);
+    }
+    ib->nrows = 0;
+    
+    return retval;
+}
+
+/*
+ * queue the rows of a complete binary frame; consecutive frames for the
+ * same target are appended at once
+ */
+static int queue_binary_frame(GraceApp *gapp, Input_buffer *ib,
+    const char *frame)
+{
+    const unsigned char *h = (const unsigned char *) frame;
+    const char *id = frame + RTI_FRAME_HEADER;
+    unsigned int idlen, ncols, nrows, nvalues;
+    int retval = RETURN_SUCCESS;
+    
+    idlen = h[1];
+    ncols = h[2] | (h[3] << 8);
+    nrows = h[4] | (h[5] << 8) | (h[6] << 16) | ((unsigned int) h[7] << 24);
+    
+    if (ib->nrows && (ib->ncols != ncols || strlen(ib->target) != idlen ||
+                      strncmp(ib->target, id, idlen))) {
+        retval = flush_binary_rows(gapp, ib);
+    }
+    
+    if (ib->nrows == 0) {
+        ib->target = xrealloc(ib->target, idlen + 1);
+        if (!ib->target) {
+            return RETURN_FAILURE;
+        }
+        memcpy(ib->target, id, idlen);
+        ib->target[idlen] = '\0';
+        ib->ncols = ncols;
+    }
+    
+    nvalues = (ib->nrows + nrows)*ncols;
+    if (nvalues > ib->nalloc) {
+        unsigned int nalloc = MAX2(nvalues, 2*ib->nalloc);
+        double *p = xrealloc(ib->pending, nalloc*SIZEOF_DOUBLE);
+        if (!p) {
+            return RETURN_FAILURE;
+        }
+        ib->pending = p;
+        ib->nalloc  = nalloc;
+    }
+    memcpy(ib->pending + ib->nrows*ncols, id + idlen,
+        nrows*ncols*SIZEOF_DOUBLE);
+    ib->nrows += nrows;
+    
+    return retval;
+}
+
+/*
+ * process complete lines and binary frames that have already been read
  */
 static int process_complete_lines(GraceApp *gapp, Input_buffer *ib)
 {
-    int line_corrupted;
-    char *begin_of_line, *end_of_line;
+    int line_corrupted, retval;
+    char *begin_of_line, *end_of_line, *end_of_data;
     char buf[256];
 
     if (ib->used <= 0) {
         return RETURN_SUCCESS;
     }
 
-    end_of_line = NULL;
-    do {
-        /* loop over the embedded lines */
-        begin_of_line  = (end_of_line == NULL) ? ib->buf : (end_of_line + 1);
-        end_of_line    = begin_of_line;
-        line_corrupted = 0;
-        while (end_of_line != NULL && *end_of_line != '\n') {
-            /* trying to find a complete line */
-            if (end_of_line == ib->buf + ib->used) {
-                end_of_line = NULL;
+    begin_of_line = ib->buf;
+    end_of_data   = ib->buf + ib->used;
+    while (begin_of_line < end_of_data) {
+        if (ib->resync) {
+            /* the rest of a frame with a bad header; its length is unknown,
+               so everything up to the next newline is dropped */
+            end_of_line = memchr(begin_of_line, '\n',
+                end_of_data - begin_of_line);
+            if (end_of_line == NULL) {
+                begin_of_line = end_of_data;
+                break;
+            }
+            ib->resync = FALSE;
+            begin_of_line = end_of_line + 1;
+            continue;
+        }
+        
+        if (*begin_of_line == RTI_FRAME_MARKER) {
+            /* a binary frame */
+            long flen = binary_frame_length(begin_of_line,
+                end_of_data - begin_of_line);
+            if (flen == 0) {
+                /* wait for the rest of it */
+                break;
+            }
+
+            ++(ib->lineno);
+            close_input = NULL;
+            
+            if (flen < 0) {
+                /* don't parse the raw values as text */
+                ib->resync = TRUE;
+                end_of_line = begin_of_line;
+                retval = RETURN_FAILURE;
             } else {
+                end_of_line = begin_of_line + flen - 1;
+                retval = queue_binary_frame(gapp, ib, begin_of_line);
+            }
+        } else {
+            /* trying to find a complete line */
+            end_of_line    = begin_of_line;
+            line_corrupted = 0;
+            while (end_of_line < end_of_data && *end_of_line != '\n') {
                 if (*end_of_line == '\0') {
                     line_corrupted = 1;
                 }
                 ++end_of_line;
             }
-        }
+            if (end_of_line == end_of_data) {
+                break;
+            }
 
-        if (end_of_line != NULL) {
             /* we have a whole line */
-
             ++(ib->lineno);
             *end_of_line = '\0';
             close_input = NULL;
 
+            /* commands must see the data sent before them */
+            flush_binary_rows(gapp, ib);
+            
             if (line_corrupted ||
                 graal_parse_line(grace_get_graal(gapp->grace),
                     begin_of_line, gproject_get_top(gapp->gp)) != RETURN_SUCCESS) {
-                sprintf(buf, "Error at line %d", ib->lineno);
-                errmsg(buf);
-                ++(ib->errors);
-                if (ib->errors > MAXERR) {
+                retval = RETURN_FAILURE;
+            } else {
+                retval = RETURN_SUCCESS;
+            }
+        }
+        
+        if (retval != RETURN_SUCCESS) {
+            sprintf(buf, "Error at line %d", ib->lineno);
+            errmsg(buf);
+            ++(ib->errors);
+            if (ib->errors > MAXERR) {
 
 #ifndef NONE_GUI
-                    /* this prevents from being called recursively by
-                       the inner X loop of yesno */
-                    xunregister_rti(ib);
+                /* this prevents from being called recursively by
+                   the inner X loop of yesno */
+                xunregister_rti(ib);
 #endif
-                    if (yesno("Lots of errors, abort?", NULL, NULL, NULL)) {
-                        close_input = copy_string(close_input, "");
-                    }
+                if (gapp_yesno(gapp, "Lots of errors, abort?",
+                    NULL, NULL, NULL)) {
+                    close_input = copy_string(close_input, "");
+                }
 #ifndef NONE_GUI
-                    xregister_rti(ib);
+                xregister_rti(ib);
 #endif
-                    ib->errors = 0;
+                ib->errors = 0;
 
-                }
             }
+        }
 
-            if (close_input != NULL) {
-                /* something should be closed */
-                if (close_input[0] == '\0') {
-                    unregister_real_time_input(ib->name);
-                } else {
-                    unregister_real_time_input(close_input);
-                }
-
-                xfree(close_input);
-                close_input = NULL;
+        if (close_input != NULL) {
+            /* something should be closed */
+            if (close_input[0] == '\0') {
+                unregister_real_time_input(ib->name);
+            } else {
+                unregister_real_time_input(close_input);
+            }
 
-                if (ib->fd < 0) {
-                    /* we have closed ourselves */
-                    return RETURN_SUCCESS;
-                }
+            xfree(close_input);
+            close_input = NULL;
 
+            if (ib->fd < 0) {
+                /* we have closed ourselves */
+                return RETURN_SUCCESS;
             }
 
         }
 
-    } while (end_of_line != NULL);
-
-    if (end_of_line != NULL) {
-        /* the line has just been processed */
         begin_of_line = end_of_line + 1;
     }
 
@@ -466,7 +656,7 @@ int monitor_input(GraceApp *gapp, Input_buffer *tbl, int tblsize, int no_wait)
     fd_set rfds;
     int remaining;
     struct timeval timeout;
-    int highest, first_time, retsel;
+    int highest, first_time, retsel, retval;
 
     /* we don't want to get stuck here, we memorize the start date
        and will check we do not exceed our allowed time slice */
@@ -511,8 +701,17 @@ int monitor_input(GraceApp *gapp, Input_buffer *tbl, int tblsize, int no_wait)
              ib++) {
             if (ib->fd >= 0 && FD_ISSET(ib->fd, &rfds)) {
                 /* there is pending input */
-                if (read_real_time_lines(ib) != RETURN_SUCCESS
-                    || process_complete_lines(gapp, ib) != RETURN_SUCCESS) {
+                if (read_real_time_lines(ib) != RETURN_SUCCESS) {
+                    flush_binary_rows(gapp, ib);
+                    return RETURN_FAILURE;
+                }
+
+                /* a batch of script lines is reported as one change */
+                quark_transaction_begin();
+                retval = process_complete_lines(gapp, ib);
+                quark_transaction_commit();
+                if (retval != RETURN_SUCCESS) {
+                    flush_binary_rows(gapp, ib);
                     return RETURN_FAILURE;
                 }
 
@@ -520,6 +719,7 @@ int monitor_input(GraceApp *gapp, Input_buffer *tbl, int tblsize, int no_wait)
                     /* we were told five times something happened, but
                        never got any byte : we assume the pipe (or
                        whatever) has been closed by the peer */
+                    flush_binary_rows(gapp, ib);
                     if (ib->reopen) {
                         /* we should reset the input buffer, in case
                            the peer also reopens it */
@@ -540,6 +740,13 @@ int monitor_input(GraceApp *gapp, Input_buffer *tbl, int tblsize, int no_wait)
         first_time = 0;
     }
 
+    /* binary rows are appended once per time slice */
+    for (ib = tbl; ib < tbl + tblsize; ib++) {
+        if (ib->fd >= 0) {
+            flush_binary_rows(gapp, ib);
+        }
+    }
+
     return RETURN_SUCCESS;
 #else
     return RETURN_FAILURE;
@@ -606,7 +813,7 @@ FILE *gapp_openw(GraceApp *gapp, const char *fn)
             /* check to make sure this is a file and not a dir */
             if (S_ISREG(statb.st_mode)) {
 	        sprintf(buf, "Overwrite %s?", fn);
-	        if (!yesno(buf, NULL, NULL, NULL)) {
+	        if (!gapp_yesno(gapp, buf, NULL, NULL, NULL)) {
 	            return NULL;
 	        }
             } else {
@@ -737,6 +944,354 @@ FILE *gapp_tmpfile(char *templateval)
 }
 
 
+#ifdef USE_MAPPED_READ
+/* types of lines in a data file */
+#define LINE_DATA       0
+#define LINE_COMMENT    1
+#define LINE_EMPTY      2
+
+/* a newline-aligned piece of a data block */
+typedef struct {
+    const char *start;          /* beginning of the first line */
+    const char *end;            /* past the end of the last line */
+    unsigned int row;           /* SSD row of the first data line */
+    unsigned int line;          /* number of file lines preceding the chunk */
+    unsigned int nbad;          /* number of data lines failed to parse */
+    unsigned int *badrows;      /* their SSD rows... */
+    unsigned int *badlines;     /* ...and file line numbers */
+} RowChunk;
+
+typedef struct {
+    const DataRowParser *rp;
+    unsigned int nchunks;
+    RowChunk *chunks;
+} RowChunkJobs;
+
+static const char *next_line(const char *s, const char *end)
+{
+    const char *eol = memchr(s, '\n', end - s);
+    
+    return eol ? eol + 1 : end;
+}
+
+static int get_line_type(const char *s, const char *eol)
+{
+    /* skip leading whitespaces */
+    while (s < eol && (*s == ' ' || *s == '\t')) {
+        s++;
+    }
+    
+    if (s == eol || *s == '\n' || *s == '\0' ||
+        (*s == '\r' && (s + 1 == eol || *(s + 1) == '\n'))) {
+        return LINE_EMPTY;
+    } else
+    if (*s == '#') {
+        return LINE_COMMENT;
+    } else {
+        return LINE_DATA;
+    }
+}
+
+/*
+ * make a '\n'-terminated C string of a mapped line, the way read_long_line()
+ * would return it
+ */
+static char *copy_line(const char *s, const char *eol,
+    char **linebuf, unsigned int *buflen)
+{
+    unsigned int len = eol - s;
+    
+    if (len && s[len - 1] == '\n') {
+        len--;
+    }
+    if (len && s[len - 1] == '\r') {
+        len--;
+    }
+    
+    if (len + 2 > *buflen) {
+        char *buf = xrealloc(*linebuf, len + 2);
+        if (!buf) {
+            return NULL;
+        }
+        *linebuf = buf;
+        *buflen = len + 2;
+    }
+    memcpy(*linebuf, s, len);
+    (*linebuf)[len]     = '\n';
+    (*linebuf)[len + 1] = '\0';
+    
+    return *linebuf;
+}
+
+static int chunk_add_bad_row(RowChunk *rc, unsigned int row, unsigned int line)
+{
+    if (rc->nbad % 16 == 0) {
+        unsigned int *p;
+        p = xrealloc(rc->badrows, (rc->nbad + 16)*SIZEOF_INT);
+        if (!p) {
+            return RETURN_FAILURE;
+        }
+        rc->badrows = p;
+        p = xrealloc(rc->badlines, (rc->nbad + 16)*SIZEOF_INT);
+        if (!p) {
+            return RETURN_FAILURE;
+        }
+        rc->badlines = p;
+    }
+    rc->badrows[rc->nbad]  = row;
+    rc->badlines[rc->nbad] = line;
+    rc->nbad++;
+    
+    return RETURN_SUCCESS;
+}
+
+/* parallel worker: parse every njobs-th chunk starting from the job-th */
+static void parse_row_chunks(unsigned int job, unsigned int njobs, void *udata)
+{
+    RowChunkJobs *jobs = (RowChunkJobs *) udata;
+    char *linebuf = NULL;
+    unsigned int buflen = 0, ic;
+    
+    for (ic = job; ic < jobs->nchunks; ic += njobs) {
+        RowChunk *rc = &jobs->chunks[ic];
+        const char *s = rc->start;
+        unsigned int row = rc->row, line = rc->line;
+        
+        while (s < rc->end) {
+            const char *eol = next_line(s, rc->end);
+            
+            line++;
+            if (get_line_type(s, eol) == LINE_DATA) {
+                char *buf = copy_line(s, eol, &linebuf, &buflen);
+                if (!buf ||
+                    data_row_parser_insert(jobs->rp, row, buf) != RETURN_SUCCESS) {
+                    chunk_add_bad_row(rc, row, line);
+                }
+                row++;
+            }
+            s = eol;
+        }
+    }
+    
+    xfree(linebuf);
+}
+
+/*
+ * remove rows failed to parse (given in ascending order) from an SSD
+ */
+static void ssd_squeeze_rows(Quark *q, unsigned int nrows,
+    const RowChunk *chunks, unsigned int nchunks)
+{
+    ss_data *ssd = ssd_get_data(q);
+    AMem *amem = quark_get_amem(q);
+    unsigned int i;
+    
+    for (i = 0; i < ssd->ncols; i++) {
+        ss_column *col = &ssd->cols[i];
+        unsigned int ic, ib, r, w = 0, from = 0;
+        
+        for (ic = 0; ic < nchunks; ic++) {
+            const RowChunk *rc = &chunks[ic];
+            for (ib = 0; ib < rc->nbad; ib++) {
+                unsigned int bad = rc->badrows[ib];
+                if (col->format == FFORMAT_STRING) {
+                    char **sp = (char **) col->data;
+                    for (r = from; r < bad; r++) {
+                        sp[w++] = sp[r];
+                    }
+                    AMEM_CFREE(amem, sp[bad]);
+                } else {
+                    double *dp = (double *) col->data;
+                    memmove(dp + w, dp + from, (bad - from)*SIZEOF_DOUBLE);
+                    w += bad - from;
+                }
+                from = bad + 1;
+            }
+        }
+        
+        if (col->format == FFORMAT_STRING) {
+            char **sp = (char **) col->data;
+            for (r = from; r < nrows; r++) {
+                sp[w++] = sp[r];
+            }
+            /* the tail is to be truncated; don't let it free moved strings */
+            for (r = w; r < nrows; r++) {
+                sp[r] = NULL;
+            }
+        } else {
+            double *dp = (double *) col->data;
+            memmove(dp + w, dp + from, (nrows - from)*SIZEOF_DOUBLE);
+        }
+    }
+}
+
+/*
+ * read a memory-mapped data file. Blocks of data are delimited the same way
+ * as in uniread(); the rows of each block are counted up front, so the SSD
+ * is allocated only once, and are then parsed in parallel whenever the
+ * column formats (decided by the first row) permit it
+ */
+static int uniread_mapped(Quark *pr, const char *buf, size_t len,
+    DataStore store_cb, void *udata)
+{
+    const char *s = buf, *end = buf + len;
+    unsigned int linecount = 0;
+    char *linebuf = NULL;
+    unsigned int linebuflen = 0;
+    
+    while (s < end) {
+        const char *eol, *bstart, *cstart;
+        unsigned int nrows, nchunks, nbad, ic, ib, njobs;
+        int nncols, nscols, *formats, readerror, aborted;
+        RowChunk *chunks = NULL;
+        RowChunkJobs jobs;
+        DataRowParser rp;
+        Quark *q;
+        
+        /* find the first data line of the next block */
+        eol = next_line(s, end);
+        if (get_line_type(s, eol) != LINE_DATA) {
+            linecount++;
+            s = eol;
+            continue;
+        }
+        
+        /* decide the column formats */
+        if (!copy_line(s, eol, &linebuf, &linebuflen) ||
+            parse_ss_row(pr, linebuf, &nncols, &nscols, &formats) !=
+                RETURN_SUCCESS) {
+	    errmsg("Can't parse data");
+	    xfree(linebuf);
+	    return RETURN_FAILURE;
+        }
+        
+        /* find the extent of the block, cutting it into chunks */
+        bstart = cstart = s;
+        nrows = 0;
+        nchunks = 0;
+        while (s < end) {
+            int ltype;
+            eol = next_line(s, end);
+            ltype = get_line_type(s, eol);
+            if (ltype == LINE_EMPTY) {
+                break;
+            }
+            if (s - cstart >= ROWCHUNK_SIZE || s == bstart) {
+                if (nchunks % 64 == 0) {
+                    RowChunk *p = xrealloc(chunks,
+                        (nchunks + 64)*sizeof(RowChunk));
+                    if (!p) {
+                        xfree(chunks);
+                        xfree(formats);
+                        xfree(linebuf);
+                        return RETURN_FAILURE;
+                    }
+                    chunks = p;
+                }
+                if (nchunks) {
+                    chunks[nchunks - 1].end = s;
+                }
+                memset(&chunks[nchunks], 0, sizeof(RowChunk));
+                chunks[nchunks].start = s;
+                chunks[nchunks].row   = nrows;
+                chunks[nchunks].line  = linecount;
+                nchunks++;
+                cstart = s;
+            }
+            if (ltype == LINE_DATA) {
+                nrows++;
+            }
+            linecount++;
+            s = eol;
+        }
+        chunks[nchunks - 1].end = s;
+        
+        /* init the SSD */
+        q = gapp_ssd_new(pr);
+        if (!q || ssd_set_ncols(q, nncols + nscols, formats) != RETURN_SUCCESS ||
+            ssd_set_nrows(q, nrows) != RETURN_SUCCESS ||
+            data_row_parser_init(q, &rp) != RETURN_SUCCESS) {
+	    errmsg("Malloc failed in uniread()");
+	    quark_free(q);
+            xfree(chunks);
+            xfree(formats);
+	    xfree(linebuf);
+            return RETURN_FAILURE;
+        }
+        xfree(formats);
+        
+        /* dates of a block are expected to be written uniformly */
+        data_row_parser_lock_dates(&rp, linebuf);
+        
+        /* parse the rows */
+        jobs.rp      = &rp;
+        jobs.nchunks = nchunks;
+        jobs.chunks  = chunks;
+        if (data_row_parser_is_reentrant(&rp)) {
+            njobs = MIN2(parallel_get_nthreads(), nchunks);
+        } else {
+            njobs = 1;
+        }
+        parallel_run(njobs, parse_row_chunks, &jobs);
+        
+        /* report the errors the way the line-by-line reader does */
+        nbad = 0;
+        readerror = 0;
+        aborted = FALSE;
+        for (ic = 0; ic < nchunks && !aborted; ic++) {
+            RowChunk *rc = &chunks[ic];
+            for (ib = 0; ib < rc->nbad; ib++) {
+                char tbuf[128];
+
+                sprintf(tbuf, "Error parsing line %d, skipped", rc->badlines[ib]);
+                errmsg(tbuf);
+                readerror++;
+                if (readerror > MAXERR) {
+                    if (gapp_yesno(gapp_from_quark(pr),
+                        "Lots of errors, abort?", NULL, NULL, NULL)) {
+                        aborted = TRUE;
+                        break;
+                    } else {
+                        readerror = 0;
+                    }
+                }
+            }
+            nbad += rc->nbad;
+        }
+        
+        if (!aborted && nbad) {
+            ssd_squeeze_rows(q, nrows, chunks, nchunks);
+            ssd_set_nrows(q, nrows - nbad);
+        }
+        
+        for (ic = 0; ic < nchunks; ic++) {
+            xfree(chunks[ic].badrows);
+            xfree(chunks[ic].badlines);
+        }
+        xfree(chunks);
+        
+        if (aborted) {
+            quark_free(q);
+            xfree(linebuf);
+            return RETURN_FAILURE;
+        } else if (nbad == nrows) {
+            /* nothing left */
+            quark_free(q);
+        } else
+        /* store accumulated data */
+        if (store_cb && store_cb(q, udata) != RETURN_SUCCESS) {
+	    quark_free(q);
+            xfree(linebuf);
+            return RETURN_FAILURE;
+        }
+    }
+    
+    xfree(linebuf);
+    
+    return RETURN_SUCCESS;
+}
+#endif
+
 int uniread(Quark *pr, FILE *fp,
     DataParser parse_cb, DataStore store_cb, void *udata)
 {
@@ -747,6 +1302,29 @@ int uniread(Quark *pr, FILE *fp,
     int linebuflen = 0;
     int linecount;
 
+#ifdef USE_MAPPED_READ
+    /* plain data in a regular file (not a pipe etc) can be mapped */
+    if (!parse_cb && ftell(fp) == 0) {
+        struct stat statb;
+        int fd = fileno(fp);
+        
+        if (fstat(fd, &statb) == 0 && S_ISREG(statb.st_mode) &&
+            statb.st_size > 0 && (size_t) statb.st_size == statb.st_size) {
+            size_t len = statb.st_size;
+            void *addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                int retval;
+#ifdef MADV_SEQUENTIAL
+                madvise(addr, len, MADV_SEQUENTIAL);
+#endif
+                retval = uniread_mapped(pr, addr, len, store_cb, udata);
+                munmap(addr, len);
+                return retval;
+            }
+        }
+    }
+#endif
+
     linecount = 0;
     readerror = 0;
     nrows = 0;
@@ -830,7 +1408,8 @@ int uniread(Quark *pr, FILE *fp,
                 errmsg(tbuf);
                 readerror++;
                 if (readerror > MAXERR) {
-                    if (yesno("Lots of errors, abort?", NULL, NULL, NULL)) {
+                    if (gapp_yesno(gapp_from_quark(pr),
+                        "Lots of errors, abort?", NULL, NULL, NULL)) {
                         quark_free(q);
 		        xfree(linebuf);
                         return RETURN_FAILURE;
@@ -898,6 +1477,8 @@ int getdata(Quark *gr, char *fn, int settype, int load_type)
     adata.load_type = load_type;
     adata.settype = settype;
     
+    quark_transaction_begin();
+    
     retval = uniread(gr, fp, NULL, store_cb, &adata);
 
     gapp_close(fp);
@@ -905,6 +1486,8 @@ int getdata(Quark *gr, char *fn, int settype, int load_type)
     if (load_type != LOAD_BLOCK) {
         autoscale_graph(gr, gapp->rt->autoscale_onread);
     }
+    
+    quark_transaction_commit();
 
     return retval;
 }
@@ -1018,7 +1601,7 @@ GProject *load_any_project(GraceApp *gapp, const char *fn)
     GProject *gp;
     
     /* FIXME: A temporary hack */
-    if (fn && strstr(fn, ".xgr")) {
+    if (fn && (strstr(fn, ".xgr") || strstr(fn, ".xgb"))) {
         gp = load_xgr_project(gapp, fn);
     } else {
         gp = load_agr_project(gapp, fn);
@@ -1171,6 +1754,27 @@ int new_project(GraceApp *gapp, char *pr_template)
 }
 
 
+/* whether the file is the mapped binary project backing an open project */
+static int file_is_mapped(const GraceApp *gapp, const char *fn)
+{
+    struct stat statb, mstatb;
+    unsigned int i;
+    
+    if (stat(fn, &statb) != 0) {
+        return FALSE;
+    }
+    
+    for (i = 0; i < gapp->gpcount; i++) {
+        const GProject *gp = gapp->gplist[i];
+        if (gp->map && gp->mapfile && stat(gp->mapfile, &mstatb) == 0 &&
+            mstatb.st_dev == statb.st_dev && mstatb.st_ino == statb.st_ino) {
+            return TRUE;
+        }
+    }
+    
+    return FALSE;
+}
+
 int save_project(GProject *gp, char *fn)
 {
     GrFILE *grf;
@@ -1189,7 +1793,8 @@ int save_project(GProject *gp, char *fn)
         return RETURN_FAILURE;
     }
     if (!save_unsupported &&
-        !yesno("The current format may be unsupported by the final release. Continue?",
+        !gapp_yesno(gapp_from_quark(project),
+            "The current format may be unsupported by the final release. Continue?",
             "Yeah, I'm brave!", NULL, "doc/UsersGuide.html#unsupported_format")) {
         return RETURN_FAILURE;
     }
@@ -1201,6 +1806,11 @@ int save_project(GProject *gp, char *fn)
         gui->noask = TRUE;
     }
     
+    if (file_is_mapped(gapp_from_quark(project), fn)) {
+        /* the file holds data not loaded yet; replace, don't truncate it */
+        unlink(fn);
+    }
+    
     grf = grfile_openw(fn);
     if (!grf) {
         return RETURN_FAILURE;
@@ -1208,7 +1818,11 @@ int save_project(GProject *gp, char *fn)
     
     gui->noask = noask_save;
 
-    retval = gproject_save(gp, grf);
+    if (strstr(fn, ".xgb")) {
+        retval = gproject_save_bin(gp, grf);
+    } else {
+        retval = gproject_save(gp, grf);
+    }
 
     grfile_free(grf);
     
@@ -1228,7 +1842,7 @@ GProject *load_xgr_project(GraceApp *gapp, const char *fn)
         return NULL;
     }
     
-    gp = gproject_load(gapp->pc, gapp->grace, grf, AMEM_MODEL_LIBUNDO);
+    gp = gproject_load(gapp->pc, gapp->grace, grf, AMEM_MODEL_COW);
 
     grfile_free(grf);
     
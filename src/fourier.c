@@ -34,6 +34,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "grace/baseP.h"
 #include "globals.h"
@@ -149,197 +150,562 @@ int fourier(double *jr, double *ji, int n, int iflag)
 
 #else
 
-/* Legacy FFT code */
+/* Built-in mixed-radix FFT */
 
-static int bit_swap(int i, int nu);
-static int ilog2(int n);
-static int dft(double *jr, double *ji, int n, int iflag);
-static int fft(double *jr, double *ji, int n, int nu, int iflag);
+/* radices with a dedicated kernel or worth the generic one */
+#define FFT_MAX_RADIX       7
 
-int fourier(double *jr, double *ji, int n, int iflag)
+/* max number of factors of a length */
+#define FFT_MAX_FACTORS     64
+
+/* number of cached plans */
+#define FFT_PLAN_CACHE_SIZE 8
+
+typedef struct _FFTPlan FFTPlan;
+
+/* everything depending on the length alone; plans are for the forward
+   transform, the inverse one is done by swapping the re/im parts */
+struct _FFTPlan {
+    int n;
+    
+    /* Stockham stages, n = factors[0]*factors[1]*... */
+    int nfactors;
+    int factors[FFT_MAX_FACTORS];
+    double *tw_re;          /* twiddles of all the stages */
+    double *tw_im;
+    
+    /* Bluestein's algorithm, if n has a prime factor > FFT_MAX_RADIX */
+    FFTPlan *conv;          /* plan of the (2^k) convolution length */
+    double *chirp_re;       /* exp(-i*pi*j^2/n) */
+    double *chirp_im;
+    double *kern_re;        /* FFT of the conjugate chirp, scaled by 1/m */
+    double *kern_im;
+    
+    /* real-input post-processing, exp(-2*pi*i*k/n), k < n/2; lazily */
+    double *rtw_re;
+    double *rtw_im;
+    
+    FFTPlan *next;
+};
+
+static FFTPlan *fft_plans = NULL;
+static int fft_nplans = 0;
+
+static void fft_plan_free(FFTPlan *p)
 {
-    int i2;
+    if (p) {
+        fft_plan_free(p->conv);
+        xfree(p->tw_re);
+        xfree(p->tw_im);
+        xfree(p->chirp_re);
+        xfree(p->chirp_im);
+        xfree(p->kern_re);
+        xfree(p->kern_im);
+        xfree(p->rtw_re);
+        xfree(p->rtw_im);
+        xfree(p);
+    }
+}
+
+static FFTPlan *fft_plan_new(int n);
+static int fft_exec(const FFTPlan *p, double *re, double *im);
+
+static int fft_plan_bluestein(FFTPlan *p)
+{
+    int n = p->n, m, j;
+    unsigned long j2, n2 = 2*(unsigned long) n;
     
-    if ((i2 = ilog2(n)) > 0) {
-	return fft(jr, ji, n, i2, iflag);
-    } else {
-	return dft(jr, ji, n, iflag);
+    m = 1;
+    while (m < 2*n - 1) {
+        m *= 2;
     }
+    
+    p->conv = fft_plan_new(m);
+    p->chirp_re = xmalloc(n*SIZEOF_DOUBLE);
+    p->chirp_im = xmalloc(n*SIZEOF_DOUBLE);
+    p->kern_re  = xcalloc(m, SIZEOF_DOUBLE);
+    p->kern_im  = xcalloc(m, SIZEOF_DOUBLE);
+    if (!p->conv || !p->chirp_re || !p->chirp_im ||
+        !p->kern_re || !p->kern_im) {
+        return RETURN_FAILURE;
+    }
+    
+    /* j^2 is taken modulo 2n to keep the angles accurate */
+    for (j = 0, j2 = 0; j < n; j++) {
+        double w = M_PI*j2/n;
+        
+        p->chirp_re[j] =  cos(w);
+        p->chirp_im[j] = -sin(w);
+        
+        p->kern_re[j] =  p->chirp_re[j]/m;
+        p->kern_im[j] = -p->chirp_im[j]/m;
+        if (j) {
+            p->kern_re[m - j] = p->kern_re[j];
+            p->kern_im[m - j] = p->kern_im[j];
+        }
+        
+        j2 = (j2 + 2*j + 1) % n2;
+    }
+    
+    return fft_exec(p->conv, p->kern_re, p->kern_im);
 }
 
-/*
-	DFT by definition
-*/
-static int dft(double *jr, double *ji, int n, int iflag)
+static FFTPlan *fft_plan_new(int n)
 {
-    int i, j, sgn;
-    double sumr, sumi, tpi, w, *xr, *xi, on = 1.0 / n;
-    double *cov, *siv, co, si;
-    int iwrap;
-
-    sgn = iflag ? 1:-1;
-    tpi = 2*M_PI;
-    xr  = xcalloc(n, SIZEOF_DOUBLE);
-    xi  = xcalloc(n, SIZEOF_DOUBLE);
-    cov = xcalloc(n, SIZEOF_DOUBLE);
-    siv = xcalloc(n, SIZEOF_DOUBLE);
-    if (xr == NULL || xi == NULL || cov == NULL || siv == NULL) {
-	xfree(xr);
-	xfree(xi);
-	xfree(cov);
-	xfree(siv);
-	return RETURN_FAILURE;
+    FFTPlan *p;
+    int nleft = n, ntw = 0, i, f;
+    
+    p = xmalloc(sizeof(FFTPlan));
+    if (!p) {
+        return NULL;
     }
-    for (i = 0; i < n; i++) {
-	w = i*tpi*on;
-	
-        cov[i] = cos(w);
-	siv[i] = sin(w)*sgn;
-	
-        xr[i]  = jr[i];
-	xi[i]  = ji[i];
+    memset(p, 0, sizeof(FFTPlan));
+    p->n = n;
+    
+    /* radix-4 stages first, they are the cheapest */
+    while (nleft % 4 == 0) {
+        p->factors[p->nfactors++] = 4;
+        nleft /= 4;
     }
-    for (j = 0; j < n; j++) {
-	sumr = 0.0;
-	sumi = 0.0;
-	for (i = 0, iwrap=0; i < n; i++, iwrap += j) {
-	    if (iwrap >= n) {
-                iwrap -= n;
+    for (f = 2; f <= FFT_MAX_RADIX && nleft > 1; f++) {
+        while (nleft % f == 0) {
+            p->factors[p->nfactors++] = f;
+            nleft /= f;
+        }
+    }
+    
+    if (nleft > 1) {
+        p->nfactors = 0;
+        if (fft_plan_bluestein(p) != RETURN_SUCCESS) {
+            fft_plan_free(p);
+            return NULL;
+        }
+        return p;
+    }
+    
+    /* twiddles w^(q*k), q < l/r, 0 < k < r; for each stage of length l */
+    nleft = n;
+    for (i = 0; i < p->nfactors; i++) {
+        ntw += (nleft/p->factors[i])*(p->factors[i] - 1);
+        nleft /= p->factors[i];
+    }
+    p->tw_re = xmalloc(MAX2(ntw, 1)*SIZEOF_DOUBLE);
+    p->tw_im = xmalloc(MAX2(ntw, 1)*SIZEOF_DOUBLE);
+    if (!p->tw_re || !p->tw_im) {
+        fft_plan_free(p);
+        return NULL;
+    }
+    
+    nleft = n;
+    ntw = 0;
+    for (i = 0; i < p->nfactors; i++) {
+        int r = p->factors[i], l = nleft/r, q, k;
+        for (q = 0; q < l; q++) {
+            for (k = 1; k < r; k++) {
+                double w = 2*M_PI*((double) q*k)/nleft;
+                p->tw_re[ntw] =  cos(w);
+                p->tw_im[ntw] = -sin(w);
+                ntw++;
             }
-	    co = cov[iwrap];
-	    si = siv[iwrap];
-	    sumr = sumr + xr[i]*co + sgn*xi[i]*si;
-	    sumi = sumi + xi[i]*co - sgn*xr[i]*si;
-	}
-	jr[j] = sumr;
-	ji[j] = sumi;
+        }
+        nleft = l;
     }
-
-    xfree(xr);
-    xfree(xi);
-    xfree(cov);
-    xfree(siv);
     
-    return RETURN_SUCCESS;
+    return p;
 }
 
-
-/*
-   real_data ... ptr. to real part of data to be transformed
-   imag_data ... ptr. to imag  "   "   "   "  "      "
-   inv ..... Switch to flag normal or inverse transform
-   n_pts ... Number of real data points
-   nu ...... logarithm in base 2 of n_pts e.g. nu = 5 if n_pts = 32.
-*/
-
-int fft(double *real_data, double *imag_data, int n_pts, int nu, int inv)
+/* fetch a plan from the cache, creating it if needed */
+static FFTPlan *fft_plan_get(int n)
 {
-    int n2, i, ib, mm, k;
-    int sgn, tstep;
-    double tr, ti, arg; /* intermediate values in calcs. */
-    double c, s;        /* cosine & sine components of Fourier trans. */
-    static double *sintab = NULL;
-    static int last_n = 0;
-
-    n2 = n_pts / 2;
-    
-    if (n_pts != last_n) { /* allocate new sin table */
-        arg = 2*M_PI/n_pts;
-        last_n = 0;
-        sintab = xrealloc(sintab, n_pts*SIZEOF_DOUBLE);
-        if (sintab == NULL) {
-            return RETURN_FAILURE;
+    FFTPlan *p = fft_plans, *prev = NULL;
+    
+    while (p) {
+        if (p->n == n) {
+            if (prev) {
+                prev->next = p->next;
+                p->next = fft_plans;
+                fft_plans = p;
+            }
+            return p;
         }
-        for (i = 0; i < n_pts; i++) {
-            sintab[i] = sin(arg*i);
+        prev = p;
+        p = p->next;
+    }
+    
+    p = fft_plan_new(n);
+    if (!p) {
+        return NULL;
+    }
+    p->next = fft_plans;
+    fft_plans = p;
+    fft_nplans++;
+    
+    if (fft_nplans > FFT_PLAN_CACHE_SIZE) {
+        prev = fft_plans;
+        while (prev->next->next) {
+            prev = prev->next;
         }
-        last_n = n_pts;
+        fft_plan_free(prev->next);
+        prev->next = NULL;
+        fft_nplans--;
     }
+    
+    return p;
+}
 
 /*
- * sign change for inverse transform
+ * One Stockham autosort stage of radix r: x holds s interleaved
+ * subsequences of length nl; the butterflies run over the contiguous
+ * index q for the compiler to vectorize them.
  */
-    sgn = inv ? 1:-1;
-
-    /* do bit reversal of data in advance */
-    for (k = 0; k != n_pts; k++) {
-	ib = bit_swap(k, nu);
-	if (ib > k) {
-	    fswap((real_data + k), (real_data + ib));
-	    fswap((imag_data + k), (imag_data + ib));
-	}
-    }
-/*
-* Calculate the componets of the Fourier series of the function
-*/
-    tstep = n2;
-    for (mm = 1; mm < n_pts; mm *= 2) {
-        int sinidx = 0, cosidx = n_pts/4;
-        for (k=0; k<mm; k++) {
-	    c = sintab[cosidx];
-	    s = sgn*sintab[sinidx];
-	    sinidx += tstep;
-            cosidx += tstep;
-	    if (sinidx >= n_pts) {
-              sinidx -= n_pts;
+static void fft_stage(int r, int nl, int s, const double *tw_re,
+    const double *tw_im, const double *xr, const double *xi,
+    double *yr, double *yi)
+{
+    int l = nl/r, p, q, j, k;
+    
+    for (p = 0; p < l; p++) {
+        const double *wr = tw_re + p*(r - 1), *wi = tw_im + p*(r - 1);
+        const double *ar = xr + s*p, *ai = xi + s*p;
+        double *br = yr + s*r*p, *bi = yi + s*r*p;
+        
+        switch (r) {
+        case 2:
+            {
+                double w1r = wr[0], w1i = wi[0];
+                for (q = 0; q < s; q++) {
+                    double a0r = ar[q],       a0i = ai[q];
+                    double a1r = ar[q + s*l], a1i = ai[q + s*l];
+                    double dr = a0r - a1r, di = a0i - a1i;
+                    
+                    br[q] = a0r + a1r;
+                    bi[q] = a0i + a1i;
+                    br[q + s] = dr*w1r - di*w1i;
+                    bi[q + s] = dr*w1i + di*w1r;
+                }
+            }
+            break;
+        case 3:
+            {
+                const double c = -0.5, sn = 0.86602540378443864676;
+                for (q = 0; q < s; q++) {
+                    double a0r = ar[q],         a0i = ai[q];
+                    double a1r = ar[q + s*l],   a1i = ai[q + s*l];
+                    double a2r = ar[q + 2*s*l], a2i = ai[q + 2*s*l];
+                    double tr = a1r + a2r, ti = a1i + a2i;
+                    double mr = a0r + c*tr, mi = a0i + c*ti;
+                    double dr = sn*(a1i - a2i), di = -sn*(a1r - a2r);
+                    double b1r = mr + dr, b1i = mi + di;
+                    double b2r = mr - dr, b2i = mi - di;
+                    
+                    br[q] = a0r + tr;
+                    bi[q] = a0i + ti;
+                    br[q + s]   = b1r*wr[0] - b1i*wi[0];
+                    bi[q + s]   = b1r*wi[0] + b1i*wr[0];
+                    br[q + 2*s] = b2r*wr[1] - b2i*wi[1];
+                    bi[q + 2*s] = b2r*wi[1] + b2i*wr[1];
+                }
+            }
+            break;
+        case 4:
+            for (q = 0; q < s; q++) {
+                double a0r = ar[q],         a0i = ai[q];
+                double a1r = ar[q + s*l],   a1i = ai[q + s*l];
+                double a2r = ar[q + 2*s*l], a2i = ai[q + 2*s*l];
+                double a3r = ar[q + 3*s*l], a3i = ai[q + 3*s*l];
+                double t0r = a0r + a2r, t0i = a0i + a2i;
+                double t1r = a0r - a2r, t1i = a0i - a2i;
+                double t2r = a1r + a3r, t2i = a1i + a3i;
+                /* -i*(a1 - a3) */
+                double t3r = a1i - a3i, t3i = a3r - a1r;
+                double b1r = t1r + t3r, b1i = t1i + t3i;
+                double b2r = t0r - t2r, b2i = t0i - t2i;
+                double b3r = t1r - t3r, b3i = t1i - t3i;
+                
+                br[q] = t0r + t2r;
+                bi[q] = t0i + t2i;
+                br[q + s]   = b1r*wr[0] - b1i*wi[0];
+                bi[q + s]   = b1r*wi[0] + b1i*wr[0];
+                br[q + 2*s] = b2r*wr[1] - b2i*wi[1];
+                bi[q + 2*s] = b2r*wi[1] + b2i*wr[1];
+                br[q + 3*s] = b3r*wr[2] - b3i*wi[2];
+                bi[q + 3*s] = b3r*wi[2] + b3i*wr[2];
             }
-	    if (cosidx >= n_pts) {
-                cosidx -= n_pts;
+            break;
+        case 5:
+            {
+                const double c1 =  0.30901699437494742410;
+                const double c2 = -0.80901699437494742410;
+                const double s1 =  0.95105651629515357212;
+                const double s2 =  0.58778525229247312917;
+                for (q = 0; q < s; q++) {
+                    double a0r = ar[q],         a0i = ai[q];
+                    double a1r = ar[q + s*l],   a1i = ai[q + s*l];
+                    double a2r = ar[q + 2*s*l], a2i = ai[q + 2*s*l];
+                    double a3r = ar[q + 3*s*l], a3i = ai[q + 3*s*l];
+                    double a4r = ar[q + 4*s*l], a4i = ai[q + 4*s*l];
+                    double t1r = a1r + a4r, t1i = a1i + a4i;
+                    double t2r = a2r + a3r, t2i = a2i + a3i;
+                    double t3r = a1r - a4r, t3i = a1i - a4i;
+                    double t4r = a2r - a3r, t4i = a2i - a3i;
+                    double r1r = a0r + c1*t1r + c2*t2r;
+                    double r1i = a0i + c1*t1i + c2*t2i;
+                    double r2r = a0r + c2*t1r + c1*t2r;
+                    double r2i = a0i + c2*t1i + c1*t2i;
+                    double i1r = s1*t3r + s2*t4r, i1i = s1*t3i + s2*t4i;
+                    double i2r = s2*t3r - s1*t4r, i2i = s2*t3i - s1*t4i;
+                    double b1r = r1r + i1i, b1i = r1i - i1r;
+                    double b4r = r1r - i1i, b4i = r1i + i1r;
+                    double b2r = r2r + i2i, b2i = r2i - i2r;
+                    double b3r = r2r - i2i, b3i = r2i + i2r;
+                    
+                    br[q] = a0r + t1r + t2r;
+                    bi[q] = a0i + t1i + t2i;
+                    br[q + s]   = b1r*wr[0] - b1i*wi[0];
+                    bi[q + s]   = b1r*wi[0] + b1i*wr[0];
+                    br[q + 2*s] = b2r*wr[1] - b2i*wi[1];
+                    bi[q + 2*s] = b2r*wi[1] + b2i*wr[1];
+                    br[q + 3*s] = b3r*wr[2] - b3i*wi[2];
+                    bi[q + 3*s] = b3r*wi[2] + b3i*wr[2];
+                    br[q + 4*s] = b4r*wr[3] - b4i*wi[3];
+                    bi[q + 4*s] = b4r*wi[3] + b4i*wr[3];
+                }
             }
-	    for (i = k; i < n_pts; i += mm*2) {
-	        double re1, re2, im1, im2;  
-	        re1 = real_data[i];
-	        im1 = imag_data[i];
-                re2 = real_data[i + mm];
-                im2 = imag_data[i + mm];
-
-	        tr = re2*c + im2*s;
-	        ti = im2*c - re2*s;
-	        real_data[i+mm] = re1 - tr;
-	        imag_data[i+mm] = im1 - ti;
-	        real_data[i] = re1 + tr;
-	        imag_data[i] = im1 + ti;
-	    }
+            break;
+        default:
+            {
+                /* generic odd radix, O(r^2) */
+                double omr[FFT_MAX_RADIX], omi[FFT_MAX_RADIX];
+                for (k = 0; k < r; k++) {
+                    omr[k] =  cos(2*M_PI*k/r);
+                    omi[k] = -sin(2*M_PI*k/r);
+                }
+                for (q = 0; q < s; q++) {
+                    for (k = 0; k < r; k++) {
+                        double sr = 0.0, si = 0.0;
+                        for (j = 0; j < r; j++) {
+                            int jk = (j*k) % r;
+                            double xjr = ar[q + j*s*l], xji = ai[q + j*s*l];
+                            sr += xjr*omr[jk] - xji*omi[jk];
+                            si += xjr*omi[jk] + xji*omr[jk];
+                        }
+                        if (k == 0) {
+                            br[q] = sr;
+                            bi[q] = si;
+                        } else {
+                            br[q + k*s] = sr*wr[k - 1] - si*wi[k - 1];
+                            bi[q + k*s] = sr*wi[k - 1] + si*wr[k - 1];
+                        }
+                    }
+                }
+            }
+            break;
         }
-        tstep /= 2;
+    }
+}
+
+static int fft_exec_bluestein(const FFTPlan *p, double *re, double *im)
+{
+    int n = p->n, m = p->conv->n, j;
+    double *ar, *ai;
+    
+    ar = xcalloc(m, SIZEOF_DOUBLE);
+    ai = xcalloc(m, SIZEOF_DOUBLE);
+    if (!ar || !ai) {
+        xfree(ar);
+        xfree(ai);
+        return RETURN_FAILURE;
     }
     
+    for (j = 0; j < n; j++) {
+        ar[j] = re[j]*p->chirp_re[j] - im[j]*p->chirp_im[j];
+        ai[j] = re[j]*p->chirp_im[j] + im[j]*p->chirp_re[j];
+    }
+    
+    if (fft_exec(p->conv, ar, ai) != RETURN_SUCCESS) {
+        xfree(ar);
+        xfree(ai);
+        return RETURN_FAILURE;
+    }
+    for (j = 0; j < m; j++) {
+        double tr = ar[j]*p->kern_re[j] - ai[j]*p->kern_im[j];
+        double ti = ar[j]*p->kern_im[j] + ai[j]*p->kern_re[j];
+        ar[j] = tr;
+        ai[j] = ti;
+    }
+    /* the inverse transform */
+    if (fft_exec(p->conv, ai, ar) != RETURN_SUCCESS) {
+        xfree(ar);
+        xfree(ai);
+        return RETURN_FAILURE;
+    }
+    
+    for (j = 0; j < n; j++) {
+        re[j] = ar[j]*p->chirp_re[j] - ai[j]*p->chirp_im[j];
+        im[j] = ar[j]*p->chirp_im[j] + ai[j]*p->chirp_re[j];
+    }
+    
+    xfree(ar);
+    xfree(ai);
+    
     return RETURN_SUCCESS;
 }
 
-/*
-* Bit swapping routine in which the bit pattern of the integer i is reordered.
-* See Brigham's book for details
-*/
-static int bit_swap(int i, int nu)
+/* in-place forward transform; swap re and im for the inverse one */
+static int fft_exec(const FFTPlan *p, double *re, double *im)
 {
-    int ib, i1, i2;
-
-    ib = 0;
-
-    for (i1 = 0; i1 != nu; i1++) {
-	i2 = i/2;
-	ib = ib*2 + i - 2*i2;
-	i = i2;
+    double *xr = re, *xi = im, *yr, *yi, *tmp;
+    int i, nl = p->n, s = 1;
+    const double *tw_re = p->tw_re, *tw_im = p->tw_im;
+    
+    if (p->conv) {
+        return fft_exec_bluestein(p, re, im);
     }
-    return (ib);
+    if (p->nfactors == 0) {
+        return RETURN_SUCCESS;
+    }
+    
+    yr = xmalloc(p->n*SIZEOF_DOUBLE);
+    yi = xmalloc(p->n*SIZEOF_DOUBLE);
+    if (!yr || !yi) {
+        xfree(yr);
+        xfree(yi);
+        return RETURN_FAILURE;
+    }
+    
+    for (i = 0; i < p->nfactors; i++) {
+        int r = p->factors[i];
+        
+        fft_stage(r, nl, s, tw_re, tw_im, xr, xi, yr, yi);
+        
+        tw_re += (nl/r)*(r - 1);
+        tw_im += (nl/r)*(r - 1);
+        nl /= r;
+        s  *= r;
+        
+        tmp = xr; xr = yr; yr = tmp;
+        tmp = xi; xi = yi; yi = tmp;
+    }
+    
+    if (xr != re) {
+        memcpy(re, xr, p->n*SIZEOF_DOUBLE);
+        memcpy(im, xi, p->n*SIZEOF_DOUBLE);
+        xfree(xr);
+        xfree(xi);
+    } else {
+        xfree(yr);
+        xfree(yi);
+    }
+    
+    return RETURN_SUCCESS;
 }
 
 /*
- * log base 2
+ * forward transform of real data of even length: a half-length complex
+ * transform of the even/odd samples packed together, then unscrambled
  */
-static int ilog2(int n)
+static int fft_real(double *re, double *im, int n)
 {
-    int i = 0;
-    int n1 = n;
+    FFTPlan *p, *ph;
+    int h = n/2, k;
+    double *zr, *zi;
+    
+    p = fft_plan_get(n);
+    if (!p) {
+        return RETURN_FAILURE;
+    }
+    if (!p->rtw_re) {
+        double *wr = xmalloc(h*SIZEOF_DOUBLE), *wi = xmalloc(h*SIZEOF_DOUBLE);
+        if (!wr || !wi) {
+            xfree(wr);
+            xfree(wi);
+            return RETURN_FAILURE;
+        }
+        for (k = 0; k < h; k++) {
+            wr[k] =  cos(2*M_PI*k/n);
+            wi[k] = -sin(2*M_PI*k/n);
+        }
+        p->rtw_re = wr;
+        p->rtw_im = wi;
+    }
+    
+    ph = fft_plan_get(h);
+    zr = xmalloc(h*SIZEOF_DOUBLE);
+    zi = xmalloc(h*SIZEOF_DOUBLE);
+    if (!ph || !zr || !zi) {
+        xfree(zr);
+        xfree(zi);
+        return RETURN_FAILURE;
+    }
+    
+    for (k = 0; k < h; k++) {
+        zr[k] = re[2*k];
+        zi[k] = re[2*k + 1];
+    }
+    
+    if (fft_exec(ph, zr, zi) != RETURN_SUCCESS) {
+        xfree(zr);
+        xfree(zi);
+        return RETURN_FAILURE;
+    }
+    
+    for (k = 0; k < h; k++) {
+        int kc = k ? h - k:0;
+        /* even and odd parts */
+        double er = 0.5*(zr[k] + zr[kc]), ei = 0.5*(zi[k] - zi[kc]);
+        double odr = 0.5*(zi[k] + zi[kc]), odi = 0.5*(zr[kc] - zr[k]);
+        double tr = odr*p->rtw_re[k] - odi*p->rtw_im[k];
+        double ti = odr*p->rtw_im[k] + odi*p->rtw_re[k];
+        
+        re[k]     = er + tr;
+        im[k]     = ei + ti;
+        re[k + h] = er - tr;
+        im[k + h] = ei - ti;
+    }
+    
+    xfree(zr);
+    xfree(zi);
+    
+    return RETURN_SUCCESS;
+}
 
-    while (n1 >>= 1) {
-	i++;
+int fourier(double *jr, double *ji, int n, int iflag)
+{
+    FFTPlan *p;
+    int i, real_input = TRUE;
+    
+    if (n < 1) {
+        return RETURN_FAILURE;
     }
-    if (1 << i != n) {
-	return -1;
+    
+    for (i = 0; i < n && real_input; i++) {
+        if (ji[i] != 0.0) {
+            real_input = FALSE;
+        }
+    }
+    
+    if (real_input && n % 2 == 0) {
+        if (fft_real(jr, ji, n) != RETURN_SUCCESS) {
+            return RETURN_FAILURE;
+        }
+        /* of real data, the inverse is the conjugate of the forward */
+        if (iflag) {
+            for (i = 0; i < n; i++) {
+                ji[i] = -ji[i];
+            }
+        }
+        return RETURN_SUCCESS;
+    }
+    
+    p = fft_plan_get(n);
+    if (!p) {
+        return RETURN_FAILURE;
+    }
+    
+    if (iflag) {
+        return fft_exec(p, ji, jr);
     } else {
-	return i;
+        return fft_exec(p, jr, ji);
     }
 }
 
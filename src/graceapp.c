@@ -762,12 +762,89 @@ int gapp_print(const GraceApp *gapp, const char *fname)
     return retval;
 }
 
+/*
+ * Register all hardcopy drivers with the canvas of gapp; PostScript becomes
+ * the default hardcopy device. Driver setup dialogs are attached only if
+ * nogui is FALSE.
+ */
+int gapp_register_hardcopy_drivers(GraceApp *gapp, int nogui)
+{
+    RunTime *rt = gapp->rt;
+    Canvas *canvas = grace_get_canvas(gapp->grace);
+    int device_id;
+    
+    rt->hdevice = register_ps_drv(canvas);
+    if (rt->hdevice < 0) {
+        return RETURN_FAILURE;
+    }
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_ps_drv_setup(canvas, rt->hdevice);
+    }
+#endif
+    device_id = register_eps_drv(canvas);
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_eps_drv_setup(canvas, device_id);
+    }
+#endif
+
+#ifdef HAVE_LIBPDF
+    device_id = register_pdf_drv(canvas);
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_pdf_drv_setup(canvas, device_id);
+    }
+#endif
+#endif
+#ifdef HAVE_HARU
+    device_id = register_hpdf_drv(canvas);
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_hpdf_drv_setup(canvas, device_id);
+    }
+#endif
+#endif
+    register_mif_drv(canvas);
+    register_svg_drv(canvas);
+    register_emf_drv(canvas);
+
+#ifdef HAVE_LIBXMI
+    device_id = register_pnm_drv(canvas);
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_pnm_drv_setup(canvas, device_id);
+    }
+#endif
+#  ifdef HAVE_LIBJPEG
+    device_id = register_jpg_drv(canvas);
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_jpg_drv_setup(canvas, device_id);
+    }
+#endif
+#  endif
+#  ifdef HAVE_LIBPNG
+    device_id = register_png_drv(canvas);
+#ifndef NONE_GUI
+    if (!nogui) {
+        attach_png_drv_setup(canvas, device_id);
+    }
+#endif
+#  endif
+#endif
+
+    register_mf_drv(canvas);
+    
+    return RETURN_SUCCESS;
+}
+
 #define VP_EPSILON  0.001
 
 /*
  * If writing to a file, check to see if it exists
  */
-void do_hardcopy(const GProject *gp)
+int do_hardcopy(const GProject *gp)
 {
     Quark *project = gproject_get_top(gp);
     GraceApp *gapp = gapp_from_quark(project);
@@ -780,7 +857,7 @@ void do_hardcopy(const GProject *gp)
     FILE *prstream;
     
     if (!gapp) {
-        return;
+        return RETURN_FAILURE;
     }
     
     rt = gapp->rt;
@@ -800,7 +877,7 @@ void do_hardcopy(const GProject *gp)
     }
     
     if (prstream == NULL) {
-        return;
+        return RETURN_FAILURE;
     }
     
     canvas_set_prstream(canvas, prstream); 
@@ -812,7 +889,7 @@ void do_hardcopy(const GProject *gp)
     gapp_close(prstream);
     
     if (res != RETURN_SUCCESS) {
-        return;
+        return RETURN_FAILURE;
     }
     
     get_bbox(canvas, BBOX_TYPE_GLOB, &v);
@@ -826,7 +903,8 @@ void do_hardcopy(const GProject *gp)
     
     if (get_ptofile(gapp) == FALSE) {
         if (truncated_out == FALSE ||
-            yesno("Printout is truncated. Continue?", NULL, NULL, NULL)) {
+            gapp_yesno(gapp, "Printout is truncated. Continue?",
+                NULL, NULL, NULL)) {
             gapp_print(gapp, fname);
 #ifndef PRINT_CMD_UNLINKS
             remove(fname);
@@ -837,6 +915,8 @@ void do_hardcopy(const GProject *gp)
             errmsg("Output is truncated - tune device dimensions");
         }
     }
+    
+    return RETURN_SUCCESS;
 }
 
 int gui_is_page_free(const GUI *gui)
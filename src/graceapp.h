@@ -231,6 +231,7 @@ int gapp_init_print(RunTime *rt);
 
 int gapp_print(const GraceApp *gapp, const char *fname);
 
-void do_hardcopy(const GProject *gp);
+int gapp_register_hardcopy_drivers(GraceApp *gapp, int nogui);
+int do_hardcopy(const GProject *gp);
 
 #endif /* __GRACEAPP_H_ */
@@ -135,6 +135,8 @@ static void load_example_cb(Widget but, void *data)
 
 static void do_drawgraph(Widget but, void *data)
 {
+    /* an explicit redraw request renders the whole page */
+    pagecache_invalidate(gapp->gui->xstuff->pagecache);
     xdrawgraph(gapp->gp);
 }
 
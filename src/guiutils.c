@@ -367,9 +367,14 @@ void xdrawgraph(const GProject *gp)
         Page_geometry *pg = &d->pg;
         float dpi = gapp->gui->zoom*xstuff->dpi;
         X11stream xstream;
+        view damage;
         
         set_wait_cursor();
 
+        if (!xstuff->pagecache) {
+            xstuff->pagecache = pagecache_new();
+        }
+        
         if (dpi != pg->dpi) {
             int wpp, hpp;
             project_get_page_dimensions(project, &wpp, &hpp);
@@ -377,17 +382,25 @@ void xdrawgraph(const GProject *gp)
             pg->width  = (unsigned long) (wpp*dpi/72);
             pg->height = (unsigned long) (hpp*dpi/72);
             pg->dpi = dpi;
+            
+            pagecache_invalidate(xstuff->pagecache);
         }
         
         resize_drawables(pg->width, pg->height);
         
-        xdrawgrid(xstuff);
-        
         init_xstream(&xstream);
         canvas_set_prstream(grace_get_canvas(gapp->grace), &xstream);
 
         select_device(grace_get_canvas(gapp->grace), gapp->rt->tdevice);
-        gproject_render(gp);
+        
+        /* re-render only the frames changed since the last time */
+        if (gproject_get_damage(gp, xstuff->pagecache, &damage)) {
+            xdrawgrid(xstuff, &damage);
+            gproject_render_update(gp, xstuff->pagecache, &damage);
+        }
+        
+        /* the overlays are drawn anew over a clean copy of the page */
+        xdrawpage(xstuff);
 
         if (quark_is_active(gr)) {
             draw_focus(gr);
@@ -411,8 +424,10 @@ static void resize_drawables(unsigned int w, unsigned int h)
     
     if (xstuff->bufpixmap == (Pixmap) NULL) {
         create_pixmap(w, h);
+        pagecache_invalidate(xstuff->pagecache);
     } else if (xstuff->win_w != w || xstuff->win_h != h) {
         recreate_pixmap(w, h);
+        pagecache_invalidate(xstuff->pagecache);
     }
     
     if (xstuff->bufpixmap == (Pixmap) NULL) {
@@ -45,6 +45,7 @@
 #include "utils.h"
 #include "files.h"
 #include "ssdata.h"
+#include "batch.h"
 
 #include "xprotos.h"
 
@@ -76,8 +77,6 @@ int main(int argc, char *argv[])
     GUI *gui;
     Canvas *canvas;
     
-    int device_id;
-    
     gapp = gapp_new();
     if (!gapp) {
         errmsg("Failed to allocate run-time structures");
@@ -162,65 +161,10 @@ int main(int argc, char *argv[])
     rt->tdevice = register_dummy_drv(canvas);
 #endif
 
-    rt->hdevice = register_ps_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_ps_drv_setup(canvas, rt->hdevice);
-    }
-#endif
-    device_id = register_eps_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_eps_drv_setup(canvas, device_id);
-    }
-#endif
-
-#ifdef HAVE_LIBPDF
-    device_id = register_pdf_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_pdf_drv_setup(canvas, device_id);
-    }
-#endif
-#endif
-#ifdef HAVE_HARU
-    device_id = register_hpdf_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_hpdf_drv_setup(canvas, device_id);
-    }
-#endif
-#endif
-    register_mif_drv(canvas);
-    register_svg_drv(canvas);
-    register_emf_drv(canvas);
-
-#ifdef HAVE_LIBXMI
-    device_id = register_pnm_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_pnm_drv_setup(canvas, device_id);
-    }
-#endif
-#  ifdef HAVE_LIBJPEG
-    device_id = register_jpg_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_jpg_drv_setup(canvas, device_id);
-    }
-#endif
-#  endif
-#  ifdef HAVE_LIBPNG
-    device_id = register_png_drv(canvas);
-#ifndef NONE_GUI
-    if (!nogui) {
-        attach_png_drv_setup(canvas, device_id);
+    if (gapp_register_hardcopy_drivers(gapp, nogui) != RETURN_SUCCESS) {
+        errmsg("Failed registering hardcopy drivers");
+        exit(1);
     }
-#endif
-#  endif
-#endif
-
-    register_mf_drv(canvas);
 
     /* TODO: load prefs */
 
@@ -363,6 +307,17 @@ int main(int argc, char *argv[])
 		}
 	    } else if (argmatch(argv[i], "-hardcopy", 6)) {
 		gracebat = TRUE;
+	    } else if (argmatch(argv[i], "-batch", 6)) {
+		i++;
+		if (i == argc) {
+		    fprintf(stderr, "Missing batch manifest file name\n");
+		    usage(stderr, argv[0]);
+		} else {
+		    if (batch_export(argv[i]) != RETURN_SUCCESS) {
+                        exit(1);
+                    }
+                    exit(0);
+		}
 	    } else if (argmatch(argv[i], "-block", 6)) {
 		i++;
 		if (i == argc) {
@@ -444,7 +399,8 @@ int main(int argc, char *argv[])
 		usage(stderr, argv[0]);
 	    }
 	} else {
-	    if (strstr(argv[i], ".xgr") || strstr(argv[i], ".agr")) {
+	    if (strstr(argv[i], ".xgr") || strstr(argv[i], ".xgb") ||
+                strstr(argv[i], ".agr")) {
                 load_project(gapp, argv[i]);
             } else {
 		if (!gapp->gp) {
@@ -543,6 +499,9 @@ static void usage(FILE *stream, char *progname)
 #ifndef NONE_GUI
     fprintf(stream, "-barebones                            Turn off all toolbars\n");
 #endif
+    fprintf(stream, "-batch     [manifest_file]            Export projects listed in manifest_file\n");
+    fprintf(stream, "                                        (\"project device output [options]\"\n");
+    fprintf(stream, "                                        per line) in parallel and quit\n");
     fprintf(stream, "-block     [block_data]               Assume data file is block data\n");
     fprintf(stream, "-datehint  [iso|european|us\n");
     fprintf(stream, "            |days|seconds|nohint]     Set the hint for dates analysis\n");
@@ -259,7 +259,9 @@ static void cmd_cb(TextStructure *cst, char *s, void *data)
     ui->eohistory = TRUE;
     
     if (!string_is_empty(s)) {
+        quark_transaction_begin();
         graal_parse_line(grace_get_graal(gapp->grace), s, gproject_get_top(gapp->gp));
+        quark_transaction_commit();
         
         if (ui->auto_redraw) {
             xdrawgraph(gapp->gp);
@@ -2636,7 +2636,9 @@ void aacdialog_int_cb_proc(Widget but, void *data)
 
     cbdata = (AACDialog_CBdata *) data;
     
+    quark_transaction_begin();
     retval = cbdata->cbproc(cbdata->anydata);
+    quark_transaction_commit();
 
     if (cbdata->close && retval == RETURN_SUCCESS) {
         WidgetUnmanage(XtParent(cbdata->form));
@@ -2725,6 +2727,9 @@ int td_cb(void *data)
 	        error = TRUE;
 	        break;
 	    }
+            
+            /* the data may have been changed in place, keeping the length */
+            quark_dirtystate_set(pdest, TRUE);
         }
     }
     
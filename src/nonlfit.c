@@ -30,6 +30,9 @@
  *
  * nonlinear curve fitting
  *
+ * NB: this file is currently not built (it is not in GRSRCS); it needs
+ * f2c.h and MINPACK's lmdif_(), neither of which is in the tree.
+ *
  */
 
 #include <config.h>
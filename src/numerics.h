@@ -39,7 +39,10 @@
 /* computils.c */
 double trapint(double *x, double *y, double *resx, double *resy, int n);
 int apply_window(double *v, int ilen, int window, double beta);
-int histogram(int ndata, double *data, int nbins, double *bins, int *hist);
+int histogram(int ndata, const double *data, const double *weights,
+    int nbins, const double *bins, int cumulative, double *hist);
+int running_stat(const double *x, unsigned int newlen, unsigned int runlen,
+    int type, double *out);
 double comp_area(int n, double *x, double *y);
 double comp_perimeter(int n, double *x, double *y);
 void stasum(double *x, int n, double *xbar, double *sd);
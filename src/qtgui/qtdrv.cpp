@@ -129,6 +129,23 @@ static int qt_initgraphics(const Canvas *canvas, void *data,
     qtdata->linecap     = -1;
     qtdata->linejoin    = -1;
 
+    /* on a partial redraw, keep the rest of the image intact */
+    view v;
+    if (canvas_get_update_region(canvas, &v)) {
+        VPoint vp;
+        XPoint xp1, xp2;
+
+        vp.x = v.xv1;
+        vp.y = v.yv2;
+        VPoint2XPoint(qtdata, &vp, &xp1);
+        vp.x = v.xv2;
+        vp.y = v.yv1;
+        VPoint2XPoint(qtdata, &vp, &xp2);
+
+        qtdata->painter->setClipRect(QRectF(xp1.x - 1, xp1.y - 1,
+            xp2.x - xp1.x + 2, xp2.y - xp1.y + 2));
+    }
+
     return RETURN_SUCCESS;
 }
 
@@ -495,7 +495,7 @@ void init_xstream(X11stream *xstream)
     X11Stuff *xstuff = gapp->gui->xstuff;
 
 //    xstream->screen = DefaultScreenOfDisplay(xstuff->disp);
-    xstream->pixmap = xstuff->bufpixmap;
+    xstream->pixmap = xstuff->pagepixmap;
 }
 
 void create_pixmap(unsigned int w, unsigned int h)
@@ -508,6 +508,7 @@ void create_pixmap(unsigned int w, unsigned int h)
     /* are defined in CANVAS_BPCC canvas.h file. */
     /* Use alpha channel to be able to use QPainter::setCompositionMode(CompositionMode mode)*/
     /* Image composition using alpha blending are faster using premultiplied ARGB32 than with plain ARGB32 */
+    xstuff->pagepixmap = new QImage(w, h, QImage::Format_ARGB32_Premultiplied);
     xstuff->bufpixmap = new QImage(w, h, QImage::Format_ARGB32_Premultiplied);
 }
 
@@ -517,11 +518,12 @@ void recreate_pixmap(unsigned int w, unsigned int h)
     X11Stuff *xstuff = gapp->gui->xstuff;
 //
 //    XFreePixmap(xstuff->disp, xstuff->bufpixmap);
+    delete (QImage*)xstuff->pagepixmap;
     delete (QImage*)xstuff->bufpixmap;
     create_pixmap(w, h);
 }
 
-void xdrawgrid(X11Stuff *xstuff)
+void xdrawgrid(X11Stuff *xstuff, const view *v)
 {
     int i, j;
     double step;
@@ -530,10 +532,17 @@ void xdrawgrid(X11Stuff *xstuff)
     double w = canvasWidget->width();
     double h = canvasWidget->height();
 
-    QImage *pixmap = (QImage*) xstuff->bufpixmap;
+    QImage *pixmap = (QImage*) xstuff->pagepixmap;
 
     QPainter painter(pixmap);
 
+    if (v && is_valid_bbox(v)) {
+        double scale = xstuff->win_scale;
+        painter.setClipRect(QRectF(scale*v->xv1 - 1,
+            xstuff->win_h - scale*v->yv2 - 1,
+            scale*(v->xv2 - v->xv1) + 2, scale*(v->yv2 - v->yv1) + 2));
+    }
+
     QPen pen;
     pen.setColor(Qt::black);
     pen.setWidth(1);
@@ -542,8 +551,7 @@ void xdrawgrid(X11Stuff *xstuff)
     pen.setJoinStyle(Qt::MiterJoin);
     painter.setPen(pen);
 
-    QBrush brush;
-    brush.setColor(Qt::white);
+    QBrush brush(Qt::white);
     painter.setBrush(brush);
 
     painter.drawRect(canvasWidget->rect());
@@ -558,6 +566,14 @@ void xdrawgrid(X11Stuff *xstuff)
     }
 }
 
+void xdrawpage(X11Stuff *xstuff)
+{
+    QPainter painter((QImage*) xstuff->bufpixmap);
+
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(0, 0, *((QImage*) xstuff->pagepixmap));
+}
+
 void x11_redraw_all()
 {
     X11Stuff *xstuff = gapp->gui->xstuff;
@@ -7276,7 +7292,9 @@ void aacdialog_int_cb_proc(Widget but, void *data)
 
     cbdata = (AACDialog_CBdata *) data;
 
+    quark_transaction_begin();
     retval = cbdata->cbproc(cbdata->anydata);
+    quark_transaction_commit();
 
     if (cbdata->close && retval == RETURN_SUCCESS) {
         cbdata->form->close();
@@ -9162,7 +9180,8 @@ TableModel::TableModel(QObject *parent)
 
 void TableModel::setRowCount(int rows)
 {
-    if (rows > cells.size()) {
+    /* tables with a draw cell callback are virtual: no cell storage */
+    if (cbdata == 0 && rows > cells.size()) {
         cells.resize(rows);
         for (int row = 0; row < rows; ++row) {
             cells[row].resize(this->ncols);
@@ -9176,7 +9195,7 @@ void TableModel::setRowCount(int rows)
 
 void TableModel::setColumnCount(int cols)
 {
-    for (int row = 0; row < this->nrows; ++row) {
+    for (int row = 0; cbdata == 0 && row < this->nrows; ++row) {
         if (cells[row].size() < cols)
             cells[row].resize(cols);
     }
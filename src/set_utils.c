@@ -320,131 +320,22 @@ int join_sets(Quark **sets, int nsets)
 }
 
 /*
- * sort a set
+ * sort a set (in fact, its parent SSD) on one of its columns
  */
-static double *vptr;
-
-/*
- * for ascending and descending sorts
- */
- 
-static int compare_points1(const void *p1, const void *p2)
-{
-    const int *i1, *i2;
-    double a, b;
-    i1 = (const int *)p1;
-    i2 = (const int *)p2;
-    a = vptr[*i1];
-    b = vptr[*i2];
-    if (a < b) {
-	return -1;
-    }
-    if (a > b) {
-	return 1;
-    }
-    return 0;
-}
-
-static int compare_points2(const void *p1, const void *p2)
-{
-    const int *i1, *i2;
-    double a, b;
-    i1 = (const int *)p1;
-    i2 = (const int *)p2;
-    a = vptr[*i1];
-    b = vptr[*i2];
-    if (a > b) {
-	return -1;
-    }
-    if (a < b) {
-	return 1;
-    }
-    return 0;
-}
-
 void sortset(Quark *pset, int sorton, int stype)
 {
-    int i, j, nc, len, *ind;
-    double *x, *xtmp;
-    char **s, **stmp;
-
-    /* get the vector to sort on */
-    vptr = set_get_col(pset, sorton);
-    if (vptr == NULL) {
-	errmsg("NULL vector in sort, operation cancelled, check set type");
-	return;
-    }
-
-    len = set_get_length(pset);
-    if (len <= 1) {
-	return;
-    }
+    Dataset *dsp = set_get_dataset(pset);
     
-    /* allocate memory for permuted indices */
-    ind = xmalloc(len*SIZEOF_INT);
-    if (ind == NULL) {
-	return;
-    }
-    /* allocate memory for temporary array */
-    xtmp = xmalloc(len*SIZEOF_DOUBLE);
-    if (xtmp == NULL) {
-	xfree(ind);
+    if (!dsp || sorton < 0 || sorton >= MAX_SET_COLS ||
+        dsp->cols[sorton] == COL_NONE) {
+	errmsg("NULL vector in sort, operation cancelled, check set type");
 	return;
     }
-    
-    s = set_get_strings(pset);
-    if (s != NULL) {
-        stmp = xmalloc(len*sizeof(char *));
-        if (stmp == NULL) {
-	    xfree(xtmp);
-	    xfree(ind);
-        }
-    } else {
-        stmp = NULL;
-    }
-    
-    /* initialize indices */
-    for (i = 0; i < len; i++) {
-	ind[i] = i;
-    }
-
-    /* sort */
-    qsort(ind, len, SIZEOF_INT, stype ? compare_points2 : compare_points1);
 
-    /* straighten things out - done one vector at a time for storage */
-    
-    nc = set_get_ncols(pset);
-    /* loop over the number of columns */
-    for (j = 0; j < nc; j++) {
-        /* get this vector and put into the temporary vector in the right order */
-	x = set_get_col(pset, j);
-	for (i = 0; i < len; i++) {
-	    xtmp[i] = x[ind[i]];
-	}
-        
-        /* load it back to the set */
-	for (i = 0; i < len; i++) {
-	    x[i] = xtmp[i];
-	}
-    }
-    
-    /* same with strings, if any */
-    if (s != NULL) {
-	for (i = 0; i < len; i++) {
-	    stmp[i] = s[ind[i]];
-	}
-
-	for (i = 0; i < len; i++) {
-	    s[i] = stmp[i];
-	}
+    if (ssd_sort(get_parent_ssd(pset), dsp->cols[sorton], stype) !=
+        RETURN_SUCCESS) {
+        errmsg("Sorting failed");
     }
-    
-    /* free allocated temporary arrays */
-    xfree(stmp);
-    xfree(xtmp);
-    xfree(ind);
-
-    quark_dirtystate_set(pset, TRUE);
 }
 
 int get_datapoint(Quark *pset, int ind, int *ncols, Datapoint *dpoint)
@@ -256,8 +256,8 @@ void create_datasetop_popup(Widget but, void *data)
             "Reverse",   DATASETOP_REVERSE,
             "Transpose", DATASETOP_TRANSPOSE,
             "Coalesce",  DATASETOP_COALESCE,
-#if 0
             "Sort",      DATASETOP_SORT,
+#if 0
             "Split",     DATASETOP_SPLIT,
 #endif
             "Drop rows", DATASETOP_DROP,
@@ -335,7 +335,7 @@ static void datasetoptypeCB(OptionStructure *opt, int value, void *data)
 static int datasetop_aac_cb(void *data)
 {
     int n, i;
-    int startno, endno;
+    int startno, endno, stype;
     dataSetOpType optype;
     Quark *ss, **selssd;
        
@@ -374,15 +374,18 @@ static int datasetop_aac_cb(void *data)
                 }
             }
             break;
-#if 0
         case DATASETOP_SORT:
             stype = GetOptionChoice(datasetopui.up_down_item);
 
             for (i = 0; i < n; i++) {
                 ss = selssd[i];
-                ssd_sort(ss, stype);
+                if (ssd_sort(ss, 0, stype) != RETURN_SUCCESS) {
+                    errmsg("Sorting failed");
+                    break;
+                }
             }
             break;
+#if 0
         case DATASETOP_JOIN:
             ssd_join(selssd, n);
             break;
@@ -85,39 +85,143 @@ static void create_hotfiles_popup(Widget but, void *data)
 }
 
 /*
- * We use a stack of static buffers to work around asynchronous
- * refresh/redraw events
+ * Only the visible cells are ever formatted. Numeric cells are cached in
+ * blocks of rows spanning all columns, each column of a block being
+ * formatted when first shown. Blocks are kept until the SSD changes or
+ * they are the least recently used ones when a new block is needed; since
+ * a block covers every column, the table can show any number of them and
+ * the strings stay valid long enough for the asynchronous refresh/redraw
+ * events.
  */
-#define STACKLEN    (VISIBLE_SS_ROWS*VISIBLE_SS_COLS)
+#define CELL_CACHE_ROWS   128
+#define CELL_CACHE_BLOCKS  32
+#define CELL_LEN           32
+
+typedef struct {
+    int row0;                   /* -1 if unused */
+    unsigned int nrows;
+    unsigned int stamp;         /* SSD state stamp the cells belong to */
+    unsigned int lru;
+    unsigned int ncols;         /* allocated length of cols[] */
+    char **cols;                /* CELL_CACHE_ROWS cells per column, or NULL
+                                   if the column hasn't been formatted yet */
+} SSDCellBlock;
+
+struct _SSDCellCache {
+    unsigned int clock;
+    SSDCellBlock blocks[CELL_CACHE_BLOCKS];
+};
+
+static void cell_block_clear(SSDCellBlock *b)
+{
+    unsigned int i;
+    
+    for (i = 0; i < b->ncols; i++) {
+        XCFREE(b->cols[i]);
+    }
+    b->row0 = -1;
+}
 
-static char *get_cell_content(SSDataUI *ui, int row, int column, int *format)
+static void cell_cache_flush(SSDataUI *ui)
+{
+    if (ui->cache) {
+        unsigned int i;
+        for (i = 0; i < CELL_CACHE_BLOCKS; i++) {
+            cell_block_clear(&ui->cache->blocks[i]);
+        }
+    }
+}
+
+static char *cell_cache_get(SSDataUI *ui, int row, int column,
+    const ss_column *col, int nrows)
 {
-    static char buf[STACKLEN][32];
-    static int stackp = 0;
+    struct _SSDCellCache *cache = ui->cache;
+    SSDCellBlock *b, *victim;
+    unsigned int i, stamp = quark_get_statestamp(ui->q);
+    int row0 = row - row % CELL_CACHE_ROWS;
+    const double *data;
+    char *cells;
+    
+    if (!cache) {
+        cache = xcalloc(1, sizeof(struct _SSDCellCache));
+        if (!cache) {
+            return NULL;
+        }
+        ui->cache = cache;
+        cell_cache_flush(ui);
+    }
+    
+    b = NULL;
+    victim = &cache->blocks[0];
+    for (i = 0; i < CELL_CACHE_BLOCKS; i++) {
+        SSDCellBlock *bi = &cache->blocks[i];
+        if (bi->row0 == row0) {
+            b = bi;
+            break;
+        }
+        if (bi->row0 < 0 || bi->lru < victim->lru) {
+            victim = bi;
+        }
+    }
     
+    if (!b || b->stamp != stamp) {
+        if (!b) {
+            b = victim;
+        }
+        cell_block_clear(b);
+        b->row0  = row0;
+        b->stamp = stamp;
+        b->nrows = MIN2(CELL_CACHE_ROWS, nrows - row0);
+    }
+    b->lru = ++cache->clock;
+    
+    if ((unsigned int) column >= b->ncols) {
+        unsigned int ncols = column + 1;
+        char **p = xrealloc(b->cols, ncols*SIZEOF_VOID_P);
+        if (!p) {
+            return NULL;
+        }
+        for (i = b->ncols; i < ncols; i++) {
+            p[i] = NULL;
+        }
+        b->cols  = p;
+        b->ncols = ncols;
+    }
+    
+    cells = b->cols[column];
+    if (!cells) {
+        /* format the whole column of the block at once */
+        cells = xmalloc(CELL_CACHE_ROWS*CELL_LEN);
+        if (!cells) {
+            return NULL;
+        }
+        data = (const double *) col->data + row0;
+        for (i = 0; i < b->nrows; i++) {
+            sprintf(cells + i*CELL_LEN, "%.*g", ui->prec, data[i]);
+        }
+        b->cols[column] = cells;
+    }
+    
+    return cells + (row - row0)*CELL_LEN;
+}
+
+static char *get_cell_content(SSDataUI *ui, int row, int column, int *format)
+{
     int nrows = ssd_get_nrows(ui->q);
     ss_column *col = ssd_get_col(ui->q, column);
     char *s;
 
     if (col && row >= 0 && row < nrows) {
-        unsigned int prec;
         *format = col->format;
         switch (col->format) {
         case FFORMAT_STRING:
             s = ((char **) col->data)[row];
             break;
         default:
-            prec = project_get_prec(get_parent_project(ui->q));
-            sprintf(buf[stackp], "%.*g", prec, ((double *) col->data)[row]);
-            s = buf[stackp];
-            stackp++;
-            stackp %= STACKLEN;
-            
-            /* get rid of spaces */
-            while (s && *s == ' ') {
-                s++;
+            s = cell_cache_get(ui, row, column, col, nrows);
+            if (!s) {
+                s = "";
             }
-            
             break;
         }
     } else {
@@ -176,7 +280,7 @@ static int leaveCB(TableEvent *event)
     }
     
     if (event->col == ncols && !string_is_empty(event->value)) {
-        if (parse_date_or_number(get_parent_project(ui->q),
+        if (parse_date_or_number(ui->pr,
             event->value, FALSE, get_date_hint(gapp), &value) == RETURN_SUCCESS) {
             format = FFORMAT_NUMBER;
         } else {
@@ -203,14 +307,12 @@ static int leaveCB(TableEvent *event)
                 if (graal_eval_expr(grace_get_graal(gapp->grace),
                     event->value, &value, gproject_get_top(gapp->gp)) == RETURN_SUCCESS) {
 
-                    unsigned int prec;
                     char buf[32];
                     double val;
 
-                    prec = project_get_prec(get_parent_project(ui->q));
-                    sprintf(buf, "%.*g", prec, value);
+                    sprintf(buf, "%.*g", ui->prec, value);
 
-                    if (parse_date_or_number(get_parent_project(ui->q),
+                    if (parse_date_or_number(ui->pr,
                         buf, FALSE, get_date_hint(gapp), &val) == RETURN_SUCCESS) {
 
                         if (ssd_set_value(ui->q, event->row, event->col, val) == RETURN_SUCCESS) {
@@ -358,6 +460,7 @@ SSDataUI *create_ssd_ui(ExplorerUI *eui)
         return NULL;
     }
     memset(ui, 0, sizeof(SSDataUI));
+    ui->prec = CELL_PREC;
 
     /* ------------ Tabs -------------- */
 
@@ -430,7 +533,10 @@ void update_ssd_ui(SSDataUI *ui, Quark *q)
             TableDeselectAllCells(ui->mw);
         }
         
-        ui->q = q;
+        ui->q    = q;
+        ui->pr   = get_parent_project(q);
+        ui->prec = project_get_prec(ui->pr);
+        cell_cache_flush(ui);
         
         ncols = ssd_get_ncols(q);
         nrows = ssd_get_nrows(q);
@@ -456,17 +562,23 @@ void update_ssd_ui(SSDataUI *ui, Quark *q)
             TableDeleteRows(ui->mw, -delta_nr);
         }
 
-        rowlabels = xmalloc(new_nr*sizeof(char *));
-        for (i = 0; i < new_nr; i++) {
-            char buf[32];
-            sprintf(buf, "%d", i + 1);
-            rowlabels[i] = copy_string(NULL, buf);
-        }
-        TableSetRowLabels(ui->mw, rowlabels);
-        for (i = 0; i < new_nr; i++) {
-            xfree(rowlabels[i]);
+        /* the labels are just row numbers; (re)set them only if needed */
+        if (ui->nrow_labels != new_nr) {
+            char *labelbuf;
+            rowlabels = xmalloc(new_nr*sizeof(char *));
+            labelbuf  = xmalloc(new_nr*12);
+            if (rowlabels && labelbuf) {
+                char *p = labelbuf;
+                for (i = 0; i < new_nr; i++) {
+                    rowlabels[i] = p;
+                    p += sprintf(p, "%d", i + 1) + 1;
+                }
+                TableSetRowLabels(ui->mw, rowlabels);
+                ui->nrow_labels = new_nr;
+            }
+            xfree(labelbuf);
+            xfree(rowlabels);
         }
-        xfree(rowlabels);
 
         maxlengths = xmalloc(new_nc*SIZEOF_INT);
         collabels = xmalloc(new_nc*sizeof(char *));
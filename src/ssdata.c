@@ -261,24 +261,91 @@ int parse_ss_row(Quark *pr, const char *s, int *nncols, int *nscols, int **forma
 }
 
 
+/*
+ * resolve everything insert_data_row() needs once per SSD rather than once
+ * per row
+ */
+int data_row_parser_init(Quark *q, DataRowParser *rp)
+{
+    ss_data *ssd = ssd_get_data(q);
+    
+    if (!ssd || !rp || ssd_fetch_data(q) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    rp->amem    = quark_get_amem(q);
+    rp->pr      = get_parent_project(q);
+    rp->df_pref = get_date_hint(gapp_from_quark(q));
+    rp->ncols   = ssd->ncols;
+    rp->cols    = ssd->cols;
+    
+    return RETURN_SUCCESS;
+}
+
+/*
+ * lock the date format of the parser in to the one the first date cell of
+ * the given row is written in; it is tried first for all the rows then
+ */
+int data_row_parser_lock_dates(DataRowParser *rp, const char *s)
+{
+    unsigned int i;
+    char *buf, *s1, *token;
+    int quoted, res = RETURN_FAILURE;
+    
+    buf = copy_string(NULL, s);
+    s1 = buf;
+    for (i = 0; i < rp->ncols; i++) {
+        s1 = next_token(s1, &token, &quoted);
+        if (s1 == NULL || token == NULL) {
+            break;
+        }
+        if (rp->cols[i].format == FFORMAT_DATE) {
+            double jul;
+            Dates_format recognized;
+            if (parse_date(rp->pr, token, rp->df_pref, FALSE,
+                    &jul, &recognized) == RETURN_SUCCESS) {
+                rp->df_pref = recognized;
+                res = RETURN_SUCCESS;
+            }
+            break;
+        }
+    }
+    xfree(buf);
+    
+    return res;
+}
+
+/*
+ * whether rows may be parsed concurrently: string cells are allocated from
+ * the (non thread-safe) AMem
+ */
+int data_row_parser_is_reentrant(const DataRowParser *rp)
+{
+    unsigned int i;
+    
+    for (i = 0; i < rp->ncols; i++) {
+        if (rp->cols[i].format == FFORMAT_STRING) {
+            return FALSE;
+        }
+    }
+    
+    return TRUE;
+}
+
 /* NOTE: the input string will be corrupted! */
-int insert_data_row(Quark *q, unsigned int row, char *s)
+int data_row_parser_insert(const DataRowParser *rp, unsigned int row, char *s)
 {
-    unsigned int i, ncols = ssd_get_ncols(q);
+    unsigned int i;
     char *token;
     int quoted;
     char  **sp;
     double *np;
-    Dates_format df_pref, ddummy;
+    Dates_format ddummy;
     const char *sdummy;
     int res;
-    AMem *amem = quark_get_amem(q);
-    Quark *pr = get_parent_project(q); 
-    GraceApp *gapp = gapp_from_quark(q);
     
-    df_pref = get_date_hint(gapp);
-    for (i = 0; i < ncols; i++) {
-        ss_column *pcol = ssd_get_col(q, i);
+    for (i = 0; i < rp->ncols; i++) {
+        ss_column *pcol = &rp->cols[i];
         s = next_token(s, &token, &quoted);
         if (s == NULL || token == NULL) {
             /* invalid line */
@@ -286,7 +353,7 @@ int insert_data_row(Quark *q, unsigned int row, char *s)
         } else {
             if (pcol->format == FFORMAT_STRING) {
                 sp = (char **) pcol->data;
-                sp[row] = amem_strcpy(amem, sp[row], token);
+                sp[row] = amem_strcpy(rp->amem, sp[row], token);
                 if (sp[row] != NULL) {
                     res = RETURN_SUCCESS;
                 } else {
@@ -294,7 +361,8 @@ int insert_data_row(Quark *q, unsigned int row, char *s)
                 }
             } else if (pcol->format == FFORMAT_DATE) {
                 np = (double *) pcol->data;
-                res = parse_date(pr, token, df_pref, FALSE, &np[row], &ddummy);
+                res = parse_date(rp->pr, token, rp->df_pref, FALSE,
+                    &np[row], &ddummy);
             } else {
                 np = (double *) pcol->data;
                 res = parse_float(token, &np[row], &sdummy);
@@ -308,6 +376,18 @@ int insert_data_row(Quark *q, unsigned int row, char *s)
     return RETURN_SUCCESS;
 }
 
+/* NOTE: the input string will be corrupted! */
+int insert_data_row(Quark *q, unsigned int row, char *s)
+{
+    DataRowParser rp;
+    
+    if (data_row_parser_init(q, &rp) != RETURN_SUCCESS) {
+        return RETURN_FAILURE;
+    }
+    
+    return data_row_parser_insert(&rp, row, s);
+}
+
 static int create_set_fromblock(Quark *ss, int type,
     unsigned int nc, const unsigned int *coli, int acol)
 {
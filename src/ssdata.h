@@ -44,7 +44,20 @@ double *allocate_mesh(double start, double stop, int len);
 char *cols_to_field_string(int nc, unsigned int *cols, int scol);
 int field_string_to_cols(const char *fs, int *nc, int **cols, int *scol);
 
+/* state for filling in rows of an SSD */
+typedef struct {
+    AMem *amem;
+    Quark *pr;
+    Dates_format df_pref;
+    unsigned int ncols;
+    ss_column *cols;
+} DataRowParser;
+
 int parse_ss_row(Quark *pr, const char *s, int *nncols, int *nscols, int **formats);
+int data_row_parser_init(Quark *q, DataRowParser *rp);
+int data_row_parser_lock_dates(DataRowParser *rp, const char *s);
+int data_row_parser_is_reentrant(const DataRowParser *rp);
+int data_row_parser_insert(const DataRowParser *rp, unsigned int row, char *s);
 int insert_data_row(Quark *q, unsigned int row, char *s);
 int store_data(Quark *q, int load_type, int settype);
 
@@ -376,9 +376,11 @@ int yesnoterm(char *msg)
     return TRUE;
 }
 
-int yesno(char *msg, char *s1, char *s2, char *help_anchor)
+/* ask the user of the given GraceApp (e.g., a batch worker's one) */
+int gapp_yesno(GraceApp *gapp,
+    char *msg, char *s1, char *s2, char *help_anchor)
 {
-    if (gapp->gui->noask) {
+    if (!gapp || gapp->gui->noask) {
 	return TRUE;
     }
 #ifdef NONE_GUI
@@ -391,6 +393,11 @@ int yesno(char *msg, char *s1, char *s2, char *help_anchor)
     }
 #endif
 }
+
+int yesno(char *msg, char *s1, char *s2, char *help_anchor)
+{
+    return gapp_yesno(gapp, msg, s1, s2, help_anchor);
+}
  
 void stufftext(char *s)
 {
@@ -65,6 +65,8 @@ void echomsg(char *msg);
 void stufftext(char *msg);
 
 int yesnoterm(char *msg);
+int gapp_yesno(GraceApp *gapp,
+    char *msg, char *s1, char *s2, char *help_anchor);
 int yesno(char *msg, char *s1, char *s2, char *help_anchor);
 
 char *mybasename(const char *s);
@@ -70,6 +70,9 @@ typedef struct {
 
     x11color *colors;
     unsigned int ncolors;
+    
+    int clipped;                /* drawing restricted to the update region */
+    XRectangle cliprect;
 } X11_data;
 
 static X11_data *x11_data_new(void)
@@ -102,6 +105,20 @@ static void VPoint2XPoint(const X11_data *x11data, const VPoint *vp, XPoint *xp)
     xp->y = (short) rint(x11data->height - x11data->page_scale*vp->y);
 }
 
+static void x11_setclip(X11_data *x11data)
+{
+    if (x11data->clipped) {
+        XSetClipRectangles(DisplayOfScreen(x11data->screen),
+            DefaultGCOfScreen(x11data->screen), 0, 0,
+            &x11data->cliprect, 1, Unsorted);
+    } else {
+        XSetClipMask(DisplayOfScreen(x11data->screen),
+            DefaultGCOfScreen(x11data->screen), None);
+        XSetClipOrigin(DisplayOfScreen(x11data->screen),
+            DefaultGCOfScreen(x11data->screen), 0, 0);
+    }
+}
+
 static void x11_initcmap(const Canvas *canvas, X11_data *x11data)
 {
     unsigned int i;
@@ -154,6 +171,7 @@ static int x11_initgraphics(const Canvas *canvas, void *data,
 {
     X11_data *x11data = (X11_data *) data;
     X11stream *xstream;
+    view v;
 
     Page_geometry *pg = get_page_geometry(canvas);
 
@@ -185,6 +203,26 @@ static int x11_initgraphics(const Canvas *canvas, void *data,
 
     x11_initcmap(canvas, x11data);
     
+    /* on a partial redraw, keep the rest of the pixmap intact */
+    x11data->clipped = canvas_get_update_region(canvas, &v);
+    if (x11data->clipped) {
+        VPoint vp;
+        XPoint xp1, xp2;
+        
+        vp.x = v.xv1;
+        vp.y = v.yv2;
+        VPoint2XPoint(x11data, &vp, &xp1);
+        vp.x = v.xv2;
+        vp.y = v.yv1;
+        VPoint2XPoint(x11data, &vp, &xp2);
+        
+        x11data->cliprect.x      = xp1.x - 1;
+        x11data->cliprect.y      = xp1.y - 1;
+        x11data->cliprect.width  = xp2.x - xp1.x + 3;
+        x11data->cliprect.height = xp2.y - xp1.y + 3;
+    }
+    x11_setclip(x11data);
+    
     return RETURN_SUCCESS;
 }
 
@@ -464,6 +502,14 @@ static void x11_putpixmap(const Canvas *canvas, void *data,
     int cindex, fg, bg;
     
     VPoint2XPoint(x11data, vp, &xp);
+    
+    if (x11data->clipped &&
+        (xp.x >= x11data->cliprect.x + x11data->cliprect.width  ||
+         xp.y >= x11data->cliprect.y + x11data->cliprect.height ||
+         xp.x + (int) pm->width  <= x11data->cliprect.x ||
+         xp.y + (int) pm->height <= x11data->cliprect.y)) {
+        return;
+    }
       
     if (pm->bpp != 1) {
         unsigned int *cptr = (unsigned int *) pm->bits;
@@ -567,14 +613,19 @@ static void x11_putpixmap(const Canvas *canvas, void *data,
     if (pm->type == PIXMAP_TRANSPARENT) {
         XFreePixmap(DisplayOfScreen(x11data->screen), clipmask);
         clipmask = 0;
-        XSetClipMask(DisplayOfScreen(x11data->screen), DefaultGCOfScreen(x11data->screen), None);
-        XSetClipOrigin(DisplayOfScreen(x11data->screen), DefaultGCOfScreen(x11data->screen), 0, 0);
+        x11_setclip(x11data);
     }    
 }
 
 static void x11_leavegraphics(const Canvas *canvas, void *data, 
     const CanvasStats *cstats)
 {
+    X11_data *x11data = (X11_data *) data;
+    
+    if (x11data->clipped) {
+        x11data->clipped = FALSE;
+        x11_setclip(x11data);
+    }
 }
 
 int register_x11_drv(Canvas *canvas)
@@ -38,6 +38,7 @@
 
 #include "defines.h"
 #include "core_utils.h"
+#include "grace/plot.h"
 #include "motifinc.h"
 
 #ifdef QT_GUI
@@ -83,6 +84,10 @@ struct _X11Stuff {
     
     double dpi;
 
+    /* the rendered page, updated incrementally */
+    Pixmap pagepixmap;
+    PageCache *pagecache;
+    /* the page plus the interactive overlays, as shown in the window */
     Pixmap bufpixmap;
 
     unsigned int win_h;
@@ -276,7 +281,8 @@ void aux_XDrawLine(GUI *gui, int x1, int y1, int x2, int y2);
 void aux_XDrawRectangle(GUI *gui, int x1, int y1, int x2, int y2);
 void aux_XFillRectangle(GUI *gui, int x, int y, unsigned int width, unsigned int height);
 
-void xdrawgrid(X11Stuff *xstuff);
+void xdrawgrid(X11Stuff *xstuff, const view *v);
+void xdrawpage(X11Stuff *xstuff);
 void init_xstream(X11stream *xstream);
 
 void create_pixmap(unsigned int w, unsigned int h);
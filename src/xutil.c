@@ -51,8 +51,14 @@ extern XtAppContext app_con;
 extern Input_buffer *ib_tbl;
 extern int ib_tblsize;
 
+/* minimal interval between redraws caused by real-time input, ms */
+#define RTI_REDRAW_INTERVAL 40
+
 static GC gcxor;
 
+static XtIntervalId rti_redraw_id = (XtIntervalId) 0;
+static unsigned int rti_redraw_stamp = 0;
+
 int x11_get_pixelsize(const GUI *gui)
 {
     Screen *screen = DefaultScreenOfDisplay(gui->xstuff->disp);
@@ -243,7 +249,10 @@ void expose_resize(Widget w, XtPointer client_data, XtPointer call_data)
 }
 
     
-void xdrawgrid(X11Stuff *xstuff)
+/*
+ * draw the page background grid within v (if valid) or all over the page
+ */
+void xdrawgrid(X11Stuff *xstuff, const view *v)
 {
     int i, j;
     double step;
@@ -251,9 +260,19 @@ void xdrawgrid(X11Stuff *xstuff)
     unsigned long black = BlackPixel(xstuff->disp, xstuff->screennumber);
     unsigned long white = WhitePixel(xstuff->disp, xstuff->screennumber);
     
+    if (v && is_valid_bbox(v)) {
+        XRectangle rect;
+        
+        rect.x      = (short) rint(xstuff->win_scale*v->xv1) - 1;
+        rect.y      = (short) rint(xstuff->win_h - xstuff->win_scale*v->yv2) - 1;
+        rect.width  = (unsigned short) rint(xstuff->win_scale*(v->xv2 - v->xv1)) + 3;
+        rect.height = (unsigned short) rint(xstuff->win_scale*(v->yv2 - v->yv1)) + 3;
+        XSetClipRectangles(xstuff->disp, xstuff->gc, 0, 0, &rect, 1, Unsorted);
+    }
+    
     XSetForeground(xstuff->disp, xstuff->gc, white);
     XSetFillStyle(xstuff->disp, xstuff->gc, FillSolid);
-    XFillRectangle(xstuff->disp, xstuff->bufpixmap, xstuff->gc, 0, 0, xstuff->win_w, xstuff->win_h);
+    XFillRectangle(xstuff->disp, xstuff->pagepixmap, xstuff->gc, 0, 0, xstuff->win_w, xstuff->win_h);
     XSetForeground(xstuff->disp, xstuff->gc, black);
     
     step = (double) (xstuff->win_scale)/10;
@@ -261,15 +280,27 @@ void xdrawgrid(X11Stuff *xstuff)
         for (j = 0; j < xstuff->win_h/step; j++) {
             xp.x = rint(i*step);
             xp.y = xstuff->win_h - rint(j*step);
-            XDrawPoint(xstuff->disp, xstuff->bufpixmap,
+            XDrawPoint(xstuff->disp, xstuff->pagepixmap,
                 xstuff->gc, xp.x, xp.y);
         }
     }
     
     XSetLineAttributes(xstuff->disp, xstuff->gc,
         1, LineSolid, CapButt, JoinMiter);
-    XDrawRectangle(xstuff->disp, xstuff->bufpixmap,
+    XDrawRectangle(xstuff->disp, xstuff->pagepixmap,
         xstuff->gc, 0, 0, xstuff->win_w - 1, xstuff->win_h - 1);
+    
+    XSetClipMask(xstuff->disp, xstuff->gc, None);
+}
+
+/*
+ * refresh the window buffer from the rendered page; overlays drawn on the
+ * buffer since are discarded
+ */
+void xdrawpage(X11Stuff *xstuff)
+{
+    XCopyArea(xstuff->disp, xstuff->pagepixmap, xstuff->bufpixmap, xstuff->gc,
+        0, 0, xstuff->win_w, xstuff->win_h, 0, 0);
 }
 
 void x11_redraw(Window window, int x, int y, int width, int height)
@@ -287,6 +318,18 @@ void x11_redraw_all()
     XFlush(xstuff->disp);
 }
 
+static void rti_redraw_proc(XtPointer client_data, XtIntervalId *id)
+{
+    Quark *project = gproject_get_top(gapp->gp);
+    
+    rti_redraw_id = (XtIntervalId) 0;
+    
+    if (project && quark_get_statestamp(project) != rti_redraw_stamp) {
+        xdrawgraph(gapp->gp);
+        rti_redraw_stamp = quark_get_statestamp(project);
+    }
+}
+
 static void xmonitor_rti(XtPointer ib, int *ptrFd, XtInputId *ptrId)
 {
     set_wait_cursor();
@@ -294,6 +337,12 @@ static void xmonitor_rti(XtPointer ib, int *ptrFd, XtInputId *ptrId)
     monitor_input(gapp, (Input_buffer *) ib, 1, 1);
     
     unset_wait_cursor();
+    
+    /* coalesce the redraws of a stream to a fixed frame rate */
+    if (rti_redraw_id == (XtIntervalId) 0) {
+        rti_redraw_id = XtAppAddTimeOut(app_con, RTI_REDRAW_INTERVAL,
+            rti_redraw_proc, NULL);
+    }
 }
 
 void xregister_rti(Input_buffer *ib)
@@ -525,13 +574,14 @@ void init_xstream(X11stream *xstream)
     X11Stuff *xstuff = gapp->gui->xstuff;
 
     xstream->screen = DefaultScreenOfDisplay(xstuff->disp);
-    xstream->pixmap = xstuff->bufpixmap;
+    xstream->pixmap = xstuff->pagepixmap;
 }
 
 void create_pixmap(unsigned int w, unsigned int h)
 {
     X11Stuff *xstuff = gapp->gui->xstuff;
 
+    xstuff->pagepixmap = XCreatePixmap(xstuff->disp, xstuff->root, w, h, xstuff->depth);
     xstuff->bufpixmap = XCreatePixmap(xstuff->disp, xstuff->root, w, h, xstuff->depth);
 }
 
@@ -539,6 +589,7 @@ void recreate_pixmap(unsigned int w, unsigned int h)
 {
     X11Stuff *xstuff = gapp->gui->xstuff;
 
+    XFreePixmap(xstuff->disp, xstuff->pagepixmap);
     XFreePixmap(xstuff->disp, xstuff->bufpixmap);
     create_pixmap(w, h);
 }
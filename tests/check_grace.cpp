@@ -1,7 +1,11 @@
 extern "C" {
+#include <grace/canvasP.h>
 #include <grace/grace.h>
+#include <grace/plotP.h>
 }
 
+#include <algorithm>
+#include <cmath>
 #include <gtest/gtest.h>
 
 void errmsg(const char *msg)
@@ -65,3 +69,739 @@ TEST(ColorsMergeTest, ThereAreNoDuplicateColors) {
     qfactory_free(qfactory);
 }
 
+
+TEST(CTransTest, ColumnsMatchPointwiseTransform) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    frame_qf_register(qfactory);
+    graph_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *gr = graph_new(frame_new(pr));
+    ASSERT_TRUE(gr != NULL);
+
+    world w = {0.1, 100.0, 0.01, 0.99};
+    double x[64], y[64];
+    VPoint vps[64];
+    for (int i = 0; i < 64; i++) {
+        x[i] = (i - 8)*1.7;
+        y[i] = i/63.0;
+    }
+
+    for (int xscale = SCALE_NORMAL; xscale <= SCALE_REC; xscale++) {
+        for (int yscale = SCALE_NORMAL; yscale <= SCALE_LOGIT; yscale++) {
+            graph_set_xscale(gr, xscale);
+            graph_set_yscale(gr, yscale);
+            graph_set_world(gr, &w);
+            update_graph_ccache(gr);
+
+            ASSERT_EQ(RETURN_SUCCESS, Wcols2Vpoints(gr, x, y, 64, vps));
+            for (int i = 0; i < 64; i++) {
+                WPoint wp = {x[i], y[i]};
+                VPoint vp;
+                Wpoint2Vpoint(gr, &wp, &vp);
+                EXPECT_DOUBLE_EQ(vp.x, vps[i].x);
+                EXPECT_DOUBLE_EQ(vp.y, vps[i].y);
+            }
+        }
+    }
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(LODTest, DecimationKeepsPixelColumnEnvelope) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *ss = ssd_new(pr);
+    const unsigned int n = 10000, nedges = 11;
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 2, NULL));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, n));
+
+    double *x = (double *) ssd_get_col(ss, 0)->data;
+    double *y = (double *) ssd_get_col(ss, 1)->data;
+    for (unsigned int i = 0; i < n; i++) {
+        x[i] = i/2;
+        y[i] = ((i*7919) % 1000)/1000.0;
+    }
+    double xedges[nedges];
+    for (unsigned int i = 0; i < nedges; i++) {
+        xedges[i] = 1000.5 + 300*i;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        unsigned int *ind, nind;
+        ASSERT_EQ(RETURN_SUCCESS,
+            ssd_get_lod_indices(ss, 0, 1, xedges, nedges, &ind, &nind));
+        ASSERT_LE(nind, 4*(nedges - 1) + 2);
+        for (unsigned int k = 1; k < nind; k++) {
+            EXPECT_LT(ind[k - 1], ind[k]);
+        }
+        for (unsigned int b = 0; b < nedges - 1; b++) {
+            double ymin = 1e300, ymax = -1e300, lmin = 1e300, lmax = -1e300;
+            for (unsigned int i = 0; i < n; i++) {
+                if (x[i] >= xedges[b] && x[i] < xedges[b + 1]) {
+                    ymin = std::min(ymin, y[i]);
+                    ymax = std::max(ymax, y[i]);
+                }
+            }
+            for (unsigned int k = 0; k < nind; k++) {
+                double xi = x[ind[k]];
+                if (xi >= xedges[b] && xi < xedges[b + 1]) {
+                    lmin = std::min(lmin, y[ind[k]]);
+                    lmax = std::max(lmax, y[ind[k]]);
+                }
+            }
+            EXPECT_EQ(ymin, lmin);
+            EXPECT_EQ(ymax, lmax);
+        }
+        xfree(ind);
+
+        /* the cached pyramid must follow data changes; row 4600 lies
+           inside a full bucket, not in the directly scanned ends of a bin */
+        ssd_set_value(ss, 4600, 1, 10.0);
+        quark_dirtystate_set(ss, TRUE);
+    }
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+static int lod_polyline_points;
+
+static void lod_drawpolyline(const Canvas *canvas, void *data,
+    const VPoint *vps, int n, int mode)
+{
+    lod_polyline_points += n;
+}
+
+TEST(LODTest, OnlyRasterDevicesGetDecimatedLines) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    frame_qf_register(qfactory);
+    graph_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    set_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *gr = graph_new(frame_new(pr));
+    Quark *ss = ssd_new(gr);
+    const int n = 10000;
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 2, NULL));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, n));
+    double *x = (double *) ssd_get_col(ss, 0)->data;
+    double *y = (double *) ssd_get_col(ss, 1)->data;
+    for (int i = 0; i < n; i++) {
+        x[i] = i;
+        y[i] = ((i*7919) % 1000)/1000.0;
+    }
+    quark_dirtystate_set(ss, TRUE);
+
+    Quark *pset = set_new(ss);
+    ASSERT_EQ(RETURN_SUCCESS, set_set_type(pset, SET_XY));
+    Dataset ds = *set_get_dataset(pset);
+    ds.cols[DATA_X] = 0;
+    ds.cols[DATA_Y] = 1;
+    ASSERT_EQ(RETURN_SUCCESS, set_set_dataset(pset, &ds));
+    set_get_data(pset)->line.type = LINE_TYPE_STRAIGHT;
+
+    world w = {0.0, n - 1.0, 0.0, 1.0};
+    graph_set_world(gr, &w);
+    update_graph_ccache(gr);
+
+    Canvas *canvas = canvas_new();
+    Page_geometry pg = {200, 200, 72.0};
+    Device_entry *vdev = device_new("Vector", DEVICE_FILE, FALSE, NULL, NULL);
+    Device_entry *rdev = device_new("Raster", DEVICE_TERM, FALSE, NULL, NULL);
+    device_set_procs(vdev, NULL, NULL, NULL, NULL, NULL,
+        lod_drawpolyline, NULL, NULL, NULL, NULL, NULL);
+    device_set_procs(rdev, NULL, NULL, NULL, NULL, NULL,
+        lod_drawpolyline, NULL, NULL, NULL, NULL, NULL);
+    int vindex = register_device(canvas, vdev);
+    int rindex = register_device(canvas, rdev);
+    set_draw_mode(canvas, TRUE);
+    view v;
+    graph_get_viewport(gr, &v);
+    canvas_set_clipview(canvas, &v);
+
+    plot_rt_t plot_rt;
+    memset(&plot_rt, 0, sizeof(plot_rt));
+    plot_rt.canvas = canvas;
+
+    /* a vector device gets every point of the set */
+    ASSERT_EQ(RETURN_SUCCESS, select_device(canvas, vindex));
+    ASSERT_EQ(RETURN_SUCCESS, set_page_geometry(canvas, &pg));
+    lod_polyline_points = 0;
+    drawsetline(pset, &plot_rt);
+    EXPECT_EQ(n, lod_polyline_points);
+
+    /* a raster one gets at most four per pixel column */
+    ASSERT_EQ(RETURN_SUCCESS, select_device(canvas, rindex));
+    ASSERT_EQ(RETURN_SUCCESS, set_page_geometry(canvas, &pg));
+    lod_polyline_points = 0;
+    drawsetline(pset, &plot_rt);
+    EXPECT_GT(lod_polyline_points, 0);
+    EXPECT_LE(lod_polyline_points, 4*(200 + 2));
+
+    canvas_free(canvas);
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(SSDTest, ColumnStatsFollowData) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *ss = ssd_new(pr);
+    const unsigned int n = 100;
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 1, NULL));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, n));
+
+    for (unsigned int i = 0; i < n; i++) {
+        ssd_set_value(ss, i, 0, 0.25*i);
+    }
+    quark_dirtystate_set(ss, TRUE);
+    const ss_colstats *st = ssd_get_col_stats(ss, 0);
+    ASSERT_TRUE(st != NULL);
+    EXPECT_EQ(0.0, st->min);
+    EXPECT_EQ(0.25*(n - 1), st->max);
+    EXPECT_EQ(1, st->smono);
+    EXPECT_TRUE(st->monospaced);
+    EXPECT_EQ(0.25, st->spacing);
+
+    ssd_set_value(ss, 10, 0, -1.0);
+    quark_dirtystate_set(ss, TRUE);
+    st = ssd_get_col_stats(ss, 0);
+    EXPECT_EQ(-1.0, st->min);
+    EXPECT_EQ(10U, st->imin);
+    EXPECT_EQ(0, st->mono);
+    EXPECT_FALSE(st->monospaced);
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(DSortTest, NaNsGoLastWhateverTheirSign) {
+    const double keys[6] = {-NAN, 2.0, NAN, -INFINITY, INFINITY, -1.0};
+    unsigned int ind[6];
+
+    ASSERT_EQ(RETURN_SUCCESS, dsort_index(keys, 6, FALSE, ind));
+    const unsigned int ascending[6] = {3, 5, 1, 4, 0, 2};
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(ascending[i], ind[i]);
+    }
+
+    ASSERT_EQ(RETURN_SUCCESS, dsort_index(keys, 6, TRUE, ind));
+    const unsigned int descending[6] = {0, 2, 4, 1, 5, 3};
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(descending[i], ind[i]);
+    }
+}
+
+TEST(SSDTest, SortKeepsRowsTogether) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *ss = ssd_new(pr);
+    const int formats[2] = {FFORMAT_NUMBER, FFORMAT_STRING};
+    const double keys[5] = {3.0, 1.0, 2.0, 1.0, -0.5};
+    const char *labels[5] = {"a", "b", "c", "d", "e"};
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 2, formats));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, 5));
+
+    for (int i = 0; i < 5; i++) {
+        ssd_set_value(ss, i, 0, keys[i]);
+        ssd_set_string(ss, i, 1, labels[i]);
+    }
+    ASSERT_EQ(RETURN_SUCCESS, ssd_sort(ss, 0, FALSE));
+    EXPECT_EQ(RETURN_FAILURE, ssd_sort(ss, 1, FALSE));
+
+    double *x = (double *) ssd_get_col(ss, 0)->data;
+    char **s = (char **) ssd_get_col(ss, 1)->data;
+    const double sorted[5] = {-0.5, 1.0, 1.0, 2.0, 3.0};
+    const char *order = "ebdca";
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(sorted[i], x[i]);
+        EXPECT_EQ(order[i], s[i][0]);
+    }
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(SSDTest, CompactRowsKeepsColumnsAligned) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *ss = ssd_new(pr);
+    const int formats[3] = {FFORMAT_NUMBER, FFORMAT_STRING, FFORMAT_NUMBER};
+    const char *labels[6] = {"a", "b", "c", "d", "e", "f"};
+    const char keep[6] = {0, 1, 1, 0, 0, 1};
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 3, formats));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, 6));
+
+    for (int i = 0; i < 6; i++) {
+        ssd_set_value(ss, i, 0, i);
+        ssd_set_string(ss, i, 1, labels[i]);
+        ssd_set_value(ss, i, 2, -i);
+    }
+    ASSERT_EQ(RETURN_SUCCESS, ssd_compact_rows(ss, keep));
+    ASSERT_EQ(3U, ssd_get_nrows(ss));
+
+    double *x = (double *) ssd_get_col(ss, 0)->data;
+    char **s = (char **) ssd_get_col(ss, 1)->data;
+    double *z = (double *) ssd_get_col(ss, 2)->data;
+    const char *kept = "bcf";
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(kept[i], s[i][0]);
+        EXPECT_EQ(kept[i] - 'a', x[i]);
+        EXPECT_EQ(-x[i], z[i]);
+    }
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(SSDTest, MappedColumnsLoadOnAccess) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *pr2 = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *ss = ssd_new(pr);
+    const int formats[1] = {FFORMAT_STRING};
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 1, formats));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, 4));
+    ASSERT_TRUE(ssd_add_col_unloaded(ss) != NULL);
+    ASSERT_TRUE(ssd_add_col_unloaded(ss) != NULL);
+
+    /* the block holds little-endian doubles */
+    unsigned char block[4*8];
+    for (int i = 0; i < 4; i++) {
+        double v = 1.5*i;
+        uint64_t bits;
+        memcpy(&bits, &v, 8);
+        for (int k = 0; k < 8; k++) {
+            block[8*i + k] = (bits >> 8*k) & 0xff;
+        }
+    }
+    EXPECT_EQ(RETURN_FAILURE, ssd_set_col_mapped(ss, 0, block));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_col_mapped(ss, 1, block));
+
+    ss_data *ssd = ssd_get_data(ss);
+    EXPECT_TRUE(ssd->cols[1].mapped == block);
+    EXPECT_TRUE(ssd->cols[1].data == NULL);
+    EXPECT_TRUE(ssd->cols[2].data == NULL);
+
+    /* the data are copied, not referenced, once accessed */
+    double *x = (double *) ssd_get_col(ss, 1)->data;
+    ASSERT_TRUE(x != NULL);
+    EXPECT_TRUE(ssd->cols[1].mapped == NULL);
+    memset(block, 0, sizeof(block));
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(1.5*i, x[i]);
+    }
+    /* an unloaded column not backed by a block reads as zeros */
+    EXPECT_TRUE(ssd->cols[2].data == NULL);
+    ASSERT_EQ(RETURN_SUCCESS, ssd_fetch_data(ss));
+    EXPECT_EQ(0.0, ((double *) ssd->cols[2].data)[3]);
+
+    /* moving to another project leaves no column backed by the block */
+    Quark *ss2 = ssd_new(pr);
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss2, 2));
+    ASSERT_TRUE(ssd_add_col_unloaded(ss2) != NULL);
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_col_mapped(ss2, 0, block));
+    ASSERT_EQ(RETURN_SUCCESS, quark_reparent(ss2, pr2));
+    EXPECT_TRUE(ssd_get_data(ss2)->cols[0].mapped == NULL);
+    EXPECT_TRUE(ssd_get_data(ss2)->cols[0].data != NULL);
+
+    quark_free(pr2);
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(QuarkTest, OwnStampIgnoresDescendants) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    frame_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *f1 = frame_new(pr);
+    Quark *f2 = frame_new(pr);
+    view v = {0.2, 0.8, 0.2, 0.8};
+
+    unsigned int prstamp = quark_get_ownstamp(pr);
+    unsigned int f1stamp = quark_get_statestamp(f1);
+    ASSERT_EQ(RETURN_SUCCESS, frame_set_view(f2, &v));
+    EXPECT_EQ(prstamp, quark_get_ownstamp(pr));
+    EXPECT_EQ(f1stamp, quark_get_statestamp(f1));
+    EXPECT_EQ(quark_get_statestamp(f2), quark_get_ownstamp(f2));
+    EXPECT_GT(quark_get_statestamp(pr), quark_get_statestamp(f2));
+
+    frame_new(pr);
+    EXPECT_NE(prstamp, quark_get_ownstamp(pr));
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(ParseTest, FloatIsCorrectlyRounded) {
+    const struct {
+        const char *s;
+        double v;
+    } cases[] = {
+        {"0.1", 0.1},
+        {" -2.5d-3", -2.5e-3},
+        {"1e23", 1e23},
+        {"9007199254740993", 9007199254740992.0},
+        {"2.2250738585072011e-308", 2.2250738585072011e-308},
+        {"4.9406564584124654e-324", 4.9406564584124654e-324},
+        {"0.30000000000000000000000000001", 0.3},
+        {"123456789012345678901234567890", 1.2345678901234568e29},
+        {"1.7976931348623157E308", 1.7976931348623157e308}
+    };
+    double v;
+    const char *after;
+
+    for (unsigned int i = 0; i < sizeof(cases)/sizeof(cases[0]); i++) {
+        ASSERT_EQ(RETURN_SUCCESS, parse_float(cases[i].s, &v, &after));
+        EXPECT_EQ(cases[i].v, v) << cases[i].s;
+        EXPECT_EQ('\0', *after);
+    }
+    EXPECT_EQ(RETURN_SUCCESS, parse_float("1.5,2", &v, &after));
+    EXPECT_EQ(1.5, v);
+    EXPECT_EQ(',', *after);
+    EXPECT_EQ(RETURN_FAILURE, parse_float("-.e1", &v, &after));
+}
+
+static int count_events_cb(Quark *q, int etype, void *data)
+{
+    int *counts = (int *) data;
+    counts[etype]++;
+    return TRUE;
+}
+
+TEST(QuarkTest, TransactionCoalescesEvents) {
+    QuarkFactory *qfactory = qfactory_new();
+    container_qf_register(qfactory);
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pc = container_new(qfactory, AMEM_MODEL_SIMPLE);
+    Quark *pr = project_new(pc, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *old = ssd_new(pr);
+    int counts[QUARK_ETYPE_COMMIT + 1] = {0};
+    quark_cb_add(pc, count_events_cb, counts);
+
+    quark_transaction_begin();
+    for (int i = 0; i < 50; i++) {
+        Quark *ss = ssd_new(pr);
+        ssd_set_ncols(ss, 1, NULL);
+        ssd_set_nrows(ss, 10);
+        if (i == 0) {
+            quark_free(ss);
+        }
+    }
+    quark_transaction_begin();
+    ssd_set_nrows(old, 5);
+    EXPECT_EQ(RETURN_SUCCESS, quark_transaction_commit());
+    quark_free(old);
+    EXPECT_TRUE(quark_transaction_active());
+    EXPECT_EQ(0, counts[QUARK_ETYPE_NEW]);
+    EXPECT_EQ(0, counts[QUARK_ETYPE_MODIFY]);
+    EXPECT_EQ(1, counts[QUARK_ETYPE_DELETE]);
+    EXPECT_EQ(RETURN_SUCCESS, quark_transaction_commit());
+    EXPECT_FALSE(quark_transaction_active());
+
+    EXPECT_EQ(49, counts[QUARK_ETYPE_NEW]);
+    EXPECT_EQ(1, counts[QUARK_ETYPE_MODIFY]);
+    EXPECT_EQ(1, counts[QUARK_ETYPE_DELETE]);
+    EXPECT_EQ(0, counts[QUARK_ETYPE_MOVE]);
+    EXPECT_EQ(1, counts[QUARK_ETYPE_COMMIT]);
+    EXPECT_EQ(RETURN_FAILURE, quark_transaction_commit());
+
+    quark_free(pc);
+    qfactory_free(qfactory);
+}
+
+struct NewOrder {
+    Quark *seen[8];
+    int nseen;
+    int orphans;
+};
+
+static int new_order_cb(Quark *q, int etype, void *data)
+{
+    NewOrder *o = (NewOrder *) data;
+    if (etype == QUARK_ETYPE_NEW) {
+        Quark *parent = quark_parent_get(q);
+        bool known = (quark_parent_get(parent) == NULL);
+        for (int i = 0; i < o->nseen; i++) {
+            known = known || o->seen[i] == parent;
+        }
+        if (!known) {
+            o->orphans++;
+        }
+        o->seen[o->nseen++] = q;
+    }
+    return TRUE;
+}
+
+TEST(QuarkTest, TransactionMovedNewFollowsParent) {
+    QuarkFactory *qfactory = qfactory_new();
+    container_qf_register(qfactory);
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pc = container_new(qfactory, AMEM_MODEL_SIMPLE);
+    NewOrder o = {{NULL}, 0, 0};
+    quark_cb_add(pc, new_order_cb, &o);
+
+    quark_transaction_begin();
+    Quark *pa = project_new(pc, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *ss = ssd_new(pa);
+    Quark *pb = project_new(pc, qfactory, AMEM_MODEL_SIMPLE);
+    /* a new quark moved under a parent created after it */
+    EXPECT_EQ(RETURN_SUCCESS, quark_reparent(pa, pb));
+    EXPECT_EQ(RETURN_SUCCESS, quark_transaction_commit());
+
+    EXPECT_EQ(3, o.nseen);
+    EXPECT_EQ(0, o.orphans);
+    EXPECT_EQ(pb, o.seen[0]);
+    EXPECT_EQ(pa, o.seen[1]);
+    EXPECT_EQ(ss, o.seen[2]);
+
+    quark_free(pc);
+    qfactory_free(qfactory);
+}
+
+TEST(RegionTest, BatchContainmentMatchesPointwise) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    region_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_SIMPLE);
+    Quark *r = region_new(pr);
+    const unsigned int n = 5000;
+    double x[n], y[n];
+    char flags[n];
+
+    region_set_type(r, REGION_POLYGON);
+    /* a concave polygon with vertices and horizontal edges on the grid */
+    const double vx[8] = {0, 6, 6, 2, 2, 6, 6, 0};
+    const double vy[8] = {0, 0, 2, 2, 4, 4, 6, 6};
+    for (int k = 0; k < 8; k++) {
+        WPoint wp = {vx[k], vy[k]};
+        region_add_point(r, &wp);
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        x[i] = 0.5*(i % 17) - 1.0;
+        y[i] = 0.5*(i / 17 % 17) - 1.0;
+    }
+
+    ASSERT_EQ(RETURN_SUCCESS, region_contains_points(r, x, y, n, flags));
+    for (unsigned int i = 0; i < n; i++) {
+        WPoint wp = {x[i], y[i]};
+        EXPECT_EQ(region_contains(r, &wp), flags[i]) << x[i] << "," << y[i];
+    }
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(StorageTest, IndexFollowsEdits) {
+    AMem *amem = amem_amem_new(AMEM_MODEL_SIMPLE);
+    Storage *sto = storage_new(amem, NULL, NULL, NULL);
+    static int items[100];
+    void *data;
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(RETURN_SUCCESS, storage_add(sto, &items[i]));
+    }
+    ASSERT_EQ(RETURN_SUCCESS, storage_insert(sto, &items[99], 0));
+    ASSERT_EQ(RETURN_SUCCESS, storage_delete_by_id(sto, 100));
+    ASSERT_EQ(RETURN_SUCCESS, storage_extract_data(sto, &items[50]));
+    ASSERT_EQ(RETURN_SUCCESS, storage_data_swap(sto, 1, 2));
+    EXPECT_EQ(99, storage_count(sto));
+
+    ASSERT_EQ(RETURN_SUCCESS, storage_get_data_by_id(sto, 0, &data));
+    EXPECT_EQ(&items[99], data);
+    ASSERT_EQ(RETURN_SUCCESS, storage_get_data_by_id(sto, 1, &data));
+    EXPECT_EQ(&items[1], data);
+    ASSERT_EQ(RETURN_SUCCESS, storage_scroll_to_data(sto, &items[0]));
+    EXPECT_EQ(2, storage_get_id(sto));
+    ASSERT_EQ(RETURN_SUCCESS, storage_scroll_to_data(sto, &items[51]));
+    EXPECT_EQ(51, storage_get_id(sto));
+    EXPECT_FALSE(storage_data_exists(sto, &items[50]));
+
+    storage_free(sto);
+    amem_amem_free(amem);
+}
+
+TEST(AMemTest, CowUndoRestoresModifiedBlocks) {
+    AMem *amem = amem_amem_new(AMEM_MODEL_COW);
+    double *col1 = (double *) amem_calloc(amem, 1000, sizeof(double));
+    double *col2 = (double *) amem_calloc(amem, 1000, sizeof(double));
+    char *s;
+
+    const size_t colsize = 1000*sizeof(double);
+
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    EXPECT_EQ(2*colsize, amem_get_history_size(amem));
+    col1[10] = 1.0;
+    amem_touch(amem, col1);
+    s = amem_strdup(amem, "label");
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    /* the unchanged col2 is shared with the previous version */
+    EXPECT_EQ(3*colsize + 6, amem_get_history_size(amem));
+    amem_free(amem, col2);
+    col1[10] = 2.0;
+    amem_touch(amem, col1);
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    EXPECT_EQ(4*colsize + 6, amem_get_history_size(amem));
+    EXPECT_EQ(2u, amem_get_undo_count(amem));
+
+    ASSERT_EQ(RETURN_SUCCESS, amem_undo(amem));
+    EXPECT_EQ(1.0, col1[10]);
+    EXPECT_EQ(0.0, col2[999]);
+    EXPECT_STREQ("label", s);
+    ASSERT_EQ(RETURN_SUCCESS, amem_undo(amem));
+    EXPECT_EQ(0.0, col1[10]);
+    EXPECT_EQ(RETURN_FAILURE, amem_undo(amem));
+    EXPECT_EQ(2u, amem_get_redo_count(amem));
+
+    ASSERT_EQ(RETURN_SUCCESS, amem_redo(amem));
+    EXPECT_EQ(1.0, col1[10]);
+    col2[0] = 5.0;
+    amem_touch(amem, col2);
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    EXPECT_EQ(0u, amem_get_redo_count(amem));
+    EXPECT_EQ(2u, amem_get_undo_count(amem));
+
+    amem_amem_free(amem);
+}
+
+TEST(AMemTest, CowRecordsQuarkChanges) {
+    QuarkFactory *qfactory = qfactory_new();
+    project_qf_register(qfactory);
+    ssd_qf_register(qfactory);
+    Quark *pr = project_new(NULL, qfactory, AMEM_MODEL_COW);
+    AMem *amem = quark_get_amem(pr);
+    Quark *ss = ssd_new(pr);
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_ncols(ss, 2, NULL));
+    ASSERT_EQ(RETURN_SUCCESS, ssd_set_nrows(ss, 1000));
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    size_t size0 = amem_get_history_size(amem);
+
+    /* a modified quark marks its (large) blocks for the snapshot */
+    ssd_set_value(ss, 500, 1, 3.0);
+    quark_dirtystate_set(ss, TRUE);
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    size_t size1 = amem_get_history_size(amem);
+    EXPECT_GE(size1 - size0, 1000*sizeof(double));
+    EXPECT_LT(size1 - size0, 2*1000*sizeof(double));
+
+    ASSERT_EQ(RETURN_SUCCESS, amem_undo(amem));
+    EXPECT_EQ(0.0, ((double *) ssd_get_col(ss, 1)->data)[500]);
+    ASSERT_EQ(RETURN_SUCCESS, amem_redo(amem));
+    EXPECT_EQ(3.0, ((double *) ssd_get_col(ss, 1)->data)[500]);
+
+    quark_free(pr);
+    qfactory_free(qfactory);
+}
+
+TEST(AMemTest, CowUndoesStorageEdits) {
+    AMem *amem = amem_amem_new(AMEM_MODEL_COW);
+    Storage *sto = storage_new(amem, NULL, NULL, NULL);
+    static int items[41];
+    void *data;
+
+    for (int i = 0; i < 40; i++) {
+        ASSERT_EQ(RETURN_SUCCESS, storage_add(sto, &items[i]));
+    }
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    ASSERT_EQ(RETURN_SUCCESS, storage_delete_by_id(sto, 0));
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+    ASSERT_EQ(RETURN_SUCCESS, storage_insert(sto, &items[40], 10));
+    ASSERT_EQ(RETURN_SUCCESS, amem_snapshot(amem));
+
+    /* before the insertion */
+    ASSERT_EQ(RETURN_SUCCESS, amem_undo(amem));
+    ASSERT_EQ(39, storage_count(sto));
+    for (int i = 0; i < 39; i++) {
+        ASSERT_EQ(RETURN_SUCCESS, storage_get_data_by_id(sto, i, &data));
+        EXPECT_EQ(&items[i + 1], data);
+    }
+    EXPECT_FALSE(storage_data_exists(sto, &items[40]));
+
+    /* before the deletion */
+    ASSERT_EQ(RETURN_SUCCESS, amem_undo(amem));
+    ASSERT_EQ(40, storage_count(sto));
+    for (int i = 0; i < 40; i++) {
+        ASSERT_EQ(RETURN_SUCCESS, storage_get_data_by_id(sto, i, &data));
+        EXPECT_EQ(&items[i], data);
+        ASSERT_EQ(RETURN_SUCCESS, storage_scroll_to_data(sto, &items[i]));
+        EXPECT_EQ(i, storage_get_id(sto));
+    }
+
+    ASSERT_EQ(RETURN_SUCCESS, amem_redo(amem));
+    ASSERT_EQ(RETURN_SUCCESS, amem_redo(amem));
+    ASSERT_EQ(40, storage_count(sto));
+    ASSERT_EQ(RETURN_SUCCESS, storage_get_data_by_id(sto, 10, &data));
+    EXPECT_EQ(&items[40], data);
+    ASSERT_EQ(RETURN_SUCCESS, storage_scroll_to_data(sto, &items[11]));
+    EXPECT_EQ(11, storage_get_id(sto));
+
+    storage_free(sto);
+    amem_amem_free(amem);
+}
+
+TEST(GraalTest, ComparisonsWorkElementWise) {
+    Graal *g = graal_new();
+    DArray *v = darray_new(5);
+    DArray *res = darray_new(5);
+    for (unsigned int i = 0; i < 5; i++) {
+        darray_set_val(v, i, (double) i - 2);
+    }
+    ASSERT_EQ(RETURN_SUCCESS, gvar_set_arr(graal_get_var(g, "$v", TRUE), v));
+
+    const double or_mask[5] = {1, 0, 0, 1, 1};
+    ASSERT_EQ(RETURN_SUCCESS,
+        graal_transform_arr(g, "$v > 0 || $v == -2", "$t", res, NULL));
+    for (unsigned int i = 0; i < 5; i++) {
+        EXPECT_EQ(or_mask[i], res->x[i]);
+    }
+
+    const double and_mask[5] = {1, 0, 0, 0, 0};
+    ASSERT_EQ(RETURN_SUCCESS,
+        graal_transform_arr(g, "!($v >= 0) && $v != -1", "$t", res, NULL));
+    for (unsigned int i = 0; i < 5; i++) {
+        EXPECT_EQ(and_mask[i], res->x[i]);
+    }
+
+    darray_free(res);
+    darray_free(v);
+    graal_free(g);
+}
+
+TEST(GraalTest, FailedTransformKeepsDestination) {
+    Graal *g = graal_new();
+    const unsigned int n = 1000;
+    DArray *v = darray_new(n);
+    DArray *res = darray_new(n);
+    for (unsigned int i = 0; i < n; i++) {
+        darray_set_val(v, i, (double) i - 900);
+        darray_set_val(res, i, 7.0);
+    }
+    ASSERT_EQ(RETURN_SUCCESS, gvar_set_arr(graal_get_var(g, "$v", TRUE), v));
+
+    /* the division by zero is met only in the last blocks of rows */
+    EXPECT_EQ(RETURN_FAILURE,
+        graal_transform_arr(g, "$v/$v", "$t", res, NULL));
+    for (unsigned int i = 0; i < n; i++) {
+        EXPECT_EQ(7.0, res->x[i]);
+    }
+
+    darray_free(res);
+    darray_free(v);
+    graal_free(g);
+}